@@ -0,0 +1,57 @@
+# Generates the deferred log table (grove_aqs_dlog_table.h) from the log sites in the sources.
+#
+# A log site is GROVE_AQS_LOGI/LOGW/LOGE(tag, NAME, "format", ...) with the format
+# as a single string literal. Each NAME becomes GROVE_AQS_DLOG_ID_NAME; IDs are
+# numbered in order of appearance, so the firmware and the host decoder get the
+# same numbering from the same sources. GROVE_AQS_DLOG_TABLE_HASH identifies the
+# table so the decoder can refuse a stream written by a different build.
+
+function(grove_aqs_dlog_generate_table out_file)
+    set(ws "[ \t\r\n]*")
+    set(site_regex "GROVE_AQS_LOG([EWI])\\(${ws}[A-Za-z_][A-Za-z0-9_]*${ws},${ws}([A-Z][A-Z0-9_]*)${ws},${ws}\"([^\"]*)\"")
+
+    set(names)
+    set(enum_lines)
+    set(site_lines)
+    set(all_sites)
+    foreach(src IN LISTS ARGN)
+        file(READ "${src}" content)
+        string(REGEX MATCHALL "${site_regex}" matches "${content}")
+        foreach(match IN LISTS matches)
+            string(REGEX MATCH "${site_regex}" unused "${match}")
+            set(level "${CMAKE_MATCH_1}")
+            set(name "${CMAKE_MATCH_2}")
+            set(format "${CMAKE_MATCH_3}")
+            list(FIND names "${name}" existing)
+            if(NOT existing EQUAL -1)
+                message(FATAL_ERROR "Deferred log site ${name} is defined twice (${src})")
+            endif()
+            list(LENGTH names id)
+            list(APPEND names "${name}")
+            string(APPEND enum_lines "    GROVE_AQS_DLOG_ID_${name} = ${id},\n")
+            string(APPEND site_lines "    { '${level}', \"${name}\", \"${format}\" },\n")
+            string(APPEND all_sites "${level}${name}${format}\n")
+        endforeach()
+    endforeach()
+
+    string(MD5 digest "${all_sites}")
+    string(SUBSTRING "${digest}" 0 8 hash)
+
+    set(text "/* Generated by cmake/grove_aqs_dlog_table.cmake from the GROVE_AQS_LOGx sites - do not edit */\n\n")
+    string(APPEND text "#ifndef GROVE_AQS_DLOG_TABLE_H\n#define GROVE_AQS_DLOG_TABLE_H\n\n")
+    string(APPEND text "#define GROVE_AQS_DLOG_TABLE_HASH 0x${hash}u\n\n")
+    string(APPEND text "enum {\n${enum_lines}    GROVE_AQS_DLOG_ID_COUNT\n};\n\n")
+    string(APPEND text "#ifdef GROVE_AQS_DLOG_TABLE_STRINGS\n")
+    string(APPEND text "static const grove_aqs_dlog_site_t grove_aqs_dlog_sites[] = {\n${site_lines}};\n")
+    string(APPEND text "#endif\n\n#endif /* GROVE_AQS_DLOG_TABLE_H */\n")
+
+    # Only touch the file when the table changed, so unrelated edits don't rebuild everything
+    if(EXISTS "${out_file}")
+        file(READ "${out_file}" old_text)
+    endif()
+    if(NOT "${text}" STREQUAL "${old_text}")
+        file(WRITE "${out_file}" "${text}")
+    endif()
+
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${ARGN})
+endfunction()
@@ -0,0 +1,79 @@
+/**
+ * @file grove_aqs_suspend_example.c
+ * @brief Cost of a power-save cycle: deinit/init versus suspend/resume
+ *
+ * Runs the same number of cycles both ways and reports the mean time per
+ * cycle and the heap left over, then one read to show the driver state
+ * survived the suspend cycles.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "grove_analog_aqs.h"
+
+static const char *TAG = "grove_aqs_suspend_example";
+
+#define CYCLES 100
+
+static void report(const char *name, int64_t elapsed_us, size_t heap_before) {
+    size_t heap_after = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    ESP_LOGI(TAG, "%-16s %6" PRId64 " us/cycle, heap %+d bytes, largest free block %u bytes", name,
+             elapsed_us / CYCLES, (int)heap_after - (int)heap_before,
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+}
+
+void app_main(void)
+{
+    grove_aqs_config_t config = GROVE_AQS_DEFAULT_CONFIG();
+    // Suspend switches the sensor supply, so both ways power-cycle the heater
+    config.use_gpio_power = true;
+    config.power_gpio = GPIO_NUM_5;
+    esp_err_t ret = grove_aqs_init(&config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize sensor: %d", ret);
+        return;
+    }
+
+    // Per-cycle logging would dominate the measurement
+    esp_log_level_set("grove_aqs", ESP_LOG_WARN);
+
+    size_t heap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < CYCLES && ret == ESP_OK; i++) {
+        ret = grove_aqs_deinit();
+        if (ret == ESP_OK) {
+            ret = grove_aqs_init(&config);
+        }
+    }
+    report("deinit/init", esp_timer_get_time() - start, heap);
+
+    heap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    start = esp_timer_get_time();
+    for (int i = 0; i < CYCLES && ret == ESP_OK; i++) {
+        ret = grove_aqs_suspend();
+        if (ret == ESP_OK) {
+            ret = grove_aqs_resume();
+        }
+    }
+    report("suspend/resume", esp_timer_get_time() - start, heap);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Power-save cycle failed: %d", ret);
+        return;
+    }
+
+    // Heater warm-up after the last resume
+    vTaskDelay(pdMS_TO_TICKS(2000));
+
+    grove_aqs_data_t data;
+    ret = grove_aqs_read_data(&data);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Reading after resume: %dmV, %s", data.voltage_mv,
+                 grove_aqs_quality_to_string(data.quality));
+    }
+}
@@ -0,0 +1,64 @@
+/**
+ * @file grove_aqs_wcet_example.c
+ * @brief Worst-case execution time run of grove_aqs_read_data() on the target
+ *
+ * Requires CONFIG_GROVE_AQS_WCET. The harness runs in a task pinned to one
+ * core so the cycle counter it reads stays on the same CPU.
+ */
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "grove_analog_aqs.h"
+#include "grove_aqs_wcet.h"
+
+static const char *TAG = "grove_aqs_wcet_example";
+
+static grove_aqs_core_params_t params;
+
+/* One driver read: the conversion runs, then the adversarial raw value goes through every later stage */
+static esp_err_t read_op(void *ctx, int raw, bool fail) {
+    (void)ctx;
+    grove_aqs_data_t data;
+    grove_aqs_wcet_inject(raw, fail);
+    return grove_aqs_read_data(&data);
+}
+
+static void wcet_task(void *arg) {
+    (void)arg;
+    static grove_aqs_wcet_result_t result;
+
+    grove_aqs_wcet_config_t config = GROVE_AQS_WCET_DEFAULT_CONFIG();
+    config.op = read_op;
+    config.params = &params;
+
+    esp_err_t ret = grove_aqs_wcet_run(&config, &result);
+    for (int s = 0; s < GROVE_AQS_WCET_SCENARIO_COUNT; s++) {
+        grove_aqs_wcet_hist_print(&result.hist[s], grove_aqs_wcet_scenario_name(s), stdout);
+    }
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Worst case %u ns within the %u ns budget",
+                 (unsigned)result.worst_ns, (unsigned)config.budget_ns);
+    } else {
+        ESP_LOGE(TAG, "WCET run failed: %d", ret);
+    }
+    vTaskDelete(NULL);
+}
+
+void app_main(void)
+{
+    grove_aqs_config_t config = GROVE_AQS_DEFAULT_CONFIG();
+    esp_err_t ret = grove_aqs_init(&config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize sensor: %d", ret);
+        return;
+    }
+    grove_aqs_core_params_init(&params, config.vref, config.fresh_threshold, config.good_threshold,
+                               config.moderate_threshold, config.poor_threshold);
+
+    // Per-read logging, including the errors of the injected failures, would dominate the measurement
+    esp_log_level_set("grove_aqs", ESP_LOG_NONE);
+
+    xTaskCreatePinnedToCore(wcet_task, "aqs_wcet", 4096, NULL, configMAX_PRIORITIES - 2, NULL, 0);
+}
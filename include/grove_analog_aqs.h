@@ -16,6 +16,7 @@
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
 #include "driver/gpio.h"
+#include "grove_aqs_core.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -58,6 +59,14 @@ extern "C" {
 #define CONFIG_GROVE_AQS_POOR_THRESHOLD 2000
 #endif
 
+#ifndef CONFIG_GROVE_AQS_HYSTERESIS_MV
+#define CONFIG_GROVE_AQS_HYSTERESIS_MV 0
+#endif
+
+#ifndef CONFIG_GROVE_AQS_FILTER_SHIFT
+#define CONFIG_GROVE_AQS_FILTER_SHIFT 0
+#endif
+
 #ifndef CONFIG_GROVE_AQS_USE_GPIO_POWER
 #define CONFIG_GROVE_AQS_USE_GPIO_POWER 0
 #endif
@@ -66,21 +75,47 @@ extern "C" {
 #define CONFIG_GROVE_AQS_POWER_GPIO -1
 #endif
 
+#ifndef CONFIG_GROVE_AQS_INIT_MODE
+#define CONFIG_GROVE_AQS_INIT_MODE 0
+#endif
+
+#ifndef CONFIG_GROVE_AQS_HEATER_PWM
+#define CONFIG_GROVE_AQS_HEATER_PWM 0
+#endif
+
+#ifndef CONFIG_GROVE_AQS_HEATER_DUTY_PCT
+#define CONFIG_GROVE_AQS_HEATER_DUTY_PCT 60
+#endif
+
+#ifndef CONFIG_GROVE_AQS_HEATER_SOFT_START_MS
+#define CONFIG_GROVE_AQS_HEATER_SOFT_START_MS 200
+#endif
+
+#ifndef CONFIG_GROVE_AQS_HEATER_SENSITIVITY_PCT
+#define CONFIG_GROVE_AQS_HEATER_SENSITIVITY_PCT 50
+#endif
+
 // Helper macro to convert GROVE_AQS_DEFAULT_ADC_ATTEN integer to enum
 #define GROVE_AQS_ADC_ATTEN(x) ((x) == 0 ? ADC_ATTEN_DB_0 : \
                                ((x) == 1 ? ADC_ATTEN_DB_2_5 : \
                                ((x) == 2 ? ADC_ATTEN_DB_6 : ADC_ATTEN_DB_12)))
 
 /**
- * @brief Air quality levels
+ * @brief When grove_aqs_init() builds the ADC calibration scheme
+ */
+typedef enum {
+    GROVE_AQS_INIT_EAGER = 0,        /*!< In grove_aqs_init() */
+    GROVE_AQS_INIT_LAZY,             /*!< On the first grove_aqs_read_data() */
+    GROVE_AQS_INIT_BACKGROUND,       /*!< In a low-priority task started by grove_aqs_init() */
+} grove_aqs_init_mode_t;
+
+/**
+ * @brief How power_gpio drives the sensor supply
  */
 typedef enum {
-    GROVE_AQS_QUALITY_FRESH = 0,      /*!< Fresh air */
-    GROVE_AQS_QUALITY_GOOD,           /*!< Good air quality */
-    GROVE_AQS_QUALITY_MODERATE,       /*!< Moderate air quality */
-    GROVE_AQS_QUALITY_POOR,           /*!< Poor air quality */
-    GROVE_AQS_QUALITY_VERY_POOR       /*!< Very poor air quality */
-} grove_aqs_quality_t;
+    GROVE_AQS_HEATER_SWITCHED = 0,   /*!< Fully on or off (gpio_set_level) */
+    GROVE_AQS_HEATER_PWM,            /*!< LEDC PWM at heater_duty_pct, ramped up over heater_soft_start_ms */
+} grove_aqs_heater_mode_t;
 
 /**
  * @brief Configuration for the Grove Analog Air Quality Sensor
@@ -96,9 +131,17 @@ typedef struct {
     int good_threshold;               /*!< Threshold for good air quality (in mV) */
     int moderate_threshold;           /*!< Threshold for moderate air quality (in mV) */
     int poor_threshold;               /*!< Threshold for poor air quality (in mV) */
+    int hysteresis_mv;                /*!< Distance past a threshold before the level changes (in mV, 0: none) */
+    uint8_t filter_shift;             /*!< Moving-average smoothing before classification, 0-8 (0: none) */
     
     bool use_gpio_power;              /*!< Whether to use GPIO pin for powering the sensor */
     gpio_num_t power_gpio;            /*!< GPIO pin number for sensor power control (if used) */
+
+    grove_aqs_init_mode_t init_mode;  /*!< When to build the ADC calibration scheme */
+
+    grove_aqs_heater_mode_t heater_mode; /*!< How power_gpio drives the supply (PWM needs CONFIG_GROVE_AQS_HEATER_PWM) */
+    uint8_t heater_duty_pct;          /*!< PWM duty while powered, 1-100 */
+    uint16_t heater_soft_start_ms;    /*!< PWM ramp from 0 to heater_duty_pct on power-on (0: none) */
 } grove_aqs_config_t;
 
 /**
@@ -110,6 +153,78 @@ typedef struct {
     grove_aqs_quality_t quality;     /*!< Interpreted air quality level */
 } grove_aqs_data_t;
 
+/** grove_aqs_read_data_deadline() skipped the ADC conversion: the sample is the previous one */
+#define GROVE_AQS_SKIPPED_CONVERSION  (1u << 0)
+/** The voltage comes from the linear approximation instead of the ADC calibration curve */
+#define GROVE_AQS_SKIPPED_CALIBRATION (1u << 1)
+/** The quality is that of the previous reading: compensation, smoothing and the classifier were left out */
+#define GROVE_AQS_SKIPPED_PROCESSING  (1u << 2)
+/** The quality comes from the thresholds instead of the classifier model */
+#define GROVE_AQS_SKIPPED_INFERENCE   (1u << 3)
+
+/**
+ * @brief Sensor reading returned by grove_aqs_read_data_deadline()
+ */
+typedef struct {
+    grove_aqs_data_t data;           /*!< The reading */
+    uint32_t skipped;                /*!< GROVE_AQS_SKIPPED_* flags of the stages left out */
+    int64_t timestamp_us;            /*!< When the ADC conversion of this reading finished (esp_timer time) */
+} grove_aqs_timed_data_t;
+
+/**
+ * @brief Initialization phases timed by grove_aqs_init()
+ */
+typedef enum {
+    GROVE_AQS_INIT_PHASE_GPIO = 0,   /*!< Power GPIO configuration and power-on */
+    GROVE_AQS_INIT_PHASE_ADC_UNIT,   /*!< ADC oneshot unit creation */
+    GROVE_AQS_INIT_PHASE_ADC_CHANNEL, /*!< ADC channel configuration */
+    GROVE_AQS_INIT_PHASE_CALIBRATION, /*!< ADC calibration scheme creation (wherever it ran) */
+    GROVE_AQS_INIT_PHASE_COUNT
+} grove_aqs_init_phase_t;
+
+/**
+ * @brief Phase timings of the last initialization
+ */
+typedef struct {
+    uint32_t phase_us[GROVE_AQS_INIT_PHASE_COUNT]; /*!< Duration of each phase in microseconds */
+    uint32_t init_us;                /*!< Time spent in grove_aqs_init() itself */
+    bool calibration_pending;        /*!< The deferred calibration has not been built yet */
+} grove_aqs_init_timing_t;
+
+/**
+ * @brief Power management locks the driver holds while sampling
+ */
+typedef enum {
+    GROVE_AQS_PM_LOCK_APB_FREQ = 0,  /*!< ESP_PM_APB_FREQ_MAX, held over conversion and processing */
+    GROVE_AQS_PM_LOCK_NO_LIGHT_SLEEP, /*!< ESP_PM_NO_LIGHT_SLEEP, held over the ADC conversion only */
+    GROVE_AQS_PM_LOCK_COUNT
+} grove_aqs_pm_lock_t;
+
+/**
+ * @brief Hold time statistics of one power management lock
+ */
+typedef struct {
+    uint64_t held_us;                /*!< Total time held */
+    uint32_t acquisitions;           /*!< Number of times acquired */
+    uint32_t max_held_us;            /*!< Longest single hold */
+} grove_aqs_pm_lock_stats_t;
+
+/**
+ * @brief Hold time statistics of the driver's power management locks since init
+ */
+typedef struct {
+    grove_aqs_pm_lock_stats_t lock[GROVE_AQS_PM_LOCK_COUNT]; /*!< Per lock, indexed by grove_aqs_pm_lock_t */
+} grove_aqs_pm_stats_t;
+
+/**
+ * @brief Atmospheres of the two-point calibration
+ */
+typedef enum {
+    GROVE_AQS_CAL_CLEAN_AIR = 0,     /*!< Clean air */
+    GROVE_AQS_CAL_REFERENCE_GAS,     /*!< Reference gas of a known concentration */
+    GROVE_AQS_CAL_POINT_COUNT
+} grove_aqs_cal_point_t;
+
 /**
  * @brief Default configuration for the Grove Analog Air Quality Sensor
  */
@@ -122,8 +237,14 @@ typedef struct {
     .good_threshold = CONFIG_GROVE_AQS_GOOD_THRESHOLD, \
     .moderate_threshold = CONFIG_GROVE_AQS_MODERATE_THRESHOLD, \
     .poor_threshold = CONFIG_GROVE_AQS_POOR_THRESHOLD, \
+    .hysteresis_mv = CONFIG_GROVE_AQS_HYSTERESIS_MV, \
+    .filter_shift = CONFIG_GROVE_AQS_FILTER_SHIFT, \
     .use_gpio_power = CONFIG_GROVE_AQS_USE_GPIO_POWER, \
-    .power_gpio = CONFIG_GROVE_AQS_POWER_GPIO == -1 ? GPIO_NUM_NC : CONFIG_GROVE_AQS_POWER_GPIO \
+    .power_gpio = CONFIG_GROVE_AQS_POWER_GPIO == -1 ? GPIO_NUM_NC : CONFIG_GROVE_AQS_POWER_GPIO, \
+    .init_mode = CONFIG_GROVE_AQS_INIT_MODE, \
+    .heater_mode = CONFIG_GROVE_AQS_HEATER_PWM ? GROVE_AQS_HEATER_PWM : GROVE_AQS_HEATER_SWITCHED, \
+    .heater_duty_pct = CONFIG_GROVE_AQS_HEATER_DUTY_PCT, \
+    .heater_soft_start_ms = CONFIG_GROVE_AQS_HEATER_SOFT_START_MS \
 }
 
 /**
@@ -134,6 +255,28 @@ typedef struct {
  */
 esp_err_t grove_aqs_init(const grove_aqs_config_t *config);
 
+/**
+ * @brief Get the phase timings of the last initialization
+ *
+ * With a lazy or background init mode, the calibration phase is filled in
+ * once the scheme has been built.
+ *
+ * @param timing Pointer to a structure to store the timings
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t grove_aqs_get_init_timing(grove_aqs_init_timing_t *timing);
+
+/**
+ * @brief Get the per-sample constants readings use right now
+ *
+ * Thresholds, gain and offset after calibration, heater compensation,
+ * config blobs and the selected preset.
+ *
+ * @param params Where to store a copy of the constants
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t grove_aqs_get_params(grove_aqs_core_params_t *params);
+
 /**
  * @brief Deinitialize the Grove Analog Air Quality Sensor
  * 
@@ -149,8 +292,67 @@ esp_err_t grove_aqs_deinit(void);
  */
 esp_err_t grove_aqs_read_data(grove_aqs_data_t *data);
 
+/**
+ * @brief Read data, skipping the stages that cannot finish before a deadline
+ *
+ * Each stage is only started if its recent worst-case duration still fits
+ * before the deadline. If the ADC conversion does not fit, the previous
+ * reading is returned with GROVE_AQS_SKIPPED_CONVERSION set. If the
+ * calibration does not fit, the voltage is computed with the linear
+ * approximation and GROVE_AQS_SKIPPED_CALIBRATION is set. If the processing
+ * does not fit, the previous quality is kept and GROVE_AQS_SKIPPED_PROCESSING
+ * is set; if only the classifier model does not fit, the quality comes from
+ * the thresholds and GROVE_AQS_SKIPPED_INFERENCE is set.
+ *
+ * @param data Pointer to a structure to store the reading, its skip flags and its age
+ * @param deadline_us Absolute deadline in esp_timer_get_time() microseconds
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT if the conversion does not fit
+ *         and there is no previous reading, otherwise an error code
+ */
+esp_err_t grove_aqs_read_data_deadline(grove_aqs_timed_data_t *data, int64_t deadline_us);
+
+/**
+ * @brief Get the time spent holding each power management lock since init
+ *
+ * Locks are held only around conversions and processing, so the sums show
+ * how much of the time the driver keeps the APB clock up and light sleep off.
+ *
+ * @param stats Pointer to a structure to store the statistics
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_NOT_SUPPORTED if CONFIG_GROVE_AQS_PM_LOCKS is disabled
+ */
+esp_err_t grove_aqs_get_pm_stats(grove_aqs_pm_stats_t *stats);
+
+/**
+ * @brief Suspend the sensor between measurements
+ *
+ * Powers the sensor off through power_gpio (if enabled) and holds the pin
+ * low, but keeps the ADC unit, the calibration scheme, the last reading and
+ * the stage timings. Reads, including grove_aqs_sample_mv(), and
+ * grove_aqs_set_heater_duty() fail with ESP_ERR_INVALID_STATE until
+ * grove_aqs_resume(). Much cheaper than grove_aqs_deinit()/grove_aqs_init().
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ *         or already suspended, otherwise an error code
+ */
+esp_err_t grove_aqs_suspend(void);
+
+/**
+ * @brief Resume a suspended sensor
+ *
+ * Releases the pin hold and powers the sensor on again. The heater still
+ * needs its warm-up time before readings are meaningful.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not suspended,
+ *         otherwise an error code
+ */
+esp_err_t grove_aqs_resume(void);
+
 /**
  * @brief Power on the sensor (if GPIO power control is enabled)
+ *
+ * In GROVE_AQS_HEATER_PWM mode the duty ramps up over heater_soft_start_ms
+ * in the background; the call returns as soon as the ramp has started.
  * 
  * @return esp_err_t ESP_OK on success, otherwise an error code
  */
@@ -164,12 +366,81 @@ esp_err_t grove_aqs_power_on(void);
 esp_err_t grove_aqs_power_off(void);
 
 /**
- * @brief Get a string representation of the air quality level
- * 
- * @param quality Air quality level
- * @return const char* String representation
+ * @brief Set the heater duty directly, for heater modulation
+ *
+ * Built with CONFIG_GROVE_AQS_PROFILE or CONFIG_GROVE_AQS_LOCKIN. In
+ * GROVE_AQS_HEATER_PWM mode the duty is applied without soft start; a
+ * switched supply is on for any duty above 0.
+ *
+ * @param duty_pct Heater power, 0-100
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ *         or suspended, ESP_ERR_NOT_SUPPORTED without power_gpio
+ */
+esp_err_t grove_aqs_set_heater_duty(uint8_t duty_pct);
+
+/**
+ * @brief Take one calibrated voltage sample without classifying or logging it
+ *
+ * Built with CONFIG_GROVE_AQS_PROFILE or CONFIG_GROVE_AQS_LOCKIN.
+ *
+ * @param voltage_mv Where to store the voltage
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ *         or suspended, otherwise an error code
+ */
+esp_err_t grove_aqs_sample_mv(int *voltage_mv);
+
+/**
+ * @brief Capture one point of the two-point calibration
+ *
+ * Built with CONFIG_GROVE_AQS_CALIBRATION. Averages @p samples readings,
+ * which must be taken in the given atmosphere after the sensor has warmed
+ * up. Both points are needed before grove_aqs_calibrate_finish().
+ *
+ * @param point Atmosphere the sensor is in
+ * @param samples Readings to average (at least 1)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         otherwise an error code of grove_aqs_read_data()
+ */
+esp_err_t grove_aqs_calibrate_point(grove_aqs_cal_point_t point, uint16_t samples);
+
+/**
+ * @brief Derive the correction from the captured points, apply and store it
+ *
+ * Built with CONFIG_GROVE_AQS_CALIBRATION. The correction maps the
+ * captured readings onto CONFIG_GROVE_AQS_CAL_CLEAN_MV and
+ * CONFIG_GROVE_AQS_CAL_REFERENCE_MV, the readings of the unit the
+ * thresholds were set on.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE unless both points were captured,
+ *         ESP_ERR_INVALID_RESPONSE if the readings give no usable correction,
+ *         otherwise an NVS error code (the correction is then neither applied nor
+ *         stored, and the points stay captured for another attempt)
+ */
+esp_err_t grove_aqs_calibrate_finish(void);
+
+/**
+ * @brief Apply and store a correction, e.g. one derived at the factory
+ *
+ * Built with CONFIG_GROVE_AQS_CALIBRATION. The correction is stored
+ * first and applied only once stored, so the correction in use is always
+ * the one grove_aqs_init() loads; NVS must have been initialized by then.
+ *
+ * @param cal Correction, or NULL to go back to none and erase it
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_INVALID_ARG for a gain outside 0.5-2, otherwise an NVS error code
+ *         (the previous correction stays in use)
+ */
+esp_err_t grove_aqs_set_calibration(const grove_aqs_calibration_t *cal);
+
+/**
+ * @brief Get the correction in use
+ *
+ * Built with CONFIG_GROVE_AQS_CALIBRATION.
+ *
+ * @param cal Where to store the correction
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
  */
-const char* grove_aqs_quality_to_string(grove_aqs_quality_t quality);
+esp_err_t grove_aqs_get_calibration(grove_aqs_calibration_t *cal);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,267 @@
+/**
+ * @file grove_aqs_classify.h
+ * @brief Feature windows and a quantized int8 MLP classifier loaded from a flash blob
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Fixed thresholds see a voltage, not what caused it: cooking smoke and
+ * solvent vapours can reach the same level. A window of recent samples
+ * adds how the voltage moves (slope, spread, range) and, with a heater
+ * profile running, the shape of the heater-cycle response. A small
+ * multilayer perceptron with int8 weights and activations and int32
+ * accumulators maps these features to an air quality category, including
+ * the categories after GROVE_AQS_QUALITY_LEVEL_COUNT that thresholds
+ * cannot produce.
+ *
+ * The model is a blob (see grove_aqs_model_header_t) that is parsed in
+ * place: a model loaded from a memory-mapped flash partition keeps
+ * pointing into flash and costs no RAM besides grove_aqs_model_t.
+ * Everything here is platform independent except the partition loader.
+ */
+
+#ifndef GROVE_AQS_CLASSIFY_H
+#define GROVE_AQS_CLASSIFY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_port.h"
+#include "grove_aqs_profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_CLASSIFY_WINDOW
+#define CONFIG_GROVE_AQS_CLASSIFY_WINDOW 30
+#endif
+
+/** Most samples a window holds */
+#define GROVE_AQS_WINDOW_MAX 64
+
+/** Heater-cycle response features: the shape averaged over this many equal groups of phases */
+#define GROVE_AQS_FEATURE_CYCLE_GROUPS 4
+
+/**
+ * @brief Window features, in model input order
+ */
+typedef enum {
+    GROVE_AQS_FEATURE_LEVEL = 0,     /*!< Mean voltage (mV) */
+    GROVE_AQS_FEATURE_SLOPE,         /*!< Least-squares slope (mV per minute) */
+    GROVE_AQS_FEATURE_STDDEV,        /*!< Standard deviation (mV) */
+    GROVE_AQS_FEATURE_RANGE,         /*!< Maximum minus minimum (mV) */
+    GROVE_AQS_FEATURE_CYCLE,         /*!< First of GROVE_AQS_FEATURE_CYCLE_GROUPS shape values
+                                          (Q12, 4096 = flat); 0 without a heater cycle */
+    GROVE_AQS_FEATURE_COUNT = GROVE_AQS_FEATURE_CYCLE + GROVE_AQS_FEATURE_CYCLE_GROUPS
+} grove_aqs_feature_t;
+
+/**
+ * @brief Sliding window of recent samples
+ */
+typedef struct {
+    int16_t mv[GROVE_AQS_WINDOW_MAX];   /*!< Voltages, oldest at head once full */
+    uint32_t t_ms[GROVE_AQS_WINDOW_MAX]; /*!< Sample times (ms, wrapping) */
+    uint8_t size;                    /*!< Samples per window */
+    uint8_t count;                   /*!< Samples held (up to size) */
+    uint8_t head;                    /*!< Next slot written */
+    bool have_cycle;                 /*!< cycle holds the latest heater-cycle response */
+    int32_t cycle[GROVE_AQS_FEATURE_CYCLE_GROUPS]; /*!< Heater-cycle response features */
+} grove_aqs_window_t;
+
+/** Blob magic, "AQM1" */
+#define GROVE_AQS_MODEL_MAGIC 0x314D5141u
+
+/** Blob layout version */
+#define GROVE_AQS_MODEL_VERSION 1
+
+/** Most layers of a model */
+#define GROVE_AQS_MODEL_MAX_LAYERS 4
+
+/** Most neurons per layer */
+#define GROVE_AQS_MODEL_MAX_WIDTH 32
+
+/** Most outputs (classes) of a model */
+#define GROVE_AQS_MODEL_MAX_OUTPUTS 8
+
+/** Class map entry: keep the threshold level for this class */
+#define GROVE_AQS_MODEL_KEEP_LEVEL 0xFF
+
+/**
+ * @brief Input quantization: q = clamp(((x - offset) * scale_q16) >> 16, -128, 127)
+ */
+typedef struct {
+    int32_t offset;
+    int32_t scale_q16;
+} grove_aqs_model_input_t;
+
+/**
+ * @brief Blob header, followed by the layers
+ *
+ * All fields are little-endian. Each layer is a grove_aqs_model_layer_t,
+ * then its int32 biases (out), then its int8 weights (out x in, row per
+ * output), padded to 4 bytes.
+ */
+typedef struct {
+    uint32_t magic;                  /*!< GROVE_AQS_MODEL_MAGIC */
+    uint16_t version;                /*!< GROVE_AQS_MODEL_VERSION */
+    uint8_t input_count;             /*!< Features used, the first input_count of grove_aqs_feature_t */
+    uint8_t layer_count;             /*!< 1-GROVE_AQS_MODEL_MAX_LAYERS */
+    uint32_t size;                   /*!< Blob size including this header */
+    uint32_t crc32;                  /*!< CRC-32 of the bytes after this header */
+    grove_aqs_model_input_t inputs[GROVE_AQS_FEATURE_COUNT]; /*!< Quantization of each input */
+    uint8_t class_map[GROVE_AQS_MODEL_MAX_OUTPUTS]; /*!< grove_aqs_quality_t per output, or
+                                                         GROVE_AQS_MODEL_KEEP_LEVEL */
+} grove_aqs_model_header_t;
+
+/**
+ * @brief Layer header: out = requantize(weights x in + bias), then ReLU if set
+ *
+ * Requantization: y = clamp((acc * multiplier + 2^(shift-1)) >> shift, -128, 127).
+ */
+typedef struct {
+    uint8_t in;                      /*!< Inputs (the previous layer's outputs) */
+    uint8_t out;                     /*!< Outputs, 1-GROVE_AQS_MODEL_MAX_WIDTH */
+    uint8_t relu;                    /*!< 1: clamp negative outputs to 0 */
+    uint8_t shift;                   /*!< Right shift of the requantization, 1-62 */
+    int32_t multiplier;              /*!< Requantization multiplier */
+} grove_aqs_model_layer_t;
+
+/**
+ * @brief Parsed model, pointing into the blob
+ */
+typedef struct {
+    const grove_aqs_model_header_t *header;                  /*!< Blob header */
+    const grove_aqs_model_layer_t *layers[GROVE_AQS_MODEL_MAX_LAYERS]; /*!< Layer headers */
+    const int32_t *bias[GROVE_AQS_MODEL_MAX_LAYERS];         /*!< Biases of each layer */
+    const int8_t *weights[GROVE_AQS_MODEL_MAX_LAYERS];       /*!< Weights of each layer */
+    uint8_t output_count;                                    /*!< Outputs of the last layer */
+} grove_aqs_model_t;
+
+/**
+ * @brief Inference result
+ */
+typedef struct {
+    grove_aqs_quality_t quality;     /*!< Category of the top output, or the threshold level passed in */
+    uint8_t output;                  /*!< Index of the top output */
+    int16_t margin;                  /*!< Top output minus the runner-up (int8 units), a confidence measure */
+    int8_t scores[GROVE_AQS_MODEL_MAX_OUTPUTS]; /*!< Quantized outputs */
+} grove_aqs_model_output_t;
+
+/**
+ * @brief Classifier timing in the driver since the model was set
+ */
+typedef struct {
+    uint32_t inferences;             /*!< Windows classified */
+    uint32_t last_ns;                /*!< Features and inference of the latest window */
+    uint32_t max_ns;                 /*!< Slowest window */
+    uint64_t total_ns;               /*!< Sum over all windows */
+} grove_aqs_classify_stats_t;
+
+/**
+ * @brief Reset a window
+ *
+ * @param window Window
+ * @param size Samples per window (2-GROVE_AQS_WINDOW_MAX)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for another size
+ */
+esp_err_t grove_aqs_window_init(grove_aqs_window_t *window, uint8_t size);
+
+/**
+ * @brief Add a sample, dropping the oldest once the window is full
+ *
+ * @param window Window
+ * @param voltage_mv Sensor voltage
+ * @param timestamp_us Sample time
+ */
+void grove_aqs_window_push(grove_aqs_window_t *window, int voltage_mv, int64_t timestamp_us);
+
+/**
+ * @brief Set the heater-cycle response from the latest completed profile cycle
+ *
+ * @param window Window
+ * @param cycle Cycle features, or NULL to clear them
+ */
+void grove_aqs_window_set_cycle(grove_aqs_window_t *window, const grove_aqs_profile_features_t *cycle);
+
+/**
+ * @brief Whether the window holds its full number of samples
+ */
+static inline bool grove_aqs_window_full(const grove_aqs_window_t *window) {
+    return window->count == window->size;
+}
+
+/**
+ * @brief Compute the features of the samples in the window
+ *
+ * @param window Window (at least 2 samples)
+ * @param features Destination, GROVE_AQS_FEATURE_COUNT entries
+ */
+void grove_aqs_window_features(const grove_aqs_window_t *window, int32_t *features);
+
+/**
+ * @brief Validate a model blob and parse it in place
+ *
+ * @param blob Blob, 4-byte aligned; must stay valid while the model is used
+ * @param len Bytes available at @p blob
+ * @param model Parsed model
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_VERSION for another magic or version,
+ *         ESP_ERR_INVALID_SIZE if truncated, ESP_ERR_INVALID_CRC if corrupted,
+ *         ESP_ERR_INVALID_ARG if the layers do not fit together
+ */
+esp_err_t grove_aqs_model_load(const void *blob, size_t len, grove_aqs_model_t *model);
+
+/**
+ * @brief Run the model on a feature vector
+ *
+ * @param model Model
+ * @param features Window features, GROVE_AQS_FEATURE_COUNT entries
+ * @param level Threshold level, returned for classes mapped to GROVE_AQS_MODEL_KEEP_LEVEL
+ * @param out Result
+ */
+void grove_aqs_model_infer(const grove_aqs_model_t *model, const int32_t *features, grove_aqs_quality_t level,
+                           grove_aqs_model_output_t *out);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Map a data partition holding a model blob and parse it in place
+ *
+ * The mapping is kept for the lifetime of the application.
+ *
+ * @param label Partition label
+ * @param model Parsed model
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND without the partition,
+ *         otherwise as grove_aqs_model_load()
+ */
+esp_err_t grove_aqs_model_load_partition(const char *label, grove_aqs_model_t *model);
+
+/**
+ * @brief Classify readings with a model (implemented by the driver)
+ *
+ * Once the driver's window of CONFIG_GROVE_AQS_CLASSIFY_WINDOW readings is
+ * full, every reading's quality comes from the model instead of the
+ * thresholds. The driver window has no heater-cycle features.
+ *
+ * @param model Loaded model, kept by reference; NULL goes back to thresholds
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t grove_aqs_set_model(const grove_aqs_model_t *model);
+
+/**
+ * @brief Get the classifier timing (implemented by the driver)
+ *
+ * @param stats Where to store the statistics
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t grove_aqs_get_classify_stats(grove_aqs_classify_stats_t *stats);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_CLASSIFY_H */
@@ -0,0 +1,188 @@
+/**
+ * @file grove_aqs_config_blob.h
+ * @brief Versioned, CRC-checked binary configuration loadable at runtime
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * GROVE_AQS_DEFAULT_CONFIG() fixes the classification settings at build
+ * time. A config blob carries them instead, so a fleet can be retuned by
+ * writing a data partition or an NVS entry. A blob is a header followed
+ * by tagged sections; a missing section leaves its settings unchanged, and
+ * sections with an unknown tag are skipped, so new sections do not need a
+ * new version.
+ *
+ * A blob is parsed in place: grove_aqs_config_blob_t points into it, so a
+ * blob in a memory-mapped partition costs no RAM. The driver applies all
+ * sections of a blob at once, see grove_aqs_apply_config().
+ * Everything here is platform independent except the partition and NVS
+ * helpers.
+ */
+
+#ifndef GROVE_AQS_CONFIG_BLOB_H
+#define GROVE_AQS_CONFIG_BLOB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Blob magic, "AQC1" */
+#define GROVE_AQS_CONFIG_BLOB_MAGIC 0x31435141u
+
+/** Blob layout version */
+#define GROVE_AQS_CONFIG_BLOB_VERSION 1
+
+/** Largest voltage a blob may set (mV) */
+#define GROVE_AQS_CONFIG_BLOB_MAX_MV 5000
+
+/** NVS namespace of grove_aqs_config_blob_load_nvs() and grove_aqs_config_blob_store_nvs() */
+#define GROVE_AQS_CONFIG_BLOB_NVS_NAMESPACE "grove_aqs"
+
+/**
+ * @brief Blob header, followed by the sections
+ *
+ * All fields are little-endian. Each section is a
+ * grove_aqs_config_section_t, then its payload, padded to 4 bytes.
+ */
+typedef struct {
+    uint32_t magic;                  /*!< GROVE_AQS_CONFIG_BLOB_MAGIC */
+    uint16_t version;                /*!< GROVE_AQS_CONFIG_BLOB_VERSION */
+    uint16_t section_count;          /*!< Sections after this header */
+    uint32_t size;                   /*!< Blob size including this header */
+    uint32_t crc32;                  /*!< CRC-32 of the bytes after this header */
+    uint32_t sequence;               /*!< Set by the writer to tell blobs apart, e.g. a fleet revision */
+} grove_aqs_config_blob_header_t;
+
+/**
+ * @brief Section tags
+ */
+typedef enum {
+    GROVE_AQS_CONFIG_CLASSIFY = 1,   /*!< grove_aqs_config_classify_t */
+    GROVE_AQS_CONFIG_CALIBRATION,    /*!< grove_aqs_calibration_t */
+} grove_aqs_config_tag_t;
+
+/**
+ * @brief Section header
+ */
+typedef struct {
+    uint16_t tag;                    /*!< grove_aqs_config_tag_t */
+    uint16_t size;                   /*!< Payload bytes, without this header and the padding */
+} grove_aqs_config_section_t;
+
+/**
+ * @brief Classification section: thresholds, hysteresis and smoothing
+ */
+typedef struct {
+    int32_t thresholds[GROVE_AQS_QUALITY_LEVEL_COUNT - 1]; /*!< Ascending upper bounds (mV) of fresh, good,
+                                                                moderate and poor */
+    int32_t hysteresis_mv;           /*!< See grove_aqs_core_params_t::hysteresis_mv */
+    uint8_t filter_shift;            /*!< See grove_aqs_core_params_t::filter_shift */
+    uint8_t reserved[3];             /*!< 0 */
+} grove_aqs_config_classify_t;
+
+/**
+ * @brief Parsed blob, pointing into it; a section pointer is NULL if the blob lacks the section
+ */
+typedef struct {
+    const grove_aqs_config_blob_header_t *header; /*!< Blob header */
+    const grove_aqs_config_classify_t *classify;  /*!< Classification settings */
+    const grove_aqs_calibration_t *calibration;   /*!< Per-device correction */
+} grove_aqs_config_blob_t;
+
+/**
+ * @brief Validate a blob and parse it in place
+ *
+ * Besides the framing, the values of every known section are checked, so
+ * a parsed blob can be applied without failing halfway.
+ *
+ * @param blob Blob, 4-byte aligned; must stay valid while the parsed blob is used
+ * @param len Bytes available at @p blob
+ * @param config Parsed blob
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_VERSION for another magic or version,
+ *         ESP_ERR_INVALID_SIZE if truncated, ESP_ERR_INVALID_CRC if corrupted,
+ *         ESP_ERR_INVALID_ARG for a duplicate section or a value out of range
+ */
+esp_err_t grove_aqs_config_blob_parse(const void *blob, size_t len, grove_aqs_config_blob_t *config);
+
+/**
+ * @brief Write a blob with the sections of a parsed blob
+ *
+ * @param config Sections to write (NULL pointers are left out); the header pointer is ignored
+ * @param sequence Value of grove_aqs_config_blob_header_t::sequence
+ * @param buf Destination, 4-byte aligned
+ * @param len Size of @p buf
+ * @param written Blob size
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if @p buf is too small
+ */
+esp_err_t grove_aqs_config_blob_write(const grove_aqs_config_blob_t *config, uint32_t sequence, void *buf,
+                                      size_t len, size_t *written);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Map a data partition holding a blob and parse it in place
+ *
+ * The mapping is kept for the lifetime of the application.
+ *
+ * @param label Partition label
+ * @param config Parsed blob
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND without the partition,
+ *         otherwise as grove_aqs_config_blob_parse()
+ */
+esp_err_t grove_aqs_config_blob_load_partition(const char *label, grove_aqs_config_blob_t *config);
+
+/**
+ * @brief Read a blob from NVS into a buffer and parse it there
+ *
+ * NVS cannot be mapped, so the blob is copied once into @p buf, which the
+ * parsed blob then points into.
+ *
+ * @param key NVS key in GROVE_AQS_CONFIG_BLOB_NVS_NAMESPACE
+ * @param buf Buffer, 4-byte aligned; must stay valid while the parsed blob is used
+ * @param len Size of @p buf
+ * @param config Parsed blob
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND without the key, an NVS error,
+ *         otherwise as grove_aqs_config_blob_parse()
+ */
+esp_err_t grove_aqs_config_blob_load_nvs(const char *key, void *buf, size_t len, grove_aqs_config_blob_t *config);
+
+/**
+ * @brief Validate a blob and store it in NVS
+ *
+ * @param key NVS key in GROVE_AQS_CONFIG_BLOB_NVS_NAMESPACE
+ * @param blob Blob, 4-byte aligned
+ * @param len Blob size
+ * @return esp_err_t ESP_OK on success, an NVS error, otherwise as grove_aqs_config_blob_parse()
+ */
+esp_err_t grove_aqs_config_blob_store_nvs(const char *key, const void *blob, size_t len);
+
+/**
+ * @brief Apply a parsed blob (implemented by the driver)
+ *
+ * Readings switch from the previous settings to all sections of the blob
+ * at once: the new per-sample constants are built aside and published
+ * with one pointer store, so a concurrent grove_aqs_read_data() uses
+ * either the old or the new settings, never a mix. The smoothing and
+ * hysteresis state carries over. A calibration section is stored in NVS
+ * before anything is applied, so the next boot loads it.
+ *
+ * @param config Parsed blob
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_NOT_SUPPORTED for a calibration section without CONFIG_GROVE_AQS_CALIBRATION,
+ *         an NVS error if the calibration cannot be stored (nothing is applied then)
+ */
+esp_err_t grove_aqs_apply_config(const grove_aqs_config_blob_t *config);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_CONFIG_BLOB_H */
@@ -0,0 +1,204 @@
+/**
+ * @file grove_aqs_core.h
+ * @brief Platform-independent conversion and classification core of the Grove Analog Air Quality Sensor
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Nothing in here depends on ESP-IDF, so the core also builds as a plain
+ * CMake library on a Linux host for profiling and benchmarking.
+ */
+
+#ifndef GROVE_AQS_CORE_H
+#define GROVE_AQS_CORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Air quality levels
+ */
+typedef enum {
+    GROVE_AQS_QUALITY_FRESH = 0,      /*!< Fresh air */
+    GROVE_AQS_QUALITY_GOOD,           /*!< Good air quality */
+    GROVE_AQS_QUALITY_MODERATE,       /*!< Moderate air quality */
+    GROVE_AQS_QUALITY_POOR,           /*!< Poor air quality */
+    GROVE_AQS_QUALITY_VERY_POOR,      /*!< Very poor air quality */
+    GROVE_AQS_QUALITY_SMOKE,          /*!< Combustion or cooking smoke (classifier only) */
+    GROVE_AQS_QUALITY_SOLVENT         /*!< Solvent or other VOC vapours (classifier only) */
+} grove_aqs_quality_t;
+
+/** Number of threshold based air quality levels; the categories after them come from a classifier */
+#define GROVE_AQS_QUALITY_LEVEL_COUNT 5
+
+/** Number of air quality categories */
+#define GROVE_AQS_QUALITY_COUNT 7
+
+/** Full-scale raw value of the 12-bit ADC */
+#define GROVE_AQS_ADC_MAX_RAW 4095
+
+/** Fractional bits of the classification gain */
+#define GROVE_AQS_CORE_GAIN_SHIFT 12
+
+/** Gain of 1.0: the voltage is classified as measured */
+#define GROVE_AQS_CORE_GAIN_ONE (1 << GROVE_AQS_CORE_GAIN_SHIFT)
+
+/**
+ * @brief Constants used on the per-sample path, derived once from the configuration
+ */
+typedef struct {
+    int vref;                                          /*!< Reference voltage in mV for the linear conversion */
+    int thresholds[GROVE_AQS_QUALITY_LEVEL_COUNT - 1]; /*!< Inclusive upper bounds (mV) of fresh, good, moderate and poor */
+    int32_t gain;                                      /*!< Gain applied before classification, GROVE_AQS_CORE_GAIN_SHIFT fractional bits */
+    int32_t offset_mv;                                 /*!< Offset added after the gain (mV) */
+    int hysteresis_mv;                                 /*!< Distance past a threshold before grove_aqs_core_track() changes level (mV) */
+    uint8_t filter_shift;                              /*!< Smoothing in grove_aqs_core_track(): a sample weighs 2^-filter_shift, 0 for none */
+} grove_aqs_core_params_t;
+
+/** Largest grove_aqs_core_params_t::filter_shift */
+#define GROVE_AQS_CORE_FILTER_SHIFT_MAX 8
+
+/**
+ * @brief Running state of grove_aqs_core_track()
+ */
+typedef struct {
+    int32_t filtered_q8;             /*!< Smoothed voltage, mV with 8 fractional bits */
+    grove_aqs_quality_t level;       /*!< Level of the previous sample */
+    bool primed;                     /*!< false until the first sample */
+} grove_aqs_core_track_t;
+
+/**
+ * @brief Per-device correction from a two-point calibration: v' = v * gain + offset
+ */
+typedef struct {
+    int32_t gain;                    /*!< GROVE_AQS_CORE_GAIN_SHIFT fractional bits */
+    int32_t offset_mv;               /*!< Offset (mV) */
+} grove_aqs_calibration_t;
+
+/** Identity correction */
+#define GROVE_AQS_CALIBRATION_NONE { .gain = GROVE_AQS_CORE_GAIN_ONE, .offset_mv = 0 }
+
+/**
+ * @brief Derive the per-sample constants
+ *
+ * @param params Parameters to fill in
+ * @param vref Reference voltage in mV
+ * @param fresh_threshold Threshold for fresh air (in mV)
+ * @param good_threshold Threshold for good air quality (in mV)
+ * @param moderate_threshold Threshold for moderate air quality (in mV)
+ * @param poor_threshold Threshold for poor air quality (in mV)
+ */
+void grove_aqs_core_params_init(grove_aqs_core_params_t *params, int vref, int fresh_threshold,
+                                int good_threshold, int moderate_threshold, int poor_threshold);
+
+/**
+ * @brief Convert a raw reading to mV by linear approximation (used when ADC calibration is unavailable)
+ *
+ * @param params Core parameters
+ * @param raw Raw ADC reading
+ * @return int Voltage in mV
+ */
+int grove_aqs_core_raw_to_mv(const grove_aqs_core_params_t *params, int raw);
+
+/**
+ * @brief Apply the classification gain and offset to a voltage
+ *
+ * @param params Core parameters
+ * @param voltage_mv Measured sensor voltage in mV
+ * @return int Voltage in mV as the classification thresholds expect it
+ */
+static inline int grove_aqs_core_compensate(const grove_aqs_core_params_t *params, int voltage_mv) {
+    return (int)(((int64_t)voltage_mv * params->gain) >> GROVE_AQS_CORE_GAIN_SHIFT) + params->offset_mv;
+}
+
+/**
+ * @brief Derive a correction from readings of two known atmospheres
+ *
+ * The correction maps the device's readings onto those of a reference unit:
+ * the clean-air reading onto expected_clean_mv and the reference-gas
+ * reading onto expected_reference_mv.
+ *
+ * @param clean_mv Device reading in clean air
+ * @param reference_mv Device reading in the reference gas
+ * @param expected_clean_mv Reference unit's reading in clean air
+ * @param expected_reference_mv Reference unit's reading in the reference gas
+ * @param cal Correction to fill in
+ * @return true on success, false if the readings are too close or the gain is outside 0.5-2
+ */
+bool grove_aqs_core_calibrate(int clean_mv, int reference_mv, int expected_clean_mv, int expected_reference_mv,
+                              grove_aqs_calibration_t *cal);
+
+/**
+ * @brief Fold the heater gain and a calibration into the per-sample gain and offset
+ *
+ * The heater gain is applied first, so the readings a calibration was
+ * derived from must have been compensated for the heater already. The
+ * result stays a single multiply, shift and add per sample.
+ *
+ * @param params Core parameters
+ * @param heater_gain Gain from grove_aqs_core_heater_gain(), or GROVE_AQS_CORE_GAIN_ONE
+ * @param cal Calibration
+ */
+void grove_aqs_core_set_calibration(grove_aqs_core_params_t *params, int32_t heater_gain,
+                                    const grove_aqs_calibration_t *cal);
+
+/**
+ * @brief Gain that compensates the lower sensor output at reduced heater power
+ *
+ * At a fraction d of full heater power the output is taken to drop to
+ * 1 - s * (1 - d) of its full-power value, with s the sensitivity; the gain
+ * is the inverse, so thresholds set at full power still apply.
+ *
+ * @param duty_pct Heater power in percent of full power (1-100)
+ * @param sensitivity_pct Output lost at zero heater power, in percent (0-99)
+ * @return int32_t Gain with GROVE_AQS_CORE_GAIN_SHIFT fractional bits
+ */
+int32_t grove_aqs_core_heater_gain(int duty_pct, int sensitivity_pct);
+
+/**
+ * @brief Classify a voltage into an air quality level
+ *
+ * @param params Core parameters
+ * @param voltage_mv Sensor voltage in mV
+ * @return grove_aqs_quality_t Air quality level
+ */
+grove_aqs_quality_t grove_aqs_core_classify(const grove_aqs_core_params_t *params, int voltage_mv);
+
+/**
+ * @brief Classify a voltage after smoothing it and with hysteresis around the thresholds
+ *
+ * The voltage is smoothed by an exponential moving average of weight
+ * 2^-filter_shift. The level then moves up only once the smoothed voltage
+ * exceeds a threshold by more than hysteresis_mv, and down only once it is
+ * at least hysteresis_mv below one, so noise around a threshold does not
+ * make the level flicker. With both parameters 0 the result is that of
+ * grove_aqs_core_classify().
+ *
+ * @param params Core parameters
+ * @param track Running state, zeroed before the first sample
+ * @param voltage_mv Sensor voltage in mV
+ * @return grove_aqs_quality_t Air quality level
+ */
+grove_aqs_quality_t grove_aqs_core_track(const grove_aqs_core_params_t *params, grove_aqs_core_track_t *track,
+                                         int voltage_mv);
+
+/**
+ * @brief Get a string representation of the air quality level
+ * 
+ * @param quality Air quality level
+ * @return const char* String representation
+ */
+const char* grove_aqs_quality_to_string(grove_aqs_quality_t quality);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_CORE_H */
@@ -0,0 +1,184 @@
+/**
+ * @file grove_aqs_dlog.h
+ * @brief Deferred binary logging: log sites store an ID and raw arguments, formatting happens later
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Log sites are written as
+ *
+ *     GROVE_AQS_LOGI(TAG, READING, "Raw=%d, Quality=%s", raw, GROVE_AQS_DLOG_QUALITY(q));
+ *
+ * Without CONFIG_GROVE_AQS_DEFERRED_LOG this is a plain ESP_LOGI(). With it,
+ * the site only pushes a timestamp, the ID and the arguments into a lock-free
+ * ring. The ID table is generated from the sites at configure time
+ * (cmake/grove_aqs_dlog_table.cmake), and records are formatted either by a
+ * low-priority task on the device or on a Linux host with aqs_dlog_decode.
+ *
+ * Rules for deferred sites: the format is a single string literal without
+ * ';', every argument is an integer of at most 32 bits, and the only string
+ * argument is an air quality level passed through GROVE_AQS_DLOG_QUALITY().
+ */
+
+#ifndef GROVE_AQS_DLOG_H
+#define GROVE_AQS_DLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_DLOG_RING_SIZE
+#define CONFIG_GROVE_AQS_DLOG_RING_SIZE 64
+#endif
+
+/** Largest number of arguments of a deferred log site */
+#define GROVE_AQS_DLOG_MAX_ARGS 4
+
+/** Magic at the start of a binary log stream ("AQSD") */
+#define GROVE_AQS_DLOG_STREAM_MAGIC 0x44535141u
+
+/** Version of the binary log stream format */
+#define GROVE_AQS_DLOG_STREAM_VERSION 1
+
+/**
+ * @brief One deferred log record, also the on-the-wire format (little endian)
+ */
+typedef struct {
+    uint32_t timestamp_us;           /*!< Low 32 bits of grove_aqs_port_time_us() */
+    uint16_t id;                     /*!< Log site ID (GROVE_AQS_DLOG_ID_*) */
+    uint8_t level;                   /*!< 'E', 'W' or 'I' */
+    uint8_t nargs;                   /*!< Number of valid arguments */
+    int32_t args[GROVE_AQS_DLOG_MAX_ARGS]; /*!< Raw arguments */
+} grove_aqs_dlog_record_t;
+
+/**
+ * @brief Header written once at the start of a binary log stream
+ */
+typedef struct {
+    uint32_t magic;                  /*!< GROVE_AQS_DLOG_STREAM_MAGIC */
+    uint16_t version;                /*!< GROVE_AQS_DLOG_STREAM_VERSION */
+    uint16_t record_size;            /*!< sizeof(grove_aqs_dlog_record_t) */
+    uint32_t table_hash;             /*!< GROVE_AQS_DLOG_TABLE_HASH of the writing build */
+} grove_aqs_dlog_stream_header_t;
+
+/**
+ * @brief Entry of the generated site table
+ */
+typedef struct {
+    char level;                      /*!< 'E', 'W' or 'I' */
+    const char *name;                /*!< Site name */
+    const char *format;              /*!< printf style format */
+} grove_aqs_dlog_site_t;
+
+/**
+ * @brief Callback receiving drained records
+ *
+ * @param ctx User context
+ * @param record Record, valid only during the call
+ */
+typedef void (*grove_aqs_dlog_sink_t)(void *ctx, const grove_aqs_dlog_record_t *record);
+
+/**
+ * @brief Push a record into the ring (safe from any task or ISR, never blocks)
+ *
+ * The record is dropped and counted when the ring is full.
+ *
+ * @param level 'E', 'W' or 'I'
+ * @param id Log site ID
+ * @param nargs Number of arguments (extra ones are ignored)
+ * @param args Arguments
+ */
+void grove_aqs_dlog_write(char level, uint16_t id, size_t nargs, const int32_t *args);
+
+/**
+ * @brief Pop records from the ring and pass them to a sink
+ *
+ * Only one consumer may drain at a time.
+ *
+ * @param sink Callback called once per record
+ * @param ctx User context for the callback
+ * @param max Largest number of records to drain
+ * @return size_t Number of records drained
+ */
+size_t grove_aqs_dlog_drain(grove_aqs_dlog_sink_t sink, void *ctx, size_t max);
+
+/**
+ * @brief Number of records dropped because the ring was full
+ *
+ * @return uint32_t Dropped records since boot
+ */
+uint32_t grove_aqs_dlog_dropped(void);
+
+/**
+ * @brief Fill in the header to write before records in a binary stream
+ *
+ * @param header Header to fill in
+ */
+void grove_aqs_dlog_stream_header(grove_aqs_dlog_stream_header_t *header);
+
+/**
+ * @brief Format a record with the site table of this build
+ *
+ * Only built where the table strings are wanted: in the host decoder and in
+ * firmware with CONFIG_GROVE_AQS_DLOG_FORMAT_TASK.
+ *
+ * @param record Record to format
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @return int Length of the message (as snprintf), or -1 for an unknown ID
+ */
+int grove_aqs_dlog_format(const grove_aqs_dlog_record_t *record, char *buf, size_t len);
+
+#if defined(ESP_PLATFORM) && CONFIG_GROVE_AQS_DLOG_FORMAT_TASK
+/**
+ * @brief Start the task that formats deferred records through esp_log
+ *
+ * @param priority FreeRTOS priority, normally just above idle
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_dlog_start_task(unsigned int priority);
+#endif
+
+#if CONFIG_GROVE_AQS_DEFERRED_LOG
+
+#include "grove_aqs_dlog_table.h"
+
+/* A leading dummy element keeps the compound literal valid for sites without arguments */
+#define GROVE_AQS_DLOG_ARGS_(...) \
+    (sizeof((const int32_t[]){0, ##__VA_ARGS__}) / sizeof(int32_t) - 1), \
+    ((const int32_t[]){0, ##__VA_ARGS__} + 1)
+
+#define GROVE_AQS_LOGE(tag, id, format, ...) \
+    grove_aqs_dlog_write('E', GROVE_AQS_DLOG_ID_##id, GROVE_AQS_DLOG_ARGS_(__VA_ARGS__))
+#define GROVE_AQS_LOGW(tag, id, format, ...) \
+    grove_aqs_dlog_write('W', GROVE_AQS_DLOG_ID_##id, GROVE_AQS_DLOG_ARGS_(__VA_ARGS__))
+#define GROVE_AQS_LOGI(tag, id, format, ...) \
+    grove_aqs_dlog_write('I', GROVE_AQS_DLOG_ID_##id, GROVE_AQS_DLOG_ARGS_(__VA_ARGS__))
+
+/** Air quality level argument for a "%s" conversion */
+#define GROVE_AQS_DLOG_QUALITY(quality) ((int32_t)(quality))
+
+#else
+
+#define GROVE_AQS_LOGE(tag, id, format, ...) ESP_LOGE(tag, format, ##__VA_ARGS__)
+#define GROVE_AQS_LOGW(tag, id, format, ...) ESP_LOGW(tag, format, ##__VA_ARGS__)
+#define GROVE_AQS_LOGI(tag, id, format, ...) ESP_LOGI(tag, format, ##__VA_ARGS__)
+
+/** Air quality level argument for a "%s" conversion */
+#define GROVE_AQS_DLOG_QUALITY(quality) grove_aqs_quality_to_string(quality)
+
+#endif /* CONFIG_GROVE_AQS_DEFERRED_LOG */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_DLOG_H */
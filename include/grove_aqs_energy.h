@@ -0,0 +1,200 @@
+/**
+ * @file grove_aqs_energy.h
+ * @brief Energy accounting per reading and per subsystem
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * The driver reports how long each subsystem is active: the sensor heater
+ * between grove_aqs_power_on() and grove_aqs_power_off() (or from init to
+ * deinit without power_gpio), the ADC during conversions and the CPU while
+ * a sample is converted and processed. The application adds the bytes it
+ * sends over the radio. Per-state currents and the supply voltage of an
+ * energy model turn the times into charge and energy; all time not spent
+ * on the CPU or the radio is charged at the sleep current.
+ *
+ * The accounting itself is platform independent and takes explicit
+ * timestamps, so a host simulator can drive it with virtual time. Without
+ * CONFIG_GROVE_AQS_ENERGY the GROVE_AQS_ENERGY_* hooks in the driver
+ * compile to nothing.
+ */
+
+#ifndef GROVE_AQS_ENERGY_H
+#define GROVE_AQS_ENERGY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_SUPPLY_MV
+#define CONFIG_GROVE_AQS_ENERGY_SUPPLY_MV 3300
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_HEATER_UA
+#define CONFIG_GROVE_AQS_ENERGY_HEATER_UA 25000
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_ADC_UA
+#define CONFIG_GROVE_AQS_ENERGY_ADC_UA 2000
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_CPU_UA
+#define CONFIG_GROVE_AQS_ENERGY_CPU_UA 40000
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_RADIO_UA
+#define CONFIG_GROVE_AQS_ENERGY_RADIO_UA 120000
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_SLEEP_UA
+#define CONFIG_GROVE_AQS_ENERGY_SLEEP_UA 800
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_RADIO_BYTES_PER_S
+#define CONFIG_GROVE_AQS_ENERGY_RADIO_BYTES_PER_S 100000
+#endif
+
+#ifndef CONFIG_GROVE_AQS_ENERGY_RADIO_OVERHEAD_US
+#define CONFIG_GROVE_AQS_ENERGY_RADIO_OVERHEAD_US 50000
+#endif
+
+/**
+ * @brief Accounted subsystems
+ */
+typedef enum {
+    GROVE_AQS_ENERGY_HEATER = 0,     /*!< Sensor heater powered */
+    GROVE_AQS_ENERGY_ADC,            /*!< ADC converting (in addition to the CPU) */
+    GROVE_AQS_ENERGY_CPU,            /*!< CPU converting and processing a sample */
+    GROVE_AQS_ENERGY_RADIO,          /*!< Radio sending exported data */
+    GROVE_AQS_ENERGY_SLEEP,          /*!< Everything else: chip asleep or idle */
+    GROVE_AQS_ENERGY_STATE_COUNT
+} grove_aqs_energy_state_t;
+
+/**
+ * @brief Current figures of the board
+ */
+typedef struct {
+    uint32_t supply_mv;              /*!< Supply voltage in mV */
+    uint32_t current_ua[GROVE_AQS_ENERGY_STATE_COUNT]; /*!< Current while in each state, in uA */
+    uint32_t radio_bytes_per_s;      /*!< Effective radio throughput */
+    uint32_t radio_overhead_us;      /*!< Radio on-time per export besides the payload (wake-up, connect) */
+} grove_aqs_energy_model_t;
+
+/**
+ * @brief Default energy model from Kconfig
+ */
+#define GROVE_AQS_ENERGY_DEFAULT_MODEL() { \
+    .supply_mv = CONFIG_GROVE_AQS_ENERGY_SUPPLY_MV, \
+    .current_ua = { \
+        [GROVE_AQS_ENERGY_HEATER] = CONFIG_GROVE_AQS_ENERGY_HEATER_UA, \
+        [GROVE_AQS_ENERGY_ADC] = CONFIG_GROVE_AQS_ENERGY_ADC_UA, \
+        [GROVE_AQS_ENERGY_CPU] = CONFIG_GROVE_AQS_ENERGY_CPU_UA, \
+        [GROVE_AQS_ENERGY_RADIO] = CONFIG_GROVE_AQS_ENERGY_RADIO_UA, \
+        [GROVE_AQS_ENERGY_SLEEP] = CONFIG_GROVE_AQS_ENERGY_SLEEP_UA, \
+    }, \
+    .radio_bytes_per_s = CONFIG_GROVE_AQS_ENERGY_RADIO_BYTES_PER_S, \
+    .radio_overhead_us = CONFIG_GROVE_AQS_ENERGY_RADIO_OVERHEAD_US, \
+}
+
+/**
+ * @brief Running totals since grove_aqs_energy_init()
+ */
+typedef struct {
+    uint64_t time_us[GROVE_AQS_ENERGY_STATE_COUNT];   /*!< Time spent in each state */
+    uint64_t energy_uj[GROVE_AQS_ENERGY_STATE_COUNT]; /*!< Energy used in each state */
+    uint64_t total_uj;               /*!< Sum of energy_uj */
+    uint64_t elapsed_us;             /*!< Time since grove_aqs_energy_init() */
+    uint32_t readings;               /*!< Samples converted */
+    uint32_t exports;                /*!< Radio exports */
+    uint64_t export_bytes;           /*!< Bytes exported over the radio */
+    uint32_t uj_per_reading;         /*!< total_uj / readings (0 before the first reading) */
+    uint32_t average_ua;             /*!< Average current over elapsed_us */
+} grove_aqs_energy_totals_t;
+
+/**
+ * @brief Start accounting with a model, clearing all totals
+ *
+ * @param model Current figures, or NULL for GROVE_AQS_ENERGY_DEFAULT_MODEL()
+ * @param now_us Current time
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if the model has no supply voltage
+ */
+esp_err_t grove_aqs_energy_init(const grove_aqs_energy_model_t *model, int64_t now_us);
+
+/**
+ * @brief Enter a state; ignored if it is already active or accounting was not started
+ *
+ * @param state State (not GROVE_AQS_ENERGY_SLEEP, which is derived)
+ * @param now_us Current time
+ */
+void grove_aqs_energy_begin(grove_aqs_energy_state_t state, int64_t now_us);
+
+/**
+ * @brief Set the fraction of a state's current actually drawn, e.g. a PWM heater duty
+ *
+ * Applies from the next grove_aqs_energy_begin(); times stay wall time,
+ * only the energy is scaled.
+ *
+ * @param state State
+ * @param duty_pct Percent of the model's current (0-100, default 100)
+ */
+void grove_aqs_energy_set_duty(grove_aqs_energy_state_t state, uint8_t duty_pct);
+
+/**
+ * @brief Leave a state and add the time since grove_aqs_energy_begin()
+ *
+ * @param state State
+ * @param now_us Current time
+ */
+void grove_aqs_energy_end(grove_aqs_energy_state_t state, int64_t now_us);
+
+/**
+ * @brief Count one converted sample
+ */
+void grove_aqs_energy_count_reading(void);
+
+/**
+ * @brief Account one radio export of @p bytes
+ *
+ * The radio time is the model's overhead plus the payload at its
+ * throughput; it is charged to GROVE_AQS_ENERGY_RADIO without wall time
+ * having to pass.
+ *
+ * @param bytes Payload size
+ */
+void grove_aqs_energy_add_export(size_t bytes);
+
+/**
+ * @brief Get the running totals
+ *
+ * States still active are counted up to @p now_us.
+ *
+ * @param now_us Current time
+ * @param totals Where to store the totals
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if accounting was not started
+ */
+esp_err_t grove_aqs_energy_get_totals(int64_t now_us, grove_aqs_energy_totals_t *totals);
+
+#if CONFIG_GROVE_AQS_ENERGY
+#define GROVE_AQS_ENERGY_BEGIN(state) grove_aqs_energy_begin((state), grove_aqs_port_time_us())
+#define GROVE_AQS_ENERGY_END(state)   grove_aqs_energy_end((state), grove_aqs_port_time_us())
+#define GROVE_AQS_ENERGY_SET_DUTY(state, duty_pct) grove_aqs_energy_set_duty((state), (duty_pct))
+#define GROVE_AQS_ENERGY_READING()    grove_aqs_energy_count_reading()
+#else
+#define GROVE_AQS_ENERGY_BEGIN(state) do { } while (0)
+#define GROVE_AQS_ENERGY_END(state)   do { } while (0)
+#define GROVE_AQS_ENERGY_SET_DUTY(state, duty_pct) do { } while (0)
+#define GROVE_AQS_ENERGY_READING()    do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_ENERGY_H */
@@ -0,0 +1,245 @@
+/**
+ * @file grove_aqs_history.h
+ * @brief Crash-safe circular journal of compressed sample batches on flash
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#ifndef GROVE_AQS_HISTORY_H
+#define GROVE_AQS_HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_port.h"
+#include "grove_aqs_storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_HISTORY_BATCH_SIZE
+#define CONFIG_GROVE_AQS_HISTORY_BATCH_SIZE 32
+#endif
+
+/** Largest number of samples in one journal record (and in one read) */
+#define GROVE_AQS_HISTORY_MAX_BATCH 64
+
+/** Number of qualities counted in aggregates (the levels and the classifier verdicts) */
+#define GROVE_AQS_HISTORY_QUALITY_LEVELS GROVE_AQS_QUALITY_COUNT
+
+/**
+ * @brief One stored sample
+ */
+typedef struct {
+    uint32_t timestamp;              /*!< Sample time in seconds (any monotonic epoch) */
+    uint16_t voltage_mv;             /*!< Converted voltage in mV */
+    uint16_t raw_value;              /*!< Raw ADC reading */
+    uint8_t quality;                 /*!< Air quality level (grove_aqs_quality_t) */
+} grove_aqs_history_sample_t;
+
+/**
+ * @brief Aggregate over a set of stored samples
+ */
+typedef struct {
+    uint32_t count;                  /*!< Number of samples */
+    uint32_t first_timestamp;        /*!< Timestamp of the first sample */
+    uint32_t last_timestamp;         /*!< Timestamp of the last sample */
+    uint16_t min_mv;                 /*!< Minimum voltage in mV */
+    uint16_t max_mv;                 /*!< Maximum voltage in mV */
+    uint64_t sum_mv;                 /*!< Sum of voltages in mV (mean = sum_mv / count) */
+    uint32_t quality_count[GROVE_AQS_HISTORY_QUALITY_LEVELS]; /*!< Samples per quality (grove_aqs_quality_t) */
+} grove_aqs_history_agg_t;
+
+/**
+ * @brief Aggregate computed per bucket by grove_aqs_history_query()
+ */
+typedef enum {
+    GROVE_AQS_HISTORY_AGG_MEAN = 0,  /*!< Mean voltage */
+    GROVE_AQS_HISTORY_AGG_MIN,       /*!< Minimum voltage */
+    GROVE_AQS_HISTORY_AGG_MAX,       /*!< Maximum voltage */
+    GROVE_AQS_HISTORY_AGG_DWELL,     /*!< Time spent at each quality */
+} grove_aqs_history_agg_type_t;
+
+/**
+ * @brief One downsampled point returned by grove_aqs_history_query()
+ */
+typedef struct {
+    uint32_t timestamp;              /*!< Start of the bucket */
+    uint32_t count;                  /*!< Samples in the bucket (0: no data, value is not set) */
+    union {
+        uint16_t value_mv;           /*!< MEAN, MIN or MAX voltage in mV */
+        uint32_t dwell_s[GROVE_AQS_HISTORY_QUALITY_LEVELS]; /*!< DWELL: seconds per quality,
+                                                                 estimated from the mean sample interval */
+    };
+} grove_aqs_history_point_t;
+
+/**
+ * @brief Configuration for the sample history
+ */
+typedef struct {
+    grove_aqs_storage_t storage;     /*!< Opened storage backend, owned by the history until deinit */
+    uint16_t batch_size;             /*!< Samples buffered in RAM per compressed record (1..GROVE_AQS_HISTORY_MAX_BATCH) */
+} grove_aqs_history_config_t;
+
+/**
+ * @brief Position in the journal used for sequential reads
+ */
+typedef struct {
+    uint32_t sector;                 /*!< Physical sector index */
+    uint32_t seq;                    /*!< Sequence number the sector had when the cursor was placed */
+    uint32_t offset;                 /*!< Byte offset of the next record inside the sector */
+} grove_aqs_history_cursor_t;
+
+/**
+ * @brief Journal occupancy information
+ */
+typedef struct {
+    uint32_t sectors_total;          /*!< Number of sectors in the storage */
+    uint32_t sectors_used;           /*!< Sectors currently holding data */
+    uint32_t head_seq;               /*!< Sequence number of the sector being written */
+    uint32_t oldest_timestamp;       /*!< Timestamp of the oldest stored sample (0 if empty) */
+    uint32_t newest_timestamp;       /*!< Timestamp of the newest stored sample (0 if empty) */
+    size_t pending;                  /*!< Samples buffered in RAM, not yet on flash */
+} grove_aqs_history_info_t;
+
+/**
+ * @brief Default configuration for the sample history (storage must be filled in)
+ */
+#define GROVE_AQS_HISTORY_DEFAULT_CONFIG() { \
+    .batch_size = CONFIG_GROVE_AQS_HISTORY_BATCH_SIZE, \
+}
+
+/**
+ * @brief Mount the journal, recovering the write position after a reset or power loss
+ *
+ * Locating the newest sector is a binary search over sector headers, so
+ * mounting costs O(log n) header reads plus one scan of the newest sector.
+ *
+ * @param config History configuration
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_history_init(const grove_aqs_history_config_t *config);
+
+/**
+ * @brief Flush pending samples and release the storage backend
+ *
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_history_deinit(void);
+
+/**
+ * @brief Add one sample; a compressed record is written once a batch is complete
+ *
+ * Timestamps are expected to be non-decreasing.
+ *
+ * @param sample Sample to store
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_history_append(const grove_aqs_history_sample_t *sample);
+
+/**
+ * @brief Write the pending samples as a (short) record now
+ *
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_history_flush(void);
+
+/**
+ * @brief Copy the samples buffered in RAM that are not on flash yet
+ *
+ * Used to carry the pending batch over a deep sleep or restart (see
+ * grove_aqs_retain.h); append them again after the next mount.
+ *
+ * @param samples Destination array
+ * @param max Capacity of @p samples
+ * @param count Number of samples copied
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if more than @p max
+ *         samples are pending (nothing is copied), otherwise an error code
+ */
+esp_err_t grove_aqs_history_get_pending(grove_aqs_history_sample_t *samples, size_t max, size_t *count);
+
+/**
+ * @brief Erase all stored history
+ *
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_history_erase(void);
+
+/**
+ * @brief Get journal occupancy information
+ *
+ * @param info Pointer to a structure to fill in
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_history_get_info(grove_aqs_history_info_t *info);
+
+/**
+ * @brief Place a cursor on the first record that may contain samples at or after a timestamp
+ *
+ * Uses a binary search over sectors followed by a scan of a single sector.
+ *
+ * @param timestamp Timestamp to search for (0 for the oldest record)
+ * @param cursor Cursor to initialise
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the journal is empty
+ */
+esp_err_t grove_aqs_history_seek(uint32_t timestamp, grove_aqs_history_cursor_t *cursor);
+
+/**
+ * @brief Decode the record at the cursor and advance it
+ *
+ * @param cursor Cursor from grove_aqs_history_seek()
+ * @param samples Output buffer, at least GROVE_AQS_HISTORY_MAX_BATCH entries
+ * @param max Size of the output buffer in samples
+ * @param count Number of samples decoded
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND at the end of the journal,
+ *         ESP_ERR_INVALID_STATE if the cursor's sector has been reclaimed
+ */
+esp_err_t grove_aqs_history_read(grove_aqs_history_cursor_t *cursor,
+                                 grove_aqs_history_sample_t *samples, size_t max, size_t *count);
+
+/**
+ * @brief Aggregate all samples with start <= timestamp < end
+ *
+ * Sectors and records lying completely inside the range are answered from
+ * the aggregates stored in their headers; only records straddling the range
+ * edges are decompressed. Samples still buffered in RAM are included.
+ *
+ * @param start First timestamp of the range (inclusive)
+ * @param end End of the range (exclusive)
+ * @param agg Aggregate to fill in (count is 0 if the range holds no samples)
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_history_aggregate(uint32_t start, uint32_t end, grove_aqs_history_agg_t *agg);
+
+/**
+ * @brief Downsample a time range into fixed-size buckets
+ *
+ * The range is walked once in time order. Sealed sectors and records that
+ * fall inside a single bucket are taken from their stored aggregates; only
+ * records crossing a bucket or range boundary are decompressed, so coarse
+ * steps (e.g. hourly points over a week) read little more than headers.
+ *
+ * @param start First timestamp of the range (inclusive)
+ * @param end End of the range (exclusive)
+ * @param step Bucket width in seconds
+ * @param agg Aggregate to compute per bucket
+ * @param points Output buffer, one point per bucket
+ * @param max Size of the output buffer in points
+ * @param count Number of points written: ceil((end - start) / step)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if the buffer is too small
+ */
+esp_err_t grove_aqs_history_query(uint32_t start, uint32_t end, uint32_t step,
+                                  grove_aqs_history_agg_type_t agg,
+                                  grove_aqs_history_point_t *points, size_t max, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_HISTORY_H */
@@ -0,0 +1,127 @@
+/**
+ * @file grove_aqs_live.h
+ * @brief Per-sample constants in use, switched atomically while readings run
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Readings use the constants through one pointer, loaded once per reading.
+ * A writer switches that pointer with one store, so a reading uses either
+ * the old or the new constants, never a mix, and readers never wait.
+ *
+ * The pointer may target one of two internal slots or a struct of the
+ * caller's, such as a preset. A struct that readings may still hold is
+ * never written: before writing anything but the current target, a writer
+ * waits until no reading is in flight (a grace period). Readings are short,
+ * so the wait is rare and brief; writers are rare as well, and must be
+ * serialized by the caller. Everything here is platform independent
+ * (C11 atomics).
+ */
+
+#ifndef GROVE_AQS_LIVE_H
+#define GROVE_AQS_LIVE_H
+
+#include <stdatomic.h>
+#include "grove_aqs_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Constants in use and their storage
+ */
+typedef struct {
+    grove_aqs_core_params_t slots[2];                /*!< Storage for grove_aqs_live_publish() */
+    _Atomic(const grove_aqs_core_params_t *) current; /*!< Constants readings use */
+    atomic_uint readers;                             /*!< Readings in flight */
+} grove_aqs_live_params_t;
+
+/**
+ * @brief Set the first constants; no reading may run yet
+ *
+ * @param live Live constants
+ * @param params Initial constants, copied
+ */
+void grove_aqs_live_init(grove_aqs_live_params_t *live, const grove_aqs_core_params_t *params);
+
+/**
+ * @brief Start a reading: the constants stay valid and unchanged until grove_aqs_live_release()
+ *
+ * @param live Live constants
+ * @return const grove_aqs_core_params_t* Constants to use
+ */
+static inline const grove_aqs_core_params_t *grove_aqs_live_acquire(grove_aqs_live_params_t *live) {
+    atomic_fetch_add(&live->readers, 1);
+    return atomic_load(&live->current);
+}
+
+/**
+ * @brief End a reading started with grove_aqs_live_acquire()
+ *
+ * @param live Live constants
+ */
+static inline void grove_aqs_live_release(grove_aqs_live_params_t *live) {
+    atomic_fetch_sub_explicit(&live->readers, 1, memory_order_release);
+}
+
+/**
+ * @brief Constants in use, for the writer; a reading must use grove_aqs_live_acquire()
+ *
+ * @param live Live constants
+ * @return const grove_aqs_core_params_t* Current target
+ */
+static inline const grove_aqs_core_params_t *grove_aqs_live_current(grove_aqs_live_params_t *live) {
+    return atomic_load_explicit(&live->current, memory_order_relaxed);
+}
+
+/**
+ * @brief Switch readings to a struct of the caller's with one pointer store
+ *
+ * The struct must not be written while it is the target, other than by
+ * grove_aqs_live_rewrite().
+ *
+ * @param live Live constants
+ * @param target Constants to use from now on
+ */
+static inline void grove_aqs_live_switch(grove_aqs_live_params_t *live, const grove_aqs_core_params_t *target) {
+    // Ordered against the readers count by the fence of grove_aqs_live_quiesce()
+    atomic_store_explicit(&live->current, target, memory_order_release);
+}
+
+/**
+ * @brief Wait until no reading holds anything but the current target
+ *
+ * @param live Live constants
+ */
+void grove_aqs_live_quiesce(grove_aqs_live_params_t *live);
+
+/**
+ * @brief Copy constants into the free slot and switch readings to them
+ *
+ * @param live Live constants
+ * @param next New constants
+ */
+void grove_aqs_live_publish(grove_aqs_live_params_t *live, const grove_aqs_core_params_t *next);
+
+/**
+ * @brief Rewrite a struct of the caller's, also while it is the target
+ *
+ * A current target is swapped out to a slot holding the new constants
+ * meanwhile, and back in once the struct is written.
+ *
+ * @param live Live constants
+ * @param target Struct to rewrite
+ * @param next New contents
+ */
+void grove_aqs_live_rewrite(grove_aqs_live_params_t *live, grove_aqs_core_params_t *target,
+                            const grove_aqs_core_params_t *next);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_LIVE_H */
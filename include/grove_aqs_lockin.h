@@ -0,0 +1,159 @@
+/**
+ * @file grove_aqs_lockin.h
+ * @brief Lock-in (synchronous) detection of the sensor response to a modulated heater
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * The heater is switched on for the first half of every modulation period
+ * and off for the second, and the sensor is sampled a fixed number of times
+ * per period. Each sample is multiplied by a sine and a cosine reference at
+ * the modulation frequency and integrated, which recovers the amplitude of
+ * the response at that frequency. Baseline drift and noise away from the
+ * modulation frequency average out, so the amplitude is a far less noisy
+ * measure than the DC reading of grove_aqs_read_data().
+ *
+ * The demodulator is an incremental fixed-point kernel without ESP-IDF
+ * dependencies: grove_aqs_lockin_update() costs two multiply-accumulates
+ * per sample. Only complete periods enter the result.
+ */
+
+#ifndef GROVE_AQS_LOCKIN_H
+#define GROVE_AQS_LOCKIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_LOCKIN_FREQ_MHZ
+#define CONFIG_GROVE_AQS_LOCKIN_FREQ_MHZ 250
+#endif
+
+#ifndef CONFIG_GROVE_AQS_LOCKIN_SAMPLES_PER_PERIOD
+#define CONFIG_GROVE_AQS_LOCKIN_SAMPLES_PER_PERIOD 8
+#endif
+
+#ifndef CONFIG_GROVE_AQS_LOCKIN_PERIODS
+#define CONFIG_GROVE_AQS_LOCKIN_PERIODS 8
+#endif
+
+#ifndef CONFIG_GROVE_AQS_LOCKIN_DUTY_PCT
+#define CONFIG_GROVE_AQS_LOCKIN_DUTY_PCT 100
+#endif
+
+/** Most samples per modulation period (the count must be a power of two, at least 4) */
+#define GROVE_AQS_LOCKIN_MAX_SAMPLES 32
+
+/** Scale of the references: Q15 */
+#define GROVE_AQS_LOCKIN_REF_ONE 32767
+
+/**
+ * @brief Demodulator state
+ */
+typedef struct {
+    int16_t ref_i[GROVE_AQS_LOCKIN_MAX_SAMPLES]; /*!< In-phase reference, positive while the heater is on */
+    int16_t ref_q[GROVE_AQS_LOCKIN_MAX_SAMPLES]; /*!< Quadrature reference */
+    uint8_t samples_per_period;      /*!< Samples per modulation period */
+    uint8_t phase;                   /*!< Index of the next sample within the period */
+    int64_t period_i;                /*!< Sums of the period in progress */
+    int64_t period_q;
+    int32_t period_dc;
+    int64_t sum_i;                   /*!< Sums over the complete periods */
+    int64_t sum_q;
+    int64_t sum_dc;
+    uint32_t periods;                /*!< Complete periods integrated */
+} grove_aqs_lockin_t;
+
+/**
+ * @brief Demodulated response
+ */
+typedef struct {
+    int32_t i_uv;                    /*!< In-phase amplitude of the fundamental */
+    int32_t q_uv;                    /*!< Quadrature amplitude; the heater's thermal lag rotates the response into it */
+    uint32_t amplitude_uv;           /*!< Magnitude of the fundamental, sqrt(i^2 + q^2) */
+    int32_t dc_uv;                   /*!< Mean of the samples */
+    uint32_t periods;                /*!< Complete periods the result covers */
+} grove_aqs_lockin_result_t;
+
+/**
+ * @brief Reset a demodulator
+ *
+ * @param lockin Demodulator
+ * @param samples_per_period Samples per modulation period: 4, 8, 16 or 32
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for another count
+ */
+esp_err_t grove_aqs_lockin_init(grove_aqs_lockin_t *lockin, uint8_t samples_per_period);
+
+/**
+ * @brief Whether the heater should be on while the next sample is taken
+ *
+ * @param lockin Demodulator
+ * @return true in the first half of the period
+ */
+static inline bool grove_aqs_lockin_heater_on(const grove_aqs_lockin_t *lockin) {
+    return lockin->phase < lockin->samples_per_period / 2;
+}
+
+/**
+ * @brief Integrate one sample
+ *
+ * @param lockin Demodulator
+ * @param sample_mv Sample taken at the current phase
+ */
+static inline void grove_aqs_lockin_update(grove_aqs_lockin_t *lockin, int32_t sample_mv) {
+    lockin->period_i += sample_mv * lockin->ref_i[lockin->phase];
+    lockin->period_q += sample_mv * lockin->ref_q[lockin->phase];
+    lockin->period_dc += sample_mv;
+    if (++lockin->phase < lockin->samples_per_period) {
+        return;
+    }
+    lockin->sum_i += lockin->period_i;
+    lockin->sum_q += lockin->period_q;
+    lockin->sum_dc += lockin->period_dc;
+    lockin->period_i = lockin->period_q = lockin->period_dc = 0;
+    lockin->phase = 0;
+    lockin->periods++;
+}
+
+/**
+ * @brief Get the response over the complete periods so far
+ *
+ * @param lockin Demodulator
+ * @param result Where to store the result
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE before the first complete period
+ */
+esp_err_t grove_aqs_lockin_result(const grove_aqs_lockin_t *lockin, grove_aqs_lockin_result_t *result);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Modulate the heater and demodulate the sensor response (blocking)
+ *
+ * Switches the heater between CONFIG_GROVE_AQS_LOCKIN_DUTY_PCT and off at
+ * CONFIG_GROVE_AQS_LOCKIN_FREQ_MHZ and takes
+ * CONFIG_GROVE_AQS_LOCKIN_SAMPLES_PER_PERIOD samples per period, each at
+ * its due time from the start. Blocks the calling task for @p periods
+ * modulation periods, then powers the sensor back on as configured. The
+ * slots are timed with task delays, so a slot (one period divided by the
+ * samples per period) must last at least one FreeRTOS tick.
+ *
+ * @param periods Periods to integrate, 0 for CONFIG_GROVE_AQS_LOCKIN_PERIODS
+ * @param result Where to store the result
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_NOT_SUPPORTED without power_gpio, ESP_ERR_INVALID_ARG if a
+ *         slot is shorter than a tick, otherwise an error code
+ */
+esp_err_t grove_aqs_lockin_measure(uint32_t periods, grove_aqs_lockin_result_t *result);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_LOCKIN_H */
@@ -0,0 +1,76 @@
+/**
+ * @file grove_aqs_port.h
+ * @brief Minimal platform shim for the parts of the component that also build on a Linux host
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#ifndef GROVE_AQS_PORT_H
+#define GROVE_AQS_PORT_H
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/** Monotonic time in microseconds */
+static inline int64_t grove_aqs_port_time_us(void) {
+    return esp_timer_get_time();
+}
+
+/** Let other tasks run while waiting on them, also those of lower priority */
+static inline void grove_aqs_port_yield(void) {
+    vTaskDelay(1);
+}
+
+#else /* !ESP_PLATFORM */
+
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+typedef int esp_err_t;
+
+// Same values as esp_err.h so error codes read the same in host and target logs
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_NOT_SUPPORTED   0x106
+#define ESP_ERR_TIMEOUT         0x107
+#define ESP_ERR_INVALID_RESPONSE 0x108
+#define ESP_ERR_INVALID_CRC     0x109
+#define ESP_ERR_INVALID_VERSION 0x10A
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fprintf(stderr, "I (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do { (void)(tag); } while (0)
+
+/** Monotonic time in microseconds */
+static inline int64_t grove_aqs_port_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Let other threads run while waiting on them */
+static inline void grove_aqs_port_yield(void) {
+    sched_yield();
+}
+
+#endif /* ESP_PLATFORM */
+
+#endif /* GROVE_AQS_PORT_H */
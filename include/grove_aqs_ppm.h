@@ -0,0 +1,191 @@
+/**
+ * @file grove_aqs_ppm.h
+ * @brief Gas concentration estimate from Rs/R0 power-law curves in fixed point
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * The sensing element and the load resistor RL form a divider across the
+ * circuit voltage Vc, and the output is the voltage across RL:
+ *
+ *     Rs = RL * (Vc - Vout) / Vout
+ *
+ * R0 is Rs in clean air, taken from a baseline voltage measured there.
+ * The sensitivity curves are straight lines on the log-log chart of the
+ * datasheet, ppm = a * (Rs/R0)^b, so the whole estimate is linear in log2:
+ *
+ *     log2(Rs/R0) = log2(Vc - Vout) - log2(Vout) + log2(RL/R0)
+ *     log2(ppm)   = log2(a) + b * log2(Rs/R0)
+ *
+ * log2 and exp2 come from 65-entry tables with linear interpolation, so an
+ * estimate costs three table lookups, a multiply and no division or float.
+ * Everything here is platform independent.
+ */
+
+#ifndef GROVE_AQS_PPM_H
+#define GROVE_AQS_PPM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_PPM_GAS
+#define CONFIG_GROVE_AQS_PPM_GAS 0
+#endif
+
+#ifndef CONFIG_GROVE_AQS_LOAD_OHM
+#define CONFIG_GROVE_AQS_LOAD_OHM 10000
+#endif
+
+#ifndef CONFIG_GROVE_AQS_CIRCUIT_MV
+#define CONFIG_GROVE_AQS_CIRCUIT_MV 5000
+#endif
+
+#ifndef CONFIG_GROVE_AQS_CLEAN_AIR_MV
+#define CONFIG_GROVE_AQS_CLEAN_AIR_MV 300
+#endif
+
+/** 1.0 in the Q16 values of this module */
+#define GROVE_AQS_PPM_Q16_ONE 65536
+
+/**
+ * @brief Gases with a built-in curve
+ */
+typedef enum {
+    GROVE_AQS_GAS_ALCOHOL = 0,       /*!< Ethanol */
+    GROVE_AQS_GAS_HYDROGEN,          /*!< Hydrogen */
+    GROVE_AQS_GAS_ISOBUTANE,         /*!< Isobutane */
+    GROVE_AQS_GAS_COUNT
+} grove_aqs_gas_t;
+
+/**
+ * @brief Sensitivity curve, log2(ppm) = log2_ppm_q16 + slope_q16 * log2(Rs/R0)
+ */
+typedef struct {
+    int32_t log2_ppm_q16;            /*!< log2 of the concentration (ppm) at Rs/R0 = 1, Q16 */
+    int32_t slope_q16;               /*!< Exponent b of the power law, Q16; negative for reducing gases */
+    uint32_t min_ratio_q16;          /*!< Rs/R0 range the curve was taken from, Q16 */
+    uint32_t max_ratio_q16;
+} grove_aqs_ppm_curve_t;
+
+/**
+ * @brief Constants of the estimate, derived once from the circuit and the baseline
+ */
+typedef struct {
+    int circuit_mv;                  /*!< Voltage across the sensor and the load resistor */
+    int32_t log2_load_q16;           /*!< log2(RL / 1 ohm), Q16 */
+    int32_t log2_load_r0_q16;        /*!< log2(RL / R0), Q16 */
+    grove_aqs_ppm_curve_t curve;     /*!< Sensitivity curve of the gas */
+} grove_aqs_ppm_params_t;
+
+/**
+ * @brief Estimate for one reading
+ */
+typedef struct {
+    uint32_t rs_ohm;                 /*!< Sensor resistance */
+    uint32_t ratio_q16;              /*!< Rs/R0, Q16 */
+    uint32_t ppm_x10;                /*!< Concentration in 0.1 ppm, saturated at UINT32_MAX */
+    bool in_range;                   /*!< Rs/R0 lies within the range the curve was taken from */
+} grove_aqs_ppm_t;
+
+/**
+ * @brief Base-2 logarithm
+ *
+ * @param x Argument, greater than 0
+ * @return int32_t log2(x) in Q16 (within 4 LSB), INT32_MIN for 0
+ */
+int32_t grove_aqs_log2_q16(uint32_t x);
+
+/**
+ * @brief Base-2 exponential
+ *
+ * @param y Exponent in Q16
+ * @return uint32_t 2^y rounded to an integer (interpolation within 2e-5 relative), saturated at UINT32_MAX
+ */
+uint32_t grove_aqs_exp2_q16(int32_t y);
+
+/**
+ * @brief Fit a curve through two points of a datasheet chart
+ *
+ * @param curve Curve to fill in
+ * @param ppm_a Concentration of the first point
+ * @param ratio_a_milli Rs/R0 of the first point, in thousandths
+ * @param ppm_b Concentration of the second point
+ * @param ratio_b_milli Rs/R0 of the second point, in thousandths
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for a zero or equal ratios
+ */
+esp_err_t grove_aqs_ppm_curve_init(grove_aqs_ppm_curve_t *curve, uint32_t ppm_a, uint32_t ratio_a_milli,
+                                   uint32_t ppm_b, uint32_t ratio_b_milli);
+
+/**
+ * @brief Get the built-in curve of a gas
+ *
+ * The curves are read off the sensitivity chart of the sensing element
+ * (Winsen MP503) and vary from lot to lot: the result is an approximate
+ * concentration, not a calibrated one.
+ *
+ * @param gas Gas
+ * @param curve Curve to fill in
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for an unknown gas
+ */
+esp_err_t grove_aqs_ppm_curve_get(grove_aqs_gas_t gas, grove_aqs_ppm_curve_t *curve);
+
+/**
+ * @brief Derive the per-sample constants
+ *
+ * @param params Parameters to fill in
+ * @param load_ohm Load resistor RL
+ * @param circuit_mv Voltage across the sensor and the load resistor
+ * @param clean_air_mv Output in clean air, which defines R0 (0 < clean_air_mv < circuit_mv)
+ * @param curve Sensitivity curve
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for values out of range
+ */
+esp_err_t grove_aqs_ppm_params_init(grove_aqs_ppm_params_t *params, uint32_t load_ohm, int circuit_mv,
+                                    int clean_air_mv, const grove_aqs_ppm_curve_t *curve);
+
+/**
+ * @brief Estimate Rs, Rs/R0 and the concentration of a reading
+ *
+ * Outputs at or beyond 0 and the circuit voltage are clamped 1 mV inside.
+ *
+ * @param params Constants from grove_aqs_ppm_params_init()
+ * @param voltage_mv Sensor output at full heater power (see grove_aqs_core_compensate())
+ * @param out Estimate
+ */
+void grove_aqs_ppm_estimate(const grove_aqs_ppm_params_t *params, int voltage_mv, grove_aqs_ppm_t *out);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Set the clean-air baseline that defines R0 (implemented by the driver)
+ *
+ * @param clean_air_mv Voltage grove_aqs_read_data() reports in clean air
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_INVALID_ARG for a voltage outside the circuit voltage
+ */
+esp_err_t grove_aqs_set_baseline(int clean_air_mv);
+
+/**
+ * @brief Estimate the concentration of a reading (implemented by the driver)
+ *
+ * Uses the gas selected by CONFIG_GROVE_AQS_PPM_GAS and the heater
+ * compensation of the reading's classification.
+ *
+ * @param voltage_mv Voltage of a reading from grove_aqs_read_data()
+ * @param out Estimate
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t grove_aqs_estimate_ppm(int voltage_mv, grove_aqs_ppm_t *out);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_PPM_H */
@@ -0,0 +1,210 @@
+/**
+ * @file grove_aqs_preset.h
+ * @brief Named classification presets with atomic switching and a time-of-day schedule
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * A preset is a complete set of the per-sample constants readings use
+ * (thresholds, hysteresis, smoothing, and the device's gain and offset),
+ * derived once when it is defined. Selecting a preset points the driver
+ * at it with one pointer store: nothing is re-derived and the ADC set up
+ * by grove_aqs_init() is not touched. Typical presets are thresholds for
+ * occupied and unoccupied hours, or for different room types. (They are
+ * not called profiles to keep them apart from the heater profiles of
+ * grove_aqs_profile.h.)
+ *
+ * A schedule maps weekdays and times of day to presets. The lookup is
+ * platform independent; on the target an esp_timer checks it once a
+ * minute against the local time.
+ */
+
+#ifndef GROVE_AQS_PRESET_H
+#define GROVE_AQS_PRESET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_live.h"
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_PRESET_COUNT
+#define CONFIG_GROVE_AQS_PRESET_COUNT 4
+#endif
+
+/** Longest preset name, without the terminating NUL */
+#define GROVE_AQS_PRESET_NAME_MAX 15
+
+/** Most entries of a schedule */
+#define GROVE_AQS_SCHEDULE_MAX 16
+
+/** Minutes of a day */
+#define GROVE_AQS_SCHEDULE_MINUTES_PER_DAY 1440
+
+/** Days mask of an entry that applies every day; bit n is weekday n, 0 for Sunday (as tm_wday) */
+#define GROVE_AQS_SCHEDULE_EVERY_DAY 0x7F
+
+/** Days mask of Monday to Friday */
+#define GROVE_AQS_SCHEDULE_WEEKDAYS 0x3E
+
+/** Days mask of Saturday and Sunday */
+#define GROVE_AQS_SCHEDULE_WEEKEND 0x41
+
+/**
+ * @brief Preset
+ */
+typedef struct {
+    char name[GROVE_AQS_PRESET_NAME_MAX + 1]; /*!< Empty while undefined */
+    grove_aqs_core_params_t params;  /*!< Constants readings use while the preset is selected */
+} grove_aqs_preset_t;
+
+/**
+ * @brief Schedule entry: from this time on, on the given days, the preset applies
+ */
+typedef struct {
+    uint16_t minute;                 /*!< Minute of the day the entry starts (0-1439) */
+    uint8_t days;                    /*!< Days it applies, bit per weekday, bit 0 Sunday */
+    uint8_t preset;                  /*!< Preset index */
+} grove_aqs_schedule_entry_t;
+
+/**
+ * @brief Weekly schedule; an entry applies until the next one that starts on a later minute or day
+ */
+typedef struct {
+    grove_aqs_schedule_entry_t entries[GROVE_AQS_SCHEDULE_MAX]; /*!< In any order */
+    uint8_t count;                   /*!< Entries used */
+} grove_aqs_schedule_t;
+
+/**
+ * @brief Find a preset by name
+ *
+ * @param presets Preset table
+ * @param count Presets in the table
+ * @param name Name
+ * @return int Index, or -1 if no defined preset has the name
+ */
+int grove_aqs_preset_find(const grove_aqs_preset_t *presets, size_t count, const char *name);
+
+/**
+ * @brief Carry a new gain and offset over to every defined preset
+ *
+ * A selected preset is rewritten through grove_aqs_live_rewrite(), so
+ * readings keep seeing whole presets.
+ *
+ * @param live Live constants, which may point at one of the presets
+ * @param presets Preset table
+ * @param count Presets in the table
+ * @param base Constants holding the new gain and offset
+ * @return true if one of the presets is selected and now has them in use
+ */
+bool grove_aqs_preset_rebase(grove_aqs_live_params_t *live, grove_aqs_preset_t *presets, size_t count,
+                             const grove_aqs_core_params_t *base);
+
+/**
+ * @brief Add an entry to a schedule
+ *
+ * @param schedule Schedule, zeroed before the first entry
+ * @param days Days the entry applies (GROVE_AQS_SCHEDULE_EVERY_DAY etc.)
+ * @param hour Start hour (0-23)
+ * @param minute Start minute (0-59)
+ * @param preset Preset index (below CONFIG_GROVE_AQS_PRESET_COUNT)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for values out of range,
+ *         ESP_ERR_NO_MEM if the schedule is full
+ */
+esp_err_t grove_aqs_schedule_add(grove_aqs_schedule_t *schedule, uint8_t days, uint8_t hour, uint8_t minute,
+                                 uint8_t preset);
+
+/**
+ * @brief Preset the schedule selects at a time
+ *
+ * The latest entry that started at or before the time applies, looking
+ * back up to a week, so an evening entry still applies after midnight.
+ *
+ * @param schedule Schedule
+ * @param weekday Day of the week (0-6, 0 for Sunday)
+ * @param minute Minute of the day (0-1439)
+ * @return int Preset index, or -1 for an empty schedule
+ */
+int grove_aqs_schedule_lookup(const grove_aqs_schedule_t *schedule, uint8_t weekday, uint16_t minute);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Define or replace a preset (implemented by the driver)
+ *
+ * The constants are derived here, from the given settings and the
+ * device's current gain and offset (heater power and calibration). A new
+ * calibration is carried over to all presets. Redefining the selected
+ * preset takes effect right away.
+ *
+ * @param index Preset index (below CONFIG_GROVE_AQS_PRESET_COUNT)
+ * @param name Name, 1-GROVE_AQS_PRESET_NAME_MAX characters
+ * @param thresholds Ascending upper bounds (mV) of fresh, good, moderate and poor
+ * @param hysteresis_mv See grove_aqs_core_params_t::hysteresis_mv
+ * @param filter_shift See grove_aqs_core_params_t::filter_shift
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_INVALID_ARG for values out of range
+ */
+esp_err_t grove_aqs_preset_define(uint8_t index, const char *name,
+                                  const int thresholds[GROVE_AQS_QUALITY_LEVEL_COUNT - 1], int hysteresis_mv,
+                                  uint8_t filter_shift);
+
+/**
+ * @brief Switch readings to a preset (implemented by the driver)
+ *
+ * One pointer store; safe to call while another task reads.
+ *
+ * @param index Preset index
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_NOT_FOUND if the preset is not defined
+ */
+esp_err_t grove_aqs_preset_select(uint8_t index);
+
+/**
+ * @brief Switch readings to a preset by name (implemented by the driver)
+ *
+ * @param name Preset name
+ * @return esp_err_t As grove_aqs_preset_select()
+ */
+esp_err_t grove_aqs_preset_select_name(const char *name);
+
+/**
+ * @brief Index of the selected preset (implemented by the driver)
+ *
+ * @return int Index, or -1 while the settings of grove_aqs_init() or a config blob apply
+ */
+int grove_aqs_preset_active(void);
+
+/**
+ * @brief Start switching presets by a schedule
+ *
+ * An esp_timer checks the schedule once a minute against the local time
+ * (time() and the TZ setting) and selects the scheduled preset when it
+ * changes, so a preset selected by hand holds until the next scheduled
+ * change. Nothing is switched while the clock is not set (before 2020).
+ *
+ * @param schedule Schedule, copied
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if a schedule is running,
+ *         ESP_ERR_INVALID_ARG for an entry out of range, or an esp_timer error
+ */
+esp_err_t grove_aqs_schedule_start(const grove_aqs_schedule_t *schedule);
+
+/**
+ * @brief Stop the schedule; the selected preset stays
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if no schedule is running
+ */
+esp_err_t grove_aqs_schedule_stop(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_PRESET_H */
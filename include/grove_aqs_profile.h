@@ -0,0 +1,223 @@
+/**
+ * @file grove_aqs_profile.h
+ * @brief Heater profile modulation with phase-locked sampling and per-cycle feature vectors
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * A profile is a cycle of heater steps (duty and duration) plus the phases,
+ * as offsets from the start of the cycle, at which the sensor is sampled.
+ * A MOX sensor's response over such a cycle depends on the gas, not only on
+ * its concentration, so each cycle yields a feature vector: the voltage at
+ * every phase and the same normalised by the cycle mean (the shape).
+ *
+ * The runner schedules every step change and sample at the cycle start plus
+ * its offset. A late event is recorded as phase error but does not shift
+ * the following ones, so the sampling stays locked to the heater. The
+ * runner, the feature extraction and the ring of recent feature vectors are
+ * platform independent and take the heater and the ADC as callbacks; on the
+ * target grove_aqs_profile_start() drives them from an esp_timer, on a host
+ * a simulation drives them in virtual time.
+ */
+
+#ifndef GROVE_AQS_PROFILE_H
+#define GROVE_AQS_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_PROFILE_RING_SIZE
+#define CONFIG_GROVE_AQS_PROFILE_RING_SIZE 8
+#endif
+
+/** Maximum heater steps per cycle */
+#define GROVE_AQS_PROFILE_MAX_STEPS 8
+
+/** Maximum sample phases per cycle */
+#define GROVE_AQS_PROFILE_MAX_PHASES 16
+
+/** Maximum scheduled events per cycle: one per step and one per phase */
+#define GROVE_AQS_PROFILE_MAX_EVENTS (GROVE_AQS_PROFILE_MAX_STEPS + GROVE_AQS_PROFILE_MAX_PHASES)
+
+/** Feature vectors kept; the newest CONFIG_GROVE_AQS_PROFILE_RING_SIZE - 1 can be read */
+#define GROVE_AQS_PROFILE_RING_SIZE CONFIG_GROVE_AQS_PROFILE_RING_SIZE
+
+/** Fractional bits of the shape values */
+#define GROVE_AQS_PROFILE_SHAPE_SHIFT 12
+
+/**
+ * @brief One heater step
+ */
+typedef struct {
+    uint8_t duty_pct;                /*!< Heater power, 0-100 (switched supplies: 0 off, otherwise on) */
+    uint32_t duration_ms;            /*!< How long the step lasts */
+} grove_aqs_profile_step_t;
+
+/**
+ * @brief Heater profile and sample phases of one cycle
+ */
+typedef struct {
+    grove_aqs_profile_step_t steps[GROVE_AQS_PROFILE_MAX_STEPS]; /*!< Steps in order, starting at offset 0 */
+    uint8_t step_count;              /*!< Number of steps (1-GROVE_AQS_PROFILE_MAX_STEPS) */
+    uint32_t phase_ms[GROVE_AQS_PROFILE_MAX_PHASES]; /*!< Sample offsets from the cycle start, ascending */
+    uint8_t phase_count;             /*!< Number of phases (1-GROVE_AQS_PROFILE_MAX_PHASES) */
+} grove_aqs_profile_t;
+
+/**
+ * @brief Response of one cycle
+ */
+typedef struct {
+    uint32_t cycle;                  /*!< Cycle number since the runner started */
+    uint8_t phase_count;             /*!< Valid entries in mv and shape_q12 */
+    uint16_t mv[GROVE_AQS_PROFILE_MAX_PHASES];        /*!< Voltage at each phase */
+    uint16_t shape_q12[GROVE_AQS_PROFILE_MAX_PHASES]; /*!< mv / mean_mv, independent of the concentration */
+    uint16_t mean_mv;                /*!< Mean over the phases */
+    uint16_t min_mv;                 /*!< Lowest phase voltage */
+    uint16_t max_mv;                 /*!< Highest phase voltage */
+    uint32_t max_phase_error_us;     /*!< Largest delay of a sample behind its phase */
+} grove_aqs_profile_features_t;
+
+/**
+ * @brief Heater and ADC access of the runner
+ */
+typedef struct {
+    void (*set_duty)(void *ctx, uint8_t duty_pct);  /*!< Switch the heater to a step's duty */
+    int (*sample_mv)(void *ctx);                    /*!< Take a sample; negative on error */
+    void (*cycle_done)(void *ctx, const grove_aqs_profile_features_t *features); /*!< Optional */
+    void *ctx;                                      /*!< Passed to the callbacks */
+} grove_aqs_profile_io_t;
+
+/**
+ * @brief Scheduled event within a cycle
+ */
+typedef struct {
+    uint32_t offset_us;              /*!< Offset from the cycle start */
+    uint8_t sample;                  /*!< 0: heater step, 1: sample */
+    uint8_t index;                   /*!< Step or phase index */
+} grove_aqs_profile_event_t;
+
+/**
+ * @brief Runner state, in fixed memory
+ */
+typedef struct {
+    grove_aqs_profile_event_t events[GROVE_AQS_PROFILE_MAX_EVENTS]; /*!< Events of a cycle by offset */
+    uint8_t event_count;             /*!< Valid entries in events */
+    uint8_t next;                    /*!< Next event of the current cycle */
+    uint8_t step_duty[GROVE_AQS_PROFILE_MAX_STEPS]; /*!< Duty of each step */
+    uint8_t phase_count;             /*!< Phases per cycle */
+    uint32_t cycle_us;               /*!< Cycle length */
+    int64_t cycle_start_us;          /*!< Start of the current cycle */
+    uint32_t resyncs;                /*!< Cycles restarted because the runner fell a whole cycle behind */
+    uint32_t sample_errors;          /*!< Failed samples (their cycles are dropped) */
+    grove_aqs_profile_io_t io;       /*!< Heater and ADC access */
+    grove_aqs_profile_features_t current; /*!< Features of the cycle in progress */
+    uint32_t sampled;                /*!< Bit per phase sampled in the current cycle */
+} grove_aqs_profile_runner_t;
+
+/**
+ * @brief Length of one cycle
+ *
+ * @param profile Profile
+ * @return uint32_t Sum of the step durations in ms
+ */
+uint32_t grove_aqs_profile_cycle_ms(const grove_aqs_profile_t *profile);
+
+/**
+ * @brief Validate a profile and order its steps and samples by offset
+ *
+ * At equal offsets a step comes before a sample, so a sample at a step
+ * boundary sees the new duty.
+ *
+ * @param profile Profile
+ * @param events Destination, GROVE_AQS_PROFILE_MAX_EVENTS entries
+ * @param count Set to the number of events
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if the profile is malformed
+ */
+esp_err_t grove_aqs_profile_build(const grove_aqs_profile_t *profile, grove_aqs_profile_event_t *events, size_t *count);
+
+/**
+ * @brief Prepare a runner; the first cycle starts at @p now_us
+ *
+ * @param runner Runner
+ * @param profile Profile
+ * @param io Heater and ADC access (set_duty and sample_mv are required)
+ * @param now_us Current time
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if the profile is malformed
+ */
+esp_err_t grove_aqs_profile_runner_init(grove_aqs_profile_runner_t *runner, const grove_aqs_profile_t *profile,
+                                        const grove_aqs_profile_io_t *io, int64_t now_us);
+
+/**
+ * @brief Run every event due at @p now_us
+ *
+ * When the last event of a cycle has run, the cycle's features are passed
+ * to io.cycle_done (unless a sample failed) and the next cycle starts one
+ * cycle length after the previous one.
+ *
+ * @param runner Runner
+ * @param now_us Current time
+ * @return int64_t When the next event is due
+ */
+int64_t grove_aqs_profile_runner_poll(grove_aqs_profile_runner_t *runner, int64_t now_us);
+
+/**
+ * @brief Append a feature vector to the ring of recent cycles, overwriting the oldest
+ *
+ * Single writer: the task or timer running the profile.
+ *
+ * @param features Feature vector
+ */
+void grove_aqs_profile_publish(const grove_aqs_profile_features_t *features);
+
+/**
+ * @brief Copy the feature vectors of the most recent cycles, oldest first
+ *
+ * Lock-free; may run in any task while the writer publishes.
+ *
+ * @param out Destination
+ * @param max Capacity of @p out
+ * @return size_t Number copied, at most GROVE_AQS_PROFILE_RING_SIZE - 1
+ */
+size_t grove_aqs_profile_read(grove_aqs_profile_features_t *out, size_t max);
+
+/**
+ * @brief Empty the ring
+ */
+void grove_aqs_profile_clear(void);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Start cycling the heater through a profile and sampling its phases
+ *
+ * Events run from an esp_timer callback; each completed cycle is published
+ * to the ring read by grove_aqs_profile_read(). Do not read the sensor with
+ * grove_aqs_read_data() or switch its power while a profile runs.
+ *
+ * @param profile Profile (copied)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if already running,
+ *         ESP_ERR_INVALID_ARG if the profile is malformed
+ */
+esp_err_t grove_aqs_profile_start(const grove_aqs_profile_t *profile);
+
+/**
+ * @brief Stop the profile and power the sensor back on as configured
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not running
+ */
+esp_err_t grove_aqs_profile_stop(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_PROFILE_H */
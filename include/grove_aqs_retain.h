@@ -0,0 +1,170 @@
+/**
+ * @file grove_aqs_retain.h
+ * @brief Driver state carried across deep sleep and restarts in retained (RTC) memory
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * The state block holds the driver's last reading and stage timings plus
+ * the history samples not yet written to flash, behind a header with a
+ * magic, a layout version and a CRC. On the target it lives in RTC slow
+ * memory that is not initialised at boot (RTC_NOINIT_ATTR), so it survives
+ * deep sleep and software resets such as the restart after an OTA update.
+ * After a power-on reset the header does not match and the block is ignored.
+ *
+ * The block format and the store/load functions are platform independent;
+ * on a Linux host the retained region is any memory set with
+ * grove_aqs_retain_set_region(), e.g. a shared file mapping that outlives
+ * the process.
+ */
+
+#ifndef GROVE_AQS_RETAIN_H
+#define GROVE_AQS_RETAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_history.h"
+#include "grove_aqs_port.h"
+#ifdef ESP_PLATFORM
+#include "grove_analog_aqs.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Magic at the start of a valid state block ("AQSR") */
+#define GROVE_AQS_RETAIN_MAGIC 0x52535141u
+
+/** Layout version of the state block; bumped whenever grove_aqs_retain_state_t changes */
+#define GROVE_AQS_RETAIN_VERSION 3
+
+/** Read stages whose recent worst-case duration is retained */
+#define GROVE_AQS_RETAIN_STAGES 4
+
+/** Pending history samples the block can hold (a batch never holds more than batch_size - 1) */
+#define GROVE_AQS_RETAIN_MAX_SAMPLES CONFIG_GROVE_AQS_HISTORY_BATCH_SIZE
+
+/**
+ * @brief Driver part of the retained state
+ */
+typedef struct {
+    uint32_t config_hash;            /*!< Identifies the driver configuration the state belongs to */
+    uint32_t resume_count;           /*!< Boots resumed from retained state since the last cold start */
+    uint32_t stage_cost_us[GROVE_AQS_RETAIN_STAGES]; /*!< Recent worst-case durations of conversion, calibration,
+                                                          processing and inference */
+    grove_aqs_core_track_t track;    /*!< Smoothed voltage and level, so hysteresis carries across the reboot */
+    uint16_t last_raw;               /*!< Last raw ADC reading */
+    uint16_t last_mv;                /*!< Last voltage in mV */
+    uint8_t last_quality;            /*!< Last air quality level (grove_aqs_quality_t) */
+    uint8_t have_last;               /*!< Whether the last reading is valid */
+    uint8_t reserved[2];
+} grove_aqs_retain_driver_t;
+
+/**
+ * @brief Everything carried over to the next boot
+ */
+typedef struct {
+    grove_aqs_retain_driver_t driver; /*!< Driver state */
+    uint16_t pending_count;          /*!< Number of valid entries in pending */
+    grove_aqs_history_sample_t pending[GROVE_AQS_RETAIN_MAX_SAMPLES]; /*!< History samples not yet on flash */
+} grove_aqs_retain_state_t;
+
+/**
+ * @brief State block as laid out in the retained region
+ */
+typedef struct {
+    uint32_t magic;                  /*!< GROVE_AQS_RETAIN_MAGIC */
+    uint16_t version;                /*!< GROVE_AQS_RETAIN_VERSION */
+    uint16_t size;                   /*!< sizeof(grove_aqs_retain_state_t) */
+    uint32_t crc;                    /*!< CRC-32 over the state */
+    grove_aqs_retain_state_t state;  /*!< The state */
+} grove_aqs_retain_block_t;
+
+/**
+ * @brief Use a different retained region
+ *
+ * On the target the block defaults to RTC slow memory; on a host a region
+ * must be set before storing or loading.
+ *
+ * @param mem Region, aligned for grove_aqs_retain_block_t
+ * @param size Size of the region in bytes
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if the block does not fit
+ */
+esp_err_t grove_aqs_retain_set_region(void *mem, size_t size);
+
+/**
+ * @brief Write a state to the retained region
+ *
+ * @param state State to keep
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if no region is set
+ */
+esp_err_t grove_aqs_retain_store(const grove_aqs_retain_state_t *state);
+
+/**
+ * @brief Read and validate the state in the retained region
+ *
+ * @param state Where to copy the state
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if there is no block
+ *         (cold boot), ESP_ERR_INVALID_VERSION if it has another layout,
+ *         ESP_ERR_INVALID_CRC if it is corrupted
+ */
+esp_err_t grove_aqs_retain_load(grove_aqs_retain_state_t *state);
+
+/**
+ * @brief Invalidate the retained block so it is not restored twice
+ */
+void grove_aqs_retain_clear(void);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Export the driver state (implemented by the driver)
+ *
+ * @param state Driver state to fill in
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t grove_aqs_export_state(grove_aqs_retain_driver_t *state);
+
+/**
+ * @brief Import a previously exported driver state (implemented by the driver)
+ *
+ * @param state Driver state
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized,
+ *         ESP_ERR_INVALID_VERSION if the state belongs to another configuration
+ */
+esp_err_t grove_aqs_import_state(const grove_aqs_retain_driver_t *state);
+
+/**
+ * @brief Save the driver state and the pending history samples before deep sleep or a restart
+ *
+ * If the history is initialized and holds more pending samples than the
+ * block can take, they are flushed to flash instead.
+ *
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_retain_save(void);
+
+/**
+ * @brief Initialize the driver and restore the retained state if there is one
+ *
+ * Calls grove_aqs_init() and then, if a valid block for the same
+ * configuration exists, restores the driver state and appends the pending
+ * samples to the history (initialize the history first to get them back).
+ * The block is invalidated afterwards.
+ *
+ * @param config Driver configuration, as for grove_aqs_init()
+ * @param resumed Set to true if retained state was restored (may be NULL)
+ * @return esp_err_t Result of grove_aqs_init()
+ */
+esp_err_t grove_aqs_retain_resume(const grove_aqs_config_t *config, bool *resumed);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_RETAIN_H */
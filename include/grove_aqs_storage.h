@@ -0,0 +1,82 @@
+/**
+ * @file grove_aqs_storage.h
+ * @brief Flash-like storage backends (flash partition on target, plain file on Linux) for sample history
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#ifndef GROVE_AQS_STORAGE_H
+#define GROVE_AQS_STORAGE_H
+
+#include <stddef.h>
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Storage region with NOR flash semantics
+ *
+ * Erased bytes read as 0xFF, erase works on whole sectors and writes only
+ * ever go to erased locations. Backends that can map the region into the
+ * address space set @c mapped, and readers then decode in place instead of
+ * copying through @c read.
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, size_t offset, void *dst, size_t len);         /*!< Read bytes */
+    esp_err_t (*write)(void *ctx, size_t offset, const void *src, size_t len);  /*!< Program erased bytes */
+    esp_err_t (*erase)(void *ctx, size_t offset, size_t len);                   /*!< Erase whole sectors */
+    esp_err_t (*close)(void *ctx);                                              /*!< Release the backend */
+    void *ctx;                       /*!< Backend specific context */
+    const void *mapped;              /*!< Read-only mapping of the whole region, NULL if reads must copy */
+    size_t size;                     /*!< Usable size in bytes (multiple of sector_size) */
+    size_t sector_size;              /*!< Erase unit in bytes */
+} grove_aqs_storage_t;
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Open a data partition as history storage
+ *
+ * The partition is also mapped read-only with esp_partition_mmap() when
+ * there is enough free MMU space; otherwise reads fall back to copying.
+ *
+ * @param label Partition label from the partition table
+ * @param storage Storage descriptor to fill in
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such partition
+ */
+esp_err_t grove_aqs_storage_open_partition(const char *label, grove_aqs_storage_t *storage);
+#endif
+
+/**
+ * @brief Open (and create if needed) a file emulating a flash partition
+ *
+ * A new or shorter file is extended to @p size bytes of erased (0xFF) content.
+ * On POSIX hosts the file is also mapped read-only with mmap().
+ *
+ * @param path File path
+ * @param size Partition size in bytes (multiple of sector_size)
+ * @param sector_size Emulated erase unit in bytes
+ * @param storage Storage descriptor to fill in
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_storage_open_file(const char *path, size_t size, size_t sector_size,
+                                      grove_aqs_storage_t *storage);
+
+/**
+ * @brief Close a storage backend opened by one of the open functions
+ *
+ * @param storage Storage descriptor
+ * @return esp_err_t ESP_OK on success, otherwise an error code
+ */
+esp_err_t grove_aqs_storage_close(grove_aqs_storage_t *storage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_STORAGE_H */
@@ -0,0 +1,158 @@
+/**
+ * @file grove_aqs_trace.h
+ * @brief Timeline trace points of the driver, exported as Chrome trace JSON
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Trace points record into a per-core ring of fixed-size events. On a Linux
+ * host the rings are written out as Chrome trace JSON (chrome://tracing,
+ * ui.perfetto.dev). On the target the raw events are sent through
+ * esp_app_trace and converted on the host with aqs_trace2json.
+ *
+ * Without CONFIG_GROVE_AQS_TRACE the GROVE_AQS_TRACE_* macros compile to
+ * nothing and none of this is built.
+ */
+
+#ifndef GROVE_AQS_TRACE_H
+#define GROVE_AQS_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "grove_aqs_port.h"
+#ifdef ESP_PLATFORM
+#include "soc/soc_caps.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_TRACE_BUFFER_SIZE
+#define CONFIG_GROVE_AQS_TRACE_BUFFER_SIZE 4096
+#endif
+
+/** Number of per-core rings */
+#ifdef ESP_PLATFORM
+#define GROVE_AQS_TRACE_CORES SOC_CPU_CORES_NUM
+#else
+#define GROVE_AQS_TRACE_CORES 8
+#endif
+
+/** Magic at the start of a raw trace dump ("AQST") */
+#define GROVE_AQS_TRACE_DUMP_MAGIC 0x54535141u
+
+/**
+ * @brief Traced activities
+ */
+typedef enum {
+    GROVE_AQS_TRACE_CONVERSION = 0,  /*!< ADC conversion and voltage calibration of one sample */
+    GROVE_AQS_TRACE_BATCH_HANDOFF,   /*!< A sample or batch handed to the processing stage */
+    GROVE_AQS_TRACE_SECTOR_OPEN,     /*!< History sector erase/reclaim */
+    GROVE_AQS_TRACE_BATCH_WRITE,     /*!< Compressed history record programmed to flash */
+    GROVE_AQS_TRACE_HISTORY_MOUNT,   /*!< History mount (journal head recovery) */
+    GROVE_AQS_TRACE_HISTORY_QUERY,   /*!< History aggregate or downsampling query */
+    GROVE_AQS_TRACE_CONSUMER_WAKE,   /*!< A consumer task woke up to process data */
+    GROVE_AQS_TRACE_DLOG_DRAIN,      /*!< Deferred log records drained */
+    GROVE_AQS_TRACE_EVENT_COUNT
+} grove_aqs_trace_event_id_t;
+
+/**
+ * @brief One recorded event, also the format of a raw dump record
+ */
+typedef struct {
+    uint32_t timestamp_us;           /*!< Low 32 bits of grove_aqs_port_time_us() */
+    uint16_t event;                  /*!< grove_aqs_trace_event_id_t */
+    uint8_t phase;                   /*!< 'B' begin, 'E' end, 'i' instant */
+    uint8_t core;                    /*!< Core (host: CPU) the event was recorded on */
+    int32_t arg;                     /*!< Event argument (sample count, bytes, ...) */
+} grove_aqs_trace_event_t;
+
+/**
+ * @brief Header of a raw dump, followed by @c count events
+ */
+typedef struct {
+    uint32_t magic;                  /*!< GROVE_AQS_TRACE_DUMP_MAGIC */
+    uint32_t count;                  /*!< Number of events that follow */
+} grove_aqs_trace_dump_header_t;
+
+/**
+ * @brief Clear the buffers and start recording
+ */
+void grove_aqs_trace_start(void);
+
+/**
+ * @brief Stop recording; buffers keep the newest events of each core
+ */
+void grove_aqs_trace_stop(void);
+
+/**
+ * @brief Record one event (called through the GROVE_AQS_TRACE_* macros)
+ *
+ * @param event Event ID
+ * @param phase 'B', 'E' or 'i'
+ * @param arg Event argument
+ */
+void grove_aqs_trace_record(grove_aqs_trace_event_id_t event, char phase, int32_t arg);
+
+/**
+ * @brief Name of an event as shown in the trace viewer
+ *
+ * @param event Event ID
+ * @return const char* Event name
+ */
+const char* grove_aqs_trace_event_name(uint16_t event);
+
+/**
+ * @brief Write events as Chrome trace JSON
+ *
+ * Timestamps are unwrapped per core, so the events of one core must be in
+ * recording order.
+ *
+ * @param out Output stream
+ * @param events Events
+ * @param count Number of events
+ */
+void grove_aqs_trace_write_json(FILE *out, const grove_aqs_trace_event_t *events, size_t count);
+
+/**
+ * @brief Write the recorded events of all cores as Chrome trace JSON
+ *
+ * Call after grove_aqs_trace_stop().
+ *
+ * @param out Output stream
+ * @return esp_err_t ESP_OK on success, ESP_FAIL on a write error
+ */
+esp_err_t grove_aqs_trace_export_json(FILE *out);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Send the recorded events as a raw dump through esp_app_trace
+ *
+ * Call after grove_aqs_trace_stop(); convert the received file with
+ * aqs_trace2json on the host.
+ *
+ * @param timeout_us Timeout for each esp_apptrace_write() call
+ * @return esp_err_t ESP_OK on success, otherwise the esp_app_trace error
+ */
+esp_err_t grove_aqs_trace_send_apptrace(uint32_t timeout_us);
+#endif
+
+#if CONFIG_GROVE_AQS_TRACE
+#define GROVE_AQS_TRACE_BEGIN(event, arg)   grove_aqs_trace_record((event), 'B', (int32_t)(arg))
+#define GROVE_AQS_TRACE_END(event, arg)     grove_aqs_trace_record((event), 'E', (int32_t)(arg))
+#define GROVE_AQS_TRACE_INSTANT(event, arg) grove_aqs_trace_record((event), 'i', (int32_t)(arg))
+#else
+#define GROVE_AQS_TRACE_BEGIN(event, arg)   do { } while (0)
+#define GROVE_AQS_TRACE_END(event, arg)     do { } while (0)
+#define GROVE_AQS_TRACE_INSTANT(event, arg) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_TRACE_H */
@@ -0,0 +1,165 @@
+/**
+ * @file grove_aqs_wake.h
+ * @brief Deep-sleep wake stub that samples the sensor and only boots when needed
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Each wake from deep sleep first runs a stub from RTC memory. The stub
+ * powers the sensor, takes one ADC1 conversion by direct register access,
+ * appends the raw value to a buffer in RTC memory and goes back to sleep,
+ * unless the air quality level left the band it had at the last full boot
+ * or the buffer is full. Only then does the chip boot the application,
+ * which collects the buffered samples with grove_aqs_wake_take_samples().
+ *
+ * The decision works on raw ADC values so the stub needs neither the
+ * calibration scheme nor any code in flash. grove_aqs_wake_decide() is
+ * always inlined, so the same code runs in the stub and in host tests.
+ */
+
+#ifndef GROVE_AQS_WAKE_H
+#define GROVE_AQS_WAKE_H
+
+#include <stdint.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_port.h"
+#ifdef ESP_PLATFORM
+#include "grove_analog_aqs.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_WAKE_BUFFER_SIZE
+#define CONFIG_GROVE_AQS_WAKE_BUFFER_SIZE 32
+#endif
+
+#ifndef CONFIG_GROVE_AQS_WAKE_HYSTERESIS_MV
+#define CONFIG_GROVE_AQS_WAKE_HYSTERESIS_MV 50
+#endif
+
+#ifndef CONFIG_GROVE_AQS_WAKE_WARMUP_MS
+#define CONFIG_GROVE_AQS_WAKE_WARMUP_MS 0
+#endif
+
+/** Raw samples buffered in RTC memory between full boots */
+#define GROVE_AQS_WAKE_BUFFER_SIZE CONFIG_GROVE_AQS_WAKE_BUFFER_SIZE
+
+/**
+ * @brief What the wake stub does after taking a sample
+ */
+typedef enum {
+    GROVE_AQS_WAKE_SLEEP = 0,        /*!< Go back to sleep */
+    GROVE_AQS_WAKE_BOOT_THRESHOLD,   /*!< Boot: the air quality level changed */
+    GROVE_AQS_WAKE_BOOT_BUFFER_FULL, /*!< Boot: the sample buffer is full */
+} grove_aqs_wake_action_t;
+
+/**
+ * @brief Decision parameters, kept in RTC memory
+ */
+typedef struct {
+    uint16_t raw_thresholds[GROVE_AQS_QUALITY_LEVEL_COUNT - 1]; /*!< Level thresholds as raw ADC values */
+    uint16_t hysteresis_raw;         /*!< How far past a threshold a sample must be to count as a change */
+    uint8_t level;                   /*!< Air quality level at the last full boot */
+} grove_aqs_wake_config_t;
+
+/**
+ * @brief Derive the decision parameters from the core parameters
+ *
+ * Each threshold becomes the largest raw value that the linear
+ * approximation (the conversion the driver uses without ADC calibration)
+ * followed by the gain and offset still puts at or below it, so the stub
+ * decides levels as the driver does.
+ *
+ * @param config Parameters to fill in
+ * @param params Core parameters in use (thresholds, gain, offset and vref)
+ * @param hysteresis_mv Hysteresis around each threshold in mV, in the threshold domain
+ * @param raw Raw value of the current reading; its level is the reference band
+ */
+void grove_aqs_wake_config_init(grove_aqs_wake_config_t *config, const grove_aqs_core_params_t *params,
+                                int hysteresis_mv, uint16_t raw);
+
+/**
+ * @brief Air quality level of a raw value
+ *
+ * @param config Decision parameters
+ * @param raw Raw ADC value
+ * @return uint8_t Level (grove_aqs_quality_t)
+ */
+static inline __attribute__((always_inline))
+uint8_t grove_aqs_wake_level(const grove_aqs_wake_config_t *config, uint16_t raw) {
+    uint8_t level = 0;
+    while (level < GROVE_AQS_QUALITY_LEVEL_COUNT - 1 && raw > config->raw_thresholds[level]) {
+        level++;
+    }
+    return level;
+}
+
+/**
+ * @brief Decide whether to boot after a sample was appended
+ *
+ * A sample only counts as a level change once it lies more than the
+ * hysteresis outside the band of the reference level, so noise around a
+ * threshold does not boot the chip on every wake.
+ *
+ * @param config Decision parameters
+ * @param count Samples in the buffer, including this one
+ * @param raw Raw value of this sample
+ * @return grove_aqs_wake_action_t What to do
+ */
+static inline __attribute__((always_inline))
+grove_aqs_wake_action_t grove_aqs_wake_decide(const grove_aqs_wake_config_t *config, uint32_t count, uint16_t raw) {
+    uint8_t level = config->level;
+    if (level > 0 && raw + config->hysteresis_raw <= config->raw_thresholds[level - 1]) {
+        return GROVE_AQS_WAKE_BOOT_THRESHOLD;
+    }
+    if (level < GROVE_AQS_QUALITY_LEVEL_COUNT - 1 && raw > config->raw_thresholds[level] + config->hysteresis_raw) {
+        return GROVE_AQS_WAKE_BOOT_THRESHOLD;
+    }
+    if (count >= GROVE_AQS_WAKE_BUFFER_SIZE) {
+        return GROVE_AQS_WAKE_BOOT_BUFFER_FULL;
+    }
+    return GROVE_AQS_WAKE_SLEEP;
+}
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Arm the wake stub before esp_deep_sleep_start()
+ *
+ * Takes a reading to set the reference level, derives the stub's
+ * thresholds from the constants in use (grove_aqs_get_params()), so a
+ * calibration, heater compensation or selected preset carries over,
+ * switches power_gpio (if enabled) to RTC control and holds it low,
+ * installs the stub and enables the wakeup timer. Only ADC1 channels can
+ * be sampled from the stub.
+ *
+ * @param config Driver configuration the sensor was initialized with
+ * @param sleep_us Time between samples
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED for ADC2,
+ *         otherwise an error code
+ */
+esp_err_t grove_aqs_wake_arm(const grove_aqs_config_t *config, uint64_t sleep_us);
+
+/**
+ * @brief Collect the samples the stub buffered and disarm it
+ *
+ * Samples are in order and one sleep period apart; the last one was taken
+ * just before this boot.
+ *
+ * @param raw Destination for the raw values
+ * @param max Capacity of @p raw
+ * @param reason Why the stub booted (GROVE_AQS_WAKE_SLEEP if this was not a stub boot; may be NULL)
+ * @return size_t Number of samples copied
+ */
+size_t grove_aqs_wake_take_samples(uint16_t *raw, size_t max, grove_aqs_wake_action_t *reason);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_WAKE_H */
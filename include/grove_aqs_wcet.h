@@ -0,0 +1,184 @@
+/**
+ * @file grove_aqs_wcet.h
+ * @brief Worst-case execution time harness for the read and processing path
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * The harness times an operation (one read plus processing of a raw value)
+ * under adversarial scenarios and keeps a log-linear latency histogram per
+ * scenario. The same code runs on the target, timing grove_aqs_read_data()
+ * with the raw value injected after the conversion, and on a Linux host
+ * (tools/aqs_wcet.c), timing the core stages of a read.
+ *
+ * On the target, run the harness from a task pinned to one core: latencies
+ * are taken from the CPU cycle counter.
+ */
+
+#ifndef GROVE_AQS_WCET_H
+#define GROVE_AQS_WCET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "grove_aqs_core.h"
+#include "grove_aqs_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_GROVE_AQS_WCET_BUDGET_US
+#define CONFIG_GROVE_AQS_WCET_BUDGET_US 100
+#endif
+
+#ifndef CONFIG_GROVE_AQS_WCET_RETRIES
+#define CONFIG_GROVE_AQS_WCET_RETRIES 2
+#endif
+
+/** Histogram resolution: sub-buckets per power of two */
+#define GROVE_AQS_WCET_SUB_BUCKETS 8
+
+/** Number of histogram buckets (covers 1 ns to 2^32 ns) */
+#define GROVE_AQS_WCET_BUCKETS (32 * GROVE_AQS_WCET_SUB_BUCKETS)
+
+/**
+ * @brief Adversarial input scenarios
+ */
+typedef enum {
+    GROVE_AQS_WCET_HOVER = 0,        /*!< Raw values hovering +-1 LSB around every threshold and at the rails */
+    GROVE_AQS_WCET_COLD,             /*!< Caches evicted before every operation */
+    GROVE_AQS_WCET_RETRY,            /*!< Every operation fails until the last allowed retry */
+    GROVE_AQS_WCET_SCENARIO_COUNT
+} grove_aqs_wcet_scenario_t;
+
+/**
+ * @brief Latency histogram with log-linear buckets (at most 12.5% relative bucket width)
+ */
+typedef struct {
+    uint32_t count;                  /*!< Number of samples */
+    uint32_t min_ns;                 /*!< Smallest latency */
+    uint32_t max_ns;                 /*!< Largest latency (exact) */
+    uint64_t sum_ns;                 /*!< Sum of latencies */
+    uint32_t buckets[GROVE_AQS_WCET_BUCKETS]; /*!< Sample counts per bucket */
+} grove_aqs_wcet_hist_t;
+
+/**
+ * @brief Operation under test: read once and process @p raw
+ *
+ * @param ctx User context
+ * @param raw Adversarial raw ADC value for the processing stages
+ * @param fail Fail this attempt the way a failed conversion does (RETRY scenario)
+ * @return esp_err_t Result of the operation; must not be ESP_OK when @p fail is set
+ */
+typedef esp_err_t (*grove_aqs_wcet_op_t)(void *ctx, int raw, bool fail);
+
+/**
+ * @brief Harness configuration
+ */
+typedef struct {
+    grove_aqs_wcet_op_t op;          /*!< Operation under test */
+    void *ctx;                       /*!< Context passed to op */
+    const grove_aqs_core_params_t *params; /*!< Thresholds to hover around */
+    uint32_t iterations;             /*!< Timed operations per scenario */
+    uint32_t budget_ns;              /*!< Latency budget for a single operation */
+    uint8_t retries;                 /*!< Retries allowed after a failed read (RETRY scenario) */
+} grove_aqs_wcet_config_t;
+
+/**
+ * @brief Harness results
+ */
+typedef struct {
+    grove_aqs_wcet_hist_t hist[GROVE_AQS_WCET_SCENARIO_COUNT]; /*!< Latencies per scenario */
+    uint32_t worst_ns;               /*!< Largest latency over all scenarios */
+} grove_aqs_wcet_result_t;
+
+/**
+ * @brief Default harness configuration (op and params must be filled in)
+ */
+#define GROVE_AQS_WCET_DEFAULT_CONFIG() { \
+    .iterations = 10000, \
+    .budget_ns = CONFIG_GROVE_AQS_WCET_BUDGET_US * 1000u, \
+    .retries = CONFIG_GROVE_AQS_WCET_RETRIES, \
+}
+
+/**
+ * @brief Reset a histogram
+ *
+ * @param hist Histogram
+ */
+void grove_aqs_wcet_hist_reset(grove_aqs_wcet_hist_t *hist);
+
+/**
+ * @brief Add one latency to a histogram
+ *
+ * @param hist Histogram
+ * @param ns Latency in ns
+ */
+void grove_aqs_wcet_hist_add(grove_aqs_wcet_hist_t *hist, uint32_t ns);
+
+/**
+ * @brief Latency below which a fraction of the samples lie
+ *
+ * Returns the upper bound of the bucket holding the quantile (capped at the
+ * exact maximum), so the value never understates the latency.
+ *
+ * @param hist Histogram
+ * @param num Quantile numerator (e.g. 999 for p99.9)
+ * @param den Quantile denominator (e.g. 1000)
+ * @return uint32_t Latency in ns
+ */
+uint32_t grove_aqs_wcet_hist_quantile(const grove_aqs_wcet_hist_t *hist, uint32_t num, uint32_t den);
+
+/**
+ * @brief Print summary and non-empty buckets of a histogram
+ *
+ * @param hist Histogram
+ * @param name Label for the summary line
+ * @param out Output stream
+ */
+void grove_aqs_wcet_hist_print(const grove_aqs_wcet_hist_t *hist, const char *name, FILE *out);
+
+/**
+ * @brief Name of a scenario
+ *
+ * @param scenario Scenario
+ * @return const char* Scenario name
+ */
+const char* grove_aqs_wcet_scenario_name(grove_aqs_wcet_scenario_t scenario);
+
+/**
+ * @brief Run all scenarios
+ *
+ * @param config Harness configuration
+ * @param result Results to fill in
+ * @return esp_err_t ESP_OK if every operation met the budget, ESP_ERR_TIMEOUT if
+ *         the budget was exceeded, ESP_ERR_NO_MEM if the cache eviction buffer
+ *         could not be set up, ESP_ERR_INVALID_RESPONSE if the operation
+ *         succeeded although asked to fail
+ */
+esp_err_t grove_aqs_wcet_run(const grove_aqs_wcet_config_t *config, grove_aqs_wcet_result_t *result);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Substitute the ADC result of the next read (implemented by the driver)
+ *
+ * The next read still runs its conversion, then either processes @p raw
+ * through every stage in place of the measured value or fails as a failed
+ * conversion does. Requires CONFIG_GROVE_AQS_WCET.
+ *
+ * @param raw Raw value to process
+ * @param fail Fail the read instead
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t grove_aqs_wcet_inject(int raw, bool fail);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROVE_AQS_WCET_H */
@@ -9,48 +9,486 @@
  * MIT License
  */
 
+#include <stdatomic.h>
 #include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
+#if CONFIG_GROVE_AQS_PM_LOCKS
+#include "esp_pm.h"
+#endif
+#if CONFIG_GROVE_AQS_HEATER_PWM
+#include "driver/ledc.h"
+#endif
+#if CONFIG_GROVE_AQS_CLASSIFY
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "grove_aqs_classify.h"
+#endif
+#if CONFIG_GROVE_AQS_PPM
+#include "grove_aqs_ppm.h"
+#endif
+#if CONFIG_GROVE_AQS_CALIBRATION
+#include "nvs.h"
+#endif
+#if CONFIG_GROVE_AQS_CONFIG_BLOB
+#include "grove_aqs_config_blob.h"
+#endif
+#if CONFIG_GROVE_AQS_WCET
+#include "grove_aqs_wcet.h"
+#endif
+#if CONFIG_GROVE_AQS_PRESETS
+#include "grove_aqs_preset.h"
+#endif
 #include "grove_analog_aqs.h"
+#include "grove_aqs_dlog.h"
+#include "grove_aqs_energy.h"
+#include "grove_aqs_live.h"
+#include "grove_aqs_port.h"
+#include "grove_aqs_retain.h"
+#include "grove_aqs_trace.h"
+#include "grove_aqs_util.h"
 
 static const char *TAG = "grove_aqs";
 
+/* Read stages whose duration is tracked for grove_aqs_read_data_deadline() */
+typedef enum {
+    GROVE_AQS_STAGE_CONVERSION = 0,
+    GROVE_AQS_STAGE_CALIBRATION,
+    GROVE_AQS_STAGE_PROCESSING,      // Compensation, smoothing and hysteresis
+    GROVE_AQS_STAGE_INFERENCE,       // Classifier features and model, once the window is full
+    GROVE_AQS_STAGE_COUNT
+} grove_aqs_stage_t;
+
+/* Calibration scheme life cycle; PENDING -> BUILDING is claimed by exactly one builder */
+enum {
+    CALI_PENDING = 0,
+    CALI_BUILDING,
+    CALI_DONE,
+};
+
 typedef struct {
     grove_aqs_config_t config;
     bool initialized;
+    bool suspended;                  // Powered off with the handles kept, see grove_aqs_suspend()
     adc_oneshot_unit_handle_t adc_handle;
     adc_cali_handle_t adc_cali_handle;
-    bool do_calibration;
+    bool do_calibration;             // Valid once cali_state is CALI_DONE
+    atomic_int cali_state;
     adc_unit_t adc_unit;
+    grove_aqs_live_params_t params;  // Per-sample constants in use, see grove_aqs_live.h
+    SemaphoreHandle_t params_mutex;  // Serializes the writers of params
+    StaticSemaphore_t params_mutex_buf;
+    grove_aqs_core_track_t track;    // Smoothing and hysteresis state of the threshold decision
+    grove_aqs_timed_data_t last;     // Last complete reading, returned when a deadline forces a skip
+    bool have_last;
+    uint32_t stage_cost_us[GROVE_AQS_STAGE_COUNT];
+    uint32_t resume_count;           // Boots resumed from retained state, see grove_aqs_retain.h
+    grove_aqs_init_timing_t init_timing;
+#if CONFIG_GROVE_AQS_PM_LOCKS
+    esp_pm_lock_handle_t pm_locks[GROVE_AQS_PM_LOCK_COUNT]; // NULL if creation failed
+    int64_t pm_since_us[GROVE_AQS_PM_LOCK_COUNT];
+    grove_aqs_pm_stats_t pm_stats;
+#endif
+#if CONFIG_GROVE_AQS_CLASSIFY
+    grove_aqs_window_t window;       // Recent readings, the classifier input
+    _Atomic(const grove_aqs_model_t *) model; // NULL: thresholds only
+    grove_aqs_classify_stats_t classify_stats;
+#endif
+#if CONFIG_GROVE_AQS_PPM
+    grove_aqs_ppm_params_t ppm_params;
+#endif
+#if CONFIG_GROVE_AQS_CALIBRATION
+    int32_t heater_gain;             // Folded into params.gain together with cal
+    grove_aqs_calibration_t cal;
+    int cal_mv[GROVE_AQS_CAL_POINT_COUNT]; // Captured points, heater-compensated
+    uint8_t cal_captured;            // Bit per grove_aqs_cal_point_t
+#endif
+#if CONFIG_GROVE_AQS_PRESETS
+    grove_aqs_preset_t presets[CONFIG_GROVE_AQS_PRESET_COUNT]; // Selected by pointing params at one
+#endif
+#if CONFIG_GROVE_AQS_WCET
+    bool wcet_armed;                 // The next read takes wcet_raw or fails, see grove_aqs_wcet_inject()
+    bool wcet_fail;
+    int wcet_raw;
+#endif
 } grove_aqs_dev_t;
 
 static grove_aqs_dev_t sensor = {0};
 
+/* ---- Per-sample constants ---- */
+
+/* Writers of the constants (calibration, config blobs, presets) take turns; readings never wait */
+static inline void params_write_begin(void) {
+    xSemaphoreTake(sensor.params_mutex, portMAX_DELAY);
+}
+
+static inline void params_write_end(void) {
+    xSemaphoreGive(sensor.params_mutex);
+}
+
+#if CONFIG_GROVE_AQS_PRESETS
+
+/* Carries a new gain and offset over to every preset; true if one is selected, which then has them in use */
+static inline bool presets_rebase(const grove_aqs_core_params_t *base) {
+    return grove_aqs_preset_rebase(&sensor.params, sensor.presets, CONFIG_GROVE_AQS_PRESET_COUNT, base);
+}
+
+#else
+
+static inline bool presets_rebase(const grove_aqs_core_params_t *base) {
+    (void)base;
+    return false;
+}
+
+#endif /* CONFIG_GROVE_AQS_PRESETS */
+
+/* ---- Heater supply: plain GPIO or LEDC PWM on power_gpio ---- */
+
+static inline bool heater_pwm(void) {
+    return sensor.config.heater_mode == GROVE_AQS_HEATER_PWM && sensor.config.use_gpio_power &&
+           sensor.config.power_gpio != GPIO_NUM_NC;
+}
+
+#if CONFIG_GROVE_AQS_HEATER_PWM
+
+#define HEATER_LEDC_MODE LEDC_LOW_SPEED_MODE
+#define HEATER_LEDC_CHANNEL ((ledc_channel_t)CONFIG_GROVE_AQS_HEATER_LEDC_CHANNEL)
+#define HEATER_LEDC_BITS 10
+#define HEATER_LEDC_FULL_DUTY (1u << HEATER_LEDC_BITS)
+
+static esp_err_t heater_pwm_init(void) {
+    ledc_timer_config_t timer = {
+        .speed_mode = HEATER_LEDC_MODE,
+        .duty_resolution = (ledc_timer_bit_t)HEATER_LEDC_BITS,
+        .timer_num = (ledc_timer_t)CONFIG_GROVE_AQS_HEATER_LEDC_TIMER,
+        .freq_hz = CONFIG_GROVE_AQS_HEATER_PWM_FREQ_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    esp_err_t ret = ledc_timer_config(&timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure LEDC timer: %d", ret);
+        return ret;
+    }
+
+    ledc_channel_config_t channel = {
+        .gpio_num = sensor.config.power_gpio,
+        .speed_mode = HEATER_LEDC_MODE,
+        .channel = HEATER_LEDC_CHANNEL,
+        .intr_type = LEDC_INTR_DISABLE,
+        .timer_sel = (ledc_timer_t)CONFIG_GROVE_AQS_HEATER_LEDC_TIMER,
+        .duty = 0,
+        .hpoint = 0,
+    };
+    ret = ledc_channel_config(&channel);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure LEDC channel: %d", ret);
+        return ret;
+    }
+
+    // The application may have installed the fade service already
+    ret = ledc_fade_func_install(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to install LEDC fade service: %d", ret);
+        return ret;
+    }
+    return ESP_OK;
+}
+
+/* Immediate duty change, no ramp; cuts short a soft start still in progress */
+static esp_err_t heater_pwm_set_pct(uint8_t duty_pct) {
+    esp_err_t ret = ledc_fade_stop(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL);
+    if (ret == ESP_OK) {
+        ret = ledc_set_duty(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL, HEATER_LEDC_FULL_DUTY * duty_pct / 100);
+    }
+    return ret == ESP_OK ? ledc_update_duty(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL) : ret;
+}
+
+static esp_err_t heater_pwm_set(bool on) {
+    if (!on || sensor.config.heater_soft_start_ms == 0) {
+        return heater_pwm_set_pct(on ? sensor.config.heater_duty_pct : 0);
+    }
+
+    uint32_t duty = HEATER_LEDC_FULL_DUTY * sensor.config.heater_duty_pct / 100;
+    // Soft start: ramp up so the heater's inrush current does not dip the shared rail. The fade
+    // runs in the background; readings meanwhile see a heater still warming up, as after any power-on.
+    esp_err_t ret = ledc_fade_stop(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL);
+    if (ret == ESP_OK) {
+        ret = ledc_set_fade_with_time(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL, duty, sensor.config.heater_soft_start_ms);
+    }
+    return ret == ESP_OK ? ledc_fade_start(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL, LEDC_FADE_NO_WAIT) : ret;
+}
+
+static void heater_pwm_deinit(void) {
+    ledc_fade_stop(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL);
+    ledc_stop(HEATER_LEDC_MODE, HEATER_LEDC_CHANNEL, 0);
+}
+
+#else
+
+static inline esp_err_t heater_pwm_init(void) { return ESP_ERR_NOT_SUPPORTED; }
+static inline esp_err_t heater_pwm_set_pct(uint8_t duty_pct) { (void)duty_pct; return ESP_ERR_NOT_SUPPORTED; }
+static inline esp_err_t heater_pwm_set(bool on) { (void)on; return ESP_ERR_NOT_SUPPORTED; }
+static inline void heater_pwm_deinit(void) {}
+
+#endif /* CONFIG_GROVE_AQS_HEATER_PWM */
+
+/* ---- Power management locks: held only while converting and processing ---- */
+
+#if CONFIG_GROVE_AQS_PM_LOCKS
+
+static void pm_locks_create(void) {
+    memset(&sensor.pm_stats, 0, sizeof(sensor.pm_stats));
+
+    static const esp_pm_lock_type_t types[GROVE_AQS_PM_LOCK_COUNT] = {
+        [GROVE_AQS_PM_LOCK_APB_FREQ] = ESP_PM_APB_FREQ_MAX,
+        [GROVE_AQS_PM_LOCK_NO_LIGHT_SLEEP] = ESP_PM_NO_LIGHT_SLEEP,
+    };
+    static const char *const names[GROVE_AQS_PM_LOCK_COUNT] = {
+        [GROVE_AQS_PM_LOCK_APB_FREQ] = "grove_aqs_apb",
+        [GROVE_AQS_PM_LOCK_NO_LIGHT_SLEEP] = "grove_aqs_no_ls",
+    };
+    for (int i = 0; i < GROVE_AQS_PM_LOCK_COUNT; i++) {
+        esp_err_t ret = esp_pm_lock_create(types[i], 0, names[i], &sensor.pm_locks[i]);
+        if (ret != ESP_OK) {
+            // Reads still work, just without holding off frequency scaling and light sleep
+            ESP_LOGW(TAG, "Failed to create PM lock %s: %d", names[i], ret);
+            sensor.pm_locks[i] = NULL;
+        }
+    }
+}
+
+static void pm_locks_delete(void) {
+    for (int i = 0; i < GROVE_AQS_PM_LOCK_COUNT; i++) {
+        if (sensor.pm_locks[i] != NULL) {
+            esp_pm_lock_delete(sensor.pm_locks[i]);
+            sensor.pm_locks[i] = NULL;
+        }
+    }
+}
+
+static inline void pm_acquire(grove_aqs_pm_lock_t lock) {
+    if (sensor.pm_locks[lock] != NULL) {
+        esp_pm_lock_acquire(sensor.pm_locks[lock]);
+    }
+    sensor.pm_since_us[lock] = grove_aqs_port_time_us();
+}
+
+static inline void pm_release(grove_aqs_pm_lock_t lock) {
+    uint32_t held = (uint32_t)(grove_aqs_port_time_us() - sensor.pm_since_us[lock]);
+    if (sensor.pm_locks[lock] != NULL) {
+        esp_pm_lock_release(sensor.pm_locks[lock]);
+    }
+    grove_aqs_pm_lock_stats_t *stats = &sensor.pm_stats.lock[lock];
+    stats->held_us += held;
+    stats->acquisitions++;
+    if (held > stats->max_held_us) {
+        stats->max_held_us = held;
+    }
+}
+
+#else
+
+static inline void pm_locks_create(void) {}
+static inline void pm_locks_delete(void) {}
+static inline void pm_acquire(grove_aqs_pm_lock_t lock) { (void)lock; }
+static inline void pm_release(grove_aqs_pm_lock_t lock) { (void)lock; }
+
+#endif /* CONFIG_GROVE_AQS_PM_LOCKS */
+
+/* ---- Two-point calibration, stored in NVS ---- */
+
+#if CONFIG_GROVE_AQS_CALIBRATION
+
+#define CAL_NVS_NAMESPACE "grove_aqs"
+#define CAL_NVS_KEY "cal"
+
+static inline bool cal_gain_valid(int32_t gain) {
+    return gain >= GROVE_AQS_CORE_GAIN_ONE / 2 && gain <= 2 * GROVE_AQS_CORE_GAIN_ONE;
+}
+
+/* The stored correction, or none */
+static void cal_load(grove_aqs_calibration_t *cal) {
+    const grove_aqs_calibration_t none = GROVE_AQS_CALIBRATION_NONE;
+    *cal = none;
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(CAL_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret != ESP_OK) {
+        if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Failed to open NVS, no calibration: %d", ret);
+        }
+        return;
+    }
+    grove_aqs_calibration_t stored;
+    size_t len = sizeof(stored);
+    ret = nvs_get_blob(nvs, CAL_NVS_KEY, &stored, &len);
+    nvs_close(nvs);
+    if (ret == ESP_OK && len == sizeof(stored) && cal_gain_valid(stored.gain)) {
+        *cal = stored;
+    } else if (ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Ignoring stored calibration: %d", ret);
+    }
+}
+
+/* Stores a correction; NULL erases it */
+static esp_err_t cal_store(const grove_aqs_calibration_t *cal) {
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(CAL_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %d", ret);
+        return ret;
+    }
+    if (cal != NULL) {
+        ret = nvs_set_blob(nvs, CAL_NVS_KEY, cal, sizeof(*cal));
+    } else {
+        ret = nvs_erase_key(nvs, CAL_NVS_KEY);
+        ret = ret == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : ret;
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store calibration: %d", ret);
+    }
+    return ret;
+}
+
+#endif /* CONFIG_GROVE_AQS_CALIBRATION */
+
+static inline uint32_t elapsed_us(int64_t start_us) {
+    return (uint32_t)(grove_aqs_port_time_us() - start_us);
+}
+
+/* Build the calibration scheme unless another caller already claimed it */
+static void build_calibration(void) {
+    int expected = CALI_PENDING;
+    if (!atomic_compare_exchange_strong(&sensor.cali_state, &expected, CALI_BUILDING)) {
+        return;
+    }
+
+    int64_t start = grove_aqs_port_time_us();
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = sensor.adc_unit,
+        .atten = sensor.config.adc_atten,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    esp_err_t ret = adc_cali_create_scheme_curve_fitting(&cali_config, &sensor.adc_cali_handle);
+    if (ret == ESP_OK) {
+        sensor.do_calibration = true;
+        GROVE_AQS_LOGI(TAG, CALI_ENABLED, "ADC calibration enabled");
+    } else {
+        sensor.do_calibration = false;
+        GROVE_AQS_LOGW(TAG, CALI_DISABLED, "ADC calibration disabled due to error: %d", ret);
+    }
+    sensor.init_timing.phase_us[GROVE_AQS_INIT_PHASE_CALIBRATION] = elapsed_us(start);
+
+    atomic_store(&sensor.cali_state, CALI_DONE);
+}
+
+static void calibration_task(void *arg) {
+    (void)arg;
+    build_calibration();
+    vTaskDelete(NULL);
+}
+
 esp_err_t grove_aqs_init(const grove_aqs_config_t *config) {
     if (config == NULL) {
         ESP_LOGE(TAG, "Config is NULL");
         return ESP_ERR_INVALID_ARG;
     }
 
+    if (config->heater_mode == GROVE_AQS_HEATER_PWM) {
+        if (!CONFIG_GROVE_AQS_HEATER_PWM) {
+            ESP_LOGE(TAG, "PWM heater drive needs CONFIG_GROVE_AQS_HEATER_PWM");
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (config->heater_duty_pct == 0 || config->heater_duty_pct > 100) {
+            ESP_LOGE(TAG, "Invalid heater duty: %u%%", config->heater_duty_pct);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (config->filter_shift > GROVE_AQS_CORE_FILTER_SHIFT_MAX || config->hysteresis_mv < 0) {
+        ESP_LOGE(TAG, "Invalid filter shift %u or hysteresis %d mV", config->filter_shift, config->hysteresis_mv);
+        return ESP_ERR_INVALID_ARG;
+    }
+
     if (sensor.initialized) {
         ESP_LOGW(TAG, "Sensor already initialized, deinitializing first");
         grove_aqs_deinit();
     }
 
+    int64_t init_start = grove_aqs_port_time_us();
+    memset(&sensor.init_timing, 0, sizeof(sensor.init_timing));
+
     // Store the configuration
     memcpy(&sensor.config, config, sizeof(grove_aqs_config_t));
     
     // Set the ADC unit based on the configuration
     sensor.adc_unit = sensor.config.adc_unit_num == 0 ? ADC_UNIT_1 : ADC_UNIT_2;
+
+    // Derive the per-sample constants once
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, sensor.config.vref,
+                               sensor.config.fresh_threshold, sensor.config.good_threshold,
+                               sensor.config.moderate_threshold, sensor.config.poor_threshold);
+    params.hysteresis_mv = sensor.config.hysteresis_mv;
+    params.filter_shift = sensor.config.filter_shift;
+    memset(&sensor.track, 0, sizeof(sensor.track));
+    if (heater_pwm()) {
+        // Thresholds are set at full heater power; scale the lower output back up
+        params.gain = grove_aqs_core_heater_gain(sensor.config.heater_duty_pct,
+                                                 CONFIG_GROVE_AQS_HEATER_SENSITIVITY_PCT);
+    }
+#if CONFIG_GROVE_AQS_CALIBRATION
+    // Per-device correction on top of the heater gain, still one multiply-shift-add per sample
+    sensor.heater_gain = params.gain;
+    sensor.cal_captured = 0;
+    cal_load(&sensor.cal);
+    grove_aqs_core_set_calibration(&params, sensor.heater_gain, &sensor.cal);
+#endif
+    grove_aqs_live_init(&sensor.params, &params);
+    if (sensor.params_mutex == NULL) {
+        sensor.params_mutex = xSemaphoreCreateMutexStatic(&sensor.params_mutex_buf);
+    }
+#if CONFIG_GROVE_AQS_PRESETS
+    memset(sensor.presets, 0, sizeof(sensor.presets));
+#endif
+#if CONFIG_GROVE_AQS_PPM
+    // R0 from the configured clean-air baseline until grove_aqs_set_baseline()
+    grove_aqs_ppm_curve_t curve;
+    esp_err_t ppm_ret = grove_aqs_ppm_curve_get((grove_aqs_gas_t)CONFIG_GROVE_AQS_PPM_GAS, &curve);
+    if (ppm_ret == ESP_OK) {
+        ppm_ret = grove_aqs_ppm_params_init(&sensor.ppm_params, CONFIG_GROVE_AQS_LOAD_OHM, CONFIG_GROVE_AQS_CIRCUIT_MV,
+                                            CONFIG_GROVE_AQS_CLEAN_AIR_MV, &curve);
+    }
+    if (ppm_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up the ppm estimate: %d", ppm_ret);
+        return ppm_ret;
+    }
+#endif
+
+    // Readings and stage timings of a previous configuration do not apply
+    sensor.have_last = false;
+    sensor.resume_count = 0;
+    memset(sensor.stage_cost_us, 0, sizeof(sensor.stage_cost_us));
+#if CONFIG_GROVE_AQS_CLASSIFY
+    grove_aqs_window_init(&sensor.window, CONFIG_GROVE_AQS_CLASSIFY_WINDOW);
+    atomic_store(&sensor.model, NULL);
+    memset(&sensor.classify_stats, 0, sizeof(sensor.classify_stats));
+#endif
     
     // Log the configuration
-    ESP_LOGI(TAG, "Initializing with ADC Unit: %d, ADC Channel: %d",
-             sensor.config.adc_unit_num, sensor.config.adc_channel);
+    GROVE_AQS_LOGI(TAG, INIT_START, "Initializing with ADC Unit: %d, ADC Channel: %d",
+                   sensor.config.adc_unit_num, sensor.config.adc_channel);
     
     // Initialize GPIO for power control if needed
+    int64_t phase_start = grove_aqs_port_time_us();
     if (sensor.config.use_gpio_power && sensor.config.power_gpio != GPIO_NUM_NC) {
         gpio_config_t io_conf = {
             .pin_bit_mask = (1ULL << sensor.config.power_gpio),
@@ -64,6 +502,14 @@ esp_err_t grove_aqs_init(const grove_aqs_config_t *config) {
             ESP_LOGE(TAG, "Failed to configure GPIO: %d", ret);
             return ret;
         }
+        // A hold set by grove_aqs_suspend() or the wake stub survives resets
+        gpio_hold_dis(sensor.config.power_gpio);
+        if (heater_pwm()) {
+            ret = heater_pwm_init();
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
         
         // Turn on the sensor by default
         ret = grove_aqs_power_on();
@@ -73,7 +519,10 @@ esp_err_t grove_aqs_init(const grove_aqs_config_t *config) {
         }
     }
 
+    sensor.init_timing.phase_us[GROVE_AQS_INIT_PHASE_GPIO] = elapsed_us(phase_start);
+
     // Initialize ADC
+    phase_start = grove_aqs_port_time_us();
     adc_oneshot_unit_init_cfg_t init_config = {
         .unit_id = sensor.adc_unit,
     };
@@ -82,8 +531,10 @@ esp_err_t grove_aqs_init(const grove_aqs_config_t *config) {
         ESP_LOGE(TAG, "Failed to create ADC unit: %d", ret);
         return ret;
     }
+    sensor.init_timing.phase_us[GROVE_AQS_INIT_PHASE_ADC_UNIT] = elapsed_us(phase_start);
 
     // Configure ADC channel
+    phase_start = grove_aqs_port_time_us();
     adc_oneshot_chan_cfg_t channel_config = {
         .atten = sensor.config.adc_atten,
         .bitwidth = ADC_BITWIDTH_DEFAULT,
@@ -95,23 +546,61 @@ esp_err_t grove_aqs_init(const grove_aqs_config_t *config) {
         return ret;
     }
 
-    // Try to create ADC calibration handle
-    adc_cali_curve_fitting_config_t cali_config = {
-        .unit_id = sensor.adc_unit,
-        .atten = sensor.config.adc_atten,
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-    };
-    ret = adc_cali_create_scheme_curve_fitting(&cali_config, &sensor.adc_cali_handle);
-    if (ret == ESP_OK) {
-        sensor.do_calibration = true;
-        ESP_LOGI(TAG, "ADC calibration enabled");
-    } else {
-        sensor.do_calibration = false;
-        ESP_LOGW(TAG, "ADC calibration disabled due to error: %d", ret);
+    sensor.init_timing.phase_us[GROVE_AQS_INIT_PHASE_ADC_CHANNEL] = elapsed_us(phase_start);
+
+    // Try to create ADC calibration handle, now or deferred
+    sensor.do_calibration = false;
+    atomic_store(&sensor.cali_state, CALI_PENDING);
+    if (sensor.config.init_mode == GROVE_AQS_INIT_BACKGROUND) {
+        if (xTaskCreate(calibration_task, "aqs_cali", 3072, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+            // Nothing else would build it, so readings would stay uncalibrated
+            ESP_LOGW(TAG, "Failed to start calibration task, calibrating now");
+            build_calibration();
+        }
+    } else if (sensor.config.init_mode != GROVE_AQS_INIT_LAZY) {
+        build_calibration();
+    }
+
+    pm_locks_create();
+    if (!sensor.config.use_gpio_power || sensor.config.power_gpio == GPIO_NUM_NC) {
+        // Heater wired to the supply: on for as long as the driver is
+        GROVE_AQS_ENERGY_BEGIN(GROVE_AQS_ENERGY_HEATER);
     }
 
     sensor.initialized = true;
-    ESP_LOGI(TAG, "Grove Analog Air Quality Sensor initialized successfully");
+    sensor.init_timing.init_us = elapsed_us(init_start);
+    GROVE_AQS_LOGI(TAG, INIT_DONE, "Grove Analog Air Quality Sensor initialized successfully");
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_get_init_timing(grove_aqs_init_timing_t *timing) {
+    if (timing == NULL) {
+        ESP_LOGE(TAG, "Timing pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bool pending = atomic_load(&sensor.cali_state) != CALI_DONE;
+    *timing = sensor.init_timing;
+    timing->calibration_pending = pending;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_get_params(grove_aqs_core_params_t *params) {
+    if (params == NULL) {
+        ESP_LOGE(TAG, "Params pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *params = *grove_aqs_live_acquire(&sensor.params);
+    grove_aqs_live_release(&sensor.params);
     return ESP_OK;
 }
 
@@ -123,7 +612,22 @@ esp_err_t grove_aqs_deinit(void) {
 
     // Power off the sensor if we're using GPIO control
     if (sensor.config.use_gpio_power && sensor.config.power_gpio != GPIO_NUM_NC) {
+        if (sensor.suspended) {
+            gpio_hold_dis(sensor.config.power_gpio);
+        }
         grove_aqs_power_off();
+        if (heater_pwm()) {
+            heater_pwm_deinit();
+        }
+    }
+    sensor.suspended = false;
+
+    // Cancel a deferred calibration, or wait for the background task to finish it
+    int expected = CALI_PENDING;
+    if (!atomic_compare_exchange_strong(&sensor.cali_state, &expected, CALI_DONE)) {
+        while (atomic_load(&sensor.cali_state) != CALI_DONE) {
+            vTaskDelay(1);
+        }
     }
 
     // Delete ADC calibration handle if it was created
@@ -142,71 +646,710 @@ esp_err_t grove_aqs_deinit(void) {
         return ret;
     }
 
+    pm_locks_delete();
+    GROVE_AQS_ENERGY_END(GROVE_AQS_ENERGY_HEATER);
+
     sensor.initialized = false;
     ESP_LOGI(TAG, "Grove Analog Air Quality Sensor deinitialized");
     return ESP_OK;
 }
 
-esp_err_t grove_aqs_read_data(grove_aqs_data_t *data) {
+/* Recent worst case of a stage: follows increases at once, decays by 1/16 per read */
+static void stage_cost_update(grove_aqs_stage_t stage, int64_t start_us, int64_t end_us) {
+    uint32_t elapsed = (uint32_t)(end_us - start_us);
+    uint32_t decayed = sensor.stage_cost_us[stage] - sensor.stage_cost_us[stage] / 16;
+    sensor.stage_cost_us[stage] = elapsed > decayed ? elapsed : decayed;
+}
+
+static inline bool stage_fits(grove_aqs_stage_t stage, int64_t now_us, int64_t deadline_us) {
+    return now_us + (int64_t)sensor.stage_cost_us[stage] <= deadline_us;
+}
+
+#if CONFIG_GROVE_AQS_CLASSIFY
+
+/* Adds the reading to the window; once it is full, the model decides the quality if it fits the deadline */
+static grove_aqs_quality_t classify_window(grove_aqs_quality_t level, int voltage_mv, int64_t timestamp_us,
+                                           int64_t deadline_us, uint32_t *skipped) {
+    grove_aqs_window_push(&sensor.window, voltage_mv, timestamp_us);
+    const grove_aqs_model_t *model = atomic_load(&sensor.model);
+    if (model == NULL || !grove_aqs_window_full(&sensor.window)) {
+        return level;
+    }
+    int64_t now = grove_aqs_port_time_us();
+    if (!stage_fits(GROVE_AQS_STAGE_INFERENCE, now, deadline_us)) {
+        *skipped |= GROVE_AQS_SKIPPED_INFERENCE;
+        return level;
+    }
+
+    uint32_t start = esp_cpu_get_cycle_count();
+    int32_t features[GROVE_AQS_FEATURE_COUNT];
+    grove_aqs_model_output_t out;
+    grove_aqs_window_features(&sensor.window, features);
+    grove_aqs_model_infer(model, features, level, &out);
+    uint32_t ns = (uint32_t)((uint64_t)(esp_cpu_get_cycle_count() - start) * 1000u /
+                             esp_rom_get_cpu_ticks_per_us());
+    stage_cost_update(GROVE_AQS_STAGE_INFERENCE, now, now + (ns + 999) / 1000);
+
+    grove_aqs_classify_stats_t *stats = &sensor.classify_stats;
+    stats->inferences++;
+    stats->last_ns = ns;
+    stats->max_ns = ns > stats->max_ns ? ns : stats->max_ns;
+    stats->total_ns += ns;
+    return out.quality;
+}
+
+#else
+
+static inline grove_aqs_quality_t classify_window(grove_aqs_quality_t level, int voltage_mv, int64_t timestamp_us,
+                                                  int64_t deadline_us, uint32_t *skipped) {
+    (void)voltage_mv;
+    (void)timestamp_us;
+    (void)deadline_us;
+    (void)skipped;
+    return level;
+}
+
+#endif /* CONFIG_GROVE_AQS_CLASSIFY */
+
+#if CONFIG_GROVE_AQS_WCET
+
+/* Hands the raw value injected by the WCET harness to the stages after the conversion, once */
+static inline esp_err_t wcet_substitute(esp_err_t ret, int *raw) {
+    if (!sensor.wcet_armed) {
+        return ret;
+    }
+    sensor.wcet_armed = false;
+    if (sensor.wcet_fail) {
+        return ESP_FAIL;
+    }
+    *raw = sensor.wcet_raw;
+    return ret;
+}
+
+#else
+
+static inline esp_err_t wcet_substitute(esp_err_t ret, int *raw) {
+    (void)raw;
+    return ret;
+}
+
+#endif /* CONFIG_GROVE_AQS_WCET */
+
+/* Conversion and processing of one sample, with the APB frequency lock held */
+static esp_err_t convert_sample(grove_aqs_timed_data_t *out, const grove_aqs_core_params_t *params, int64_t now,
+                                int64_t deadline_us);
+
+/* Shared read path; with deadline_us = INT64_MAX nothing is skipped */
+static esp_err_t read_sample(grove_aqs_timed_data_t *out, int64_t deadline_us) {
     if (!sensor.initialized) {
         ESP_LOGE(TAG, "Sensor not initialized");
         return ESP_ERR_INVALID_STATE;
     }
+    if (sensor.suspended) {
+        ESP_LOGE(TAG, "Sensor suspended");
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    if (data == NULL) {
-        ESP_LOGE(TAG, "Data pointer is NULL");
-        return ESP_ERR_INVALID_ARG;
+    int64_t now = grove_aqs_port_time_us();
+    if (!stage_fits(GROVE_AQS_STAGE_CONVERSION, now, deadline_us)) {
+        if (!sensor.have_last) {
+            return ESP_ERR_TIMEOUT;
+        }
+        *out = sensor.last;
+        out->skipped |= GROVE_AQS_SKIPPED_CONVERSION;
+        return ESP_OK;
     }
 
-    // Read raw ADC value
+    pm_acquire(GROVE_AQS_PM_LOCK_APB_FREQ);
+    GROVE_AQS_ENERGY_BEGIN(GROVE_AQS_ENERGY_CPU);
+    const grove_aqs_core_params_t *params = grove_aqs_live_acquire(&sensor.params);
+    esp_err_t ret = convert_sample(out, params, now, deadline_us);
+    grove_aqs_live_release(&sensor.params);
+    GROVE_AQS_ENERGY_END(GROVE_AQS_ENERGY_CPU);
+    pm_release(GROVE_AQS_PM_LOCK_APB_FREQ);
+    if (ret == ESP_OK) {
+        GROVE_AQS_ENERGY_READING();
+    }
+    return ret;
+}
+
+static esp_err_t convert_sample(grove_aqs_timed_data_t *out, const grove_aqs_core_params_t *params, int64_t now,
+                                int64_t deadline_us) {
+    grove_aqs_data_t *data = &out->data;
+    out->skipped = 0;
+
+    // Read raw ADC value; light sleep must not cut into the conversion
+    GROVE_AQS_TRACE_BEGIN(GROVE_AQS_TRACE_CONVERSION, sensor.config.adc_channel);
+    pm_acquire(GROVE_AQS_PM_LOCK_NO_LIGHT_SLEEP);
+    GROVE_AQS_ENERGY_BEGIN(GROVE_AQS_ENERGY_ADC);
     esp_err_t ret = adc_oneshot_read(sensor.adc_handle, sensor.config.adc_channel, &data->raw_value);
+    GROVE_AQS_ENERGY_END(GROVE_AQS_ENERGY_ADC);
+    pm_release(GROVE_AQS_PM_LOCK_NO_LIGHT_SLEEP);
+    ret = wcet_substitute(ret, &data->raw_value);
+    int64_t converted = grove_aqs_port_time_us();
     if (ret != ESP_OK) {
+        GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_CONVERSION, ret);
         ESP_LOGE(TAG, "Failed to read ADC: %d", ret);
         return ret;
     }
+    stage_cost_update(GROVE_AQS_STAGE_CONVERSION, now, converted);
+    out->timestamp_us = converted;
+
+    // A lazy calibration is built by the first read without a deadline
+    if (deadline_us == INT64_MAX && sensor.config.init_mode == GROVE_AQS_INIT_LAZY) {
+        build_calibration();
+    }
+    bool cali_done = atomic_load(&sensor.cali_state) == CALI_DONE;
 
     // Convert to voltage
-    if (sensor.do_calibration) {
+    if (cali_done && sensor.do_calibration && stage_fits(GROVE_AQS_STAGE_CALIBRATION, converted, deadline_us)) {
         ret = adc_cali_raw_to_voltage(sensor.adc_cali_handle, data->raw_value, &data->voltage_mv);
         if (ret != ESP_OK) {
+            GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_CONVERSION, ret);
             ESP_LOGE(TAG, "Failed to convert ADC reading to voltage: %d", ret);
             return ret;
         }
+        stage_cost_update(GROVE_AQS_STAGE_CALIBRATION, converted, grove_aqs_port_time_us());
     } else {
-        // Simple linear approximation if calibration is not available
-        data->voltage_mv = (data->raw_value * sensor.config.vref) / 4095;
-    }
-
-    // Determine air quality based on voltage and thresholds
-    if (data->voltage_mv <= sensor.config.fresh_threshold) {
-        data->quality = GROVE_AQS_QUALITY_FRESH;
-    } else if (data->voltage_mv <= sensor.config.good_threshold) {
-        data->quality = GROVE_AQS_QUALITY_GOOD;
-    } else if (data->voltage_mv <= sensor.config.moderate_threshold) {
-        data->quality = GROVE_AQS_QUALITY_MODERATE;
-    } else if (data->voltage_mv <= sensor.config.poor_threshold) {
-        data->quality = GROVE_AQS_QUALITY_POOR;
+        // Simple linear approximation if calibration is not available (or would miss the deadline)
+        data->voltage_mv = grove_aqs_core_raw_to_mv(params, data->raw_value);
+        if (!cali_done || sensor.do_calibration) {
+            out->skipped |= GROVE_AQS_SKIPPED_CALIBRATION;
+        }
+    }
+    GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_CONVERSION, data->raw_value);
+
+    int64_t processing = grove_aqs_port_time_us();
+    if (sensor.have_last && !stage_fits(GROVE_AQS_STAGE_PROCESSING, processing, deadline_us)) {
+        // The level of the previous reading stands in; the smoothing and the window skip this sample
+        data->quality = sensor.last.data.quality;
+        out->skipped |= GROVE_AQS_SKIPPED_PROCESSING;
     } else {
-        data->quality = GROVE_AQS_QUALITY_VERY_POOR;
+        // Classified at the equivalent full heater power; the reported voltage stays as measured
+        int classified_mv = grove_aqs_core_compensate(params, data->voltage_mv);
+        data->quality = grove_aqs_core_track(params, &sensor.track, classified_mv);
+        stage_cost_update(GROVE_AQS_STAGE_PROCESSING, processing, grove_aqs_port_time_us());
+        data->quality = classify_window(data->quality, classified_mv, converted, deadline_us, &out->skipped);
     }
 
-    ESP_LOGI(TAG, "Air quality reading: Raw=%d, Voltage=%dmV, Quality=%s", 
-             data->raw_value, data->voltage_mv, grove_aqs_quality_to_string(data->quality));
+    sensor.last = *out;
+    sensor.have_last = true;
+
+    GROVE_AQS_LOGI(TAG, READING, "Air quality reading: Raw=%d, Voltage=%dmV, Quality=%s",
+                   data->raw_value, data->voltage_mv, GROVE_AQS_DLOG_QUALITY(data->quality));
     
     return ESP_OK;
 }
 
+esp_err_t grove_aqs_read_data(grove_aqs_data_t *data) {
+    if (data == NULL) {
+        ESP_LOGE(TAG, "Data pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    grove_aqs_timed_data_t timed;
+    esp_err_t ret = read_sample(&timed, INT64_MAX);
+    if (ret == ESP_OK) {
+        *data = timed.data;
+    }
+    return ret;
+}
+
+esp_err_t grove_aqs_read_data_deadline(grove_aqs_timed_data_t *data, int64_t deadline_us) {
+    if (data == NULL) {
+        ESP_LOGE(TAG, "Data pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return read_sample(data, deadline_us);
+}
+
+esp_err_t grove_aqs_get_pm_stats(grove_aqs_pm_stats_t *stats) {
+    if (stats == NULL) {
+        ESP_LOGE(TAG, "Stats pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if CONFIG_GROVE_AQS_PM_LOCKS
+    *stats = sensor.pm_stats;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t grove_aqs_suspend(void) {
+    if (!sensor.initialized || sensor.suspended) {
+        ESP_LOGW(TAG, "Sensor not initialized or already suspended");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The oneshot unit draws nothing between conversions, so only the sensor itself is switched off
+    if (sensor.config.use_gpio_power && sensor.config.power_gpio != GPIO_NUM_NC) {
+        esp_err_t ret = grove_aqs_power_off();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        // Keep the heater off through light sleep
+        ret = gpio_hold_en(sensor.config.power_gpio);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to hold power GPIO: %d", ret);
+            return ret;
+        }
+    }
+
+    sensor.suspended = true;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_resume(void) {
+    if (!sensor.initialized || !sensor.suspended) {
+        ESP_LOGW(TAG, "Sensor not suspended");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (sensor.config.use_gpio_power && sensor.config.power_gpio != GPIO_NUM_NC) {
+        esp_err_t ret = gpio_hold_dis(sensor.config.power_gpio);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to release power GPIO: %d", ret);
+            return ret;
+        }
+        ret = grove_aqs_power_on();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    sensor.suspended = false;
+    return ESP_OK;
+}
+
+#if CONFIG_GROVE_AQS_RETAIN
+
+_Static_assert(GROVE_AQS_RETAIN_STAGES == GROVE_AQS_STAGE_COUNT, "retained stage costs");
+
+/* Retained state is only restored into the configuration it was taken with */
+static uint32_t config_hash(void) {
+    const int fields[] = {
+        sensor.config.adc_unit_num, sensor.config.adc_channel, sensor.config.adc_atten, sensor.config.vref,
+        sensor.config.fresh_threshold, sensor.config.good_threshold, sensor.config.moderate_threshold,
+        sensor.config.poor_threshold, sensor.config.use_gpio_power, sensor.config.power_gpio,
+        sensor.config.heater_mode, sensor.config.heater_duty_pct, sensor.config.hysteresis_mv,
+        sensor.config.filter_shift,
+    };
+    return grove_aqs_crc32(0, fields, sizeof(fields));
+}
+
+esp_err_t grove_aqs_export_state(grove_aqs_retain_driver_t *state) {
+    if (state == NULL) {
+        ESP_LOGE(TAG, "State pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(state, 0, sizeof(*state));
+    state->config_hash = config_hash();
+    state->resume_count = sensor.resume_count;
+    memcpy(state->stage_cost_us, sensor.stage_cost_us, sizeof(sensor.stage_cost_us));
+    state->track = sensor.track;
+    state->have_last = sensor.have_last;
+    state->last_raw = (uint16_t)sensor.last.data.raw_value;
+    state->last_mv = (uint16_t)sensor.last.data.voltage_mv;
+    state->last_quality = (uint8_t)sensor.last.data.quality;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_import_state(const grove_aqs_retain_driver_t *state) {
+    if (state == NULL) {
+        ESP_LOGE(TAG, "State pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (state->config_hash != config_hash()) {
+        ESP_LOGW(TAG, "Retained state belongs to another configuration");
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    sensor.resume_count = state->resume_count;
+    memcpy(sensor.stage_cost_us, state->stage_cost_us, sizeof(sensor.stage_cost_us));
+    sensor.track = state->track;
+    sensor.have_last = state->have_last;
+    // The esp_timer clock restarted, so the reading is dated to the start of this boot
+    sensor.last = (grove_aqs_timed_data_t){
+        .data = {
+            .raw_value = state->last_raw,
+            .voltage_mv = state->last_mv,
+            .quality = (grove_aqs_quality_t)state->last_quality,
+        },
+    };
+    return ESP_OK;
+}
+
+#endif /* CONFIG_GROVE_AQS_RETAIN */
+
+#if CONFIG_GROVE_AQS_WCET
+
+esp_err_t grove_aqs_wcet_inject(int raw, bool fail) {
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sensor.wcet_raw = raw;
+    sensor.wcet_fail = fail;
+    sensor.wcet_armed = true;
+    return ESP_OK;
+}
+
+#endif /* CONFIG_GROVE_AQS_WCET */
+
+#if CONFIG_GROVE_AQS_CLASSIFY
+
+esp_err_t grove_aqs_set_model(const grove_aqs_model_t *model) {
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(&sensor.classify_stats, 0, sizeof(sensor.classify_stats));
+    atomic_store(&sensor.model, model);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_get_classify_stats(grove_aqs_classify_stats_t *stats) {
+    if (stats == NULL) {
+        ESP_LOGE(TAG, "Stats pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *stats = sensor.classify_stats;
+    return ESP_OK;
+}
+
+#endif /* CONFIG_GROVE_AQS_CLASSIFY */
+
+#if CONFIG_GROVE_AQS_CALIBRATION
+
+esp_err_t grove_aqs_calibrate_point(grove_aqs_cal_point_t point, uint16_t samples) {
+    if ((unsigned)point >= GROVE_AQS_CAL_POINT_COUNT || samples == 0) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t sum_mv = 0;
+    for (uint16_t i = 0; i < samples; i++) {
+        grove_aqs_timed_data_t reading;
+        esp_err_t ret = read_sample(&reading, INT64_MAX);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        sum_mv += reading.data.voltage_mv;
+    }
+
+    // Captured at full heater power, the domain the correction is applied in
+    int mv = (int)(sum_mv / samples);
+    sensor.cal_mv[point] = (int)(((int64_t)mv * sensor.heater_gain) >> GROVE_AQS_CORE_GAIN_SHIFT);
+    sensor.cal_captured |= 1u << point;
+    ESP_LOGI(TAG, "Calibration point %d: %d mV", point, sensor.cal_mv[point]);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_calibrate_finish(void) {
+    if (!sensor.initialized || sensor.cal_captured != (1u << GROVE_AQS_CAL_POINT_COUNT) - 1) {
+        ESP_LOGE(TAG, "Both calibration points must be captured first");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    grove_aqs_calibration_t cal;
+    if (!grove_aqs_core_calibrate(sensor.cal_mv[GROVE_AQS_CAL_CLEAN_AIR], sensor.cal_mv[GROVE_AQS_CAL_REFERENCE_GAS],
+                                  CONFIG_GROVE_AQS_CAL_CLEAN_MV, CONFIG_GROVE_AQS_CAL_REFERENCE_MV, &cal)) {
+        ESP_LOGE(TAG, "No usable calibration from %d and %d mV", sensor.cal_mv[GROVE_AQS_CAL_CLEAN_AIR],
+                 sensor.cal_mv[GROVE_AQS_CAL_REFERENCE_GAS]);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    ESP_LOGI(TAG, "Calibration: gain %ld/%d, offset %ld mV", (long)cal.gain, GROVE_AQS_CORE_GAIN_ONE,
+             (long)cal.offset_mv);
+    // The points stay captured if the correction cannot be stored, so finishing can be retried
+    esp_err_t ret = grove_aqs_set_calibration(&cal);
+    if (ret == ESP_OK) {
+        sensor.cal_captured = 0;
+    }
+    return ret;
+}
+
+esp_err_t grove_aqs_set_calibration(const grove_aqs_calibration_t *cal) {
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cal != NULL && !cal_gain_valid(cal->gain)) {
+        ESP_LOGE(TAG, "Calibration gain out of range: %ld", (long)cal->gain);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Stored first, so the correction in use is always the one the next boot loads
+    params_write_begin();
+    esp_err_t ret = cal_store(cal);
+    if (ret != ESP_OK) {
+        params_write_end();
+        return ret;
+    }
+
+    const grove_aqs_calibration_t none = GROVE_AQS_CALIBRATION_NONE;
+    sensor.cal = cal != NULL ? *cal : none;
+    grove_aqs_core_params_t next = *grove_aqs_live_current(&sensor.params);
+    grove_aqs_core_set_calibration(&next, sensor.heater_gain, &sensor.cal);
+    if (!presets_rebase(&next)) {
+        grove_aqs_live_publish(&sensor.params, &next);
+    }
+    params_write_end();
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_get_calibration(grove_aqs_calibration_t *cal) {
+    if (cal == NULL) {
+        ESP_LOGE(TAG, "Calibration pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *cal = sensor.cal;
+    return ESP_OK;
+}
+
+#endif /* CONFIG_GROVE_AQS_CALIBRATION */
+
+#if CONFIG_GROVE_AQS_PPM
+
+esp_err_t grove_aqs_set_baseline(int clean_air_mv) {
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // R0 is defined at full heater power, like the thresholds
+    grove_aqs_ppm_curve_t curve = sensor.ppm_params.curve;
+    int compensated_mv = grove_aqs_core_compensate(grove_aqs_live_acquire(&sensor.params), clean_air_mv);
+    grove_aqs_live_release(&sensor.params);
+    return grove_aqs_ppm_params_init(&sensor.ppm_params, CONFIG_GROVE_AQS_LOAD_OHM, CONFIG_GROVE_AQS_CIRCUIT_MV,
+                                     compensated_mv, &curve);
+}
+
+esp_err_t grove_aqs_estimate_ppm(int voltage_mv, grove_aqs_ppm_t *out) {
+    if (out == NULL) {
+        ESP_LOGE(TAG, "Estimate pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int compensated_mv = grove_aqs_core_compensate(grove_aqs_live_acquire(&sensor.params), voltage_mv);
+    grove_aqs_live_release(&sensor.params);
+    grove_aqs_ppm_estimate(&sensor.ppm_params, compensated_mv, out);
+    return ESP_OK;
+}
+
+#endif /* CONFIG_GROVE_AQS_PPM */
+
+#if CONFIG_GROVE_AQS_CONFIG_BLOB
+
+esp_err_t grove_aqs_apply_config(const grove_aqs_config_blob_t *config) {
+    if (config == NULL || config->header == NULL) {
+        ESP_LOGE(TAG, "Config is not a parsed blob");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+#if !CONFIG_GROVE_AQS_CALIBRATION
+    if (config->calibration != NULL) {
+        ESP_LOGE(TAG, "Calibration section needs CONFIG_GROVE_AQS_CALIBRATION");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+
+    // Sections were validated by the parser; only storing a calibration can fail, and it is stored
+    // first, so the correction in use is always the one the next boot loads
+    params_write_begin();
+#if CONFIG_GROVE_AQS_CALIBRATION
+    if (config->calibration != NULL) {
+        esp_err_t ret = cal_store(config->calibration);
+        if (ret != ESP_OK) {
+            params_write_end();
+            return ret;
+        }
+    }
+#endif
+    grove_aqs_core_params_t next = *grove_aqs_live_current(&sensor.params);
+    if (config->classify != NULL) {
+        for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+            next.thresholds[t] = config->classify->thresholds[t];
+        }
+        next.hysteresis_mv = config->classify->hysteresis_mv;
+        next.filter_shift = config->classify->filter_shift;
+    }
+#if CONFIG_GROVE_AQS_CALIBRATION
+    if (config->calibration != NULL) {
+        sensor.cal = *config->calibration;
+        grove_aqs_core_set_calibration(&next, sensor.heater_gain, &sensor.cal);
+    }
+#endif
+    if (config->classify != NULL) {
+        // Thresholds from a blob replace a selected preset
+        grove_aqs_live_publish(&sensor.params, &next);
+        presets_rebase(&next);
+    } else if (!presets_rebase(&next)) {
+        grove_aqs_live_publish(&sensor.params, &next);
+    }
+    params_write_end();
+    ESP_LOGI(TAG, "Config %u applied", (unsigned)config->header->sequence);
+    return ESP_OK;
+}
+
+#endif /* CONFIG_GROVE_AQS_CONFIG_BLOB */
+
+#if CONFIG_GROVE_AQS_PRESETS
+
+esp_err_t grove_aqs_preset_define(uint8_t index, const char *name,
+                                  const int thresholds[GROVE_AQS_QUALITY_LEVEL_COUNT - 1], int hysteresis_mv,
+                                  uint8_t filter_shift) {
+    if (name == NULL || thresholds == NULL || index >= CONFIG_GROVE_AQS_PRESET_COUNT) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t len = strnlen(name, GROVE_AQS_PRESET_NAME_MAX + 1);
+    if (len == 0 || len > GROVE_AQS_PRESET_NAME_MAX) {
+        ESP_LOGE(TAG, "Preset name must have 1-%d characters", GROVE_AQS_PRESET_NAME_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+        if (thresholds[t] < (t > 0 ? thresholds[t - 1] + 1 : 0)) {
+            ESP_LOGE(TAG, "Preset thresholds must ascend");
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (hysteresis_mv < 0 || filter_shift > GROVE_AQS_CORE_FILTER_SHIFT_MAX) {
+        ESP_LOGE(TAG, "Invalid filter shift %u or hysteresis %d mV", filter_shift, hysteresis_mv);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // vref, gain and offset are the device's, whichever constants are in use
+    params_write_begin();
+    grove_aqs_core_params_t params = *grove_aqs_live_current(&sensor.params);
+    for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+        params.thresholds[t] = thresholds[t];
+    }
+    params.hysteresis_mv = hysteresis_mv;
+    params.filter_shift = filter_shift;
+    grove_aqs_live_rewrite(&sensor.params, &sensor.presets[index].params, &params);
+    memcpy(sensor.presets[index].name, name, len);
+    sensor.presets[index].name[len] = '\0';
+    params_write_end();
+    return ESP_OK;
+}
+
+/* Points readings at a preset; called with the writers' mutex held */
+static esp_err_t preset_select(int index) {
+    if (index < 0 || index >= CONFIG_GROVE_AQS_PRESET_COUNT || sensor.presets[index].name[0] == '\0') {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // The smoothing and hysteresis state carries over, so the level does not jump back to the raw voltage
+    grove_aqs_live_switch(&sensor.params, &sensor.presets[index].params);
+    ESP_LOGI(TAG, "Preset '%s' selected", sensor.presets[index].name);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_preset_select(uint8_t index) {
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    params_write_begin();
+    esp_err_t ret = preset_select(index);
+    params_write_end();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Preset %u not defined", index);
+    }
+    return ret;
+}
+
+esp_err_t grove_aqs_preset_select_name(const char *name) {
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    params_write_begin();
+    esp_err_t ret = preset_select(grove_aqs_preset_find(sensor.presets, CONFIG_GROVE_AQS_PRESET_COUNT, name));
+    params_write_end();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "No preset named '%s'", name != NULL ? name : "");
+    }
+    return ret;
+}
+
+int grove_aqs_preset_active(void) {
+    const grove_aqs_core_params_t *params = grove_aqs_live_current(&sensor.params);
+    for (int i = 0; i < CONFIG_GROVE_AQS_PRESET_COUNT; i++) {
+        if (params == &sensor.presets[i].params) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#endif /* CONFIG_GROVE_AQS_PRESETS */
+
 esp_err_t grove_aqs_power_on(void) {
     if (!sensor.config.use_gpio_power || sensor.config.power_gpio == GPIO_NUM_NC) {
         ESP_LOGW(TAG, "GPIO power control not enabled");
         return ESP_ERR_NOT_SUPPORTED;
     }
 
+    if (heater_pwm()) {
+        esp_err_t ret = heater_pwm_set(true);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to ramp up heater PWM: %d", ret);
+            return ret;
+        }
+        GROVE_AQS_ENERGY_SET_DUTY(GROVE_AQS_ENERGY_HEATER, sensor.config.heater_duty_pct);
+        GROVE_AQS_ENERGY_BEGIN(GROVE_AQS_ENERGY_HEATER);
+        ESP_LOGI(TAG, "Sensor powered on at %u%% duty", sensor.config.heater_duty_pct);
+        return ESP_OK;
+    }
+
     esp_err_t ret = gpio_set_level(sensor.config.power_gpio, 1);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set GPIO high: %d", ret);
         return ret;
     }
+    GROVE_AQS_ENERGY_SET_DUTY(GROVE_AQS_ENERGY_HEATER, 100);
+    GROVE_AQS_ENERGY_BEGIN(GROVE_AQS_ENERGY_HEATER);
 
     ESP_LOGI(TAG, "Sensor powered on");
     return ESP_OK;
@@ -218,29 +1361,81 @@ esp_err_t grove_aqs_power_off(void) {
         return ESP_ERR_NOT_SUPPORTED;
     }
 
-    esp_err_t ret = gpio_set_level(sensor.config.power_gpio, 0);
+    esp_err_t ret = heater_pwm() ? heater_pwm_set(false) : gpio_set_level(sensor.config.power_gpio, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set GPIO low: %d", ret);
         return ret;
     }
+    GROVE_AQS_ENERGY_END(GROVE_AQS_ENERGY_HEATER);
 
     ESP_LOGI(TAG, "Sensor powered off");
     return ESP_OK;
 }
 
-const char* grove_aqs_quality_to_string(grove_aqs_quality_t quality) {
-    switch (quality) {
-        case GROVE_AQS_QUALITY_FRESH:
-            return "Fresh";
-        case GROVE_AQS_QUALITY_GOOD:
-            return "Good";
-        case GROVE_AQS_QUALITY_MODERATE:
-            return "Moderate";
-        case GROVE_AQS_QUALITY_POOR:
-            return "Poor";
-        case GROVE_AQS_QUALITY_VERY_POOR:
-            return "Very Poor";
-        default:
-            return "Unknown";
+#if CONFIG_GROVE_AQS_PROFILE || CONFIG_GROVE_AQS_LOCKIN
+
+/* ---- Heater modulation: direct duty and bare samples ---- */
+
+esp_err_t grove_aqs_set_heater_duty(uint8_t duty_pct) {
+    if (!sensor.initialized) {
+        ESP_LOGE(TAG, "Sensor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (sensor.suspended) {
+        ESP_LOGE(TAG, "Sensor suspended");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!sensor.config.use_gpio_power || sensor.config.power_gpio == GPIO_NUM_NC) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    duty_pct = duty_pct > 100 ? 100 : duty_pct;
+    esp_err_t ret = heater_pwm() ? heater_pwm_set_pct(duty_pct) : gpio_set_level(sensor.config.power_gpio, duty_pct > 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set heater duty: %d", ret);
+        return ret;
+    }
+    GROVE_AQS_ENERGY_END(GROVE_AQS_ENERGY_HEATER);
+    if (duty_pct > 0) {
+        GROVE_AQS_ENERGY_SET_DUTY(GROVE_AQS_ENERGY_HEATER, heater_pwm() ? duty_pct : 100);
+        GROVE_AQS_ENERGY_BEGIN(GROVE_AQS_ENERGY_HEATER);
+    }
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_sample_mv(int *voltage_mv) {
+    if (voltage_mv == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sensor.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (sensor.suspended) {
+        ESP_LOGE(TAG, "Sensor suspended");
+        return ESP_ERR_INVALID_STATE;
     }
-} 
\ No newline at end of file
+
+    int raw;
+    pm_acquire(GROVE_AQS_PM_LOCK_APB_FREQ);
+    pm_acquire(GROVE_AQS_PM_LOCK_NO_LIGHT_SLEEP);
+    GROVE_AQS_ENERGY_BEGIN(GROVE_AQS_ENERGY_ADC);
+    esp_err_t ret = adc_oneshot_read(sensor.adc_handle, sensor.config.adc_channel, &raw);
+    GROVE_AQS_ENERGY_END(GROVE_AQS_ENERGY_ADC);
+    pm_release(GROVE_AQS_PM_LOCK_NO_LIGHT_SLEEP);
+    if (ret == ESP_OK) {
+        // Modulation samples never build a lazy calibration; they use it once it is there
+        if (atomic_load(&sensor.cali_state) == CALI_DONE && sensor.do_calibration) {
+            ret = adc_cali_raw_to_voltage(sensor.adc_cali_handle, raw, voltage_mv);
+        } else {
+            *voltage_mv = grove_aqs_core_raw_to_mv(grove_aqs_live_acquire(&sensor.params), raw);
+            grove_aqs_live_release(&sensor.params);
+        }
+    }
+    pm_release(GROVE_AQS_PM_LOCK_APB_FREQ);
+    if (ret == ESP_OK) {
+        GROVE_AQS_ENERGY_READING();
+    }
+    return ret;
+}
+
+#endif /* CONFIG_GROVE_AQS_PROFILE || CONFIG_GROVE_AQS_LOCKIN */
@@ -0,0 +1,266 @@
+/**
+ * @file grove_aqs_classify.c
+ * @brief Feature windows, model blob parsing and int8 inference
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <string.h>
+#include "grove_aqs_classify.h"
+#include "grove_aqs_util.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#endif
+
+static const char *TAG = "grove_aqs_classify";
+
+_Static_assert(sizeof(grove_aqs_model_header_t) % 4 == 0, "layers must start 4-byte aligned");
+_Static_assert(sizeof(grove_aqs_model_layer_t) == 8, "layer header is part of the blob format");
+_Static_assert(GROVE_AQS_QUALITY_COUNT < GROVE_AQS_MODEL_KEEP_LEVEL, "class map values are bytes");
+
+static inline int8_t saturate_int8(int64_t v) {
+    return (int8_t)(v < -128 ? -128 : v > 127 ? 127 : v);
+}
+
+/* ---- Feature window ---- */
+
+esp_err_t grove_aqs_window_init(grove_aqs_window_t *window, uint8_t size) {
+    if (window == NULL || size < 2 || size > GROVE_AQS_WINDOW_MAX) {
+        ESP_LOGE(TAG, "Window needs 2-%d samples", GROVE_AQS_WINDOW_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(window, 0, sizeof(*window));
+    window->size = size;
+    return ESP_OK;
+}
+
+void grove_aqs_window_push(grove_aqs_window_t *window, int voltage_mv, int64_t timestamp_us) {
+    window->mv[window->head] = (int16_t)(voltage_mv > INT16_MAX ? INT16_MAX : voltage_mv);
+    window->t_ms[window->head] = (uint32_t)(timestamp_us / 1000);
+    window->head = window->head + 1 == window->size ? 0 : window->head + 1;
+    if (window->count < window->size) {
+        window->count++;
+    }
+}
+
+void grove_aqs_window_set_cycle(grove_aqs_window_t *window, const grove_aqs_profile_features_t *cycle) {
+    window->have_cycle = cycle != NULL && cycle->phase_count > 0;
+    if (!window->have_cycle) {
+        memset(window->cycle, 0, sizeof(window->cycle));
+        return;
+    }
+    // Shape averaged over equal groups of phases, so models do not depend on the phase count
+    uint8_t phases = cycle->phase_count;
+    for (int g = 0; g < GROVE_AQS_FEATURE_CYCLE_GROUPS; g++) {
+        uint8_t first = (uint8_t)(g * phases / GROVE_AQS_FEATURE_CYCLE_GROUPS);
+        uint8_t end = (uint8_t)((g + 1) * phases / GROVE_AQS_FEATURE_CYCLE_GROUPS);
+        if (end <= first) {
+            end = first + 1 < phases ? first + 1 : phases;
+            first = end - 1;
+        }
+        int32_t sum = 0;
+        for (uint8_t i = first; i < end; i++) {
+            sum += cycle->shape_q12[i];
+        }
+        window->cycle[g] = sum / (end - first);
+    }
+}
+
+void grove_aqs_window_features(const grove_aqs_window_t *window, int32_t *features) {
+    uint8_t n = window->count;
+    // Oldest sample first: at head once the window is full, at 0 before
+    uint8_t oldest = n == window->size ? window->head : 0;
+    uint32_t t0 = window->t_ms[oldest];
+
+    int64_t sum_mv = 0;
+    int64_t sum_t = 0;
+    int32_t min_mv = INT16_MAX;
+    int32_t max_mv = INT16_MIN;
+    for (uint8_t i = 0; i < n; i++) {
+        int32_t mv = window->mv[i];
+        sum_mv += mv;
+        sum_t += (uint32_t)(window->t_ms[i] - t0);
+        min_mv = mv < min_mv ? mv : min_mv;
+        max_mv = mv > max_mv ? mv : max_mv;
+    }
+    int32_t mean_mv = (int32_t)(sum_mv / n);
+    int64_t mean_t = sum_t / n;
+
+    // Centered sums keep the products small
+    int64_t sxy = 0;
+    int64_t sxx = 0;
+    int64_t syy = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        int64_t dt = (int64_t)(uint32_t)(window->t_ms[i] - t0) - mean_t;
+        int64_t dv = (int64_t)window->mv[i] * n - sum_mv; // n times the deviation, exact
+        sxy += dt * dv;
+        sxx += dt * dt;
+        syy += dv * dv;
+    }
+
+    features[GROVE_AQS_FEATURE_LEVEL] = mean_mv;
+    features[GROVE_AQS_FEATURE_SLOPE] = sxx > 0 ? (int32_t)(sxy / n * 60000 / sxx) : 0;
+    features[GROVE_AQS_FEATURE_STDDEV] = (int32_t)(grove_aqs_isqrt64((uint64_t)syy / n) / n);
+    features[GROVE_AQS_FEATURE_RANGE] = max_mv - min_mv;
+    for (int g = 0; g < GROVE_AQS_FEATURE_CYCLE_GROUPS; g++) {
+        features[GROVE_AQS_FEATURE_CYCLE + g] = window->cycle[g];
+    }
+}
+
+/* ---- Model ---- */
+
+esp_err_t grove_aqs_model_load(const void *blob, size_t len, grove_aqs_model_t *model) {
+    if (blob == NULL || model == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((uintptr_t)blob % 4 != 0) {
+        ESP_LOGE(TAG, "Model blob must be 4-byte aligned");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < sizeof(grove_aqs_model_header_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)blob;
+    const grove_aqs_model_header_t *header = (const grove_aqs_model_header_t *)blob;
+    if (header->magic != GROVE_AQS_MODEL_MAGIC || header->version != GROVE_AQS_MODEL_VERSION) {
+        ESP_LOGE(TAG, "Not a version %d model blob", GROVE_AQS_MODEL_VERSION);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header->size < sizeof(*header) || header->size > len) {
+        ESP_LOGE(TAG, "Model blob truncated: %u of %u bytes", (unsigned)len, (unsigned)header->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (grove_aqs_crc32(0, bytes + sizeof(*header), header->size - sizeof(*header)) != header->crc32) {
+        ESP_LOGE(TAG, "Model blob corrupted");
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (header->input_count == 0 || header->input_count > GROVE_AQS_FEATURE_COUNT ||
+        header->layer_count == 0 || header->layer_count > GROVE_AQS_MODEL_MAX_LAYERS) {
+        ESP_LOGE(TAG, "Model has %u inputs and %u layers", header->input_count, header->layer_count);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(model, 0, sizeof(*model));
+    model->header = header;
+    size_t offset = sizeof(*header);
+    uint8_t width = header->input_count;
+    for (uint8_t l = 0; l < header->layer_count; l++) {
+        if (offset + sizeof(grove_aqs_model_layer_t) > header->size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        const grove_aqs_model_layer_t *layer = (const grove_aqs_model_layer_t *)(bytes + offset);
+        if (layer->in != width || layer->out == 0 || layer->out > GROVE_AQS_MODEL_MAX_WIDTH ||
+            layer->shift == 0 || layer->shift > 62) {
+            ESP_LOGE(TAG, "Layer %u does not fit the model", l);
+            return ESP_ERR_INVALID_ARG;
+        }
+        offset += sizeof(*layer);
+        model->layers[l] = layer;
+        model->bias[l] = (const int32_t *)(bytes + offset);
+        offset += layer->out * sizeof(int32_t);
+        model->weights[l] = (const int8_t *)(bytes + offset);
+        offset += ((size_t)layer->out * layer->in + 3) & ~(size_t)3;
+        if (offset > header->size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        width = layer->out;
+    }
+
+    if (width > GROVE_AQS_MODEL_MAX_OUTPUTS) {
+        ESP_LOGE(TAG, "Model has %u outputs", width);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t o = 0; o < width; o++) {
+        if (header->class_map[o] >= GROVE_AQS_QUALITY_COUNT && header->class_map[o] != GROVE_AQS_MODEL_KEEP_LEVEL) {
+            ESP_LOGE(TAG, "Output %u maps to unknown category %u", o, header->class_map[o]);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    model->output_count = width;
+    return ESP_OK;
+}
+
+void grove_aqs_model_infer(const grove_aqs_model_t *model, const int32_t *features, grove_aqs_quality_t level,
+                           grove_aqs_model_output_t *out) {
+    int8_t buffers[2][GROVE_AQS_MODEL_MAX_WIDTH];
+    int8_t *in = buffers[0];
+    int8_t *next = buffers[1];
+
+    const grove_aqs_model_header_t *header = model->header;
+    for (uint8_t i = 0; i < header->input_count; i++) {
+        int64_t centered = (int64_t)features[i] - header->inputs[i].offset;
+        in[i] = saturate_int8((centered * header->inputs[i].scale_q16) >> 16);
+    }
+
+    for (uint8_t l = 0; l < header->layer_count; l++) {
+        const grove_aqs_model_layer_t *layer = model->layers[l];
+        const int8_t *w = model->weights[l];
+        const int64_t round = 1LL << (layer->shift - 1);
+        for (uint8_t o = 0; o < layer->out; o++, w += layer->in) {
+            int32_t acc = model->bias[l][o];
+            for (uint8_t i = 0; i < layer->in; i++) {
+                acc += w[i] * in[i];
+            }
+            int8_t y = saturate_int8(((int64_t)acc * layer->multiplier + round) >> layer->shift);
+            next[o] = layer->relu && y < 0 ? 0 : y;
+        }
+        int8_t *swap = in;
+        in = next;
+        next = swap;
+    }
+
+    memset(out, 0, sizeof(*out));
+    int16_t second = INT16_MIN;
+    for (uint8_t o = 0; o < model->output_count; o++) {
+        out->scores[o] = in[o];
+        if (o == 0 || in[o] > in[out->output]) {
+            second = o == 0 ? INT16_MIN : in[out->output];
+            out->output = o;
+        } else if (in[o] > second) {
+            second = in[o];
+        }
+    }
+    out->margin = second == INT16_MIN ? 0 : (int16_t)(in[out->output] - second);
+    uint8_t category = header->class_map[out->output];
+    out->quality = category == GROVE_AQS_MODEL_KEEP_LEVEL ? level : (grove_aqs_quality_t)category;
+}
+
+#ifdef ESP_PLATFORM
+
+esp_err_t grove_aqs_model_load_partition(const char *label, grove_aqs_model_t *model) {
+    if (label == NULL || model == NULL) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *ptr = NULL;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map partition '%s': %d", label, ret);
+        return ret;
+    }
+    ret = grove_aqs_model_load(ptr, part->size, model);
+    if (ret != ESP_OK) {
+        esp_partition_munmap(handle);
+        return ret;
+    }
+    ESP_LOGI(TAG, "Model loaded from '%s': %u inputs, %u layers, %u outputs", label,
+             model->header->input_count, model->header->layer_count, model->output_count);
+    return ESP_OK;
+}
+
+#endif /* ESP_PLATFORM */
@@ -0,0 +1,248 @@
+/**
+ * @file grove_aqs_config_blob.c
+ * @brief Config blob parsing, writing and storage
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <string.h>
+#include "grove_aqs_config_blob.h"
+#include "grove_aqs_util.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#include "nvs.h"
+#endif
+
+static const char *TAG = "grove_aqs_config";
+
+_Static_assert(sizeof(grove_aqs_config_blob_header_t) % 4 == 0, "sections must start 4-byte aligned");
+_Static_assert(sizeof(grove_aqs_config_section_t) == 4, "section header is part of the blob format");
+_Static_assert(sizeof(grove_aqs_config_classify_t) == 24, "classify section is part of the blob format");
+_Static_assert(sizeof(grove_aqs_calibration_t) == 8, "calibration section is part of the blob format");
+
+static inline size_t padded(size_t size) {
+    return (size + 3) & ~(size_t)3;
+}
+
+static bool classify_valid(const grove_aqs_config_classify_t *classify) {
+    for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+        int32_t floor_mv = t > 0 ? classify->thresholds[t - 1] + 1 : 0;
+        if (classify->thresholds[t] < floor_mv || classify->thresholds[t] > GROVE_AQS_CONFIG_BLOB_MAX_MV) {
+            return false;
+        }
+    }
+    return classify->hysteresis_mv >= 0 && classify->hysteresis_mv <= GROVE_AQS_CONFIG_BLOB_MAX_MV &&
+           classify->filter_shift <= GROVE_AQS_CORE_FILTER_SHIFT_MAX;
+}
+
+static bool calibration_valid(const grove_aqs_calibration_t *cal) {
+    return cal->gain >= GROVE_AQS_CORE_GAIN_ONE / 2 && cal->gain <= 2 * GROVE_AQS_CORE_GAIN_ONE &&
+           cal->offset_mv >= -GROVE_AQS_CONFIG_BLOB_MAX_MV && cal->offset_mv <= GROVE_AQS_CONFIG_BLOB_MAX_MV;
+}
+
+esp_err_t grove_aqs_config_blob_parse(const void *blob, size_t len, grove_aqs_config_blob_t *config) {
+    if (blob == NULL || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((uintptr_t)blob % 4 != 0) {
+        ESP_LOGE(TAG, "Config blob must be 4-byte aligned");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < sizeof(grove_aqs_config_blob_header_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)blob;
+    const grove_aqs_config_blob_header_t *header = (const grove_aqs_config_blob_header_t *)blob;
+    if (header->magic != GROVE_AQS_CONFIG_BLOB_MAGIC || header->version != GROVE_AQS_CONFIG_BLOB_VERSION) {
+        ESP_LOGE(TAG, "Not a version %d config blob", GROVE_AQS_CONFIG_BLOB_VERSION);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header->size < sizeof(*header) || header->size > len) {
+        ESP_LOGE(TAG, "Config blob truncated: %u of %u bytes", (unsigned)len, (unsigned)header->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (grove_aqs_crc32(0, bytes + sizeof(*header), header->size - sizeof(*header)) != header->crc32) {
+        ESP_LOGE(TAG, "Config blob corrupted");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    memset(config, 0, sizeof(*config));
+    size_t offset = sizeof(*header);
+    for (uint16_t s = 0; s < header->section_count; s++) {
+        if (offset + sizeof(grove_aqs_config_section_t) > header->size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        const grove_aqs_config_section_t *section = (const grove_aqs_config_section_t *)(bytes + offset);
+        offset += sizeof(*section);
+        const void *payload = bytes + offset;
+        offset += padded(section->size);
+        if (offset > header->size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        // A payload may be longer than the structure, for fields added later
+        switch (section->tag) {
+            case GROVE_AQS_CONFIG_CLASSIFY:
+                if (config->classify != NULL || section->size < sizeof(grove_aqs_config_classify_t) ||
+                    !classify_valid(payload)) {
+                    ESP_LOGE(TAG, "Invalid classification section");
+                    return ESP_ERR_INVALID_ARG;
+                }
+                config->classify = payload;
+                break;
+            case GROVE_AQS_CONFIG_CALIBRATION:
+                if (config->calibration != NULL || section->size < sizeof(grove_aqs_calibration_t) ||
+                    !calibration_valid(payload)) {
+                    ESP_LOGE(TAG, "Invalid calibration section");
+                    return ESP_ERR_INVALID_ARG;
+                }
+                config->calibration = payload;
+                break;
+            default:
+                ESP_LOGD(TAG, "Skipping section %u", section->tag);
+                break;
+        }
+    }
+    config->header = header;
+    return ESP_OK;
+}
+
+/* Appends a section if there is room; offset advances either way, so the caller learns the size needed */
+static void put_section(uint8_t *bytes, size_t len, size_t *offset, uint16_t tag, const void *payload,
+                        uint16_t size) {
+    size_t end = *offset + sizeof(grove_aqs_config_section_t) + padded(size);
+    if (end <= len) {
+        grove_aqs_config_section_t section = { .tag = tag, .size = size };
+        memcpy(bytes + *offset, &section, sizeof(section));
+        memcpy(bytes + *offset + sizeof(section), payload, size);
+        memset(bytes + *offset + sizeof(section) + size, 0, padded(size) - size);
+    }
+    *offset = end;
+}
+
+esp_err_t grove_aqs_config_blob_write(const grove_aqs_config_blob_t *config, uint32_t sequence, void *buf,
+                                      size_t len, size_t *written) {
+    if (config == NULL || buf == NULL || written == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t *bytes = (uint8_t *)buf;
+    size_t offset = sizeof(grove_aqs_config_blob_header_t);
+    uint16_t count = 0;
+    if (config->classify != NULL) {
+        put_section(bytes, len, &offset, GROVE_AQS_CONFIG_CLASSIFY, config->classify,
+                    sizeof(grove_aqs_config_classify_t));
+        count++;
+    }
+    if (config->calibration != NULL) {
+        put_section(bytes, len, &offset, GROVE_AQS_CONFIG_CALIBRATION, config->calibration,
+                    sizeof(grove_aqs_calibration_t));
+        count++;
+    }
+    *written = offset;
+    if (offset > len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    grove_aqs_config_blob_header_t header = {
+        .magic = GROVE_AQS_CONFIG_BLOB_MAGIC,
+        .version = GROVE_AQS_CONFIG_BLOB_VERSION,
+        .section_count = count,
+        .size = (uint32_t)offset,
+        .crc32 = grove_aqs_crc32(0, bytes + sizeof(header), offset - sizeof(header)),
+        .sequence = sequence,
+    };
+    memcpy(bytes, &header, sizeof(header));
+    return ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+
+esp_err_t grove_aqs_config_blob_load_partition(const char *label, grove_aqs_config_blob_t *config) {
+    if (label == NULL || config == NULL) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *ptr = NULL;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map partition '%s': %d", label, ret);
+        return ret;
+    }
+    ret = grove_aqs_config_blob_parse(ptr, part->size, config);
+    if (ret != ESP_OK) {
+        esp_partition_munmap(handle);
+        return ret;
+    }
+    ESP_LOGI(TAG, "Config %u loaded from '%s'", (unsigned)config->header->sequence, label);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_config_blob_load_nvs(const char *key, void *buf, size_t len, grove_aqs_config_blob_t *config) {
+    if (key == NULL || buf == NULL || config == NULL) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(GROVE_AQS_CONFIG_BLOB_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret != ESP_OK) {
+        return ret == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : ret;
+    }
+    size_t size = len;
+    ret = nvs_get_blob(nvs, key, buf, &size);
+    nvs_close(nvs);
+    if (ret != ESP_OK) {
+        if (ret == ESP_ERR_NVS_NOT_FOUND) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        ESP_LOGE(TAG, "Failed to read config '%s': %d", key, ret);
+        return ret;
+    }
+    return grove_aqs_config_blob_parse(buf, size, config);
+}
+
+esp_err_t grove_aqs_config_blob_store_nvs(const char *key, const void *blob, size_t len) {
+    if (key == NULL) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+    grove_aqs_config_blob_t config;
+    esp_err_t ret = grove_aqs_config_blob_parse(blob, len, &config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    nvs_handle_t nvs;
+    ret = nvs_open(GROVE_AQS_CONFIG_BLOB_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %d", ret);
+        return ret;
+    }
+    ret = nvs_set_blob(nvs, key, blob, config.header->size);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store config '%s': %d", key, ret);
+    }
+    return ret;
+}
+
+#endif /* ESP_PLATFORM */
@@ -0,0 +1,120 @@
+/**
+ * @file grove_aqs_core.c
+ * @brief Platform-independent conversion and classification core
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include "grove_aqs_core.h"
+
+void grove_aqs_core_params_init(grove_aqs_core_params_t *params, int vref, int fresh_threshold,
+                                int good_threshold, int moderate_threshold, int poor_threshold) {
+    params->vref = vref;
+    params->thresholds[0] = fresh_threshold;
+    params->thresholds[1] = good_threshold;
+    params->thresholds[2] = moderate_threshold;
+    params->thresholds[3] = poor_threshold;
+    params->gain = GROVE_AQS_CORE_GAIN_ONE;
+    params->offset_mv = 0;
+    params->hysteresis_mv = 0;
+    params->filter_shift = 0;
+}
+
+bool grove_aqs_core_calibrate(int clean_mv, int reference_mv, int expected_clean_mv, int expected_reference_mv,
+                              grove_aqs_calibration_t *cal) {
+    int measured_span = reference_mv - clean_mv;
+    int expected_span = expected_reference_mv - expected_clean_mv;
+    if (measured_span == 0 || expected_span == 0 || (measured_span < 0) != (expected_span < 0)) {
+        return false;
+    }
+    // Rounded to the nearest step of the gain
+    int64_t gain = (((int64_t)expected_span << GROVE_AQS_CORE_GAIN_SHIFT) + measured_span / 2) / measured_span;
+    if (gain < GROVE_AQS_CORE_GAIN_ONE / 2 || gain > 2 * GROVE_AQS_CORE_GAIN_ONE) {
+        return false;
+    }
+    cal->gain = (int32_t)gain;
+    cal->offset_mv = expected_clean_mv - (int32_t)(((int64_t)clean_mv * gain) >> GROVE_AQS_CORE_GAIN_SHIFT);
+    return true;
+}
+
+void grove_aqs_core_set_calibration(grove_aqs_core_params_t *params, int32_t heater_gain,
+                                    const grove_aqs_calibration_t *cal) {
+    params->gain = (int32_t)(((int64_t)heater_gain * cal->gain) >> GROVE_AQS_CORE_GAIN_SHIFT);
+    params->offset_mv = cal->offset_mv;
+}
+
+int32_t grove_aqs_core_heater_gain(int duty_pct, int sensitivity_pct) {
+    // Relative output in units of 1/10000: 1 - s * (1 - d)
+    int32_t output = 10000 - sensitivity_pct * (100 - duty_pct);
+    if (output <= 0) {
+        return GROVE_AQS_CORE_GAIN_ONE;
+    }
+    return (int32_t)(((int64_t)10000 << GROVE_AQS_CORE_GAIN_SHIFT) / output);
+}
+
+int grove_aqs_core_raw_to_mv(const grove_aqs_core_params_t *params, int raw) {
+    return (raw * params->vref) / GROVE_AQS_ADC_MAX_RAW;
+}
+
+grove_aqs_quality_t grove_aqs_core_classify(const grove_aqs_core_params_t *params, int voltage_mv) {
+    // Determine air quality based on voltage and thresholds
+    if (voltage_mv <= params->thresholds[0]) {
+        return GROVE_AQS_QUALITY_FRESH;
+    } else if (voltage_mv <= params->thresholds[1]) {
+        return GROVE_AQS_QUALITY_GOOD;
+    } else if (voltage_mv <= params->thresholds[2]) {
+        return GROVE_AQS_QUALITY_MODERATE;
+    } else if (voltage_mv <= params->thresholds[3]) {
+        return GROVE_AQS_QUALITY_POOR;
+    }
+    return GROVE_AQS_QUALITY_VERY_POOR;
+}
+
+grove_aqs_quality_t grove_aqs_core_track(const grove_aqs_core_params_t *params, grove_aqs_core_track_t *track,
+                                         int voltage_mv) {
+    int32_t sample_q8 = (int32_t)voltage_mv * 256;
+    if (!track->primed) {
+        // The filter starts at the first sample instead of ramping up from 0
+        track->filtered_q8 = sample_q8;
+        track->level = grove_aqs_core_classify(params, voltage_mv);
+        track->primed = true;
+        return track->level;
+    }
+    track->filtered_q8 += (sample_q8 - track->filtered_q8) >> params->filter_shift;
+    int mv = (track->filtered_q8 + 128) >> 8;
+
+    int level = track->level;
+    while (level < GROVE_AQS_QUALITY_LEVEL_COUNT - 1 && mv > params->thresholds[level] + params->hysteresis_mv) {
+        level++;
+    }
+    while (level > 0 && mv + params->hysteresis_mv <= params->thresholds[level - 1]) {
+        level--;
+    }
+    track->level = (grove_aqs_quality_t)level;
+    return track->level;
+}
+
+const char* grove_aqs_quality_to_string(grove_aqs_quality_t quality) {
+    switch (quality) {
+        case GROVE_AQS_QUALITY_FRESH:
+            return "Fresh";
+        case GROVE_AQS_QUALITY_GOOD:
+            return "Good";
+        case GROVE_AQS_QUALITY_MODERATE:
+            return "Moderate";
+        case GROVE_AQS_QUALITY_POOR:
+            return "Poor";
+        case GROVE_AQS_QUALITY_VERY_POOR:
+            return "Very Poor";
+        case GROVE_AQS_QUALITY_SMOKE:
+            return "Smoke";
+        case GROVE_AQS_QUALITY_SOLVENT:
+            return "Solvent";
+        default:
+            return "Unknown";
+    }
+}
@@ -0,0 +1,171 @@
+/**
+ * @file grove_aqs_dlog.c
+ * @brief Lock-free record ring of the deferred logger
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * The ring is a bounded multi-producer queue: a producer claims a slot by
+ * advancing the write position with a compare-and-swap, fills the record and
+ * then publishes it by bumping the slot's sequence number. The consumer only
+ * reads slots whose sequence says they are complete, so a preempted producer
+ * delays the drain but never corrupts it.
+ */
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "grove_aqs_dlog.h"
+#include "grove_aqs_dlog_table.h"
+#include "grove_aqs_trace.h"
+
+#define RING_SIZE CONFIG_GROVE_AQS_DLOG_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+_Static_assert((RING_SIZE & RING_MASK) == 0, "CONFIG_GROVE_AQS_DLOG_RING_SIZE must be a power of two");
+_Static_assert(sizeof(grove_aqs_dlog_record_t) == 24, "record layout is part of the stream format");
+
+/*
+ * Slot i is free for position pos when its sequence equals pos and holds a
+ * record for pos when it equals pos + 1. Sequences are stored relative to the
+ * slot index, so the zero-initialised ring is already in its start state.
+ */
+typedef struct {
+    atomic_uint_fast32_t seq;
+    grove_aqs_dlog_record_t record;
+} slot_t;
+
+static slot_t ring[RING_SIZE];
+static atomic_uint_fast32_t write_pos;
+static uint32_t read_pos;
+static atomic_uint_fast32_t dropped;
+
+void grove_aqs_dlog_write(char level, uint16_t id, size_t nargs, const int32_t *args) {
+    uint32_t pos = (uint32_t)atomic_load_explicit(&write_pos, memory_order_relaxed);
+    slot_t *slot;
+
+    for (;;) {
+        slot = &ring[pos & RING_MASK];
+        uint32_t seq = (uint32_t)atomic_load_explicit(&slot->seq, memory_order_acquire) + (pos & RING_MASK);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            uint_fast32_t expected = pos;
+            if (atomic_compare_exchange_weak_explicit(&write_pos, &expected, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+            pos = (uint32_t)expected;
+        } else if (diff < 0) {
+            // Ring full: the consumer has not freed this slot yet
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = (uint32_t)atomic_load_explicit(&write_pos, memory_order_relaxed);
+        }
+    }
+
+    if (nargs > GROVE_AQS_DLOG_MAX_ARGS) {
+        nargs = GROVE_AQS_DLOG_MAX_ARGS;
+    }
+    slot->record.timestamp_us = (uint32_t)grove_aqs_port_time_us();
+    slot->record.id = id;
+    slot->record.level = (uint8_t)level;
+    slot->record.nargs = (uint8_t)nargs;
+    memcpy(slot->record.args, args, nargs * sizeof(int32_t));
+
+    atomic_store_explicit(&slot->seq, pos + 1 - (pos & RING_MASK), memory_order_release);
+}
+
+size_t grove_aqs_dlog_drain(grove_aqs_dlog_sink_t sink, void *ctx, size_t max) {
+    size_t drained = 0;
+
+    GROVE_AQS_TRACE_BEGIN(GROVE_AQS_TRACE_DLOG_DRAIN, 0);
+
+    while (drained < max) {
+        slot_t *slot = &ring[read_pos & RING_MASK];
+        uint32_t seq = (uint32_t)atomic_load_explicit(&slot->seq, memory_order_acquire) + (read_pos & RING_MASK);
+        if (seq != read_pos + 1) {
+            break;
+        }
+
+        grove_aqs_dlog_record_t record = slot->record;
+        atomic_store_explicit(&slot->seq, read_pos + RING_SIZE - (read_pos & RING_MASK), memory_order_release);
+        read_pos++;
+
+        if (record.nargs < GROVE_AQS_DLOG_MAX_ARGS) {
+            memset(&record.args[record.nargs], 0, (GROVE_AQS_DLOG_MAX_ARGS - record.nargs) * sizeof(int32_t));
+        }
+        sink(ctx, &record);
+        drained++;
+    }
+    GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_DLOG_DRAIN, drained);
+    return drained;
+}
+
+uint32_t grove_aqs_dlog_dropped(void) {
+    return (uint32_t)atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+void grove_aqs_dlog_stream_header(grove_aqs_dlog_stream_header_t *header) {
+    header->magic = GROVE_AQS_DLOG_STREAM_MAGIC;
+    header->version = GROVE_AQS_DLOG_STREAM_VERSION;
+    header->record_size = sizeof(grove_aqs_dlog_record_t);
+    header->table_hash = GROVE_AQS_DLOG_TABLE_HASH;
+}
+
+#if defined(ESP_PLATFORM) && CONFIG_GROVE_AQS_DLOG_FORMAT_TASK
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "grove_aqs";
+
+static void format_sink(void *ctx, const grove_aqs_dlog_record_t *record) {
+    char *line = ctx;
+    if (grove_aqs_dlog_format(record, line, 128) < 0) {
+        ESP_LOGW(TAG, "Unknown deferred log id %u", record->id);
+        return;
+    }
+    switch (record->level) {
+    case 'E':
+        ESP_LOGE(TAG, "[%" PRIu32 "] %s", record->timestamp_us, line);
+        break;
+    case 'W':
+        ESP_LOGW(TAG, "[%" PRIu32 "] %s", record->timestamp_us, line);
+        break;
+    default:
+        ESP_LOGI(TAG, "[%" PRIu32 "] %s", record->timestamp_us, line);
+        break;
+    }
+}
+
+static void format_task(void *arg) {
+    (void)arg;
+    char line[128];
+    uint32_t reported_drops = 0;
+
+    for (;;) {
+        if (grove_aqs_dlog_drain(format_sink, line, SIZE_MAX) == 0) {
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_GROVE_AQS_DLOG_FORMAT_PERIOD_MS));
+            GROVE_AQS_TRACE_INSTANT(GROVE_AQS_TRACE_CONSUMER_WAKE, 0);
+        }
+        uint32_t drops = grove_aqs_dlog_dropped();
+        if (drops != reported_drops) {
+            ESP_LOGW(TAG, "Deferred log ring overflowed, %" PRIu32 " records dropped", drops - reported_drops);
+            reported_drops = drops;
+        }
+    }
+}
+
+esp_err_t grove_aqs_dlog_start_task(unsigned int priority) {
+    if (xTaskCreate(format_task, "aqs_dlog", 3072, NULL, priority, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create deferred log task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#endif /* ESP_PLATFORM && CONFIG_GROVE_AQS_DLOG_FORMAT_TASK */
@@ -0,0 +1,78 @@
+/**
+ * @file grove_aqs_dlog_format.c
+ * @brief Formatting of deferred log records from the generated site table
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+// Before any include of the table, which is include-guarded
+#define GROVE_AQS_DLOG_TABLE_STRINGS
+#include "grove_aqs_dlog.h"
+#include "grove_aqs_dlog_table.h"
+
+/* Position to continue writing at; once the buffer is full, output is only counted */
+static char *tail(char *buf, size_t len, size_t out, size_t *room) {
+    size_t at = out < len ? out : len - 1;
+    *room = len - at;
+    return buf + at;
+}
+
+int grove_aqs_dlog_format(const grove_aqs_dlog_record_t *record, char *buf, size_t len) {
+    if (record->id >= GROVE_AQS_DLOG_ID_COUNT || len == 0) {
+        return -1;
+    }
+
+    const char *fmt = grove_aqs_dlog_sites[record->id].format;
+    size_t out = 0;
+    size_t arg = 0;
+    size_t room;
+    char *dst;
+    int n;
+
+    // Hand the format to snprintf one conversion at a time, each with its raw argument
+    while (*fmt != '\0') {
+        const char *next = strchr(fmt + (*fmt == '%' ? 1 : 0), '%');
+        size_t literal = next != NULL ? (size_t)(next - fmt) : strlen(fmt);
+
+        if (*fmt != '%') {
+            dst = tail(buf, len, out, &room);
+            n = snprintf(dst, room, "%.*s", (int)literal, fmt);
+            fmt += literal;
+        } else if (fmt[1] == '%') {
+            dst = tail(buf, len, out, &room);
+            n = snprintf(dst, room, "%%");
+            fmt += 2;
+        } else {
+            char spec[16];
+            size_t spec_len = 0;
+            while (*fmt != '\0' && spec_len < sizeof(spec) - 1) {
+                spec[spec_len++] = *fmt++;
+                if (strchr("diuxXcs", spec[spec_len - 1]) != NULL) {
+                    break;
+                }
+            }
+            spec[spec_len] = '\0';
+
+            int32_t value = arg < record->nargs ? record->args[arg] : 0;
+            arg++;
+            dst = tail(buf, len, out, &room);
+            if (spec[spec_len - 1] == 's') {
+                // The only string argument deferred sites may pass is an air quality level
+                n = snprintf(dst, room, spec, grove_aqs_quality_to_string((grove_aqs_quality_t)value));
+            } else {
+                n = snprintf(dst, room, spec, value);
+            }
+        }
+        if (n > 0) {
+            out += (size_t)n;
+        }
+    }
+    return (int)out;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file grove_aqs_energy.c
+ * @brief Energy accounting per reading and per subsystem
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Only times are accumulated; charge and energy are derived from the model
+ * when the totals are read. The hooks are called from the sampling path,
+ * which the driver already requires to be single-threaded.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "grove_aqs_energy.h"
+
+static const char *TAG = "grove_aqs_energy";
+
+static struct {
+    bool started;
+    grove_aqs_energy_model_t model;
+    int64_t start_us;
+    int64_t since_us[GROVE_AQS_ENERGY_STATE_COUNT]; // -1 while the state is inactive
+    uint64_t time_us[GROVE_AQS_ENERGY_STATE_COUNT];
+    uint64_t drawn_us[GROVE_AQS_ENERGY_STATE_COUNT]; // time_us scaled by the duty it was spent at
+    uint8_t duty_pct[GROVE_AQS_ENERGY_STATE_COUNT];
+    uint8_t active_duty_pct[GROVE_AQS_ENERGY_STATE_COUNT]; // Duty of the interval in progress
+    uint32_t readings;
+    uint32_t exports;
+    uint64_t export_bytes;
+} acct;
+
+/* uA x us = pC; pC x mV = 1e-9 uJ. Scaled in two steps so a year of heater time does not overflow. */
+static uint64_t energy_uj(uint64_t time_us, uint32_t current_ua, uint32_t supply_mv) {
+    uint64_t charge_nc = time_us * current_ua / 1000;
+    return charge_nc * supply_mv / 1000000;
+}
+
+esp_err_t grove_aqs_energy_init(const grove_aqs_energy_model_t *model, int64_t now_us) {
+    static const grove_aqs_energy_model_t default_model = GROVE_AQS_ENERGY_DEFAULT_MODEL();
+    if (model == NULL) {
+        model = &default_model;
+    }
+    if (model->supply_mv == 0 || model->radio_bytes_per_s == 0) {
+        ESP_LOGE(TAG, "Model needs a supply voltage and a radio throughput");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&acct, 0, sizeof(acct));
+    acct.model = *model;
+    acct.start_us = now_us;
+    for (int i = 0; i < GROVE_AQS_ENERGY_STATE_COUNT; i++) {
+        acct.since_us[i] = -1;
+        acct.duty_pct[i] = 100;
+    }
+    acct.started = true;
+    return ESP_OK;
+}
+
+void grove_aqs_energy_begin(grove_aqs_energy_state_t state, int64_t now_us) {
+    if (!acct.started || state >= GROVE_AQS_ENERGY_SLEEP || acct.since_us[state] >= 0) {
+        return;
+    }
+    acct.since_us[state] = now_us;
+    acct.active_duty_pct[state] = acct.duty_pct[state];
+}
+
+void grove_aqs_energy_set_duty(grove_aqs_energy_state_t state, uint8_t duty_pct) {
+    if (!acct.started || state >= GROVE_AQS_ENERGY_STATE_COUNT) {
+        return;
+    }
+    acct.duty_pct[state] = duty_pct > 100 ? 100 : duty_pct;
+}
+
+void grove_aqs_energy_end(grove_aqs_energy_state_t state, int64_t now_us) {
+    if (!acct.started || state >= GROVE_AQS_ENERGY_SLEEP || acct.since_us[state] < 0) {
+        return;
+    }
+    if (now_us > acct.since_us[state]) {
+        uint64_t elapsed = (uint64_t)(now_us - acct.since_us[state]);
+        acct.time_us[state] += elapsed;
+        acct.drawn_us[state] += elapsed * acct.active_duty_pct[state] / 100;
+    }
+    acct.since_us[state] = -1;
+}
+
+void grove_aqs_energy_count_reading(void) {
+    if (acct.started) {
+        acct.readings++;
+    }
+}
+
+void grove_aqs_energy_add_export(size_t bytes) {
+    if (!acct.started) {
+        return;
+    }
+    uint64_t radio_us = acct.model.radio_overhead_us + (uint64_t)bytes * 1000000 / acct.model.radio_bytes_per_s;
+    acct.time_us[GROVE_AQS_ENERGY_RADIO] += radio_us;
+    acct.drawn_us[GROVE_AQS_ENERGY_RADIO] += radio_us * acct.duty_pct[GROVE_AQS_ENERGY_RADIO] / 100;
+    acct.exports++;
+    acct.export_bytes += bytes;
+}
+
+esp_err_t grove_aqs_energy_get_totals(int64_t now_us, grove_aqs_energy_totals_t *totals) {
+    if (totals == NULL) {
+        ESP_LOGE(TAG, "Totals pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!acct.started) {
+        ESP_LOGE(TAG, "Accounting not started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(totals, 0, sizeof(*totals));
+    totals->elapsed_us = now_us > acct.start_us ? (uint64_t)(now_us - acct.start_us) : 0;
+    uint64_t drawn_us[GROVE_AQS_ENERGY_STATE_COUNT];
+    for (int i = 0; i < GROVE_AQS_ENERGY_SLEEP; i++) {
+        totals->time_us[i] = acct.time_us[i];
+        drawn_us[i] = acct.drawn_us[i];
+        if (acct.since_us[i] >= 0 && now_us > acct.since_us[i]) {
+            uint64_t open_us = (uint64_t)(now_us - acct.since_us[i]);
+            totals->time_us[i] += open_us;
+            drawn_us[i] += open_us * acct.active_duty_pct[i] / 100;
+        }
+    }
+
+    // The heater and the ADC draw on top of whatever the chip is doing; CPU and radio replace sleep
+    uint64_t awake_us = totals->time_us[GROVE_AQS_ENERGY_CPU] + totals->time_us[GROVE_AQS_ENERGY_RADIO];
+    totals->time_us[GROVE_AQS_ENERGY_SLEEP] = totals->elapsed_us > awake_us ? totals->elapsed_us - awake_us : 0;
+    drawn_us[GROVE_AQS_ENERGY_SLEEP] = totals->time_us[GROVE_AQS_ENERGY_SLEEP];
+
+    for (int i = 0; i < GROVE_AQS_ENERGY_STATE_COUNT; i++) {
+        totals->energy_uj[i] = energy_uj(drawn_us[i], acct.model.current_ua[i], acct.model.supply_mv);
+        totals->total_uj += totals->energy_uj[i];
+    }
+
+    totals->readings = acct.readings;
+    totals->exports = acct.exports;
+    totals->export_bytes = acct.export_bytes;
+    if (acct.readings > 0) {
+        totals->uj_per_reading = (uint32_t)(totals->total_uj / acct.readings);
+    }
+    if (totals->elapsed_us > 0) {
+        // uJ / (mV x us) = 1e9 uA
+        totals->average_ua = (uint32_t)((double)totals->total_uj * 1e9 /
+                                        ((double)acct.model.supply_mv * (double)totals->elapsed_us));
+    }
+    return ESP_OK;
+}
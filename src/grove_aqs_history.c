@@ -0,0 +1,986 @@
+/**
+ * @file grove_aqs_history.c
+ * @brief Crash-safe circular journal of compressed sample batches
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Layout: the storage is a ring of sectors. Every sector starts with a
+ * header carrying a sequence number that grows by one each time a sector is
+ * (re)opened, followed by append-only records. A record is a header with a
+ * CRC over header and payload, followed by delta/zigzag/varint encoded
+ * samples. The payload is programmed before the header, so a record only
+ * becomes visible once it is complete; anything after the last valid record
+ * that is not erased marks the sector as closed on the next mount.
+ *
+ * Record headers carry the aggregate (count, min/max/sum, quality counts)
+ * of their samples. When a sector is closed, the aggregate over all of its
+ * records is programmed into the still-erased seal area of its header. These
+ * seals form the persistent index: range aggregates are answered from seals
+ * and record headers and only records straddling the range edges are
+ * decompressed.
+ *
+ * When the storage backend provides a read-only mapping, headers are read
+ * and payloads are checked and decoded in place from the mapping instead of
+ * being copied into RAM first.
+ */
+
+#include <string.h>
+#include "grove_aqs_history.h"
+#include "grove_aqs_trace.h"
+#include "grove_aqs_util.h"
+
+static const char *TAG = "grove_aqs_history";
+
+#define SECTOR_MAGIC        0x4A535141u  /* "AQSJ" */
+#define RECORD_MAGIC        0x5AA5u
+#define RECORD_ERASED       0xFFFFu
+#define FORMAT_VERSION      3
+
+/* Worst case encoding per sample: 5 byte time delta, 3 byte voltage+quality, 3 byte raw delta */
+#define MAX_SAMPLE_BYTES    11
+#define MAX_PAYLOAD         (GROVE_AQS_HISTORY_MAX_BATCH * MAX_SAMPLE_BYTES)
+
+typedef struct {
+    uint32_t first_ts;
+    uint32_t last_ts;
+    uint32_t count;
+    uint32_t sum_mv;
+    uint16_t min_mv;
+    uint16_t max_mv;
+    uint16_t quality_count[GROVE_AQS_HISTORY_QUALITY_LEVELS];
+    uint16_t reserved;
+    uint32_t crc;                    /* Over the fields above */
+} sector_seal_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t seq;
+    uint32_t crc;                    /* Over the fields above */
+    sector_seal_t seal;              /* Erased until the sector is closed */
+} sector_hdr_t;
+
+typedef struct {
+    uint16_t magic;
+    uint16_t length;                 /* Payload bytes */
+    uint16_t count;                  /* Samples in the payload */
+    uint16_t min_mv;
+    uint16_t max_mv;
+    uint16_t quality_count[GROVE_AQS_HISTORY_QUALITY_LEVELS];
+    uint32_t sum_mv;
+    uint32_t first_ts;
+    uint32_t last_ts;
+    uint32_t crc;                    /* Over the fields above and the payload */
+} record_hdr_t;
+
+/* All fields are naturally aligned, so the structs map 1:1 onto the on-flash layout */
+_Static_assert(sizeof(sector_seal_t) == 40, "sector seal layout");
+_Static_assert(sizeof(sector_hdr_t) == 56, "sector header layout");
+_Static_assert(sizeof(record_hdr_t) == 40, "record header layout");
+
+typedef enum {
+    RECORD_OK,
+    RECORD_END,                      /* Erased header: no more records in this sector */
+    RECORD_CORRUPT,                  /* Torn or damaged record */
+} record_status_t;
+
+typedef struct {
+    grove_aqs_history_config_t config;
+    bool initialized;
+    uint32_t sector_count;
+    uint32_t tail;                   /* Oldest sector */
+    uint32_t used;                   /* Sectors holding data, the newest one is the head */
+    uint32_t head_seq;
+    uint32_t write_offset;           /* Next free byte in the head sector */
+    uint32_t newest_ts;
+    grove_aqs_history_agg_t head_agg;  /* Aggregate of the records in the head sector, becomes its seal */
+    grove_aqs_history_sample_t batch[GROVE_AQS_HISTORY_MAX_BATCH];
+    size_t batch_len;
+    uint8_t scratch[sizeof(record_hdr_t) + MAX_PAYLOAD];  /* Encoding, and payload copies when not mapped */
+} grove_aqs_history_t;
+
+typedef struct {
+    const uint8_t *src;
+    size_t len;
+    size_t pos;
+    uint32_t ts;
+    int32_t mv;
+    int32_t raw;
+} decoder_t;
+
+static grove_aqs_history_t history = {0};
+
+static inline uint32_t head_sector(void) {
+    return (history.tail + history.used - 1) % history.sector_count;
+}
+
+static inline size_t sector_base(uint32_t sector) {
+    return (size_t)sector * history.config.storage.sector_size;
+}
+
+static esp_err_t storage_read(size_t offset, void *dst, size_t len) {
+    if (history.config.storage.mapped != NULL) {
+        memcpy(dst, (const uint8_t *)history.config.storage.mapped + offset, len);
+        return ESP_OK;
+    }
+    return history.config.storage.read(history.config.storage.ctx, offset, dst, len);
+}
+
+static esp_err_t storage_write(size_t offset, const void *src, size_t len) {
+    return history.config.storage.write(history.config.storage.ctx, offset, src, len);
+}
+
+static void agg_reset(grove_aqs_history_agg_t *agg) {
+    memset(agg, 0, sizeof(*agg));
+    agg->min_mv = UINT16_MAX;
+}
+
+static void agg_add_sample(grove_aqs_history_agg_t *agg, const grove_aqs_history_sample_t *s) {
+    if (agg->count == 0) {
+        agg->first_timestamp = s->timestamp;
+    }
+    agg->last_timestamp = s->timestamp;
+    agg->count++;
+    agg->sum_mv += s->voltage_mv;
+    if (s->voltage_mv < agg->min_mv) {
+        agg->min_mv = s->voltage_mv;
+    }
+    if (s->voltage_mv > agg->max_mv) {
+        agg->max_mv = s->voltage_mv;
+    }
+    if (s->quality < GROVE_AQS_HISTORY_QUALITY_LEVELS) {
+        agg->quality_count[s->quality]++;
+    }
+}
+
+static void agg_merge(grove_aqs_history_agg_t *agg, uint32_t first_ts, uint32_t last_ts, uint32_t count,
+                      uint32_t sum_mv, uint16_t min_mv, uint16_t max_mv, const uint16_t *quality_count) {
+    if (count == 0) {
+        return;
+    }
+    if (agg->count == 0) {
+        agg->first_timestamp = first_ts;
+    }
+    agg->last_timestamp = last_ts;
+    agg->count += count;
+    agg->sum_mv += sum_mv;
+    if (min_mv < agg->min_mv) {
+        agg->min_mv = min_mv;
+    }
+    if (max_mv > agg->max_mv) {
+        agg->max_mv = max_mv;
+    }
+    for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+        agg->quality_count[q] += quality_count[q];
+    }
+}
+
+static void agg_merge_record(grove_aqs_history_agg_t *agg, const record_hdr_t *hdr) {
+    agg_merge(agg, hdr->first_ts, hdr->last_ts, hdr->count, hdr->sum_mv, hdr->min_mv, hdr->max_mv,
+              hdr->quality_count);
+}
+
+static bool read_sector_hdr(uint32_t sector, sector_hdr_t *hdr) {
+    if (storage_read(sector_base(sector), hdr, sizeof(*hdr)) != ESP_OK) {
+        return false;
+    }
+    return hdr->magic == SECTOR_MAGIC && hdr->version == FORMAT_VERSION &&
+           hdr->crc == grove_aqs_crc32(0, hdr, offsetof(sector_hdr_t, crc));
+}
+
+static bool seal_is_valid(const sector_hdr_t *hdr) {
+    return hdr->seal.count != UINT32_MAX &&
+           hdr->seal.crc == grove_aqs_crc32(0, &hdr->seal, offsetof(sector_seal_t, crc));
+}
+
+static bool read_sector_seq(uint32_t sector, uint32_t *seq) {
+    sector_hdr_t hdr;
+    if (!read_sector_hdr(sector, &hdr)) {
+        return false;
+    }
+    *seq = hdr.seq;
+    return true;
+}
+
+/*
+ * Read a record header. With payload set, also locate the payload (in the
+ * mapping, or copied into scratch) and check the CRC.
+ */
+static record_status_t read_record(uint32_t sector, uint32_t offset, record_hdr_t *hdr,
+                                   const uint8_t **payload) {
+    size_t sector_size = history.config.storage.sector_size;
+    if (offset + sizeof(record_hdr_t) > sector_size) {
+        return RECORD_END;
+    }
+    if (storage_read(sector_base(sector) + offset, hdr, sizeof(*hdr)) != ESP_OK) {
+        return RECORD_CORRUPT;
+    }
+    if (hdr->magic == RECORD_ERASED) {
+        return RECORD_END;
+    }
+    if (hdr->magic != RECORD_MAGIC || hdr->length > MAX_PAYLOAD ||
+        hdr->count == 0 || hdr->count > GROVE_AQS_HISTORY_MAX_BATCH ||
+        offset + sizeof(record_hdr_t) + hdr->length > sector_size) {
+        return RECORD_CORRUPT;
+    }
+    if (payload == NULL) {
+        return RECORD_OK;
+    }
+
+    size_t payload_offset = sector_base(sector) + offset + sizeof(record_hdr_t);
+    if (history.config.storage.mapped != NULL) {
+        *payload = (const uint8_t *)history.config.storage.mapped + payload_offset;
+    } else {
+        if (storage_read(payload_offset, history.scratch, hdr->length) != ESP_OK) {
+            return RECORD_CORRUPT;
+        }
+        *payload = history.scratch;
+    }
+    uint32_t crc = grove_aqs_crc32(0, hdr, offsetof(record_hdr_t, crc));
+    crc = grove_aqs_crc32(crc, *payload, hdr->length);
+    return crc == hdr->crc ? RECORD_OK : RECORD_CORRUPT;
+}
+
+static bool region_is_erased(size_t offset, size_t len) {
+    if (history.config.storage.mapped != NULL) {
+        const uint8_t *p = (const uint8_t *)history.config.storage.mapped + offset;
+        for (size_t i = 0; i < len; i++) {
+            if (p[i] != 0xFF) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    while (len > 0) {
+        size_t chunk = len < sizeof(history.scratch) ? len : sizeof(history.scratch);
+        if (storage_read(offset, history.scratch, chunk) != ESP_OK) {
+            return false;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            if (history.scratch[i] != 0xFF) {
+                return false;
+            }
+        }
+        offset += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+/* Erase the next sector in the ring (reclaiming the oldest one if full) and stamp its header */
+static esp_err_t seal_sector(uint32_t sector, const grove_aqs_history_agg_t *agg) {
+    sector_seal_t seal = {
+        .first_ts = agg->first_timestamp,
+        .last_ts = agg->last_timestamp,
+        .count = agg->count,
+        .sum_mv = (uint32_t)agg->sum_mv,
+        .min_mv = agg->min_mv,
+        .max_mv = agg->max_mv,
+        .reserved = 0xFFFF,
+    };
+    for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+        seal.quality_count[q] = (uint16_t)agg->quality_count[q];
+    }
+    seal.crc = grove_aqs_crc32(0, &seal, offsetof(sector_seal_t, crc));
+    return storage_write(sector_base(sector) + offsetof(sector_hdr_t, seal), &seal, sizeof(seal));
+}
+
+static esp_err_t open_next_sector(void) {
+    uint32_t next = history.used == 0 ? history.tail : (head_sector() + 1) % history.sector_count;
+
+    // Seal the sector being left so later queries can use its aggregate
+    if (history.used > 0 && history.head_agg.count > 0) {
+        esp_err_t ret = seal_sector(head_sector(), &history.head_agg);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to seal sector %u: %d", (unsigned)head_sector(), ret);
+        }
+    }
+
+    if (history.used == history.sector_count) {
+        history.tail = (history.tail + 1) % history.sector_count;
+        history.used--;
+    }
+
+    esp_err_t ret = history.config.storage.erase(history.config.storage.ctx, sector_base(next),
+                                                 history.config.storage.sector_size);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase sector %u: %d", (unsigned)next, ret);
+        return ret;
+    }
+
+    sector_hdr_t hdr = {
+        .magic = SECTOR_MAGIC,
+        .version = FORMAT_VERSION,
+        .reserved = 0xFFFF,
+        .seq = history.head_seq + 1,
+    };
+    hdr.crc = grove_aqs_crc32(0, &hdr, offsetof(sector_hdr_t, crc));
+    ret = storage_write(sector_base(next), &hdr, offsetof(sector_hdr_t, seal));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write sector header: %d", ret);
+        return ret;
+    }
+
+    if (history.used == 0) {
+        history.tail = next;
+    }
+    history.used++;
+    history.head_seq = hdr.seq;
+    history.write_offset = sizeof(sector_hdr_t);
+    agg_reset(&history.head_agg);
+    return ESP_OK;
+}
+
+/* Walk the records of a sector; returns the offset after the last valid one */
+static uint32_t scan_sector(uint32_t sector, grove_aqs_history_agg_t *agg, record_status_t *stop) {
+    uint32_t offset = sizeof(sector_hdr_t);
+    record_hdr_t hdr;
+    record_status_t status;
+    const uint8_t *payload;
+    agg_reset(agg);
+    while ((status = read_record(sector, offset, &hdr, &payload)) == RECORD_OK) {
+        agg_merge_record(agg, &hdr);
+        offset += sizeof(record_hdr_t) + hdr.length;
+    }
+    *stop = status;
+    return offset;
+}
+
+static esp_err_t mount(void) {
+    uint32_t n = history.sector_count;
+    uint32_t s0 = 0;
+    uint32_t seq = 0;
+
+    history.tail = 0;
+    history.used = 0;
+    history.head_seq = 0;
+    history.newest_ts = 0;
+    agg_reset(&history.head_agg);
+
+    if (!read_sector_seq(0, &s0)) {
+        // Either empty, or sector 0 was being reclaimed when power was lost
+        if (read_sector_seq(n - 1, &seq)) {
+            history.tail = 1;
+            history.used = n - 1;
+            history.head_seq = seq;
+        }
+    } else {
+        // Sectors 0..head carry s0, s0+1, ...; everything after is older or erased
+        uint32_t lo = 0;
+        uint32_t hi = n - 1;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo + 1) / 2;
+            if (read_sector_seq(mid, &seq) && seq >= s0) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        uint32_t head = lo;
+        read_sector_seq(head, &history.head_seq);
+
+        if (head == n - 1) {
+            history.used = n;
+        } else if (read_sector_seq(head + 1, &seq)) {
+            history.tail = head + 1;
+            history.used = n;
+        } else if ((head + 2) % n != 0 && read_sector_seq(head + 2, &seq)) {
+            // Wrapped, with the sector after the head erased by an interrupted reclaim
+            history.tail = head + 2;
+            history.used = n - 1;
+        } else {
+            history.used = head + 1;
+        }
+    }
+
+    if (history.used == 0) {
+        return ESP_OK;
+    }
+
+    // Find the write position in the head sector
+    uint32_t head = head_sector();
+    record_status_t stop;
+    history.write_offset = scan_sector(head, &history.head_agg, &stop);
+    history.newest_ts = history.head_agg.last_timestamp;
+    size_t sector_size = history.config.storage.sector_size;
+    if (stop == RECORD_CORRUPT ||
+        (history.write_offset < sector_size &&
+         !region_is_erased(sector_base(head) + history.write_offset, sector_size - history.write_offset))) {
+        ESP_LOGW(TAG, "Torn write in sector %u, closing it", (unsigned)head);
+        history.write_offset = sector_size;
+    }
+
+    if (history.head_agg.count == 0 && history.used > 1) {
+        uint32_t prev = (head + history.sector_count - 1) % history.sector_count;
+        sector_hdr_t hdr;
+        if (read_sector_hdr(prev, &hdr) && seal_is_valid(&hdr)) {
+            history.newest_ts = hdr.seal.last_ts;
+        } else {
+            grove_aqs_history_agg_t agg;
+            scan_sector(prev, &agg, &stop);
+            history.newest_ts = agg.last_timestamp;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_init(const grove_aqs_history_config_t *config) {
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Config is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->storage.read == NULL || config->storage.write == NULL || config->storage.erase == NULL ||
+        config->storage.sector_size < sizeof(sector_hdr_t) + sizeof(history.scratch) ||
+        config->storage.size / config->storage.sector_size < 2) {
+        ESP_LOGE(TAG, "Storage must provide at least 2 sectors of %u bytes",
+                 (unsigned)(sizeof(sector_hdr_t) + sizeof(history.scratch)));
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (config->batch_size == 0 || config->batch_size > GROVE_AQS_HISTORY_MAX_BATCH) {
+        ESP_LOGE(TAG, "Invalid batch size: %u", (unsigned)config->batch_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (history.initialized) {
+        ESP_LOGW(TAG, "History already initialized, deinitializing first");
+        grove_aqs_history_deinit();
+    }
+
+    memcpy(&history.config, config, sizeof(grove_aqs_history_config_t));
+    history.sector_count = config->storage.size / config->storage.sector_size;
+    history.batch_len = 0;
+
+    GROVE_AQS_TRACE_BEGIN(GROVE_AQS_TRACE_HISTORY_MOUNT, history.sector_count);
+    esp_err_t ret = mount();
+    GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_HISTORY_MOUNT, ret);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to mount history: %d", ret);
+        return ret;
+    }
+
+    history.initialized = true;
+    ESP_LOGI(TAG, "History mounted: %u/%u sectors used, head seq %u",
+             (unsigned)history.used, (unsigned)history.sector_count, (unsigned)history.head_seq);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_deinit(void) {
+    if (!history.initialized) {
+        ESP_LOGW(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = grove_aqs_history_flush();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to flush pending samples: %d", ret);
+    }
+
+    if (history.config.storage.close != NULL) {
+        grove_aqs_storage_close(&history.config.storage);
+    }
+
+    history.initialized = false;
+    return ret;
+}
+
+static size_t encode_batch(uint8_t *dst) {
+    size_t len = 0;
+    uint32_t prev_ts = history.batch[0].timestamp;
+    int32_t prev_mv = 0;
+    int32_t prev_raw = 0;
+
+    for (size_t i = 0; i < history.batch_len; i++) {
+        const grove_aqs_history_sample_t *s = &history.batch[i];
+        len += grove_aqs_varint_put(dst + len, grove_aqs_zigzag_encode((int32_t)(s->timestamp - prev_ts)));
+        len += grove_aqs_varint_put(dst + len,
+                                    (grove_aqs_zigzag_encode((int32_t)s->voltage_mv - prev_mv) << 3) | (s->quality & 0x07));
+        len += grove_aqs_varint_put(dst + len, grove_aqs_zigzag_encode((int32_t)s->raw_value - prev_raw));
+        prev_ts = s->timestamp;
+        prev_mv = s->voltage_mv;
+        prev_raw = s->raw_value;
+    }
+    return len;
+}
+
+static void decoder_init(decoder_t *d, const record_hdr_t *hdr, const uint8_t *payload) {
+    d->src = payload;
+    d->len = hdr->length;
+    d->pos = 0;
+    d->ts = hdr->first_ts;
+    d->mv = 0;
+    d->raw = 0;
+}
+
+/* Decode the next sample straight from the payload (scratch copy or flash mapping) */
+static bool decoder_next(decoder_t *d, grove_aqs_history_sample_t *sample) {
+    uint32_t v[3];
+    for (int k = 0; k < 3; k++) {
+        size_t used = grove_aqs_varint_get(d->src + d->pos, d->len - d->pos, &v[k]);
+        if (used == 0) {
+            return false;
+        }
+        d->pos += used;
+    }
+    d->ts += (uint32_t)grove_aqs_zigzag_decode(v[0]);
+    d->mv += grove_aqs_zigzag_decode(v[1] >> 3);
+    d->raw += grove_aqs_zigzag_decode(v[2]);
+    sample->timestamp = d->ts;
+    sample->voltage_mv = (uint16_t)d->mv;
+    sample->raw_value = (uint16_t)d->raw;
+    sample->quality = (uint8_t)(v[1] & 0x07);
+    return true;
+}
+
+esp_err_t grove_aqs_history_append(const grove_aqs_history_sample_t *sample) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (sample == NULL) {
+        ESP_LOGE(TAG, "Sample pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    history.batch[history.batch_len++] = *sample;
+    if (history.batch_len >= history.config.batch_size) {
+        return grove_aqs_history_flush();
+    }
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_flush(void) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (history.batch_len == 0) {
+        return ESP_OK;
+    }
+
+    grove_aqs_history_agg_t agg;
+    agg_reset(&agg);
+    for (size_t i = 0; i < history.batch_len; i++) {
+        agg_add_sample(&agg, &history.batch[i]);
+    }
+
+    record_hdr_t hdr = {
+        .magic = RECORD_MAGIC,
+        .count = (uint16_t)history.batch_len,
+        .min_mv = agg.min_mv,
+        .max_mv = agg.max_mv,
+        .sum_mv = (uint32_t)agg.sum_mv,
+        .first_ts = agg.first_timestamp,
+        .last_ts = agg.last_timestamp,
+    };
+    for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+        hdr.quality_count[q] = (uint16_t)agg.quality_count[q];
+    }
+    uint8_t *payload = history.scratch + sizeof(record_hdr_t);
+    hdr.length = (uint16_t)encode_batch(payload);
+    hdr.crc = grove_aqs_crc32(grove_aqs_crc32(0, &hdr, offsetof(record_hdr_t, crc)), payload, hdr.length);
+
+    size_t record_size = sizeof(record_hdr_t) + hdr.length;
+    if (history.used == 0 || history.write_offset + record_size > history.config.storage.sector_size) {
+        GROVE_AQS_TRACE_BEGIN(GROVE_AQS_TRACE_SECTOR_OPEN, history.head_seq + 1);
+        esp_err_t ret = open_next_sector();
+        GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_SECTOR_OPEN, ret);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    // Payload first, header last: the record is only valid once the header lands
+    GROVE_AQS_TRACE_BEGIN(GROVE_AQS_TRACE_BATCH_WRITE, hdr.count);
+    size_t offset = sector_base(head_sector()) + history.write_offset;
+    esp_err_t ret = storage_write(offset + sizeof(record_hdr_t), payload, hdr.length);
+    if (ret == ESP_OK) {
+        ret = storage_write(offset, &hdr, sizeof(hdr));
+    }
+    GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_BATCH_WRITE, record_size);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write record: %d", ret);
+        // Do not reuse a possibly half-programmed region
+        history.write_offset = history.config.storage.sector_size;
+        return ret;
+    }
+
+    history.write_offset += record_size;
+    history.newest_ts = hdr.last_ts;
+    agg_merge_record(&history.head_agg, &hdr);
+    history.batch_len = 0;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_get_pending(grove_aqs_history_sample_t *samples, size_t max, size_t *count) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (samples == NULL || count == NULL) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (history.batch_len > max) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(samples, history.batch, history.batch_len * sizeof(history.batch[0]));
+    *count = history.batch_len;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_erase(void) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = history.config.storage.erase(history.config.storage.ctx, 0,
+                                                 (size_t)history.sector_count * history.config.storage.sector_size);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase history: %d", ret);
+        return ret;
+    }
+
+    history.tail = 0;
+    history.used = 0;
+    history.head_seq = 0;
+    history.newest_ts = 0;
+    history.batch_len = 0;
+    agg_reset(&history.head_agg);
+    return ESP_OK;
+}
+
+/* First timestamp stored in a sector, UINT32_MAX if it holds no records */
+static uint32_t sector_first_ts(uint32_t sector) {
+    record_hdr_t hdr;
+    if (read_record(sector, sizeof(sector_hdr_t), &hdr, NULL) != RECORD_OK) {
+        return UINT32_MAX;
+    }
+    return hdr.first_ts;
+}
+
+/* Ring position of the last sector whose first sample is not after the timestamp */
+static uint32_t locate_sector(uint32_t timestamp) {
+    uint32_t lo = 0;
+    uint32_t hi = history.used - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (sector_first_ts((history.tail + mid) % history.sector_count) <= timestamp) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+esp_err_t grove_aqs_history_get_info(grove_aqs_history_info_t *info) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (info == NULL) {
+        ESP_LOGE(TAG, "Info pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(info, 0, sizeof(*info));
+    info->sectors_total = history.sector_count;
+    info->sectors_used = history.used;
+    info->head_seq = history.head_seq;
+    info->pending = history.batch_len;
+    if (history.used > 0) {
+        uint32_t oldest = sector_first_ts(history.tail);
+        info->oldest_timestamp = oldest == UINT32_MAX ? 0 : oldest;
+        info->newest_timestamp = history.newest_ts;
+    }
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_seek(uint32_t timestamp, grove_aqs_history_cursor_t *cursor) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (cursor == NULL) {
+        ESP_LOGE(TAG, "Cursor pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (history.used == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t sector = (history.tail + locate_sector(timestamp)) % history.sector_count;
+    uint32_t offset = sizeof(sector_hdr_t);
+    record_hdr_t hdr;
+    while (read_record(sector, offset, &hdr, NULL) == RECORD_OK && hdr.last_ts < timestamp) {
+        offset += sizeof(record_hdr_t) + hdr.length;
+    }
+
+    cursor->sector = sector;
+    cursor->offset = offset;
+    if (!read_sector_seq(sector, &cursor->seq)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_read(grove_aqs_history_cursor_t *cursor,
+                                 grove_aqs_history_sample_t *samples, size_t max, size_t *count) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (cursor == NULL || samples == NULL || count == NULL || max < GROVE_AQS_HISTORY_MAX_BATCH) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *count = 0;
+    if (history.used == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for (uint32_t visited = 0; visited <= history.used; visited++) {
+        uint32_t seq;
+        if (!read_sector_seq(cursor->sector, &seq) || seq != cursor->seq) {
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        record_hdr_t hdr;
+        const uint8_t *payload;
+        if (read_record(cursor->sector, cursor->offset, &hdr, &payload) == RECORD_OK) {
+            decoder_t decoder;
+            decoder_init(&decoder, &hdr, payload);
+            for (size_t i = 0; i < hdr.count; i++) {
+                if (!decoder_next(&decoder, &samples[i])) {
+                    ESP_LOGE(TAG, "Malformed record payload in sector %u", (unsigned)cursor->sector);
+                    return ESP_ERR_INVALID_SIZE;
+                }
+            }
+            cursor->offset += sizeof(record_hdr_t) + hdr.length;
+            *count = hdr.count;
+            return ESP_OK;
+        }
+
+        if (cursor->sector == head_sector()) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        cursor->sector = (cursor->sector + 1) % history.sector_count;
+        cursor->seq++;
+        cursor->offset = sizeof(sector_hdr_t);
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/* Streaming state of a range walk: samples arrive in time order and are folded into buckets */
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    uint32_t step;
+    grove_aqs_history_agg_type_t type;
+    grove_aqs_history_point_t *points;  /* NULL: single bucket, result stays in cur */
+    size_t current;
+    grove_aqs_history_agg_t cur;
+} range_walk_t;
+
+static inline size_t walk_bucket(const range_walk_t *w, uint32_t ts) {
+    return (ts - w->start) / w->step;
+}
+
+static void walk_emit(range_walk_t *w) {
+    if (w->points == NULL || w->cur.count == 0) {
+        return;
+    }
+
+    grove_aqs_history_point_t *p = &w->points[w->current];
+    p->count = w->cur.count;
+    switch (w->type) {
+        case GROVE_AQS_HISTORY_AGG_MIN:
+            p->value_mv = w->cur.min_mv;
+            break;
+        case GROVE_AQS_HISTORY_AGG_MAX:
+            p->value_mv = w->cur.max_mv;
+            break;
+        case GROVE_AQS_HISTORY_AGG_DWELL: {
+            // Samples per level times the mean sample interval inside the bucket
+            uint32_t span = w->cur.last_timestamp - w->cur.first_timestamp;
+            for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+                p->dwell_s[q] = w->cur.count > 1 ?
+                    (uint32_t)(((uint64_t)w->cur.quality_count[q] * span) / (w->cur.count - 1)) : 0;
+            }
+            break;
+        }
+        case GROVE_AQS_HISTORY_AGG_MEAN:
+        default:
+            p->value_mv = (uint16_t)(w->cur.sum_mv / w->cur.count);
+            break;
+    }
+}
+
+static void walk_select(range_walk_t *w, uint32_t ts) {
+    size_t bucket = walk_bucket(w, ts);
+    if (bucket != w->current) {
+        walk_emit(w);
+        agg_reset(&w->cur);
+        w->current = bucket;
+    }
+}
+
+static void walk_add_sample(range_walk_t *w, const grove_aqs_history_sample_t *s) {
+    if (s->timestamp >= w->start && s->timestamp < w->end) {
+        walk_select(w, s->timestamp);
+        agg_add_sample(&w->cur, s);
+    }
+}
+
+/* True if [first_ts, last_ts] lies in the range and inside a single bucket */
+static inline bool walk_fits(const range_walk_t *w, uint32_t first_ts, uint32_t last_ts) {
+    return first_ts >= w->start && last_ts < w->end && walk_bucket(w, first_ts) == walk_bucket(w, last_ts);
+}
+
+/* Fold the records of one sector into the walk; returns false once past the range */
+static bool walk_sector(range_walk_t *w, uint32_t sector) {
+    uint32_t offset = sizeof(sector_hdr_t);
+    record_hdr_t hdr;
+    const uint8_t *payload;
+    while (read_record(sector, offset, &hdr, NULL) == RECORD_OK) {
+        if (hdr.first_ts >= w->end) {
+            return false;
+        }
+        if (hdr.last_ts >= w->start) {
+            if (walk_fits(w, hdr.first_ts, hdr.last_ts)) {
+                walk_select(w, hdr.first_ts);
+                agg_merge_record(&w->cur, &hdr);
+            } else if (read_record(sector, offset, &hdr, &payload) == RECORD_OK) {
+                // Edge record: spans a bucket or range boundary
+                decoder_t decoder;
+                grove_aqs_history_sample_t sample;
+                decoder_init(&decoder, &hdr, payload);
+                for (size_t i = 0; i < hdr.count && decoder_next(&decoder, &sample); i++) {
+                    walk_add_sample(w, &sample);
+                }
+            }
+        }
+        offset += sizeof(record_hdr_t) + hdr.length;
+    }
+    return true;
+}
+
+static void walk_range(range_walk_t *w) {
+    GROVE_AQS_TRACE_BEGIN(GROVE_AQS_TRACE_HISTORY_QUERY, w->step);
+    agg_reset(&w->cur);
+    w->current = 0;
+
+    if (history.used > 0) {
+        for (uint32_t j = locate_sector(w->start); j < history.used; j++) {
+            uint32_t sector = (history.tail + j) % history.sector_count;
+            sector_hdr_t hdr;
+            if (!read_sector_hdr(sector, &hdr)) {
+                continue;
+            }
+            if (seal_is_valid(&hdr)) {
+                if (hdr.seal.first_ts >= w->end) {
+                    break;
+                }
+                if (hdr.seal.last_ts < w->start) {
+                    continue;
+                }
+                if (walk_fits(w, hdr.seal.first_ts, hdr.seal.last_ts)) {
+                    walk_select(w, hdr.seal.first_ts);
+                    agg_merge(&w->cur, hdr.seal.first_ts, hdr.seal.last_ts, hdr.seal.count, hdr.seal.sum_mv,
+                              hdr.seal.min_mv, hdr.seal.max_mv, hdr.seal.quality_count);
+                    continue;
+                }
+            }
+            if (!walk_sector(w, sector)) {
+                break;
+            }
+        }
+    }
+
+    // Samples still waiting in RAM are part of the history as well
+    for (size_t i = 0; i < history.batch_len; i++) {
+        walk_add_sample(w, &history.batch[i]);
+    }
+    walk_emit(w);
+    GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_HISTORY_QUERY, w->cur.count);
+}
+
+esp_err_t grove_aqs_history_aggregate(uint32_t start, uint32_t end, grove_aqs_history_agg_t *agg) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (agg == NULL || end < start) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    range_walk_t walk = {
+        .start = start,
+        .end = end,
+        .step = end > start ? end - start : 1,
+    };
+    walk_range(&walk);
+
+    *agg = walk.cur;
+    if (agg->count == 0) {
+        agg->min_mv = 0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_history_query(uint32_t start, uint32_t end, uint32_t step,
+                                  grove_aqs_history_agg_type_t agg,
+                                  grove_aqs_history_point_t *points, size_t max, size_t *count) {
+    if (!history.initialized) {
+        ESP_LOGE(TAG, "History not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (points == NULL || count == NULL || step == 0 || end <= start) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t buckets = ((size_t)(end - start) + step - 1) / step;
+    if (buckets > max) {
+        ESP_LOGE(TAG, "Query needs %u points, buffer holds %u", (unsigned)buckets, (unsigned)max);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    for (size_t i = 0; i < buckets; i++) {
+        memset(&points[i], 0, sizeof(points[i]));
+        points[i].timestamp = start + (uint32_t)(i * step);
+    }
+
+    range_walk_t walk = {
+        .start = start,
+        .end = end,
+        .step = step,
+        .type = agg,
+        .points = points,
+    };
+    walk_range(&walk);
+
+    *count = buckets;
+    return ESP_OK;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file grove_aqs_live.c
+ * @brief Switching the per-sample constants with a grace period before reuse
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include "grove_aqs_live.h"
+#include "grove_aqs_port.h"
+
+void grove_aqs_live_init(grove_aqs_live_params_t *live, const grove_aqs_core_params_t *params) {
+    live->slots[0] = *params;
+    atomic_init(&live->readers, 0);
+    atomic_init(&live->current, &live->slots[0]);
+}
+
+void grove_aqs_live_quiesce(grove_aqs_live_params_t *live) {
+    // A reading counted after this fence loads the target switched to before it
+    atomic_thread_fence(memory_order_seq_cst);
+    while (atomic_load(&live->readers) != 0) {
+        grove_aqs_port_yield();
+    }
+}
+
+void grove_aqs_live_publish(grove_aqs_live_params_t *live, const grove_aqs_core_params_t *next) {
+    const grove_aqs_core_params_t *current = grove_aqs_live_current(live);
+    grove_aqs_core_params_t *spare = current == &live->slots[0] ? &live->slots[1] : &live->slots[0];
+    grove_aqs_live_quiesce(live);
+    *spare = *next;
+    grove_aqs_live_switch(live, spare);
+}
+
+void grove_aqs_live_rewrite(grove_aqs_live_params_t *live, grove_aqs_core_params_t *target,
+                            const grove_aqs_core_params_t *next) {
+    bool selected = grove_aqs_live_current(live) == target;
+    if (selected) {
+        grove_aqs_live_publish(live, next);
+    }
+    grove_aqs_live_quiesce(live);
+    *target = *next;
+    if (selected) {
+        grove_aqs_live_switch(live, target);
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * @file grove_aqs_lockin.c
+ * @brief Lock-in demodulator: references and result
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <string.h>
+#include "grove_aqs_lockin.h"
+#include "grove_aqs_util.h"
+
+static const char *TAG = "grove_aqs_lockin";
+
+/* sin(2 * pi * j / 64) in Q15 */
+#define SINE_STEPS 64
+static const int16_t sine_q15[SINE_STEPS] = {
+         0,   3212,   6393,   9512,  12539,  15446,  18204,  20787,
+     23170,  25329,  27245,  28898,  30273,  31356,  32137,  32609,
+     32767,  32609,  32137,  31356,  30273,  28898,  27245,  25329,
+     23170,  20787,  18204,  15446,  12539,   9512,   6393,   3212,
+         0,  -3212,  -6393,  -9512, -12539, -15446, -18204, -20787,
+    -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609,
+    -32767, -32609, -32137, -31356, -30273, -28898, -27245, -25329,
+    -23170, -20787, -18204, -15446, -12539,  -9512,  -6393,  -3212,
+};
+
+esp_err_t grove_aqs_lockin_init(grove_aqs_lockin_t *lockin, uint8_t samples_per_period) {
+    if (lockin == NULL || samples_per_period < 4 || samples_per_period > GROVE_AQS_LOCKIN_MAX_SAMPLES ||
+        (samples_per_period & (samples_per_period - 1)) != 0) {
+        ESP_LOGE(TAG, "Samples per period must be 4, 8, 16 or 32");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(lockin, 0, sizeof(*lockin));
+    lockin->samples_per_period = samples_per_period;
+    // Sample p stands for the middle of its slot, (p + 1/2) / N of the period
+    const unsigned step = SINE_STEPS / (2 * samples_per_period);
+    for (unsigned p = 0; p < samples_per_period; p++) {
+        unsigned j = (2 * p + 1) * step;
+        lockin->ref_i[p] = sine_q15[j % SINE_STEPS];
+        lockin->ref_q[p] = sine_q15[(j + SINE_STEPS / 4) % SINE_STEPS];
+    }
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_lockin_result(const grove_aqs_lockin_t *lockin, grove_aqs_lockin_result_t *result) {
+    if (lockin == NULL || result == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (lockin->periods == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Fundamental amplitude = 2 / count * sum(x * ref), with x in mV and ref in Q15
+    int64_t count = (int64_t)lockin->periods * lockin->samples_per_period;
+    int64_t scale = count * GROVE_AQS_LOCKIN_REF_ONE;
+    result->i_uv = (int32_t)(lockin->sum_i * 2000 / scale);
+    result->q_uv = (int32_t)(lockin->sum_q * 2000 / scale);
+    result->amplitude_uv = grove_aqs_isqrt64((uint64_t)((int64_t)result->i_uv * result->i_uv) +
+                                             (uint64_t)((int64_t)result->q_uv * result->q_uv));
+    result->dc_uv = (int32_t)(lockin->sum_dc * 1000 / count);
+    result->periods = lockin->periods;
+    return ESP_OK;
+}
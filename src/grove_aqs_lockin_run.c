@@ -0,0 +1,87 @@
+/**
+ * @file grove_aqs_lockin_run.c
+ * @brief Lock-in measurement on the target: heater modulation and sampling
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "grove_analog_aqs.h"
+#include "grove_aqs_lockin.h"
+
+static const char *TAG = "grove_aqs_lockin";
+
+/* Shortest slot the tick-based wait can keep */
+#define TICK_US (1000000 / configTICK_RATE_HZ)
+
+/*
+ * Sleeps until an absolute esp_timer time, rounded up to whole ticks (a
+ * truncated delay could be zero and return at once); late by at most a
+ * tick, which does not accumulate.
+ */
+static void wait_until(int64_t due_us) {
+    int64_t wait_us = due_us - esp_timer_get_time();
+    if (wait_us > 0) {
+        vTaskDelay((TickType_t)((wait_us + TICK_US - 1) / TICK_US));
+    }
+}
+
+esp_err_t grove_aqs_lockin_measure(uint32_t periods, grove_aqs_lockin_result_t *result) {
+    if (result == NULL) {
+        ESP_LOGE(TAG, "Result pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (periods == 0) {
+        periods = CONFIG_GROVE_AQS_LOCKIN_PERIODS;
+    }
+
+    // Every slot is due at the start plus its index, so late wake-ups do not add up
+    const int64_t slot_us = 1000000000LL / ((int64_t)CONFIG_GROVE_AQS_LOCKIN_FREQ_MHZ *
+                                            CONFIG_GROVE_AQS_LOCKIN_SAMPLES_PER_PERIOD);
+    if (slot_us < TICK_US) {
+        ESP_LOGE(TAG, "Lock-in slot of %lld us is shorter than a tick (%d us)", (long long)slot_us, TICK_US);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    grove_aqs_lockin_t lockin;
+    esp_err_t ret = grove_aqs_lockin_init(&lockin, CONFIG_GROVE_AQS_LOCKIN_SAMPLES_PER_PERIOD);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const uint32_t slots = periods * CONFIG_GROVE_AQS_LOCKIN_SAMPLES_PER_PERIOD;
+    const int64_t start_us = esp_timer_get_time();
+    bool heater_on = false;
+    for (uint32_t k = 0; k < slots && ret == ESP_OK; k++) {
+        wait_until(start_us + (int64_t)k * slot_us);
+        if (k == 0 || grove_aqs_lockin_heater_on(&lockin) != heater_on) {
+            heater_on = grove_aqs_lockin_heater_on(&lockin);
+            ret = grove_aqs_set_heater_duty(heater_on ? CONFIG_GROVE_AQS_LOCKIN_DUTY_PCT : 0);
+            if (ret != ESP_OK) {
+                break;
+            }
+        }
+        int mv;
+        ret = grove_aqs_sample_mv(&mv);
+        if (ret == ESP_OK) {
+            grove_aqs_lockin_update(&lockin, mv);
+        }
+    }
+
+    esp_err_t power_ret = grove_aqs_power_on();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Lock-in measurement failed: %d", ret);
+        return ret;
+    }
+    if (power_ret != ESP_OK) {
+        return power_ret;
+    }
+    return grove_aqs_lockin_result(&lockin, result);
+}
@@ -0,0 +1,161 @@
+/**
+ * @file grove_aqs_ppm.c
+ * @brief Fixed-point log2/exp2 and the Rs/R0 concentration estimate
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <stddef.h>
+#include "grove_aqs_ppm.h"
+
+static const char *TAG = "grove_aqs_ppm";
+
+/* log2(1 + i / 64) in Q16 */
+static const uint32_t log2_q16[65] = {
+        0,  1466,  2909,  4331,  5732,  7112,  8473,  9814,
+    11136, 12440, 13727, 14996, 16248, 17484, 18704, 19909,
+    21098, 22272, 23433, 24579, 25711, 26830, 27936, 29029,
+    30109, 31178, 32234, 33279, 34312, 35334, 36346, 37346,
+    38336, 39316, 40286, 41246, 42196, 43137, 44068, 44990,
+    45904, 46809, 47705, 48593, 49472, 50344, 51207, 52063,
+    52911, 53751, 54584, 55410, 56229, 57040, 57845, 58643,
+    59434, 60219, 60997, 61769, 62534, 63294, 64047, 64794,
+    65536,
+};
+
+/* 2^(i / 64) in Q30 */
+static const uint32_t exp2_q30[65] = {
+    1073741824, 1085434106, 1097253708, 1109202018, 1121280436, 1133490379, 1145833280, 1158310587,
+    1170923762, 1183674286, 1196563654, 1209593378, 1222764986, 1236080024, 1249540052, 1263146652,
+    1276901417, 1290805962, 1304861917, 1319070932, 1333434672, 1347954824, 1362633090, 1377471191,
+    1392470869, 1407633882, 1422962010, 1438457051, 1454120821, 1469955159, 1485961921, 1502142985,
+    1518500250, 1535035634, 1551751076, 1568648537, 1585730000, 1602997467, 1620452965, 1638098541,
+    1655936265, 1673968228, 1692196547, 1710623359, 1729250827, 1748081133, 1767116489, 1786359126,
+    1805811301, 1825475297, 1845353420, 1865448001, 1885761398, 1906295993, 1927054196, 1948038440,
+    1969251188, 1990694927, 2012372174, 2034285470, 2056437387, 2078830522, 2101467502, 2124350982,
+    2147483648u,
+};
+
+/* log2(10) in Q16, turns ppm into 0.1 ppm */
+#define LOG2_10_Q16 217706
+
+/* log2(1000) in Q16, for ratios given in thousandths */
+#define LOG2_1000_Q16 653118
+
+/* Two points of each sensitivity curve, read off the MP503 chart */
+static const struct {
+    uint16_t ppm;
+    uint16_t ratio_milli;            // Rs/R0 in thousandths
+} datasheet_curves[GROVE_AQS_GAS_COUNT][2] = {
+    [GROVE_AQS_GAS_ALCOHOL] = { { 10, 550 }, { 300, 120 } },
+    [GROVE_AQS_GAS_HYDROGEN] = { { 10, 720 }, { 300, 250 } },
+    [GROVE_AQS_GAS_ISOBUTANE] = { { 10, 800 }, { 300, 350 } },
+};
+
+int32_t grove_aqs_log2_q16(uint32_t x) {
+    if (x == 0) {
+        return INT32_MIN;
+    }
+    // Normalize to [1, 2) with the leading one at bit 31: 6 bits of index, 16 of interpolation
+    int msb = 31 - __builtin_clz(x);
+    uint32_t m = x << (31 - msb);
+    uint32_t i = (m >> 25) & 63;
+    uint32_t frac = (m >> 9) & 0xFFFF;
+    uint32_t step = log2_q16[i + 1] - log2_q16[i];
+    return (int32_t)(((uint32_t)msb << 16) + log2_q16[i] + ((step * frac) >> 16));
+}
+
+uint32_t grove_aqs_exp2_q16(int32_t y) {
+    int32_t n = y >> 16;             // Floor, also for negative exponents
+    uint32_t f = (uint32_t)y & 0xFFFF;
+    if (n >= 32) {
+        return UINT32_MAX;
+    }
+    if (n < -1) {
+        return 0;
+    }
+    uint32_t i = f >> 10;
+    uint64_t m = exp2_q30[i] + (((uint64_t)(exp2_q30[i + 1] - exp2_q30[i]) * (f & 0x3FF)) >> 10);
+    // m * 2^n in Q30, rounded to an integer
+    int shift = 30 - n;
+    uint64_t r = shift > 0 ? (m + (1ull << (shift - 1))) >> shift : m << -shift;
+    return r > UINT32_MAX ? UINT32_MAX : (uint32_t)r;
+}
+
+static inline int32_t log2_milli_q16(uint32_t milli) {
+    return grove_aqs_log2_q16(milli) - LOG2_1000_Q16;
+}
+
+esp_err_t grove_aqs_ppm_curve_init(grove_aqs_ppm_curve_t *curve, uint32_t ppm_a, uint32_t ratio_a_milli,
+                                   uint32_t ppm_b, uint32_t ratio_b_milli) {
+    if (curve == NULL || ppm_a == 0 || ppm_b == 0 || ratio_a_milli == 0 || ratio_b_milli == 0 ||
+        ratio_a_milli == ratio_b_milli) {
+        ESP_LOGE(TAG, "Curve needs two points with distinct non-zero ratios");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int32_t log2_ratio_a = log2_milli_q16(ratio_a_milli);
+    int32_t log2_ratio_b = log2_milli_q16(ratio_b_milli);
+    int32_t log2_ppm_a = grove_aqs_log2_q16(ppm_a);
+    int32_t log2_ppm_b = grove_aqs_log2_q16(ppm_b);
+    if (log2_ratio_b == log2_ratio_a) {
+        // Ratios this close fall onto the same Q16 logarithm and give no slope
+        ESP_LOGE(TAG, "Curve ratios %u and %u are too close", (unsigned)ratio_a_milli, (unsigned)ratio_b_milli);
+        return ESP_ERR_INVALID_ARG;
+    }
+    curve->slope_q16 = (int32_t)(((int64_t)(log2_ppm_b - log2_ppm_a) << 16) / (log2_ratio_b - log2_ratio_a));
+    curve->log2_ppm_q16 = log2_ppm_a - (int32_t)(((int64_t)curve->slope_q16 * log2_ratio_a) >> 16);
+
+    uint32_t lo = ratio_a_milli < ratio_b_milli ? ratio_a_milli : ratio_b_milli;
+    uint32_t hi = ratio_a_milli < ratio_b_milli ? ratio_b_milli : ratio_a_milli;
+    curve->min_ratio_q16 = (uint32_t)(((uint64_t)lo << 16) / 1000);
+    curve->max_ratio_q16 = (uint32_t)(((uint64_t)hi << 16) / 1000);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_ppm_curve_get(grove_aqs_gas_t gas, grove_aqs_ppm_curve_t *curve) {
+    if ((unsigned)gas >= GROVE_AQS_GAS_COUNT) {
+        ESP_LOGE(TAG, "Unknown gas: %d", (int)gas);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return grove_aqs_ppm_curve_init(curve, datasheet_curves[gas][0].ppm, datasheet_curves[gas][0].ratio_milli,
+                                    datasheet_curves[gas][1].ppm, datasheet_curves[gas][1].ratio_milli);
+}
+
+esp_err_t grove_aqs_ppm_params_init(grove_aqs_ppm_params_t *params, uint32_t load_ohm, int circuit_mv,
+                                    int clean_air_mv, const grove_aqs_ppm_curve_t *curve) {
+    if (params == NULL || curve == NULL || load_ohm == 0 || circuit_mv < 2) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (clean_air_mv <= 0 || clean_air_mv >= circuit_mv) {
+        ESP_LOGE(TAG, "Clean-air baseline %d mV outside 0-%d mV", clean_air_mv, circuit_mv);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    params->circuit_mv = circuit_mv;
+    params->log2_load_q16 = grove_aqs_log2_q16(load_ohm);
+    // R0 = RL * (Vc - V0) / V0, so RL / R0 = V0 / (Vc - V0)
+    params->log2_load_r0_q16 = grove_aqs_log2_q16((uint32_t)clean_air_mv) -
+                               grove_aqs_log2_q16((uint32_t)(circuit_mv - clean_air_mv));
+    params->curve = *curve;
+    return ESP_OK;
+}
+
+void grove_aqs_ppm_estimate(const grove_aqs_ppm_params_t *params, int voltage_mv, grove_aqs_ppm_t *out) {
+    int v = voltage_mv < 1 ? 1 : voltage_mv >= params->circuit_mv ? params->circuit_mv - 1 : voltage_mv;
+    int32_t log2_rs_load = grove_aqs_log2_q16((uint32_t)(params->circuit_mv - v)) - grove_aqs_log2_q16((uint32_t)v);
+    int32_t log2_ratio = log2_rs_load + params->log2_load_r0_q16;
+    int64_t log2_ppm_x10 = params->curve.log2_ppm_q16 + LOG2_10_Q16 +
+                           (((int64_t)params->curve.slope_q16 * log2_ratio) >> 16);
+
+    out->rs_ohm = grove_aqs_exp2_q16(log2_rs_load + params->log2_load_q16);
+    out->ratio_q16 = grove_aqs_exp2_q16(log2_ratio + (16 << 16));
+    out->ppm_x10 = grove_aqs_exp2_q16((int32_t)(log2_ppm_x10 > INT32_MAX ? INT32_MAX
+                                                : log2_ppm_x10 < INT32_MIN ? INT32_MIN : log2_ppm_x10));
+    out->in_range = out->ratio_q16 >= params->curve.min_ratio_q16 && out->ratio_q16 <= params->curve.max_ratio_q16;
+}
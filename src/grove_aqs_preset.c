@@ -0,0 +1,82 @@
+/**
+ * @file grove_aqs_preset.c
+ * @brief Preset lookup and schedule evaluation
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <string.h>
+#include "grove_aqs_preset.h"
+
+static const char *TAG = "grove_aqs_preset";
+
+int grove_aqs_preset_find(const grove_aqs_preset_t *presets, size_t count, const char *name) {
+    if (presets == NULL || name == NULL || name[0] == '\0') {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(presets[i].name, name, sizeof(presets[i].name)) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool grove_aqs_preset_rebase(grove_aqs_live_params_t *live, grove_aqs_preset_t *presets, size_t count,
+                             const grove_aqs_core_params_t *base) {
+    bool selected = false;
+    for (size_t i = 0; i < count; i++) {
+        if (presets[i].name[0] == '\0') {
+            continue;
+        }
+        grove_aqs_core_params_t params = presets[i].params;
+        params.gain = base->gain;
+        params.offset_mv = base->offset_mv;
+        selected |= grove_aqs_live_current(live) == &presets[i].params;
+        grove_aqs_live_rewrite(live, &presets[i].params, &params);
+    }
+    return selected;
+}
+
+esp_err_t grove_aqs_schedule_add(grove_aqs_schedule_t *schedule, uint8_t days, uint8_t hour, uint8_t minute,
+                                 uint8_t preset) {
+    if (schedule == NULL || days == 0 || (days & ~GROVE_AQS_SCHEDULE_EVERY_DAY) != 0 || hour > 23 ||
+        minute > 59 || preset >= CONFIG_GROVE_AQS_PRESET_COUNT) {
+        ESP_LOGD(TAG, "Invalid schedule entry");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (schedule->count >= GROVE_AQS_SCHEDULE_MAX) {
+        ESP_LOGD(TAG, "Schedule full (%d entries)", GROVE_AQS_SCHEDULE_MAX);
+        return ESP_ERR_NO_MEM;
+    }
+    schedule->entries[schedule->count++] = (grove_aqs_schedule_entry_t){
+        .minute = (uint16_t)(hour * 60 + minute),
+        .days = days,
+        .preset = preset,
+    };
+    return ESP_OK;
+}
+
+int grove_aqs_schedule_lookup(const grove_aqs_schedule_t *schedule, uint8_t weekday, uint16_t minute) {
+    // Today up to now, then whole days further back; the eighth step is today after now
+    for (int back = 0; back <= 7; back++) {
+        uint8_t day = (uint8_t)((weekday + 7 - back % 7) % 7);
+        int latest = back == 0 ? minute : GROVE_AQS_SCHEDULE_MINUTES_PER_DAY - 1;
+        int best = -1;
+        for (uint8_t e = 0; e < schedule->count; e++) {
+            const grove_aqs_schedule_entry_t *entry = &schedule->entries[e];
+            if ((entry->days & (1u << day)) && entry->minute <= latest &&
+                (best < 0 || entry->minute >= schedule->entries[best].minute)) {
+                best = e;
+            }
+        }
+        if (best >= 0) {
+            return schedule->entries[best].preset;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file grove_aqs_preset_run.c
+ * @brief Preset schedule on the target: a once-a-minute esp_timer against the local time
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <stdatomic.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "grove_analog_aqs.h"
+#include "grove_aqs_preset.h"
+
+static const char *TAG = "grove_aqs_preset";
+
+#define SCHEDULE_PERIOD_US (60 * 1000000LL)
+
+/* Clocks before 2020-01-01 have not been set (SNTP or RTC) yet */
+#define SCHEDULE_MIN_EPOCH 1577836800
+
+static grove_aqs_schedule_t schedule;
+static esp_timer_handle_t timer;
+static int scheduled;                // Preset of the last scheduled change, -1 before the first
+static atomic_bool running;
+static atomic_bool in_callback;
+
+static void schedule_timer_cb(void *arg) {
+    (void)arg;
+    atomic_store(&in_callback, true);
+    time_t now = time(NULL);
+    if (atomic_load(&running) && now >= SCHEDULE_MIN_EPOCH) {
+        struct tm local;
+        localtime_r(&now, &local);
+        int preset = grove_aqs_schedule_lookup(&schedule, (uint8_t)local.tm_wday,
+                                               (uint16_t)(local.tm_hour * 60 + local.tm_min));
+        // Only a change of the scheduled preset switches, so a selection by hand holds until then;
+        // a failed switch is retried on the next tick
+        if (preset >= 0 && preset != scheduled && grove_aqs_preset_select((uint8_t)preset) == ESP_OK) {
+            scheduled = preset;
+        }
+    }
+    atomic_store(&in_callback, false);
+}
+
+esp_err_t grove_aqs_schedule_start(const grove_aqs_schedule_t *new_schedule) {
+    if (new_schedule == NULL || new_schedule->count > GROVE_AQS_SCHEDULE_MAX) {
+        ESP_LOGE(TAG, "Invalid schedule");
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t e = 0; e < new_schedule->count; e++) {
+        const grove_aqs_schedule_entry_t *entry = &new_schedule->entries[e];
+        if (entry->minute >= GROVE_AQS_SCHEDULE_MINUTES_PER_DAY || entry->preset >= CONFIG_GROVE_AQS_PRESET_COUNT) {
+            ESP_LOGE(TAG, "Schedule entry %u out of range", e);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (atomic_load(&running)) {
+        ESP_LOGE(TAG, "Schedule already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    schedule = *new_schedule;
+    scheduled = -1;
+    const esp_timer_create_args_t args = {
+        .callback = schedule_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "grove_aqs_schedule",
+    };
+    esp_err_t ret = esp_timer_create(&args, &timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create schedule timer: %d", ret);
+        return ret;
+    }
+
+    atomic_store(&running, true);
+    ret = esp_timer_start_periodic(timer, SCHEDULE_PERIOD_US);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start schedule timer: %d", ret);
+        atomic_store(&running, false);
+        esp_timer_delete(timer);
+        return ret;
+    }
+    // The scheduled preset applies now rather than at the first tick
+    schedule_timer_cb(NULL);
+
+    ESP_LOGI(TAG, "Preset schedule started: %u entries", schedule.count);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_schedule_stop(void) {
+    if (!atomic_load(&running)) {
+        ESP_LOGE(TAG, "Schedule not running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    atomic_store(&running, false);
+    while (atomic_load(&in_callback)) {
+        vTaskDelay(1);
+    }
+    esp_timer_stop(timer);
+    esp_err_t ret = esp_timer_delete(timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to delete schedule timer: %d", ret);
+        return ret;
+    }
+    ESP_LOGI(TAG, "Preset schedule stopped");
+    return ESP_OK;
+}
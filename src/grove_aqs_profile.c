@@ -0,0 +1,209 @@
+/**
+ * @file grove_aqs_profile.c
+ * @brief Heater profile runner, per-cycle feature extraction and the ring of recent cycles
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+#include "grove_aqs_profile.h"
+
+_Static_assert(GROVE_AQS_PROFILE_RING_SIZE >= 2, "CONFIG_GROVE_AQS_PROFILE_RING_SIZE must be at least 2");
+_Static_assert(GROVE_AQS_PROFILE_MAX_PHASES <= 32, "sampled phases are tracked in a 32-bit mask");
+
+static const char *TAG = "grove_aqs_profile";
+
+static grove_aqs_profile_features_t ring[GROVE_AQS_PROFILE_RING_SIZE];
+static atomic_uint_fast32_t ring_count;
+
+uint32_t grove_aqs_profile_cycle_ms(const grove_aqs_profile_t *profile) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < profile->step_count && i < GROVE_AQS_PROFILE_MAX_STEPS; i++) {
+        total += profile->steps[i].duration_ms;
+    }
+    return total;
+}
+
+esp_err_t grove_aqs_profile_build(const grove_aqs_profile_t *profile, grove_aqs_profile_event_t *events, size_t *count) {
+    if (profile == NULL || events == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (profile->step_count == 0 || profile->step_count > GROVE_AQS_PROFILE_MAX_STEPS ||
+        profile->phase_count == 0 || profile->phase_count > GROVE_AQS_PROFILE_MAX_PHASES) {
+        ESP_LOGE(TAG, "Profile needs 1-%d steps and 1-%d phases", GROVE_AQS_PROFILE_MAX_STEPS,
+                 GROVE_AQS_PROFILE_MAX_PHASES);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t i = 0; i < profile->step_count; i++) {
+        if (profile->steps[i].duration_ms == 0 || profile->steps[i].duty_pct > 100) {
+            ESP_LOGE(TAG, "Invalid step %u", i);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    uint32_t cycle_ms = grove_aqs_profile_cycle_ms(profile);
+    if (cycle_ms > UINT32_MAX / 1000) {
+        ESP_LOGE(TAG, "Cycle of %u ms is too long", (unsigned)cycle_ms);
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t i = 0; i < profile->phase_count; i++) {
+        if (profile->phase_ms[i] >= cycle_ms || (i > 0 && profile->phase_ms[i] <= profile->phase_ms[i - 1])) {
+            ESP_LOGE(TAG, "Phases must ascend within the %u ms cycle", (unsigned)cycle_ms);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    // Both lists are already ordered: merge them, steps first at equal offsets
+    size_t n = 0;
+    uint8_t step = 0;
+    uint8_t phase = 0;
+    uint32_t step_start_ms = 0;
+    while (step < profile->step_count || phase < profile->phase_count) {
+        if (step < profile->step_count &&
+            (phase == profile->phase_count || step_start_ms <= profile->phase_ms[phase])) {
+            events[n++] = (grove_aqs_profile_event_t){ .offset_us = step_start_ms * 1000, .sample = 0, .index = step };
+            step_start_ms += profile->steps[step++].duration_ms;
+        } else {
+            events[n++] = (grove_aqs_profile_event_t){
+                .offset_us = profile->phase_ms[phase] * 1000, .sample = 1, .index = phase };
+            phase++;
+        }
+    }
+    *count = n;
+    return ESP_OK;
+}
+
+static void cycle_reset(grove_aqs_profile_runner_t *runner, uint32_t cycle) {
+    memset(&runner->current, 0, sizeof(runner->current));
+    runner->current.cycle = cycle;
+    runner->current.phase_count = runner->phase_count;
+    runner->sampled = 0;
+}
+
+esp_err_t grove_aqs_profile_runner_init(grove_aqs_profile_runner_t *runner, const grove_aqs_profile_t *profile,
+                                        const grove_aqs_profile_io_t *io, int64_t now_us) {
+    if (runner == NULL || io == NULL || io->set_duty == NULL || io->sample_mv == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t count;
+    esp_err_t ret = grove_aqs_profile_build(profile, runner->events, &count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    runner->event_count = (uint8_t)count;
+    runner->next = 0;
+    runner->cycle_us = grove_aqs_profile_cycle_ms(profile) * 1000;
+    runner->cycle_start_us = now_us;
+    runner->resyncs = 0;
+    runner->sample_errors = 0;
+    runner->io = *io;
+    runner->phase_count = profile->phase_count;
+    for (uint8_t i = 0; i < profile->step_count; i++) {
+        runner->step_duty[i] = profile->steps[i].duty_pct;
+    }
+    cycle_reset(runner, 0);
+    return ESP_OK;
+}
+
+static void cycle_finish(grove_aqs_profile_runner_t *runner) {
+    grove_aqs_profile_features_t *f = &runner->current;
+    uint32_t all = runner->phase_count == 32 ? UINT32_MAX : (1u << runner->phase_count) - 1;
+    if (runner->sampled != all) {
+        return;
+    }
+
+    uint32_t sum = 0;
+    f->min_mv = UINT16_MAX;
+    for (uint8_t i = 0; i < f->phase_count; i++) {
+        sum += f->mv[i];
+        f->min_mv = f->mv[i] < f->min_mv ? f->mv[i] : f->min_mv;
+        f->max_mv = f->mv[i] > f->max_mv ? f->mv[i] : f->max_mv;
+    }
+    f->mean_mv = (uint16_t)(sum / f->phase_count);
+    for (uint8_t i = 0; i < f->phase_count && f->mean_mv > 0; i++) {
+        uint32_t shape = ((uint32_t)f->mv[i] << GROVE_AQS_PROFILE_SHAPE_SHIFT) / f->mean_mv;
+        f->shape_q12[i] = (uint16_t)(shape > UINT16_MAX ? UINT16_MAX : shape);
+    }
+
+    if (runner->io.cycle_done != NULL) {
+        runner->io.cycle_done(runner->io.ctx, f);
+    }
+}
+
+int64_t grove_aqs_profile_runner_poll(grove_aqs_profile_runner_t *runner, int64_t now_us) {
+    for (;;) {
+        const grove_aqs_profile_event_t *event = &runner->events[runner->next];
+        int64_t due = runner->cycle_start_us + event->offset_us;
+        if (due > now_us) {
+            return due;
+        }
+
+        if (event->sample) {
+            int mv = runner->io.sample_mv(runner->io.ctx);
+            if (mv >= 0) {
+                uint32_t late = (uint32_t)(now_us - due);
+                runner->current.mv[event->index] = (uint16_t)(mv > UINT16_MAX ? UINT16_MAX : mv);
+                runner->sampled |= 1u << event->index;
+                if (late > runner->current.max_phase_error_us) {
+                    runner->current.max_phase_error_us = late;
+                }
+            } else {
+                runner->sample_errors++;
+            }
+        } else {
+            runner->io.set_duty(runner->io.ctx, runner->step_duty[event->index]);
+        }
+
+        if (++runner->next < runner->event_count) {
+            continue;
+        }
+
+        // Cycle complete: the next one starts a cycle length after this one, not after the last event
+        cycle_finish(runner);
+        cycle_reset(runner, runner->current.cycle + 1);
+        runner->next = 0;
+        runner->cycle_start_us += runner->cycle_us;
+        if (now_us - runner->cycle_start_us >= (int64_t)runner->cycle_us) {
+            // A whole cycle behind (e.g. the timer was held off): restart rather than catch up in a burst
+            runner->cycle_start_us = now_us;
+            runner->resyncs++;
+        }
+    }
+}
+
+void grove_aqs_profile_publish(const grove_aqs_profile_features_t *features) {
+    uint32_t count = (uint32_t)atomic_load_explicit(&ring_count, memory_order_relaxed);
+    ring[count % GROVE_AQS_PROFILE_RING_SIZE] = *features;
+    atomic_store_explicit(&ring_count, count + 1, memory_order_release);
+}
+
+size_t grove_aqs_profile_read(grove_aqs_profile_features_t *out, size_t max) {
+    if (out == NULL) {
+        return 0;
+    }
+    for (;;) {
+        uint32_t before = (uint32_t)atomic_load_explicit(&ring_count, memory_order_acquire);
+        // One slot stays out of reach: the writer may be filling it
+        size_t n = GROVE_AQS_PROFILE_RING_SIZE - 1;
+        n = max < n ? max : n;
+        n = before < n ? before : n;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = ring[(before - n + i) % GROVE_AQS_PROFILE_RING_SIZE];
+        }
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t after = (uint32_t)atomic_load_explicit(&ring_count, memory_order_relaxed);
+        // Slots of the copied cycles are only reused once the writer is RING_SIZE - n cycles further
+        if (after - before < GROVE_AQS_PROFILE_RING_SIZE - n) {
+            return n;
+        }
+    }
+}
+
+void grove_aqs_profile_clear(void) {
+    atomic_store_explicit(&ring_count, 0, memory_order_release);
+}
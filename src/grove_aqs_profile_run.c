@@ -0,0 +1,131 @@
+/**
+ * @file grove_aqs_profile_run.c
+ * @brief Heater profile cycling on the target: esp_timer scheduling of the profile runner
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * One-shot esp_timer re-armed for the next event's absolute due time after
+ * every poll, so callback latency shows up as phase error of single samples
+ * instead of accumulating over the cycle.
+ */
+
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "grove_analog_aqs.h"
+#include "grove_aqs_profile.h"
+
+static const char *TAG = "grove_aqs_profile";
+
+static grove_aqs_profile_runner_t runner;
+static esp_timer_handle_t timer;
+static atomic_bool running;
+static atomic_bool in_callback;
+
+static void io_set_duty(void *ctx, uint8_t duty_pct) {
+    (void)ctx;
+    grove_aqs_set_heater_duty(duty_pct);
+}
+
+static int io_sample_mv(void *ctx) {
+    (void)ctx;
+    int mv;
+    return grove_aqs_sample_mv(&mv) == ESP_OK ? mv : -1;
+}
+
+static void io_cycle_done(void *ctx, const grove_aqs_profile_features_t *features) {
+    (void)ctx;
+    grove_aqs_profile_publish(features);
+}
+
+static void profile_timer_cb(void *arg) {
+    (void)arg;
+    atomic_store(&in_callback, true);
+    if (atomic_load(&running)) {
+        int64_t next = grove_aqs_profile_runner_poll(&runner, esp_timer_get_time());
+        int64_t wait = next - esp_timer_get_time();
+        esp_timer_start_once(timer, wait > 0 ? (uint64_t)wait : 0);
+    }
+    atomic_store(&in_callback, false);
+}
+
+esp_err_t grove_aqs_profile_start(const grove_aqs_profile_t *profile) {
+    if (atomic_load(&running)) {
+        ESP_LOGE(TAG, "Profile already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const grove_aqs_profile_io_t io = {
+        .set_duty = io_set_duty,
+        .sample_mv = io_sample_mv,
+        .cycle_done = io_cycle_done,
+    };
+    esp_err_t ret = grove_aqs_profile_runner_init(&runner, profile, &io, esp_timer_get_time());
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    // The first step is due right away anyway; applying it here checks the sensor and its supply
+    ret = grove_aqs_set_heater_duty(profile->steps[0].duty_pct);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to drive the heater: %d", ret);
+        return ret;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = profile_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "grove_aqs_profile",
+    };
+    ret = esp_timer_create(&args, &timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create profile timer: %d", ret);
+        return ret;
+    }
+
+    grove_aqs_profile_clear();
+    atomic_store(&running, true);
+    ret = esp_timer_start_once(timer, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start profile timer: %d", ret);
+        atomic_store(&running, false);
+        esp_timer_delete(timer);
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Heater profile started: %u steps, %u phases, %u ms cycle", profile->step_count,
+             profile->phase_count, (unsigned)grove_aqs_profile_cycle_ms(profile));
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_profile_stop(void) {
+    if (!atomic_load(&running)) {
+        ESP_LOGE(TAG, "Profile not running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A callback already past the running check may still re-arm: let it finish, then disarm
+    atomic_store(&running, false);
+    while (atomic_load(&in_callback)) {
+        vTaskDelay(1);
+    }
+    esp_timer_stop(timer);
+    esp_err_t ret = esp_timer_delete(timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to delete profile timer: %d", ret);
+        return ret;
+    }
+
+    ret = grove_aqs_power_on();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ESP_LOGI(TAG, "Heater profile stopped after %u cycles (%u resyncs, %u failed samples)",
+             (unsigned)runner.current.cycle, (unsigned)runner.resyncs, (unsigned)runner.sample_errors);
+    return ESP_OK;
+}
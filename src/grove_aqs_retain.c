@@ -0,0 +1,163 @@
+/**
+ * @file grove_aqs_retain.c
+ * @brief Driver state carried across deep sleep and restarts in retained (RTC) memory
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <string.h>
+#include "grove_aqs_retain.h"
+#include "grove_aqs_util.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#endif
+
+static const char *TAG = "grove_aqs_retain";
+
+#ifdef ESP_PLATFORM
+/* Not zeroed at boot: survives deep sleep and software resets */
+static RTC_NOINIT_ATTR grove_aqs_retain_block_t rtc_block;
+static grove_aqs_retain_block_t *block = &rtc_block;
+#else
+static grove_aqs_retain_block_t *block;
+#endif
+
+esp_err_t grove_aqs_retain_set_region(void *mem, size_t size) {
+    if (mem == NULL) {
+        ESP_LOGE(TAG, "Region is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size < sizeof(grove_aqs_retain_block_t)) {
+        ESP_LOGE(TAG, "Region of %u bytes is too small for the %u byte block",
+                 (unsigned)size, (unsigned)sizeof(grove_aqs_retain_block_t));
+        return ESP_ERR_INVALID_SIZE;
+    }
+    block = mem;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_retain_store(const grove_aqs_retain_state_t *state) {
+    if (block == NULL) {
+        ESP_LOGE(TAG, "No retained region");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (state == NULL) {
+        ESP_LOGE(TAG, "State pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Invalidate first, so a reset in the middle of the copy leaves no valid-looking block
+    block->magic = 0;
+    block->state = *state;
+    block->version = GROVE_AQS_RETAIN_VERSION;
+    block->size = sizeof(grove_aqs_retain_state_t);
+    block->crc = grove_aqs_crc32(0, &block->state, sizeof(block->state));
+    block->magic = GROVE_AQS_RETAIN_MAGIC;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_retain_load(grove_aqs_retain_state_t *state) {
+    if (block == NULL) {
+        ESP_LOGE(TAG, "No retained region");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (state == NULL) {
+        ESP_LOGE(TAG, "State pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (block->magic != GROVE_AQS_RETAIN_MAGIC) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (block->version != GROVE_AQS_RETAIN_VERSION || block->size != sizeof(grove_aqs_retain_state_t)) {
+        ESP_LOGW(TAG, "Ignoring retained state of version %u (%u bytes)", block->version, block->size);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (block->crc != grove_aqs_crc32(0, &block->state, sizeof(block->state))) {
+        ESP_LOGW(TAG, "Ignoring corrupted retained state");
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (block->state.pending_count > GROVE_AQS_RETAIN_MAX_SAMPLES) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    *state = block->state;
+    return ESP_OK;
+}
+
+void grove_aqs_retain_clear(void) {
+    if (block != NULL) {
+        block->magic = 0;
+    }
+}
+
+#ifdef ESP_PLATFORM
+
+esp_err_t grove_aqs_retain_save(void) {
+    grove_aqs_retain_state_t state;
+    memset(&state, 0, sizeof(state));
+
+    esp_err_t ret = grove_aqs_export_state(&state.driver);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+#if CONFIG_GROVE_AQS_ENABLE_HISTORY
+    size_t count = 0;
+    ret = grove_aqs_history_get_pending(state.pending, GROVE_AQS_RETAIN_MAX_SAMPLES, &count);
+    if (ret == ESP_ERR_INVALID_SIZE) {
+        // Batch larger than the block: write it to flash as a short record instead
+        ret = grove_aqs_history_flush();
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to save pending samples: %d", ret);
+        return ret;
+    }
+    state.pending_count = (uint16_t)count;
+#endif
+
+    return grove_aqs_retain_store(&state);
+}
+
+esp_err_t grove_aqs_retain_resume(const grove_aqs_config_t *config, bool *resumed) {
+    if (resumed != NULL) {
+        *resumed = false;
+    }
+
+    grove_aqs_retain_state_t state;
+    esp_err_t loaded = grove_aqs_retain_load(&state);
+    grove_aqs_retain_clear();
+
+    esp_err_t ret = grove_aqs_init(config);
+    if (ret != ESP_OK || loaded != ESP_OK) {
+        return ret;
+    }
+
+    state.driver.resume_count++;
+    if (grove_aqs_import_state(&state.driver) != ESP_OK) {
+        // Another configuration: the readings and the samples don't belong to this one
+        return ESP_OK;
+    }
+
+#if CONFIG_GROVE_AQS_ENABLE_HISTORY
+    for (uint16_t i = 0; i < state.pending_count; i++) {
+        esp_err_t err = grove_aqs_history_append(&state.pending[i]);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Dropped %u retained samples: %d", (unsigned)(state.pending_count - i), err);
+            break;
+        }
+    }
+#endif
+
+    if (resumed != NULL) {
+        *resumed = true;
+    }
+    return ESP_OK;
+}
+
+#endif /* ESP_PLATFORM */
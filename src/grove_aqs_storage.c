@@ -0,0 +1,227 @@
+/**
+ * @file grove_aqs_storage.c
+ * @brief Storage backends for the sample history journal
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grove_aqs_storage.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#else
+#include <sys/mman.h>
+#endif
+
+static const char *TAG = "grove_aqs_storage";
+
+#ifdef ESP_PLATFORM
+
+typedef struct {
+    const esp_partition_t *part;
+    esp_partition_mmap_handle_t mmap_handle;
+    bool mapped;
+} partition_ctx_t;
+
+static esp_err_t partition_read(void *ctx, size_t offset, void *dst, size_t len) {
+    return esp_partition_read(((partition_ctx_t *)ctx)->part, offset, dst, len);
+}
+
+// Flash writes and erases through esp_partition also invalidate the cache for mapped ranges
+static esp_err_t partition_write(void *ctx, size_t offset, const void *src, size_t len) {
+    return esp_partition_write(((partition_ctx_t *)ctx)->part, offset, src, len);
+}
+
+static esp_err_t partition_erase(void *ctx, size_t offset, size_t len) {
+    return esp_partition_erase_range(((partition_ctx_t *)ctx)->part, offset, len);
+}
+
+static esp_err_t partition_close(void *ctx) {
+    partition_ctx_t *p = (partition_ctx_t *)ctx;
+    if (p->mapped) {
+        esp_partition_munmap(p->mmap_handle);
+    }
+    free(p);
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_storage_open_partition(const char *label, grove_aqs_storage_t *storage) {
+    if (label == NULL || storage == NULL) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    partition_ctx_t *p = calloc(1, sizeof(partition_ctx_t));
+    if (p == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    p->part = part;
+
+    memset(storage, 0, sizeof(*storage));
+    storage->read = partition_read;
+    storage->write = partition_write;
+    storage->erase = partition_erase;
+    storage->close = partition_close;
+    storage->ctx = p;
+    storage->sector_size = part->erase_size;
+    storage->size = part->size - (part->size % part->erase_size);
+
+    const void *ptr = NULL;
+    esp_err_t ret = esp_partition_mmap(part, 0, storage->size, ESP_PARTITION_MMAP_DATA, &ptr, &p->mmap_handle);
+    if (ret == ESP_OK) {
+        p->mapped = true;
+        storage->mapped = ptr;
+    } else {
+        ESP_LOGW(TAG, "Partition '%s' not mapped, reads will copy: %d", label, ret);
+    }
+    return ESP_OK;
+}
+
+#endif /* ESP_PLATFORM */
+
+typedef struct {
+    FILE *fp;
+    size_t size;
+    size_t sector_size;
+    void *map;
+} file_ctx_t;
+
+static esp_err_t file_read(void *ctx, size_t offset, void *dst, size_t len) {
+    file_ctx_t *f = (file_ctx_t *)ctx;
+    if (fseek(f->fp, (long)offset, SEEK_SET) != 0 || fread(dst, 1, len, f->fp) != len) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t file_write(void *ctx, size_t offset, const void *src, size_t len) {
+    file_ctx_t *f = (file_ctx_t *)ctx;
+    if (fseek(f->fp, (long)offset, SEEK_SET) != 0 || fwrite(src, 1, len, f->fp) != len) {
+        return ESP_FAIL;
+    }
+    return fflush(f->fp) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t file_fill_erased(FILE *fp, size_t offset, size_t len) {
+    uint8_t erased[256];
+    memset(erased, 0xFF, sizeof(erased));
+    if (fseek(fp, (long)offset, SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+    while (len > 0) {
+        size_t chunk = len < sizeof(erased) ? len : sizeof(erased);
+        if (fwrite(erased, 1, chunk, fp) != chunk) {
+            return ESP_FAIL;
+        }
+        len -= chunk;
+    }
+    return fflush(fp) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t file_erase(void *ctx, size_t offset, size_t len) {
+    file_ctx_t *f = (file_ctx_t *)ctx;
+    if (offset % f->sector_size != 0 || len % f->sector_size != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return file_fill_erased(f->fp, offset, len);
+}
+
+static esp_err_t file_close(void *ctx) {
+    file_ctx_t *f = (file_ctx_t *)ctx;
+#ifndef ESP_PLATFORM
+    if (f->map != NULL) {
+        munmap(f->map, f->size);
+    }
+#endif
+    int rc = fclose(f->fp);
+    free(f);
+    return rc == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t grove_aqs_storage_open_file(const char *path, size_t size, size_t sector_size,
+                                      grove_aqs_storage_t *storage) {
+    if (path == NULL || storage == NULL || sector_size == 0 || size < sector_size ||
+        size % sector_size != 0) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    FILE *fp = fopen(path, "r+b");
+    if (fp == NULL) {
+        fp = fopen(path, "w+b");
+    }
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "Failed to open '%s'", path);
+        return ESP_FAIL;
+    }
+
+    // Extend short files with erased content so they behave like a fresh partition
+    if (fseek(fp, 0, SEEK_END) != 0) {
+        fclose(fp);
+        return ESP_FAIL;
+    }
+    long current = ftell(fp);
+    if (current >= 0 && (size_t)current < size) {
+        esp_err_t ret = file_fill_erased(fp, (size_t)current, size - (size_t)current);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to extend '%s'", path);
+            fclose(fp);
+            return ret;
+        }
+    }
+
+    file_ctx_t *f = calloc(1, sizeof(file_ctx_t));
+    if (f == NULL) {
+        fclose(fp);
+        return ESP_ERR_NO_MEM;
+    }
+    f->fp = fp;
+    f->size = size;
+    f->sector_size = sector_size;
+
+#ifndef ESP_PLATFORM
+    // A shared mapping sees the stdio writes once they are flushed
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+    if (map != MAP_FAILED) {
+        f->map = map;
+    } else {
+        ESP_LOGW(TAG, "'%s' not mapped, reads will copy", path);
+    }
+#endif
+
+    memset(storage, 0, sizeof(*storage));
+    storage->read = file_read;
+    storage->write = file_write;
+    storage->erase = file_erase;
+    storage->close = file_close;
+    storage->ctx = f;
+    storage->mapped = f->map;
+    storage->size = size;
+    storage->sector_size = sector_size;
+    return ESP_OK;
+}
+
+esp_err_t grove_aqs_storage_close(grove_aqs_storage_t *storage) {
+    if (storage == NULL || storage->close == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = storage->close(storage->ctx);
+    memset(storage, 0, sizeof(*storage));
+    return ret;
+}
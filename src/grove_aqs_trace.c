@@ -0,0 +1,193 @@
+/**
+ * @file grove_aqs_trace.c
+ * @brief Per-core trace rings and Chrome trace JSON export
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Each core writes to its own ring, so recording an event is a single
+ * uncontended atomic increment plus a 12-byte store. An interrupt (or, on a
+ * host, another thread on the same CPU) simply claims the next slot. When a
+ * ring is full the oldest events are overwritten.
+ */
+
+#ifndef ESP_PLATFORM
+#define _GNU_SOURCE /* sched_getcpu() */
+#include <sched.h>
+#endif
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "grove_aqs_trace.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_app_trace.h"
+#include "esp_cpu.h"
+#endif
+
+#define RING_SIZE CONFIG_GROVE_AQS_TRACE_BUFFER_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+_Static_assert((RING_SIZE & RING_MASK) == 0, "CONFIG_GROVE_AQS_TRACE_BUFFER_SIZE must be a power of two");
+_Static_assert(sizeof(grove_aqs_trace_event_t) == 12, "event layout is part of the dump format");
+
+static grove_aqs_trace_event_t rings[GROVE_AQS_TRACE_CORES][RING_SIZE];
+static atomic_uint_fast32_t heads[GROVE_AQS_TRACE_CORES];
+static atomic_bool recording;
+
+static const char *const event_names[GROVE_AQS_TRACE_EVENT_COUNT] = {
+    [GROVE_AQS_TRACE_CONVERSION] = "conversion",
+    [GROVE_AQS_TRACE_BATCH_HANDOFF] = "batch_handoff",
+    [GROVE_AQS_TRACE_SECTOR_OPEN] = "sector_open",
+    [GROVE_AQS_TRACE_BATCH_WRITE] = "batch_write",
+    [GROVE_AQS_TRACE_HISTORY_MOUNT] = "history_mount",
+    [GROVE_AQS_TRACE_HISTORY_QUERY] = "history_query",
+    [GROVE_AQS_TRACE_CONSUMER_WAKE] = "consumer_wake",
+    [GROVE_AQS_TRACE_DLOG_DRAIN] = "dlog_drain",
+};
+
+static inline uint32_t current_core(void) {
+#ifdef ESP_PLATFORM
+    return (uint32_t)esp_cpu_get_core_id();
+#else
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : (uint32_t)cpu % GROVE_AQS_TRACE_CORES;
+#endif
+}
+
+void grove_aqs_trace_start(void) {
+    for (int core = 0; core < GROVE_AQS_TRACE_CORES; core++) {
+        atomic_store_explicit(&heads[core], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&recording, true, memory_order_release);
+}
+
+void grove_aqs_trace_stop(void) {
+    atomic_store_explicit(&recording, false, memory_order_release);
+}
+
+void grove_aqs_trace_record(grove_aqs_trace_event_id_t event, char phase, int32_t arg) {
+    if (!atomic_load_explicit(&recording, memory_order_relaxed)) {
+        return;
+    }
+
+    uint32_t core = current_core();
+    uint32_t slot = (uint32_t)atomic_fetch_add_explicit(&heads[core], 1, memory_order_relaxed);
+    grove_aqs_trace_event_t *e = &rings[core][slot & RING_MASK];
+    e->timestamp_us = (uint32_t)grove_aqs_port_time_us();
+    e->event = (uint16_t)event;
+    e->phase = (uint8_t)phase;
+    e->core = (uint8_t)core;
+    e->arg = arg;
+}
+
+const char* grove_aqs_trace_event_name(uint16_t event) {
+    return event < GROVE_AQS_TRACE_EVENT_COUNT ? event_names[event] : "unknown";
+}
+
+/* JSON writer state: 32-bit timestamps are extended to 64 bits per core */
+typedef struct {
+    FILE *out;
+    bool first;
+    uint32_t last_ts[GROVE_AQS_TRACE_CORES];
+    uint64_t epoch[GROVE_AQS_TRACE_CORES];
+} json_writer_t;
+
+static void json_begin(json_writer_t *w, FILE *out) {
+    *w = (json_writer_t){ .out = out, .first = true };
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", out);
+}
+
+static void json_event(json_writer_t *w, const grove_aqs_trace_event_t *e) {
+    uint32_t core = e->core % GROVE_AQS_TRACE_CORES;
+    uint32_t ts = e->timestamp_us;
+    if (ts < w->last_ts[core]) {
+        if ((uint32_t)(w->last_ts[core] - ts) > 0x80000000u) {
+            // Wrapped: a step back of more than half the range is a step forward into the next epoch
+            w->epoch[core] += 1ull << 32;
+        } else {
+            // Slightly out of order (claimed its slot before an interrupting event, stamped after it): clamp
+            ts = w->last_ts[core];
+        }
+    }
+    w->last_ts[core] = ts;
+
+    fprintf(w->out, "%s{\"name\":\"%s\",\"ph\":\"%c\",%s\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%" PRId32 "}}",
+            w->first ? "" : ",\n", grove_aqs_trace_event_name(e->event), e->phase,
+            e->phase == 'i' ? "\"s\":\"t\"," : "", w->epoch[core] + ts, (unsigned)core, e->arg);
+    w->first = false;
+}
+
+static void json_end(json_writer_t *w) {
+    fputs("\n]}\n", w->out);
+}
+
+void grove_aqs_trace_write_json(FILE *out, const grove_aqs_trace_event_t *events, size_t count) {
+    json_writer_t w;
+    json_begin(&w, out);
+    for (size_t i = 0; i < count; i++) {
+        json_event(&w, &events[i]);
+    }
+    json_end(&w);
+}
+
+/* Oldest retained slot and number of events of one core's ring */
+static uint32_t ring_span(int core, uint32_t *count) {
+    uint32_t head = (uint32_t)atomic_load_explicit(&heads[core], memory_order_acquire);
+    *count = head < RING_SIZE ? head : RING_SIZE;
+    return head - *count;
+}
+
+esp_err_t grove_aqs_trace_export_json(FILE *out) {
+    json_writer_t w;
+    json_begin(&w, out);
+    for (int core = 0; core < GROVE_AQS_TRACE_CORES; core++) {
+        uint32_t count;
+        uint32_t first = ring_span(core, &count);
+        for (uint32_t i = 0; i < count; i++) {
+            json_event(&w, &rings[core][(first + i) & RING_MASK]);
+        }
+    }
+    json_end(&w);
+    return ferror(out) ? ESP_FAIL : ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+
+static const char *TAG = "grove_aqs_trace";
+
+esp_err_t grove_aqs_trace_send_apptrace(uint32_t timeout_us) {
+    grove_aqs_trace_dump_header_t header = { .magic = GROVE_AQS_TRACE_DUMP_MAGIC };
+    for (int core = 0; core < GROVE_AQS_TRACE_CORES; core++) {
+        uint32_t count;
+        ring_span(core, &count);
+        header.count += count;
+    }
+
+    esp_err_t ret = esp_apptrace_write(ESP_APPTRACE_DEST_JTAG, &header, sizeof(header), timeout_us);
+    for (int core = 0; core < GROVE_AQS_TRACE_CORES && ret == ESP_OK; core++) {
+        uint32_t count;
+        uint32_t first = ring_span(core, &count) & RING_MASK;
+        // The retained events are at most two contiguous runs of the ring
+        uint32_t run = count < RING_SIZE - first ? count : RING_SIZE - first;
+        ret = esp_apptrace_write(ESP_APPTRACE_DEST_JTAG, &rings[core][first],
+                                 run * sizeof(grove_aqs_trace_event_t), timeout_us);
+        if (ret == ESP_OK && count > run) {
+            ret = esp_apptrace_write(ESP_APPTRACE_DEST_JTAG, &rings[core][0],
+                                     (count - run) * sizeof(grove_aqs_trace_event_t), timeout_us);
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = esp_apptrace_flush(ESP_APPTRACE_DEST_JTAG, timeout_us);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send trace: %d", ret);
+    }
+    return ret;
+}
+
+#endif /* ESP_PLATFORM */
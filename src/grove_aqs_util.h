@@ -0,0 +1,102 @@
+/**
+ * @file grove_aqs_util.h
+ * @brief Small internal helpers shared by the component sources (CRC, square root, varint coding)
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#ifndef GROVE_AQS_UTIL_H
+#define GROVE_AQS_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected) using a 16 entry nibble table
+ *
+ * @param crc Running CRC, 0 for the first chunk
+ * @param data Data to process
+ * @param len Number of bytes
+ * @return uint32_t Updated CRC
+ */
+static inline uint32_t grove_aqs_crc32(uint32_t crc, const void *data, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    while (len--) {
+        crc = (crc >> 4) ^ table[(crc ^ *p) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (*p >> 4)) & 0x0F];
+        p++;
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Integer square root, rounded down
+ */
+static inline uint32_t grove_aqs_isqrt64(uint64_t x) {
+    uint64_t root = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+static inline uint32_t grove_aqs_zigzag_encode(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t grove_aqs_zigzag_decode(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/**
+ * @brief Append an unsigned LEB128 varint
+ *
+ * @return size_t Bytes written (at most 5)
+ */
+static inline size_t grove_aqs_varint_put(uint8_t *dst, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        dst[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    dst[n++] = (uint8_t)v;
+    return n;
+}
+
+/**
+ * @brief Read an unsigned LEB128 varint
+ *
+ * @return size_t Bytes consumed, 0 if the input is truncated or malformed
+ */
+static inline size_t grove_aqs_varint_get(const uint8_t *src, size_t len, uint32_t *v) {
+    uint32_t result = 0;
+    for (size_t n = 0; n < len && n < 5; n++) {
+        result |= (uint32_t)(src[n] & 0x7F) << (7 * n);
+        if ((src[n] & 0x80) == 0) {
+            *v = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* GROVE_AQS_UTIL_H */
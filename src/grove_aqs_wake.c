@@ -0,0 +1,43 @@
+/**
+ * @file grove_aqs_wake.c
+ * @brief Platform-independent part of the deep-sleep wake stub
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include "grove_aqs_wake.h"
+
+static uint16_t mv_to_raw(const grove_aqs_core_params_t *params, int mv) {
+    int raw = mv * GROVE_AQS_ADC_MAX_RAW / params->vref;
+    return (uint16_t)(raw < 0 ? 0 : raw > GROVE_AQS_ADC_MAX_RAW ? GROVE_AQS_ADC_MAX_RAW : raw);
+}
+
+/* Voltage the driver classifies a raw value at without ADC calibration */
+static int classified_mv(const grove_aqs_core_params_t *params, int raw) {
+    return grove_aqs_core_compensate(params, grove_aqs_core_raw_to_mv(params, raw));
+}
+
+/* Largest raw value classified at or below mv: estimated through the inverse gain and offset, then made exact */
+static uint16_t threshold_raw(const grove_aqs_core_params_t *params, int mv) {
+    int raw = mv_to_raw(params, (int)((((int64_t)mv - params->offset_mv) * GROVE_AQS_CORE_GAIN_ONE) / params->gain));
+    while (raw > 0 && classified_mv(params, raw) > mv) {
+        raw--;
+    }
+    while (raw < GROVE_AQS_ADC_MAX_RAW && classified_mv(params, raw + 1) <= mv) {
+        raw++;
+    }
+    return (uint16_t)raw;
+}
+
+void grove_aqs_wake_config_init(grove_aqs_wake_config_t *config, const grove_aqs_core_params_t *params,
+                                int hysteresis_mv, uint16_t raw) {
+    for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+        config->raw_thresholds[t] = threshold_raw(params, params->thresholds[t]);
+    }
+    config->hysteresis_raw = mv_to_raw(params, (int)(((int64_t)hysteresis_mv * GROVE_AQS_CORE_GAIN_ONE) / params->gain));
+    config->level = grove_aqs_wake_level(config, raw);
+}
@@ -0,0 +1,194 @@
+/**
+ * @file grove_aqs_wake_stub.c
+ * @brief Deep-sleep wake stub (ESP32): power, one ADC1 conversion, buffer, decide
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ *
+ * Everything the stub touches lives in RTC memory: its code (RTC_IRAM_ATTR),
+ * its state (RTC_DATA_ATTR) and the inlined decision. It must not call into
+ * flash, so the ADC is driven through the SENS registers directly and the
+ * power pad through the RTC GPIO registers, with the pad's hold register
+ * looked up while arming. The channel, attenuation and output inversion
+ * configured by the oneshot driver during the last full boot are kept in
+ * the RTC domain across deep sleep.
+ */
+
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_sleep.h"
+#include "esp_wake_stub.h"
+#include "driver/rtc_io.h"
+#include "soc/rtc_io_periph.h"
+#include "soc/rtc_io_reg.h"
+#include "soc/sens_reg.h"
+#include "soc/soc.h"
+#include "grove_aqs_wake.h"
+
+static const char *TAG = "grove_aqs_wake";
+
+/* Marks the RTC state as set up by grove_aqs_wake_arm() */
+#define WAKE_ARMED_MAGIC 0x57515341u
+
+typedef struct {
+    uint32_t armed;                  /* WAKE_ARMED_MAGIC while the stub should sample */
+    grove_aqs_wake_config_t config;
+    uint64_t sleep_us;
+    uint32_t warmup_us;
+    uint32_t power_hold_reg;         /* RTC IO register holding the power pad, 0 without power_gpio */
+    uint32_t power_hold_mask;
+    uint32_t power_out_bit;          /* Bit of the power pad in RTC_GPIO_OUT_W1TS/W1TC */
+    uint8_t channel;
+    uint8_t reason;                  /* grove_aqs_wake_action_t of the last stub run */
+    uint16_t count;
+    uint16_t raw[GROVE_AQS_WAKE_BUFFER_SIZE];
+} wake_state_t;
+
+static RTC_DATA_ATTR wake_state_t wake;
+
+static inline void RTC_IRAM_ATTR power_set(bool on) {
+    if (wake.power_hold_reg == 0) {
+        return;
+    }
+    CLEAR_PERI_REG_MASK(wake.power_hold_reg, wake.power_hold_mask);
+    REG_WRITE(on ? RTC_GPIO_OUT_W1TS_REG : RTC_GPIO_OUT_W1TC_REG, wake.power_out_bit);
+    if (!on) {
+        SET_PERI_REG_MASK(wake.power_hold_reg, wake.power_hold_mask);
+    }
+}
+
+static inline uint16_t RTC_IRAM_ATTR adc1_read(uint8_t channel) {
+    // RTC controller, software-started conversion, SAR powered up
+    CLEAR_PERI_REG_MASK(SENS_SAR_READ_CTRL_REG, SENS_SAR1_DIG_FORCE);
+    SET_PERI_REG_MASK(SENS_SAR_READ_CTRL_REG, SENS_SAR1_DATA_INV);
+    SET_PERI_REG_MASK(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_START_FORCE | SENS_SAR1_EN_PAD_FORCE);
+    SET_PERI_REG_BITS(SENS_SAR_MEAS_WAIT2_REG, SENS_FORCE_XPD_SAR_V, SENS_FORCE_XPD_SAR_PU, SENS_FORCE_XPD_SAR_S);
+
+    SET_PERI_REG_BITS(SENS_SAR_MEAS_START1_REG, SENS_SAR1_EN_PAD_V, 1u << channel, SENS_SAR1_EN_PAD_S);
+    CLEAR_PERI_REG_MASK(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_START_SAR);
+    SET_PERI_REG_MASK(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_START_SAR);
+    while (GET_PERI_REG_MASK(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_DONE_SAR) == 0) {
+    }
+    uint16_t raw = (uint16_t)GET_PERI_REG_BITS2(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_DATA_SAR_V, SENS_MEAS1_DATA_SAR_S);
+
+    SET_PERI_REG_BITS(SENS_SAR_MEAS_WAIT2_REG, SENS_FORCE_XPD_SAR_V, SENS_FORCE_XPD_SAR_PD, SENS_FORCE_XPD_SAR_S);
+    return raw;
+}
+
+static void RTC_IRAM_ATTR wake_stub(void) {
+    esp_default_wake_deep_sleep();
+    if (wake.armed != WAKE_ARMED_MAGIC) {
+        return;
+    }
+
+    power_set(true);
+    if (wake.warmup_us > 0) {
+        esp_rom_delay_us(wake.warmup_us);
+    }
+    uint16_t raw = adc1_read(wake.channel);
+    power_set(false);
+
+    if (wake.count < GROVE_AQS_WAKE_BUFFER_SIZE) {
+        wake.raw[wake.count++] = raw;
+    }
+    wake.reason = grove_aqs_wake_decide(&wake.config, wake.count, raw);
+    if (wake.reason != GROVE_AQS_WAKE_SLEEP) {
+        return;
+    }
+
+    esp_wake_stub_set_wakeup_time(wake.sleep_us);
+    esp_wake_stub_sleep(&wake_stub);
+}
+
+esp_err_t grove_aqs_wake_arm(const grove_aqs_config_t *config, uint64_t sleep_us) {
+    if (config == NULL || sleep_us == 0) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->adc_unit_num != 0) {
+        ESP_LOGE(TAG, "Only ADC1 can be sampled from the wake stub");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // The current reading sets the band the stub compares against
+    grove_aqs_data_t data;
+    esp_err_t ret = grove_aqs_read_data(&data);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    grove_aqs_core_params_t params;
+    ret = grove_aqs_get_params(&params);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    wake.armed = 0;
+    grove_aqs_wake_config_init(&wake.config, &params, CONFIG_GROVE_AQS_WAKE_HYSTERESIS_MV, (uint16_t)data.raw_value);
+    wake.sleep_us = sleep_us;
+    wake.warmup_us = CONFIG_GROVE_AQS_WAKE_WARMUP_MS * 1000u;
+    wake.channel = (uint8_t)config->adc_channel;
+    wake.count = 0;
+    wake.reason = GROVE_AQS_WAKE_SLEEP;
+    wake.power_hold_reg = 0;
+
+    if (config->use_gpio_power && config->power_gpio != GPIO_NUM_NC) {
+        int rtcio = rtc_io_number_get(config->power_gpio);
+        if (rtcio < 0) {
+            ESP_LOGE(TAG, "Power GPIO %d is not an RTC GPIO", config->power_gpio);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        gpio_hold_dis(config->power_gpio);
+        ret = rtc_gpio_init(config->power_gpio);
+        if (ret == ESP_OK) {
+            ret = rtc_gpio_set_direction(config->power_gpio, RTC_GPIO_MODE_OUTPUT_ONLY);
+        }
+        if (ret == ESP_OK) {
+            ret = rtc_gpio_set_level(config->power_gpio, 0);
+        }
+        if (ret == ESP_OK) {
+            ret = rtc_gpio_hold_en(config->power_gpio);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to hand the power GPIO to the RTC domain: %d", ret);
+            return ret;
+        }
+        // rtc_io_desc lives in flash, so the stub gets the register and bits ready-made
+        wake.power_hold_reg = rtc_io_desc[rtcio].reg;
+        wake.power_hold_mask = rtc_io_desc[rtcio].hold;
+        wake.power_out_bit = 1u << (rtcio + RTC_GPIO_OUT_DATA_W1TS_S);
+    }
+
+    ret = esp_sleep_enable_timer_wakeup(sleep_us);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable timer wakeup: %d", ret);
+        return ret;
+    }
+    esp_set_deep_sleep_wake_stub(&wake_stub);
+    wake.armed = WAKE_ARMED_MAGIC;
+
+    ESP_LOGI(TAG, "Wake stub armed: level %u, sample every %llu us", wake.config.level,
+             (unsigned long long)sleep_us);
+    return ESP_OK;
+}
+
+size_t grove_aqs_wake_take_samples(uint16_t *raw, size_t max, grove_aqs_wake_action_t *reason) {
+    bool stub_boot = wake.armed == WAKE_ARMED_MAGIC && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+    if (reason != NULL) {
+        *reason = stub_boot ? (grove_aqs_wake_action_t)wake.reason : GROVE_AQS_WAKE_SLEEP;
+    }
+
+    // The newest samples if they don't all fit
+    size_t count = 0;
+    if (stub_boot && raw != NULL) {
+        count = wake.count < max ? wake.count : max;
+        memcpy(raw, &wake.raw[wake.count - count], count * sizeof(raw[0]));
+    }
+    wake.armed = 0;
+    wake.count = 0;
+    return count;
+}
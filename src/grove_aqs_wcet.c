@@ -0,0 +1,296 @@
+/**
+ * @file grove_aqs_wcet.c
+ * @brief Worst-case execution time harness for the read and processing path
+ * @version 1.0.0
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * MIT License
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grove_aqs_wcet.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#include "esp_partition.h"
+#include "esp_rom_sys.h"
+#else
+#include <time.h>
+#endif
+
+static const char *TAG = "grove_aqs_wcet";
+
+/* Cache-cold operations are expensive to set up, so that scenario is capped */
+#define COLD_MAX_ITERATIONS 1000
+
+/* Untimed operations before the warm scenarios */
+#define WARMUP_ITERATIONS 100
+
+static const char *const scenario_names[GROVE_AQS_WCET_SCENARIO_COUNT] = {
+    [GROVE_AQS_WCET_HOVER] = "hover",
+    [GROVE_AQS_WCET_COLD] = "cold",
+    [GROVE_AQS_WCET_RETRY] = "retry",
+};
+
+/* ---- Time source: cycle counter on target, monotonic clock on host ---- */
+
+#ifdef ESP_PLATFORM
+
+typedef uint32_t stamp_t;
+
+static inline stamp_t stamp(void) {
+    return esp_cpu_get_cycle_count();
+}
+
+static inline uint32_t elapsed_ns(stamp_t start, stamp_t end) {
+    return (uint32_t)((uint64_t)(end - start) * 1000u / esp_rom_get_cpu_ticks_per_us());
+}
+
+#else
+
+typedef uint64_t stamp_t;
+
+static inline stamp_t stamp(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint32_t elapsed_ns(stamp_t start, stamp_t end) {
+    uint64_t ns = end - start;
+    return ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+#endif
+
+/* ---- Cache eviction ---- */
+
+#ifdef ESP_PLATFORM
+
+/* Reading a separate mapping of flash evicts the code and rodata of the read path from the flash cache */
+#define EVICT_SIZE (128 * 1024)
+#define EVICT_STRIDE 32
+
+static const volatile uint8_t *evict_buf;
+static esp_partition_mmap_handle_t evict_handle;
+
+static esp_err_t evict_init(void) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, NULL);
+    if (part == NULL || part->size < EVICT_SIZE) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    const void *ptr;
+    esp_err_t ret = esp_partition_mmap(part, 0, EVICT_SIZE, ESP_PARTITION_MMAP_DATA, &ptr, &evict_handle);
+    if (ret == ESP_OK) {
+        evict_buf = ptr;
+    }
+    return ret;
+}
+
+static void evict_deinit(void) {
+    esp_partition_munmap(evict_handle);
+    evict_buf = NULL;
+}
+
+#else
+
+/* Larger than the last-level cache of typical desktop and CI machines */
+#define EVICT_SIZE (32 * 1024 * 1024)
+#define EVICT_STRIDE 64
+
+static volatile uint8_t *evict_buf;
+
+static esp_err_t evict_init(void) {
+    evict_buf = malloc(EVICT_SIZE);
+    if (evict_buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset((void *)evict_buf, 1, EVICT_SIZE);
+    return ESP_OK;
+}
+
+static void evict_deinit(void) {
+    free((void *)evict_buf);
+    evict_buf = NULL;
+}
+
+#endif
+
+static void evict(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < EVICT_SIZE; i += EVICT_STRIDE) {
+        sum += evict_buf[i];
+    }
+    (void)sum;
+}
+
+/* ---- Histogram ---- */
+
+static uint32_t bucket_of(uint32_t ns) {
+    if (ns < GROVE_AQS_WCET_SUB_BUCKETS) {
+        return ns;
+    }
+    uint32_t e = 31u - (uint32_t)__builtin_clz(ns);
+    return (e - 2u) * GROVE_AQS_WCET_SUB_BUCKETS + ((ns >> (e - 3u)) - GROVE_AQS_WCET_SUB_BUCKETS);
+}
+
+static uint32_t bucket_upper(uint32_t bucket) {
+    if (bucket < GROVE_AQS_WCET_SUB_BUCKETS) {
+        return bucket;
+    }
+    uint32_t e = bucket / GROVE_AQS_WCET_SUB_BUCKETS + 2u;
+    uint64_t lower = (uint64_t)(GROVE_AQS_WCET_SUB_BUCKETS + bucket % GROVE_AQS_WCET_SUB_BUCKETS) << (e - 3u);
+    uint64_t upper = lower + (1ull << (e - 3u)) - 1u;
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+}
+
+void grove_aqs_wcet_hist_reset(grove_aqs_wcet_hist_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min_ns = UINT32_MAX;
+}
+
+void grove_aqs_wcet_hist_add(grove_aqs_wcet_hist_t *hist, uint32_t ns) {
+    hist->count++;
+    hist->sum_ns += ns;
+    if (ns < hist->min_ns) {
+        hist->min_ns = ns;
+    }
+    if (ns > hist->max_ns) {
+        hist->max_ns = ns;
+    }
+    hist->buckets[bucket_of(ns)]++;
+}
+
+uint32_t grove_aqs_wcet_hist_quantile(const grove_aqs_wcet_hist_t *hist, uint32_t num, uint32_t den) {
+    if (hist->count == 0 || den == 0) {
+        return 0;
+    }
+    // Rank of the quantile sample, rounded up
+    uint64_t rank = ((uint64_t)hist->count * num + den - 1) / den;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < GROVE_AQS_WCET_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank && seen > 0) {
+            uint32_t upper = bucket_upper(b);
+            return upper < hist->max_ns ? upper : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+void grove_aqs_wcet_hist_print(const grove_aqs_wcet_hist_t *hist, const char *name, FILE *out) {
+    if (hist->count == 0) {
+        fprintf(out, "%-8s no samples\n", name);
+        return;
+    }
+    fprintf(out, "%-8s n=%" PRIu32 " min=%" PRIu32 " mean=%" PRIu32 " p99=%" PRIu32 " p99.9=%" PRIu32
+            " max=%" PRIu32 " ns\n", name, hist->count, hist->min_ns, (uint32_t)(hist->sum_ns / hist->count),
+            grove_aqs_wcet_hist_quantile(hist, 99, 100), grove_aqs_wcet_hist_quantile(hist, 999, 1000),
+            hist->max_ns);
+
+    for (uint32_t b = 0; b < GROVE_AQS_WCET_BUCKETS; b++) {
+        if (hist->buckets[b] == 0) {
+            continue;
+        }
+        // Log-scaled bar so single outliers stay visible next to the bulk
+        int bar = 1;
+        for (uint32_t n = hist->buckets[b]; n > 1 && bar < 40; n >>= 1) {
+            bar += 2;
+        }
+        fprintf(out, "  <=%10" PRIu32 " ns %10" PRIu32 " %.*s\n", bucket_upper(b), hist->buckets[b], bar,
+                "########################################");
+    }
+}
+
+const char* grove_aqs_wcet_scenario_name(grove_aqs_wcet_scenario_t scenario) {
+    return scenario < GROVE_AQS_WCET_SCENARIO_COUNT ? scenario_names[scenario] : "unknown";
+}
+
+/* ---- Harness ---- */
+
+/* Raw values one LSB below, at and above every threshold, plus both rails */
+static size_t hover_inputs(const grove_aqs_core_params_t *params, int *raw) {
+    size_t n = 0;
+    raw[n++] = 0;
+    for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+        int edge = (params->thresholds[t] * GROVE_AQS_ADC_MAX_RAW + params->vref - 1) / params->vref;
+        for (int d = -1; d <= 1; d++) {
+            int v = edge + d;
+            raw[n++] = v < 0 ? 0 : v > GROVE_AQS_ADC_MAX_RAW ? GROVE_AQS_ADC_MAX_RAW : v;
+        }
+    }
+    raw[n++] = GROVE_AQS_ADC_MAX_RAW;
+    return n;
+}
+
+esp_err_t grove_aqs_wcet_run(const grove_aqs_wcet_config_t *config, grove_aqs_wcet_result_t *result) {
+    if (config == NULL || result == NULL || config->op == NULL || config->params == NULL) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int inputs[2 + 3 * (GROVE_AQS_QUALITY_LEVEL_COUNT - 1)];
+    size_t input_count = hover_inputs(config->params, inputs);
+
+    esp_err_t ret = evict_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up cache eviction: %d", ret);
+        return ret;
+    }
+
+    memset(result, 0, sizeof(*result));
+    for (int s = 0; s < GROVE_AQS_WCET_SCENARIO_COUNT; s++) {
+        grove_aqs_wcet_hist_t *hist = &result->hist[s];
+        grove_aqs_wcet_hist_reset(hist);
+
+        uint32_t iterations = config->iterations;
+        if (s == GROVE_AQS_WCET_COLD && iterations > COLD_MAX_ITERATIONS) {
+            iterations = COLD_MAX_ITERATIONS;
+        }
+        if (s != GROVE_AQS_WCET_COLD) {
+            for (uint32_t i = 0; i < WARMUP_ITERATIONS; i++) {
+                config->op(config->ctx, inputs[i % input_count], false);
+            }
+        }
+
+        // RETRY: the worst case of a retry policy is every attempt but the last failing
+        uint32_t failing = s == GROVE_AQS_WCET_RETRY ? config->retries : 0u;
+        for (uint32_t i = 0; i < iterations; i++) {
+            int raw = inputs[i % input_count];
+            if (s == GROVE_AQS_WCET_COLD) {
+                evict();
+            }
+
+            uint32_t a = 0;
+            esp_err_t op_ret;
+            stamp_t start = stamp();
+            do {
+                op_ret = config->op(config->ctx, raw, a < failing);
+            } while (op_ret != ESP_OK && a++ < failing);
+            uint32_t ns = elapsed_ns(start, stamp());
+
+            if (a < failing) {
+                evict_deinit();
+                ESP_LOGE(TAG, "Operation succeeded on attempt %u of %u that was to fail",
+                         (unsigned)a + 1, (unsigned)failing + 1);
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            grove_aqs_wcet_hist_add(hist, ns);
+        }
+        if (hist->max_ns > result->worst_ns) {
+            result->worst_ns = hist->max_ns;
+        }
+    }
+    evict_deinit();
+
+    if (result->worst_ns > config->budget_ns) {
+        ESP_LOGE(TAG, "Worst case %u ns exceeds the budget of %u ns",
+                 (unsigned)result->worst_ns, (unsigned)config->budget_ns);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
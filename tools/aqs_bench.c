@@ -0,0 +1,2452 @@
+/**
+ * @file aqs_bench.c
+ * @brief Host (Linux) benchmarks for the platform-independent parts of the component
+ *
+ * Usage: aqs_bench <benchmark> [options]
+ *   core [samples]                Conversion and classification throughput
+ *   journal [samples] [sectors]   Append throughput, compression, mount and seek time
+ *   boot                          Mount time and range aggregates vs history size
+ *   query [sectors]               Hourly points over the last week: query engine vs client side
+ *   mmap [sectors]                Query and export speed with and without the read-only mapping
+ *   dlog [lines] [file]           Per-log-site cost: formatting vs deferred record; optionally
+ *                                 writes the records as a stream for aqs_dlog_decode
+ *   trace [samples] [out.json]    Sampler/processing/consumer threads traced to Chrome trace JSON
+ *                                 (needs -DGROVE_AQS_TRACE=ON)
+ *   retain [iterations]           State handoff through a simulated retained region across a
+ *                                 process "reboot", rejection of bad blocks, store/load cost
+ *   wake [days]                   Wake stub decisions at one sample per minute: full boots vs
+ *                                 stub-only wakes, with and without hysteresis
+ *   energy [days]                 Energy per reading and battery life of sampling strategies,
+ *                                 driven through the energy accounting in virtual time
+ *   heater [samples]              Classification at reduced PWM heater duty with and without the
+ *                                 heater gain, also when the sensor deviates from the model
+ *   profile [cycles]              Heater profile cycling against a simulated sensor in virtual
+ *                                 time: phase alignment, repeatability, gas selectivity, ring
+ *   lockin [trials]               Lock-in demodulation vs DC readings on synthetic signals with
+ *                                 drift and noise: SNR of a small response change, kernel cost
+ *   classify [windows] [model.bin] Int8 MLP trained on synthetic smoke/solvent/clean windows:
+ *                                 accuracy vs float and thresholds, latency per window;
+ *                                 optionally writes the model blob
+ *   ppm [samples]                 Rs/R0 concentration estimate: table log2/exp2 accuracy, fixed
+ *                                 point vs float over all voltages, cost per estimate
+ *   calibrate [units]             Two-point calibration of a simulated fleet against a reference
+ *                                 unit: error and level agreement, per-sample cost
+ *   config [iterations]           Config blob round trip, rejection of corrupted, truncated and
+ *                                 invalid blobs, skipping of unknown sections, parse cost
+ *   preset [days]                 Schedule lookup against minute-by-minute replay of random weekly
+ *                                 schedules, preset switch cost vs re-deriving the constants, no
+ *                                 mixed constants under random selects, defines and rebases
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "grove_aqs_classify.h"
+#include "grove_aqs_config_blob.h"
+#include "grove_aqs_core.h"
+#include "grove_aqs_dlog.h"
+#include "grove_aqs_dlog_table.h"
+#include "grove_aqs_energy.h"
+#include "grove_aqs_history.h"
+#include "grove_aqs_lockin.h"
+#include "grove_aqs_live.h"
+#include "grove_aqs_ppm.h"
+#include "grove_aqs_preset.h"
+#include "grove_aqs_profile.h"
+#include "grove_aqs_retain.h"
+#include "grove_aqs_trace.h"
+#include "grove_aqs_wake.h"
+
+#define SECTOR_SIZE 4096
+#define BENCH_FILE "aqs_bench_history.bin"
+#define RETAIN_FILE "aqs_bench_retain.bin"
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int check(bool ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/* Sample i of the synthetic series at a given voltage */
+static void synth_fill(uint32_t i, int mv, grove_aqs_history_sample_t *s) {
+    s->timestamp = 1700000000u + i * 10u;
+    s->voltage_mv = (uint16_t)mv;
+    s->raw_value = (uint16_t)(mv * 4095 / 3300);
+    s->quality = mv <= 700 ? 0 : mv <= 1000 ? 1 : mv <= 1500 ? 2 : mv <= 2000 ? 3 : 4;
+}
+
+/* Slowly drifting sensor voltage with noise, sampled every 10 s */
+static void synth_sample(uint32_t i, grove_aqs_history_sample_t *s) {
+    static int mv = 800;
+    mv += (rand() % 21) - 10;
+    if (mv < 300) mv = 300;
+    if (mv > 2600) mv = 2600;
+    synth_fill(i, mv, s);
+}
+
+/* Storage read counter, wrapped around the file backend */
+static esp_err_t (*file_read)(void *ctx, size_t offset, void *dst, size_t len);
+static uint32_t read_calls;
+static bool disable_mapping;
+
+static esp_err_t counting_read(void *ctx, size_t offset, void *dst, size_t len) {
+    read_calls++;
+    return file_read(ctx, offset, dst, len);
+}
+
+static int open_history(uint32_t sectors) {
+    grove_aqs_history_config_t config = GROVE_AQS_HISTORY_DEFAULT_CONFIG();
+    config.batch_size = GROVE_AQS_HISTORY_MAX_BATCH;
+    if (grove_aqs_storage_open_file(BENCH_FILE, (size_t)sectors * SECTOR_SIZE, SECTOR_SIZE,
+                                    &config.storage) != ESP_OK) {
+        return -1;
+    }
+    file_read = config.storage.read;
+    config.storage.read = counting_read;
+    if (disable_mapping) {
+        config.storage.mapped = NULL;
+    }
+    return grove_aqs_history_init(&config) == ESP_OK ? 0 : -1;
+}
+
+static int bench_core(int argc, char **argv) {
+    uint32_t samples = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 10000000;
+
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, 3300, 700, 1000, 1500, 2000);
+
+    // Pre-generated noisy raw readings so the loop measures only the core
+    enum { RAW_COUNT = 4096 };
+    static int raw[RAW_COUNT];
+    for (int i = 0; i < RAW_COUNT; i++) {
+        raw[i] = rand() % (GROVE_AQS_ADC_MAX_RAW + 1);
+    }
+
+    uint32_t histogram[GROVE_AQS_QUALITY_LEVEL_COUNT] = {0};
+    double t0 = now_us();
+    for (uint32_t i = 0; i < samples; i++) {
+        int mv = grove_aqs_core_raw_to_mv(&params, raw[i % RAW_COUNT]);
+        histogram[grove_aqs_core_classify(&params, mv)]++;
+    }
+    double us = now_us() - t0;
+
+    printf("core: %u samples\n", samples);
+    printf("  convert+classify: %.2f ns/sample\n", us * 1000.0 / samples);
+    for (int q = 0; q < GROVE_AQS_QUALITY_LEVEL_COUNT; q++) {
+        printf("  %-10s %u\n", grove_aqs_quality_to_string((grove_aqs_quality_t)q), histogram[q]);
+    }
+    return 0;
+}
+
+/*
+ * Reads the whole history back: it must be the newest stretch of the appended
+ * series (voltages in mv), without gaps and up to the last sample
+ */
+static bool history_recovered(const uint16_t *mv, uint32_t appended, size_t *stored) {
+    grove_aqs_history_cursor_t cursor;
+    grove_aqs_history_sample_t out[GROVE_AQS_HISTORY_MAX_BATCH];
+    size_t count;
+    uint32_t next = 0;
+    bool ok = true;
+    *stored = 0;
+    grove_aqs_history_seek(0, &cursor);
+    while (grove_aqs_history_read(&cursor, out, GROVE_AQS_HISTORY_MAX_BATCH, &count) == ESP_OK) {
+        for (size_t k = 0; k < count && ok; k++) {
+            uint32_t i = (out[k].timestamp - 1700000000u) / 10u;
+            grove_aqs_history_sample_t e = { 0 };
+            if (i < appended) {
+                synth_fill(i, mv[i], &e);
+            }
+            ok = i < appended && (*stored == 0 || i == next) && out[k].timestamp == e.timestamp &&
+                 out[k].voltage_mv == e.voltage_mv && out[k].raw_value == e.raw_value && out[k].quality == e.quality;
+            next = i + 1;
+            (*stored)++;
+        }
+    }
+    return ok && *stored > 0 && next == appended;
+}
+
+static int bench_journal(int argc, char **argv) {
+    uint32_t samples = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 200000;
+    uint32_t sectors = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 256;
+
+    unlink(BENCH_FILE);
+    if (open_history(sectors) != 0) {
+        fprintf(stderr, "failed to open history\n");
+        return 1;
+    }
+
+    uint16_t *mv = malloc(samples * sizeof(*mv));
+    if (mv == NULL) {
+        return 1;
+    }
+    grove_aqs_history_sample_t s;
+    double t0 = now_us();
+    for (uint32_t i = 0; i < samples; i++) {
+        synth_sample(i, &s);
+        grove_aqs_history_append(&s);
+        mv[i] = s.voltage_mv;
+    }
+    grove_aqs_history_flush();
+    double append_us = now_us() - t0;
+
+    grove_aqs_history_info_t info;
+    grove_aqs_history_get_info(&info);
+    grove_aqs_history_deinit();
+
+    t0 = now_us();
+    open_history(sectors);
+    double mount_us = now_us() - t0;
+
+    // Count what survived the ring and time a seek into the middle of it
+    grove_aqs_history_get_info(&info);
+    uint32_t target = info.oldest_timestamp + (info.newest_timestamp - info.oldest_timestamp) / 2;
+    grove_aqs_history_cursor_t cursor;
+    t0 = now_us();
+    grove_aqs_history_seek(target, &cursor);
+    double seek_us = now_us() - t0;
+
+    grove_aqs_history_sample_t out[GROVE_AQS_HISTORY_MAX_BATCH];
+    size_t count;
+    size_t stored = 0;
+    grove_aqs_history_seek(0, &cursor);
+    t0 = now_us();
+    while (grove_aqs_history_read(&cursor, out, GROVE_AQS_HISTORY_MAX_BATCH, &count) == ESP_OK) {
+        stored += count;
+    }
+    double read_us = now_us() - t0;
+    size_t recovered;
+    bool intact = history_recovered(mv, samples, &recovered);
+    grove_aqs_history_deinit();
+    free(mv);
+
+    double bytes = (double)info.sectors_used * SECTOR_SIZE;
+    printf("journal: %u samples into %u sectors\n", samples, sectors);
+    printf("  append:   %.3f us/sample\n", append_us / samples);
+    printf("  stored:   %zu samples in %u sectors (%.2f bytes/sample, raw %zu)\n",
+           stored, info.sectors_used, bytes / (double)stored, sizeof(grove_aqs_history_sample_t));
+    printf("  mount:    %.1f us\n", mount_us);
+    printf("  seek:     %.1f us\n", seek_us);
+    printf("  read all: %.3f us/sample\n", read_us / (double)stored);
+    int failures = check(intact && recovered == stored, "remount: newest samples intact, no gap");
+    unlink(BENCH_FILE);
+    return failures == 0 ? 0 : 1;
+}
+
+static int bench_boot(void) {
+    static const uint32_t sizes[] = { 16, 64, 256, 1024, 4096 };
+
+    // Reads are counted at the backend, so keep the copying path
+    disable_mapping = true;
+    printf("boot: full ring, 10 s sample period, unmapped\n");
+    printf("%8s %10s %8s %10s %8s %12s %10s %12s %10s\n", "sectors", "samples", "days",
+           "mount_us", "reads", "week_agg_us", "reads", "week_dec_us", "reads");
+
+    uint16_t *mv = malloc(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1] * (SECTOR_SIZE / 3) * sizeof(*mv));
+    if (mv == NULL) {
+        return 1;
+    }
+    uint32_t damaged = 0, agg_wrong = 0;
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        uint32_t sectors = sizes[k];
+        unlink(BENCH_FILE);
+        if (open_history(sectors) != 0) {
+            fprintf(stderr, "failed to open history\n");
+            free(mv);
+            return 1;
+        }
+
+        // Fill the ring completely and wrap a little
+        grove_aqs_history_sample_t s;
+        uint32_t total = sectors * (SECTOR_SIZE / 3);
+        for (uint32_t i = 0; i < total; i++) {
+            synth_sample(i, &s);
+            grove_aqs_history_append(&s);
+            mv[i] = s.voltage_mv;
+        }
+        grove_aqs_history_deinit();
+
+        const int mounts = 20;
+        double t0 = now_us();
+        for (int m = 0; m < mounts; m++) {
+            open_history(sectors);
+            if (m + 1 < mounts) {
+                grove_aqs_history_deinit();
+            }
+        }
+        double mount_us = (now_us() - t0) / mounts;
+        read_calls = 0;
+        grove_aqs_history_deinit();
+        open_history(sectors);
+        uint32_t mount_reads = read_calls;
+
+        grove_aqs_history_info_t info;
+        grove_aqs_history_get_info(&info);
+        uint32_t week_start = info.newest_timestamp > 7 * 86400 ? info.newest_timestamp - 7 * 86400 : 0;
+        if (week_start < info.oldest_timestamp) {
+            week_start = info.oldest_timestamp;
+        }
+
+        // Mean over the last week, from stored aggregates
+        read_calls = 0;
+        t0 = now_us();
+        grove_aqs_history_agg_t agg;
+        grove_aqs_history_aggregate(week_start, info.newest_timestamp + 1, &agg);
+        double agg_us = now_us() - t0;
+        uint32_t agg_reads = read_calls;
+
+        // Same by decompressing every sample in the week
+        read_calls = 0;
+        t0 = now_us();
+        grove_aqs_history_cursor_t cursor;
+        grove_aqs_history_sample_t out[GROVE_AQS_HISTORY_MAX_BATCH];
+        size_t count;
+        uint64_t decoded = 0;
+        grove_aqs_history_seek(week_start, &cursor);
+        while (grove_aqs_history_read(&cursor, out, GROVE_AQS_HISTORY_MAX_BATCH, &count) == ESP_OK) {
+            decoded += count;
+        }
+        double decode_us = now_us() - t0;
+        uint32_t decode_reads = read_calls;
+
+        // What the last mount recovered: the newest samples, and the week's aggregate over them
+        size_t stored;
+        damaged += !history_recovered(mv, total, &stored);
+        uint64_t sum_mv = 0;
+        uint32_t first = (week_start - 1700000000u + 9) / 10;
+        for (uint32_t i = first; i < total; i++) {
+            sum_mv += mv[i];
+        }
+        agg_wrong += agg.count != total - first || agg.sum_mv != sum_mv;
+        grove_aqs_history_deinit();
+
+        uint32_t span = info.newest_timestamp - info.oldest_timestamp;
+        printf("%8u %10u %8.1f %10.1f %8u %12.1f %10u %12.1f %10u\n", sectors, span / 10, span / 86400.0,
+               mount_us, mount_reads, agg_us, agg_reads, decode_us, decode_reads);
+        (void)decoded;
+    }
+    free(mv);
+    disable_mapping = false;
+    unlink(BENCH_FILE);
+
+    int failures = 0;
+    failures += check(damaged == 0, "remount: newest samples intact, no gap");
+    failures += check(agg_wrong == 0, "remount: week aggregate matches the samples");
+    return failures == 0 ? 0 : 1;
+}
+
+static int bench_query(int argc, char **argv) {
+    uint32_t sectors = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 1024;
+
+    unlink(BENCH_FILE);
+    if (open_history(sectors) != 0) {
+        fprintf(stderr, "failed to open history\n");
+        return 1;
+    }
+    grove_aqs_history_sample_t s;
+    uint32_t total = sectors * (SECTOR_SIZE / 4);
+    for (uint32_t i = 0; i < total; i++) {
+        synth_sample(i, &s);
+        // An hour of smoke and a half hour of solvent verdicts a day, partly across bucket edges
+        uint32_t minute = (i / 6) % (24 * 60);
+        if (minute >= 5 * 60 + 20 && minute < 6 * 60 + 20) {
+            s.quality = GROVE_AQS_QUALITY_SMOKE;
+        } else if (minute >= 14 * 60 + 40 && minute < 15 * 60 + 10) {
+            s.quality = GROVE_AQS_QUALITY_SOLVENT;
+        }
+        grove_aqs_history_append(&s);
+    }
+    grove_aqs_history_flush();
+
+    grove_aqs_history_info_t info;
+    grove_aqs_history_get_info(&info);
+    uint32_t end = info.newest_timestamp + 1;
+    uint32_t start = end - 7 * 86400;
+    static grove_aqs_history_point_t points[GROVE_AQS_HISTORY_AGG_DWELL + 1][7 * 24];
+    static const char *names[] = { "mean", "min", "max", "dwell" };
+
+    printf("query: hourly points over the last week, %u sectors\n", sectors);
+    for (int agg = GROVE_AQS_HISTORY_AGG_MEAN; agg <= GROVE_AQS_HISTORY_AGG_DWELL; agg++) {
+        size_t count;
+        read_calls = 0;
+        double t0 = now_us();
+        grove_aqs_history_query(start, end, 3600, (grove_aqs_history_agg_type_t)agg, points[agg], 7 * 24, &count);
+        double us = now_us() - t0;
+        printf("  engine %-5s: %8.1f us, %5u reads, %zu points (%zu bytes)\n", names[agg], us, read_calls,
+               count, count * sizeof(grove_aqs_history_point_t));
+    }
+
+    // Client side: fetch every raw sample in the range and bucket them
+    read_calls = 0;
+    double t0 = now_us();
+    grove_aqs_history_cursor_t cursor;
+    grove_aqs_history_sample_t out[GROVE_AQS_HISTORY_MAX_BATCH];
+    size_t count;
+    size_t raw = 0;
+    uint64_t sum[7 * 24] = {0};
+    uint32_t n[7 * 24] = {0};
+    grove_aqs_history_seek(start, &cursor);
+    while (grove_aqs_history_read(&cursor, out, GROVE_AQS_HISTORY_MAX_BATCH, &count) == ESP_OK) {
+        for (size_t i = 0; i < count; i++) {
+            if (out[i].timestamp >= start && out[i].timestamp < end) {
+                size_t b = (out[i].timestamp - start) / 3600;
+                sum[b] += out[i].voltage_mv;
+                n[b]++;
+                raw++;
+            }
+        }
+    }
+    double us = now_us() - t0;
+    printf("  client mean : %8.1f us, %5u reads, %zu raw samples (%zu bytes)\n", us, read_calls,
+           raw, raw * sizeof(grove_aqs_history_sample_t));
+
+    // The engine's points must be what the raw samples give, for every aggregate
+    static grove_aqs_history_agg_t expect[7 * 24];
+    memset(expect, 0, sizeof(expect));
+    grove_aqs_history_seek(start, &cursor);
+    while (grove_aqs_history_read(&cursor, out, GROVE_AQS_HISTORY_MAX_BATCH, &count) == ESP_OK) {
+        for (size_t i = 0; i < count; i++) {
+            if (out[i].timestamp < start || out[i].timestamp >= end) {
+                continue;
+            }
+            grove_aqs_history_agg_t *e = &expect[(out[i].timestamp - start) / 3600];
+            if (e->count++ == 0) {
+                e->first_timestamp = out[i].timestamp;
+                e->min_mv = e->max_mv = out[i].voltage_mv;
+            }
+            e->last_timestamp = out[i].timestamp;
+            e->min_mv = out[i].voltage_mv < e->min_mv ? out[i].voltage_mv : e->min_mv;
+            e->max_mv = out[i].voltage_mv > e->max_mv ? out[i].voltage_mv : e->max_mv;
+            e->quality_count[out[i].quality]++;
+        }
+    }
+    uint32_t mismatched[GROVE_AQS_HISTORY_AGG_DWELL + 1] = { 0 };
+    uint32_t dwell_short = 0;
+    grove_aqs_history_agg_t week_expect = { 0 };
+    for (size_t b = 0; b < 7 * 24; b++) {
+        for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+            week_expect.quality_count[q] += expect[b].quality_count[q];
+        }
+        // Every sample contributes one mean interval, so the dwell times cover the whole bucket
+        if (n[b] > 1) {
+            uint32_t span = expect[b].last_timestamp - expect[b].first_timestamp;
+            uint32_t covered = (uint32_t)((uint64_t)n[b] * span / (n[b] - 1));
+            uint32_t dwell = 0;
+            for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+                dwell += points[GROVE_AQS_HISTORY_AGG_DWELL][b].dwell_s[q];
+            }
+            dwell_short += dwell > covered || covered - dwell >= GROVE_AQS_HISTORY_QUALITY_LEVELS;
+        }
+        for (int agg = GROVE_AQS_HISTORY_AGG_MEAN; agg <= GROVE_AQS_HISTORY_AGG_DWELL; agg++) {
+            const grove_aqs_history_point_t *p = &points[agg][b];
+            const grove_aqs_history_agg_t *e = &expect[b];
+            bool ok = p->count == n[b] && e->count == n[b];
+            if (ok && n[b] > 0) {
+                switch (agg) {
+                    case GROVE_AQS_HISTORY_AGG_MEAN:
+                        ok = p->value_mv == sum[b] / n[b];
+                        break;
+                    case GROVE_AQS_HISTORY_AGG_MIN:
+                        ok = p->value_mv == e->min_mv;
+                        break;
+                    case GROVE_AQS_HISTORY_AGG_MAX:
+                        ok = p->value_mv == e->max_mv;
+                        break;
+                    default:
+                        for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+                            uint32_t span = e->last_timestamp - e->first_timestamp;
+                            uint32_t dwell = n[b] > 1 ? (uint32_t)((uint64_t)e->quality_count[q] * span / (n[b] - 1)) : 0;
+                            ok &= p->dwell_s[q] == dwell;
+                        }
+                        break;
+                }
+            }
+            mismatched[agg] += !ok;
+        }
+    }
+
+    int failures = 0;
+    char what[48];
+    for (int agg = GROVE_AQS_HISTORY_AGG_MEAN; agg <= GROVE_AQS_HISTORY_AGG_DWELL; agg++) {
+        snprintf(what, sizeof(what), "%s matches the raw samples", names[agg]);
+        failures += check(mismatched[agg] == 0, what);
+    }
+    failures += check(dwell_short == 0, "dwell covers every bucket");
+
+    // Classifier verdicts are counted in the stored aggregates like the levels
+    grove_aqs_history_agg_t week;
+    grove_aqs_history_aggregate(start, end, &week);
+    bool counted = week_expect.quality_count[GROVE_AQS_QUALITY_SMOKE] > 0 &&
+                   week_expect.quality_count[GROVE_AQS_QUALITY_SOLVENT] > 0;
+    for (int q = 0; q < GROVE_AQS_HISTORY_QUALITY_LEVELS; q++) {
+        counted &= week.quality_count[q] == week_expect.quality_count[q];
+    }
+    failures += check(counted, "week counts include smoke and solvent");
+
+    grove_aqs_history_deinit();
+    unlink(BENCH_FILE);
+    return failures == 0 ? 0 : 1;
+}
+
+static int bench_mmap(int argc, char **argv) {
+    uint32_t sectors = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 1024;
+
+    unlink(BENCH_FILE);
+    if (open_history(sectors) != 0) {
+        fprintf(stderr, "failed to open history\n");
+        return 1;
+    }
+    grove_aqs_history_sample_t s;
+    uint32_t total = sectors * (SECTOR_SIZE / 4);
+    for (uint32_t i = 0; i < total; i++) {
+        synth_sample(i, &s);
+        grove_aqs_history_append(&s);
+    }
+    grove_aqs_history_deinit();
+
+    printf("mmap: %u sectors\n", sectors);
+    for (int pass = 0; pass < 2; pass++) {
+        disable_mapping = pass == 0;
+        open_history(sectors);
+
+        grove_aqs_history_info_t info;
+        grove_aqs_history_get_info(&info);
+        uint32_t end = info.newest_timestamp + 1;
+        uint32_t start = end - 7 * 86400;
+        static grove_aqs_history_point_t points[7 * 24];
+        size_t count;
+
+        read_calls = 0;
+        double t0 = now_us();
+        for (int r = 0; r < 10; r++) {
+            grove_aqs_history_query(start, end, 3600, GROVE_AQS_HISTORY_AGG_MEAN, points, 7 * 24, &count);
+        }
+        double query_us = (now_us() - t0) / 10;
+        uint32_t query_reads = read_calls / 10;
+
+        grove_aqs_history_cursor_t cursor;
+        grove_aqs_history_sample_t out[GROVE_AQS_HISTORY_MAX_BATCH];
+        size_t exported = 0;
+        read_calls = 0;
+        t0 = now_us();
+        grove_aqs_history_seek(0, &cursor);
+        while (grove_aqs_history_read(&cursor, out, GROVE_AQS_HISTORY_MAX_BATCH, &count) == ESP_OK) {
+            exported += count;
+        }
+        double export_us = now_us() - t0;
+
+        printf("  %-7s hourly week query %8.1f us (%5u backend reads), export %zu samples %9.1f us (%6u backend reads)\n",
+               pass == 0 ? "copy" : "mapped", query_us, query_reads, exported, export_us, read_calls);
+        grove_aqs_history_deinit();
+    }
+    disable_mapping = false;
+    unlink(BENCH_FILE);
+    return 0;
+}
+
+static void stream_sink(void *ctx, const grove_aqs_dlog_record_t *record) {
+    FILE *out = ctx;
+    if (out != NULL) {
+        fwrite(record, sizeof(*record), 1, out);
+    }
+}
+
+static int bench_dlog(int argc, char **argv) {
+    uint32_t lines = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 1000000;
+    FILE *out = NULL;
+    if (argc > 1) {
+        out = fopen(argv[1], "wb");
+        if (out == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+        grove_aqs_dlog_stream_header_t header;
+        grove_aqs_dlog_stream_header(&header);
+        fwrite(&header, sizeof(header), 1, out);
+    }
+
+    // Before: what ESP_LOGI spends formatting the reading line (UART output not included)
+    char line[128];
+    volatile size_t sink_len = 0;
+    double t0 = now_us();
+    for (uint32_t i = 0; i < lines; i++) {
+        int raw = (int)(i & GROVE_AQS_ADC_MAX_RAW);
+        sink_len += (size_t)snprintf(line, sizeof(line), "I (%u) %s: Air quality reading: Raw=%d, Voltage=%dmV, Quality=%s\n",
+                                     i, "grove_aqs", raw, raw * 3300 / 4095,
+                                     grove_aqs_quality_to_string((grove_aqs_quality_t)(i % 5)));
+    }
+    double format_us = now_us() - t0;
+
+    // After: the deferred site, drained in ring-sized chunks outside the timed section
+    double write_us = 0;
+    double drain_us = 0;
+    uint32_t done = 0;
+    while (done < lines) {
+        uint32_t chunk = lines - done < CONFIG_GROVE_AQS_DLOG_RING_SIZE ? lines - done : CONFIG_GROVE_AQS_DLOG_RING_SIZE;
+        t0 = now_us();
+        for (uint32_t i = done; i < done + chunk; i++) {
+            int raw = (int)(i & GROVE_AQS_ADC_MAX_RAW);
+            const int32_t args[] = { raw, raw * 3300 / 4095, (int32_t)(i % 5) };
+            grove_aqs_dlog_write('I', GROVE_AQS_DLOG_ID_READING, 3, args);
+        }
+        double t1 = now_us();
+        grove_aqs_dlog_drain(stream_sink, out, SIZE_MAX);
+        drain_us += now_us() - t1;
+        write_us += t1 - t0;
+        done += chunk;
+    }
+
+    printf("log site        %8.1f ns/line formatted\n", format_us * 1e3 / lines);
+    printf("deferred site   %8.1f ns/line (%zu byte records)\n", write_us * 1e3 / lines,
+           sizeof(grove_aqs_dlog_record_t));
+    printf("drain           %8.1f ns/line%s\n", drain_us * 1e3 / lines, out != NULL ? " (incl. file write)" : "");
+    printf("dropped         %8u\n", grove_aqs_dlog_dropped());
+    if (out != NULL) {
+        fclose(out);
+    }
+    return 0;
+}
+
+#if CONFIG_GROVE_AQS_TRACE
+/* Host stand-in for the usual task split: sampler -> processing -> consumer */
+typedef struct {
+    pthread_mutex_t lock;            // Guards the queue and the (single-threaded) history
+    pthread_cond_t ready;
+    grove_aqs_history_sample_t queue[64];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t samples;
+    bool done;
+} sim_t;
+
+enum { SIM_STAGE_PROCESSING = 1, SIM_STAGE_CONSUMER = 2 };
+
+static void *sim_sampler(void *arg) {
+    sim_t *sim = arg;
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, 3300, 700, 1000, 1500, 2000);
+
+    for (uint32_t i = 0; i < sim->samples; i++) {
+        grove_aqs_history_sample_t sample;
+        GROVE_AQS_TRACE_BEGIN(GROVE_AQS_TRACE_CONVERSION, i);
+        synth_sample(i, &sample);
+        sample.voltage_mv = (uint16_t)grove_aqs_core_raw_to_mv(&params, sample.raw_value);
+        sample.quality = (uint8_t)grove_aqs_core_classify(&params, sample.voltage_mv);
+        GROVE_AQS_TRACE_END(GROVE_AQS_TRACE_CONVERSION, sample.raw_value);
+
+        pthread_mutex_lock(&sim->lock);
+        while (sim->head - sim->tail == 64) {
+            pthread_mutex_unlock(&sim->lock);
+            usleep(100);
+            pthread_mutex_lock(&sim->lock);
+        }
+        sim->queue[sim->head++ % 64] = sample;
+        GROVE_AQS_TRACE_INSTANT(GROVE_AQS_TRACE_BATCH_HANDOFF, sim->head - sim->tail);
+        pthread_cond_signal(&sim->ready);
+        pthread_mutex_unlock(&sim->lock);
+        usleep(50);
+    }
+
+    pthread_mutex_lock(&sim->lock);
+    sim->done = true;
+    pthread_cond_broadcast(&sim->ready);
+    pthread_mutex_unlock(&sim->lock);
+    return NULL;
+}
+
+static void *sim_processing(void *arg) {
+    sim_t *sim = arg;
+    pthread_mutex_lock(&sim->lock);
+    for (;;) {
+        while (sim->head == sim->tail && !sim->done) {
+            pthread_cond_wait(&sim->ready, &sim->lock);
+        }
+        if (sim->head == sim->tail) {
+            break;
+        }
+        GROVE_AQS_TRACE_INSTANT(GROVE_AQS_TRACE_CONSUMER_WAKE, SIM_STAGE_PROCESSING);
+        while (sim->head != sim->tail) {
+            grove_aqs_history_append(&sim->queue[sim->tail++ % 64]);
+        }
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return NULL;
+}
+
+static void *sim_consumer(void *arg) {
+    sim_t *sim = arg;
+    grove_aqs_history_point_t points[60];
+    size_t count;
+
+    for (;;) {
+        usleep(20000);
+        pthread_mutex_lock(&sim->lock);
+        if (sim->done && sim->head == sim->tail) {
+            pthread_mutex_unlock(&sim->lock);
+            break;
+        }
+        GROVE_AQS_TRACE_INSTANT(GROVE_AQS_TRACE_CONSUMER_WAKE, SIM_STAGE_CONSUMER);
+        grove_aqs_history_info_t info;
+        grove_aqs_history_get_info(&info);
+        if (info.newest_timestamp > 3600) {
+            // Last hour in one-minute points
+            grove_aqs_history_query(info.newest_timestamp - 3600, info.newest_timestamp, 60,
+                                    GROVE_AQS_HISTORY_AGG_MEAN, points, 60, &count);
+        }
+        pthread_mutex_unlock(&sim->lock);
+    }
+    return NULL;
+}
+#endif /* CONFIG_GROVE_AQS_TRACE */
+
+static int bench_trace(int argc, char **argv) {
+#if CONFIG_GROVE_AQS_TRACE
+    uint32_t samples = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 20000;
+    const char *path = argc > 1 ? argv[1] : "aqs_trace.json";
+
+    unlink(BENCH_FILE);
+    grove_aqs_trace_start();
+    if (open_history(64) != 0) {
+        fprintf(stderr, "failed to open history\n");
+        return 1;
+    }
+
+    sim_t sim = { .samples = samples };
+    pthread_mutex_init(&sim.lock, NULL);
+    pthread_cond_init(&sim.ready, NULL);
+    pthread_t threads[3];
+    pthread_create(&threads[0], NULL, sim_sampler, &sim);
+    pthread_create(&threads[1], NULL, sim_processing, &sim);
+    pthread_create(&threads[2], NULL, sim_consumer, &sim);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    grove_aqs_trace_stop();
+    grove_aqs_history_deinit();
+    unlink(BENCH_FILE);
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+    esp_err_t ret = grove_aqs_trace_export_json(out);
+    fclose(out);
+    printf("wrote %s (open in chrome://tracing or ui.perfetto.dev)\n", path);
+    return ret == ESP_OK ? 0 : 1;
+#else
+    (void)argc;
+    (void)argv;
+    fprintf(stderr, "trace points are compiled out, configure with -DGROVE_AQS_TRACE=ON\n");
+    return 1;
+#endif
+}
+
+/* History with the default batch size, so its pending samples fit the retained block */
+static int open_history_default(uint32_t sectors) {
+    grove_aqs_history_config_t config = GROVE_AQS_HISTORY_DEFAULT_CONFIG();
+    if (grove_aqs_storage_open_file(BENCH_FILE, (size_t)sectors * SECTOR_SIZE, SECTOR_SIZE,
+                                    &config.storage) != ESP_OK) {
+        return -1;
+    }
+    return grove_aqs_history_init(&config) == ESP_OK ? 0 : -1;
+}
+
+static int bench_retain(int argc, char **argv) {
+    uint32_t iterations = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 100000;
+    const uint32_t appended = 3 * CONFIG_GROVE_AQS_HISTORY_BATCH_SIZE / 2;
+
+    // The retained region is a shared file mapping: it outlives the process like RTC memory outlives a boot
+    unlink(RETAIN_FILE);
+    unlink(BENCH_FILE);
+    int fd = open(RETAIN_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(grove_aqs_retain_block_t)) != 0) {
+        perror(RETAIN_FILE);
+        return 1;
+    }
+    void *region = mmap(NULL, sizeof(grove_aqs_retain_block_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED || grove_aqs_retain_set_region(region, sizeof(grove_aqs_retain_block_t)) != ESP_OK) {
+        perror("mmap");
+        return 1;
+    }
+
+    printf("retain: %u byte block, %u pending samples max\n",
+           (unsigned)sizeof(grove_aqs_retain_block_t), (unsigned)GROVE_AQS_RETAIN_MAX_SAMPLES);
+    grove_aqs_retain_state_t state;
+    int failures = check(grove_aqs_retain_load(&state) == ESP_ERR_NOT_FOUND, "cold boot: no block");
+
+    // First boot: sample until a batch is half full, save and "sleep"
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (open_history_default(16) != 0) {
+            _exit(1);
+        }
+        grove_aqs_history_sample_t s;
+        for (uint32_t i = 0; i < appended; i++) {
+            synth_sample(i, &s);
+            grove_aqs_history_append(&s);
+        }
+        memset(&state, 0, sizeof(state));
+        size_t count;
+        grove_aqs_history_get_pending(state.pending, GROVE_AQS_RETAIN_MAX_SAMPLES, &count);
+        state.pending_count = (uint16_t)count;
+        state.driver = (grove_aqs_retain_driver_t){
+            .config_hash = 0x1234, .stage_cost_us = { 45, 12, 3, 20 }, .have_last = 1,
+            .track = { .filtered_q8 = s.voltage_mv << 8, .level = (grove_aqs_quality_t)s.quality, .primed = true },
+            .last_raw = s.raw_value, .last_mv = s.voltage_mv, .last_quality = s.quality,
+        };
+        _exit(grove_aqs_retain_store(&state) == ESP_OK ? 0 : 1);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    failures += check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "first boot: stored state");
+
+    // Next boot: restore the driver state and put the pending samples back into the history
+    double t0 = now_us();
+    esp_err_t ret = grove_aqs_retain_load(&state);
+    double load_us = now_us() - t0;
+    grove_aqs_retain_clear();
+    failures += check(ret == ESP_OK && state.driver.config_hash == 0x1234 && state.driver.have_last &&
+                      state.driver.stage_cost_us[GROVE_AQS_RETAIN_STAGES - 1] == 20 &&
+                      state.driver.track.primed && state.driver.track.filtered_q8 == state.driver.last_mv << 8 &&
+                      state.pending_count == appended % CONFIG_GROVE_AQS_HISTORY_BATCH_SIZE,
+                      "next boot: driver state and pending samples");
+    if (open_history_default(16) != 0) {
+        fprintf(stderr, "failed to open history\n");
+        return 1;
+    }
+    for (uint16_t i = 0; i < state.pending_count; i++) {
+        grove_aqs_history_append(&state.pending[i]);
+    }
+    grove_aqs_history_flush();
+    grove_aqs_history_agg_t agg;
+    grove_aqs_history_aggregate(0, UINT32_MAX, &agg);
+    failures += check(agg.count == appended && agg.last_timestamp == state.pending[state.pending_count - 1].timestamp,
+                      "next boot: no sample lost across the reboot");
+    grove_aqs_history_deinit();
+    failures += check(grove_aqs_retain_load(&state) == ESP_ERR_NOT_FOUND, "block consumed after restore");
+
+    // Blocks that must not be restored
+    grove_aqs_retain_block_t *block = region;
+    grove_aqs_retain_store(&state);
+    ((uint8_t *)&block->state)[5] ^= 0x10;
+    failures += check(grove_aqs_retain_load(&state) == ESP_ERR_INVALID_CRC, "corrupted state rejected");
+    grove_aqs_retain_store(&state);
+    block->version++;
+    failures += check(grove_aqs_retain_load(&state) == ESP_ERR_INVALID_VERSION, "other layout version rejected");
+    memset(region, 0xA5, sizeof(grove_aqs_retain_block_t));
+    failures += check(grove_aqs_retain_load(&state) == ESP_ERR_NOT_FOUND, "power-on garbage rejected");
+
+    // Cost of the handoff itself
+    t0 = now_us();
+    for (uint32_t i = 0; i < iterations; i++) {
+        state.driver.resume_count = i;
+        grove_aqs_retain_store(&state);
+    }
+    double store_ns = (now_us() - t0) * 1000.0 / iterations;
+    t0 = now_us();
+    for (uint32_t i = 0; i < iterations; i++) {
+        grove_aqs_retain_load(&state);
+    }
+    double validate_ns = (now_us() - t0) * 1000.0 / iterations;
+    printf("  first load %.1f us, store %.0f ns, load %.0f ns\n", load_us, store_ns, validate_ns);
+
+    munmap(region, sizeof(grove_aqs_retain_block_t));
+    unlink(RETAIN_FILE);
+    unlink(BENCH_FILE);
+    return failures == 0 ? 0 : 1;
+}
+
+/* Replay one sample per minute through the stub decision; a boot re-arms at the current level */
+static void wake_replay(const grove_aqs_core_params_t *params, int hysteresis_mv, uint32_t wakes,
+                        uint32_t boots[3]) {
+    grove_aqs_history_sample_t s;
+    srand(1);
+    synth_sample(0, &s);
+    grove_aqs_wake_config_t config;
+    grove_aqs_wake_config_init(&config, params, hysteresis_mv, s.raw_value);
+
+    uint32_t count = 0;
+    for (uint32_t i = 1; i <= wakes; i++) {
+        for (int k = 0; k < 6; k++) {
+            synth_sample(i, &s);
+        }
+        count++;
+        grove_aqs_wake_action_t action = grove_aqs_wake_decide(&config, count, s.raw_value);
+        boots[action]++;
+        if (action != GROVE_AQS_WAKE_SLEEP) {
+            grove_aqs_wake_config_init(&config, params, hysteresis_mv, s.raw_value);
+            count = 0;
+        }
+    }
+}
+
+static int bench_wake(int argc, char **argv) {
+    uint32_t days = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 7;
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, 3300, 700, 1000, 1500, 2000);
+
+    // Edges of the decision around the good/moderate threshold (1000 mV)
+    grove_aqs_wake_config_t config;
+    uint16_t moderate_raw = 1100 * GROVE_AQS_ADC_MAX_RAW / 3300;
+    grove_aqs_wake_config_init(&config, &params, 50, moderate_raw);
+    uint16_t t = config.raw_thresholds[1];
+    uint16_t h = config.hysteresis_raw;
+    printf("wake: good/moderate threshold raw %u, hysteresis raw %u, buffer %u\n", t, h, GROVE_AQS_WAKE_BUFFER_SIZE);
+    int failures = 0;
+    failures += check(config.level == GROVE_AQS_QUALITY_MODERATE, "reference level from the arming reading");
+    failures += check(grove_aqs_wake_decide(&config, 1, t) == GROVE_AQS_WAKE_SLEEP, "at the threshold: sleep");
+    failures += check(grove_aqs_wake_decide(&config, 1, t - h + 1) == GROVE_AQS_WAKE_SLEEP, "inside the hysteresis: sleep");
+    failures += check(grove_aqs_wake_decide(&config, 1, t - h) == GROVE_AQS_WAKE_BOOT_THRESHOLD, "past the hysteresis: boot");
+    failures += check(grove_aqs_wake_decide(&config, 1, config.raw_thresholds[2] + h + 1) == GROVE_AQS_WAKE_BOOT_THRESHOLD,
+                      "up one level: boot");
+    failures += check(grove_aqs_wake_decide(&config, GROVE_AQS_WAKE_BUFFER_SIZE, moderate_raw) ==
+                      GROVE_AQS_WAKE_BOOT_BUFFER_FULL, "buffer full: boot");
+    grove_aqs_wake_config_init(&config, &params, 50, GROVE_AQS_ADC_MAX_RAW);
+    failures += check(grove_aqs_wake_decide(&config, 1, GROVE_AQS_ADC_MAX_RAW) == GROVE_AQS_WAKE_SLEEP,
+                      "very poor at the rail: sleep");
+
+    // With a calibration folded in, the stub's levels follow the compensated readings
+    grove_aqs_core_params_t calibrated = params;
+    grove_aqs_calibration_t cal = { .gain = GROVE_AQS_CORE_GAIN_ONE * 5 / 4, .offset_mv = -40 };
+    grove_aqs_core_set_calibration(&calibrated, GROVE_AQS_CORE_GAIN_ONE, &cal);
+    grove_aqs_wake_config_init(&config, &calibrated, 0, 0);
+    uint32_t disagree = 0;
+    for (int raw = 0; raw <= GROVE_AQS_ADC_MAX_RAW; raw++) {
+        int mv = grove_aqs_core_compensate(&calibrated, grove_aqs_core_raw_to_mv(&calibrated, raw));
+        disagree += grove_aqs_wake_level(&config, (uint16_t)raw) != grove_aqs_core_classify(&calibrated, mv);
+    }
+    failures += check(disagree == 0, "calibrated: stub level matches the driver's");
+
+    uint32_t wakes = days * 24 * 60;
+    printf("  %u wakes (%u days at 1/min)\n", wakes, days);
+    printf("  %12s %10s %12s %12s %8s\n", "hysteresis", "stub only", "boot:level", "boot:full", "boots");
+    static const int hysteresis[] = { 0, 25, CONFIG_GROVE_AQS_WAKE_HYSTERESIS_MV, 100 };
+    for (size_t k = 0; k < sizeof(hysteresis) / sizeof(hysteresis[0]); k++) {
+        uint32_t boots[3] = { 0 };
+        wake_replay(&params, hysteresis[k], wakes, boots);
+        printf("  %9d mV %10u %12u %12u %7.1f%%\n", hysteresis[k], boots[GROVE_AQS_WAKE_SLEEP],
+               boots[GROVE_AQS_WAKE_BOOT_THRESHOLD], boots[GROVE_AQS_WAKE_BOOT_BUFFER_FULL],
+               100.0 * (wakes - boots[GROVE_AQS_WAKE_SLEEP]) / wakes);
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+/* Sampling strategy for the energy simulation */
+typedef struct {
+    const char *name;
+    uint32_t period_s;               // Time between readings
+    uint32_t warmup_s;               // Heater on before each reading; 0 keeps it on all the time
+    uint32_t batch;                  // Readings per radio export
+} energy_strategy_t;
+
+/* Assumed per-reading costs on the target: oneshot conversion and the driver's processing */
+#define SIM_ADC_US 40
+#define SIM_CPU_US 150
+#define SIM_BATTERY_MAH 2000
+
+static void energy_simulate(const energy_strategy_t *st, uint32_t days, grove_aqs_energy_totals_t *totals) {
+    const int64_t s = 1000000;
+    int64_t end = (int64_t)days * 24 * 3600 * s;
+    grove_aqs_energy_init(NULL, 0);
+    if (st->warmup_s == 0) {
+        grove_aqs_energy_begin(GROVE_AQS_ENERGY_HEATER, 0);
+    }
+
+    uint32_t pending = 0;
+    for (int64_t t = 0; t + (int64_t)st->warmup_s * s < end; t += (int64_t)st->period_s * s) {
+        int64_t r = t + (int64_t)st->warmup_s * s;
+        if (st->warmup_s > 0) {
+            grove_aqs_energy_begin(GROVE_AQS_ENERGY_HEATER, t);
+        }
+        grove_aqs_energy_begin(GROVE_AQS_ENERGY_CPU, r);
+        grove_aqs_energy_begin(GROVE_AQS_ENERGY_ADC, r);
+        grove_aqs_energy_end(GROVE_AQS_ENERGY_ADC, r + SIM_ADC_US);
+        grove_aqs_energy_end(GROVE_AQS_ENERGY_CPU, r + SIM_CPU_US);
+        grove_aqs_energy_count_reading();
+        if (st->warmup_s > 0) {
+            grove_aqs_energy_end(GROVE_AQS_ENERGY_HEATER, r + SIM_CPU_US);
+        }
+        if (++pending == st->batch) {
+            grove_aqs_energy_add_export(pending * sizeof(grove_aqs_history_sample_t));
+            pending = 0;
+        }
+    }
+    grove_aqs_energy_get_totals(end, totals);
+}
+
+static int bench_energy(int argc, char **argv) {
+    uint32_t days = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 7;
+    const grove_aqs_energy_model_t model = GROVE_AQS_ENERGY_DEFAULT_MODEL();
+    printf("energy: %u mV, heater %u uA, adc %u uA, cpu %u uA, radio %u uA, sleep %u uA\n", model.supply_mv,
+           model.current_ua[GROVE_AQS_ENERGY_HEATER], model.current_ua[GROVE_AQS_ENERGY_ADC],
+           model.current_ua[GROVE_AQS_ENERGY_CPU], model.current_ua[GROVE_AQS_ENERGY_RADIO],
+           model.current_ua[GROVE_AQS_ENERGY_SLEEP]);
+
+    // Known quantities: 1 s of CPU, 1 s of payload plus the per-export overhead
+    grove_aqs_energy_totals_t totals;
+    int failures = 0;
+    grove_aqs_energy_init(&model, 0);
+    grove_aqs_energy_begin(GROVE_AQS_ENERGY_CPU, 0);
+    grove_aqs_energy_begin(GROVE_AQS_ENERGY_CPU, 500000);
+    grove_aqs_energy_end(GROVE_AQS_ENERGY_CPU, 1000000);
+    grove_aqs_energy_add_export(model.radio_bytes_per_s);
+    grove_aqs_energy_count_reading();
+    grove_aqs_energy_get_totals(3000000, &totals);
+    failures += check(totals.time_us[GROVE_AQS_ENERGY_CPU] == 1000000, "nested begin ignored");
+    failures += check(totals.energy_uj[GROVE_AQS_ENERGY_CPU] ==
+                      (uint64_t)model.current_ua[GROVE_AQS_ENERGY_CPU] * model.supply_mv / 1000, "1 s of CPU");
+    failures += check(totals.time_us[GROVE_AQS_ENERGY_RADIO] == 1000000 + model.radio_overhead_us, "export time");
+    failures += check(totals.time_us[GROVE_AQS_ENERGY_SLEEP] == 1000000 - model.radio_overhead_us,
+                      "sleep is the remainder");
+    failures += check(totals.uj_per_reading == totals.total_uj, "energy per reading");
+    grove_aqs_energy_begin(GROVE_AQS_ENERGY_HEATER, 3000000);
+    grove_aqs_energy_get_totals(4000000, &totals);
+    failures += check(totals.time_us[GROVE_AQS_ENERGY_HEATER] == 1000000, "open state counted up to now");
+
+    static const energy_strategy_t strategies[] = {
+        { "continuous 1 s, export each", 1, 0, 1 },
+        { "continuous 60 s, export hourly", 60, 0, 60 },
+        { "30 s warm-up every 5 min, export each", 300, 30, 1 },
+        { "30 s warm-up every 5 min, export hourly", 300, 30, 12 },
+        { "30 s warm-up every 15 min, export hourly", 900, 30, 4 },
+    };
+    printf("  %u days, %u us conversion / %u us processing per reading, %u mAh battery\n", days, SIM_ADC_US,
+           SIM_CPU_US, SIM_BATTERY_MAH);
+    printf("  %-42s %9s %9s %8s %8s %12s %9s %8s\n", "strategy", "readings", "heater h", "cpu s", "radio s",
+           "mJ/reading", "avg uA", "days");
+    for (size_t k = 0; k < sizeof(strategies) / sizeof(strategies[0]); k++) {
+        energy_simulate(&strategies[k], days, &totals);
+        printf("  %-42s %9u %9.1f %8.2f %8.1f %12.3f %9u %8.1f\n", strategies[k].name, totals.readings,
+               totals.time_us[GROVE_AQS_ENERGY_HEATER] / 3.6e9, totals.time_us[GROVE_AQS_ENERGY_CPU] / 1e6,
+               totals.time_us[GROVE_AQS_ENERGY_RADIO] / 1e6, totals.uj_per_reading / 1e3, totals.average_ua,
+               SIM_BATTERY_MAH * 1000.0 / totals.average_ua / 24);
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+/* Share of samples classified as at full heater power; true_sens_pct is the sensor's actual slope */
+static double heater_agreement(uint32_t samples, int duty_pct, int model_sens_pct, int true_sens_pct,
+                               bool compensate) {
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, 3300, 700, 1000, 1500, 2000);
+    if (compensate) {
+        params.gain = grove_aqs_core_heater_gain(duty_pct, model_sens_pct);
+    }
+    int output = 10000 - true_sens_pct * (100 - duty_pct);
+
+    grove_aqs_history_sample_t s;
+    srand(1);
+    uint32_t agree = 0;
+    for (uint32_t i = 0; i < samples; i++) {
+        synth_sample(i, &s);
+        int reduced_mv = s.voltage_mv * output / 10000;
+        agree += grove_aqs_core_classify(&params, grove_aqs_core_compensate(&params, reduced_mv)) == s.quality;
+    }
+    return 100.0 * agree / samples;
+}
+
+static int bench_heater(int argc, char **argv) {
+    uint32_t samples = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 200000;
+    const int sens = 50; // Kconfig default of CONFIG_GROVE_AQS_HEATER_SENSITIVITY_PCT
+    printf("heater: %u samples, model sensitivity %d%%, agreement with full-power classification\n", samples, sens);
+    printf("  %6s %8s %12s %14s %14s %14s\n", "duty", "gain", "raw", "compensated", "sensor -10%", "sensor +10%");
+
+    static const int duties[] = { 100, 80, 60, 40, 20 };
+    double worst = 100.0;
+    for (size_t k = 0; k < sizeof(duties) / sizeof(duties[0]); k++) {
+        int d = duties[k];
+        double exact = heater_agreement(samples, d, sens, sens, true);
+        printf("  %5d%% %8.3f %11.1f%% %13.1f%% %13.1f%% %13.1f%%\n", d,
+               (double)grove_aqs_core_heater_gain(d, sens) / GROVE_AQS_CORE_GAIN_ONE,
+               heater_agreement(samples, d, sens, sens, false), exact,
+               heater_agreement(samples, d, sens, sens - 10, true), heater_agreement(samples, d, sens, sens + 10, true));
+        worst = exact < worst ? exact : worst;
+    }
+
+    int failures = 0;
+    failures += check(grove_aqs_core_heater_gain(100, sens) == GROVE_AQS_CORE_GAIN_ONE, "full duty: unity gain");
+    // Only the rounding of the reduced voltage can flip a level when the model matches the sensor
+    failures += check(worst > 99.0, "matching model restores the classification");
+    return failures == 0 ? 0 : 1;
+}
+
+/* MOX sensor under a modulated heater: the temperature lags the duty, and a
+ * gas responds most around its own temperature, so the response over a cycle
+ * has a shape per gas and a scale per concentration. */
+typedef struct {
+    int64_t now_us;                  // Virtual time the runner's callbacks happen at
+    int64_t last_us;
+    double duty;
+    double temp;                     // 0 (cold) to 1 (full heater power)
+    double gas_temp;                 // Temperature of the strongest response
+    double conc;                     // Response scale
+} sim_mox_t;
+
+#define SIM_MOX_TAU_US 800000.0
+
+static void sim_mox_advance(sim_mox_t *m) {
+    double dt = (double)(m->now_us - m->last_us);
+    m->temp += (m->duty - m->temp) * (1.0 - exp(-dt / SIM_MOX_TAU_US));
+    m->last_us = m->now_us;
+}
+
+static void sim_mox_set_duty(void *ctx, uint8_t duty_pct) {
+    sim_mox_t *m = ctx;
+    sim_mox_advance(m);
+    m->duty = duty_pct / 100.0;
+}
+
+static int sim_mox_sample_mv(void *ctx) {
+    sim_mox_t *m = ctx;
+    sim_mox_advance(m);
+    double d = (m->temp - m->gas_temp) / 0.2;
+    return (int)lround(150.0 + 100.0 * m->temp + m->conc * 600.0 * exp(-d * d));
+}
+
+typedef struct {
+    grove_aqs_profile_features_t last;
+    uint32_t cycles;
+    uint32_t max_phase_error_us;
+} sim_profile_out_t;
+
+static sim_profile_out_t *sim_out;
+
+static void sim_cycle_done(void *ctx, const grove_aqs_profile_features_t *features) {
+    (void)ctx;
+    sim_out->last = *features;
+    sim_out->cycles++;
+    if (features->max_phase_error_us > sim_out->max_phase_error_us) {
+        sim_out->max_phase_error_us = features->max_phase_error_us;
+    }
+    grove_aqs_profile_publish(features);
+}
+
+/* Runs the profile in virtual time; each wake-up comes up to jitter_us late */
+static void sim_profile_run(grove_aqs_profile_runner_t *runner, const grove_aqs_profile_t *profile, sim_mox_t *mox,
+                            uint32_t cycles, uint32_t jitter_us, sim_profile_out_t *out) {
+    const grove_aqs_profile_io_t io = {
+        .set_duty = sim_mox_set_duty,
+        .sample_mv = sim_mox_sample_mv,
+        .cycle_done = sim_cycle_done,
+        .ctx = mox,
+    };
+    memset(out, 0, sizeof(*out));
+    sim_out = out;
+    mox->now_us = mox->last_us = 0;
+    grove_aqs_profile_runner_init(runner, profile, &io, 0);
+    while (out->cycles < cycles) {
+        int64_t next = grove_aqs_profile_runner_poll(runner, mox->now_us);
+        mox->now_us = next + (jitter_us > 0 ? rand() % (jitter_us + 1) : 0);
+    }
+}
+
+/* Mean absolute difference of two shapes, as a fraction of the cycle mean */
+static double shape_distance(const grove_aqs_profile_features_t *a, const grove_aqs_profile_features_t *b) {
+    double sum = 0;
+    for (uint8_t i = 0; i < a->phase_count; i++) {
+        sum += fabs((double)a->shape_q12[i] - b->shape_q12[i]);
+    }
+    return sum / a->phase_count / (1 << GROVE_AQS_PROFILE_SHAPE_SHIFT);
+}
+
+static int bench_profile(int argc, char **argv) {
+    uint32_t cycles = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 50;
+    const uint32_t jitter_us = 200;
+    cycles = cycles < 4 ? 4 : cycles;
+
+    grove_aqs_profile_t profile = {
+        .steps = { { 100, 2000 }, { 20, 3000 }, { 60, 5000 } },
+        .step_count = 3,
+        .phase_count = 16,
+    };
+    for (uint8_t i = 0; i < profile.phase_count; i++) {
+        profile.phase_ms[i] = 300 + 625 * i;
+    }
+    uint32_t cycle_ms = grove_aqs_profile_cycle_ms(&profile);
+    printf("profile: %u cycles of %u ms, %u phases, wake-up jitter up to %u us\n", cycles, cycle_ms,
+           profile.phase_count, jitter_us);
+
+    static const struct {
+        const char *name;
+        double gas_temp;
+        double conc;
+    } gases[] = {
+        { "gas A x1", 0.35, 1.0 }, { "gas A x3", 0.35, 3.0 }, { "gas B x1", 0.85, 1.0 }, { "gas B x3", 0.85, 3.0 },
+    };
+    enum { GAS_COUNT = sizeof(gases) / sizeof(gases[0]) };
+    grove_aqs_profile_features_t features[GAS_COUNT];
+    grove_aqs_profile_runner_t runner;
+    sim_profile_out_t out;
+    uint32_t max_phase_error_us = 0;
+    int failures = 0;
+    bool repeatable = true;
+    bool anchored = true;
+    srand(1);
+
+    for (size_t g = 0; g < GAS_COUNT; g++) {
+        sim_mox_t mox = { .gas_temp = gases[g].gas_temp, .conc = gases[g].conc };
+        // A settled cycle to compare the last one against
+        sim_profile_run(&runner, &profile, &mox, 3, jitter_us, &out);
+        grove_aqs_profile_features_t settled = out.last;
+        sim_profile_run(&runner, &profile, &mox, cycles, jitter_us, &out);
+        features[g] = out.last;
+        max_phase_error_us = out.max_phase_error_us > max_phase_error_us ? out.max_phase_error_us : max_phase_error_us;
+        for (uint8_t i = 0; i < profile.phase_count; i++) {
+            repeatable &= abs((int)settled.mv[i] - (int)out.last.mv[i]) <= 2;
+        }
+        anchored &= runner.cycle_start_us == (int64_t)cycles * cycle_ms * 1000 && runner.resyncs == 0;
+    }
+
+    printf("  %8s", "phase");
+    for (size_t g = 0; g < GAS_COUNT; g++) {
+        printf(" %9s", gases[g].name);
+    }
+    printf("\n");
+    for (uint8_t i = 0; i < profile.phase_count; i++) {
+        printf("  %6u ms", profile.phase_ms[i]);
+        for (size_t g = 0; g < GAS_COUNT; g++) {
+            printf(" %6u mV", features[g].mv[i]);
+        }
+        printf("\n");
+    }
+    printf("  %9s", "mean");
+    for (size_t g = 0; g < GAS_COUNT; g++) {
+        printf(" %6u mV", features[g].mean_mv);
+    }
+    printf("\n");
+
+    double same_a = shape_distance(&features[0], &features[1]);
+    double same_b = shape_distance(&features[2], &features[3]);
+    double across = shape_distance(&features[0], &features[2]);
+    double across_mixed = shape_distance(&features[1], &features[2]);
+    printf("  shape distance: same gas %.3f / %.3f, different gases %.3f / %.3f\n", same_a, same_b, across,
+           across_mixed);
+
+    // A chain of relative delays carries every wake-up's lateness into all later events
+    double chained_drift_ms = (double)cycles * (profile.step_count + profile.phase_count) * jitter_us / 2 / 1000;
+    printf("  cycle start after %u cycles: anchored exact, chained delays ~%.1f ms late\n", cycles, chained_drift_ms);
+
+    // The timer held off for 2.5 cycles: one restart, no burst of stale samples
+    sim_mox_t stalled = { .gas_temp = 0.35, .conc = 1.0 };
+    sim_profile_run(&runner, &profile, &stalled, 2, 0, &out);
+    uint32_t cycle_before = runner.current.cycle;
+    stalled.now_us = runner.cycle_start_us + 5 * (int64_t)cycle_ms * 1000 / 2;
+    grove_aqs_profile_runner_poll(&runner, stalled.now_us);
+    bool resynced = runner.resyncs == 1 && runner.current.cycle == cycle_before + 1 &&
+                    runner.cycle_start_us == stalled.now_us;
+
+    // The ring holds the newest cycles of the last run
+    grove_aqs_profile_clear();
+    sim_mox_t ringed = { .gas_temp = 0.85, .conc = 1.0 };
+    sim_profile_run(&runner, &profile, &ringed, GROVE_AQS_PROFILE_RING_SIZE * 2 + 1, 0, &out);
+    grove_aqs_profile_features_t recent[GROVE_AQS_PROFILE_RING_SIZE];
+    size_t n = grove_aqs_profile_read(recent, GROVE_AQS_PROFILE_RING_SIZE);
+    bool ring_ok = n == GROVE_AQS_PROFILE_RING_SIZE - 1 && recent[n - 1].cycle == out.last.cycle;
+    for (size_t i = 1; i < n; i++) {
+        ring_ok &= recent[i].cycle == recent[i - 1].cycle + 1;
+    }
+
+    grove_aqs_profile_event_t events[GROVE_AQS_PROFILE_MAX_EVENTS];
+    size_t count;
+    grove_aqs_profile_t bad = profile;
+    bad.phase_ms[3] = bad.phase_ms[2];
+
+    failures += check(max_phase_error_us <= jitter_us, "phase error within the wake-up jitter");
+    failures += check(repeatable, "settled cycles repeat within 2 mV");
+    failures += check(anchored, "cycles stay anchored to the first");
+    failures += check(same_a < across / 2 && same_b < across / 2 && same_a < across_mixed / 2,
+                      "shape separates gases, not concentrations");
+    failures += check(resynced, "stall restarts the cycle once");
+    failures += check(ring_ok, "ring returns the newest cycles in order");
+    failures += check(grove_aqs_profile_build(&bad, events, &count) == ESP_ERR_INVALID_ARG,
+                      "unordered phases rejected");
+    return failures == 0 ? 0 : 1;
+}
+
+/* Standard normal deviate (Box-Muller) */
+static double gauss(void) {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+#define LOCKIN_SIM_SAMPLES 8         // Per modulation period
+#define LOCKIN_SIM_PERIODS 16        // Per measurement
+#define LOCKIN_SIM_PERIOD_S 4.0
+
+/* Sensor output: a baseline with linear and random-walk drift, plus a gas
+ * response that follows the heater with thermal lag, plus white noise */
+typedef struct {
+    double noise_mv;                 // White noise; the random walk steps at a quarter of it
+    double drift_mv_per_s;
+    double t_s;
+    double walk_mv;
+    double heat;                     // 0 (cold) to 1
+} sim_lockin_t;
+
+static int sim_lockin_sample(sim_lockin_t *sim, bool heater_on, double response_mv) {
+    const double dt = LOCKIN_SIM_PERIOD_S / LOCKIN_SIM_SAMPLES;
+    sim->t_s += dt;
+    sim->walk_mv += sim->noise_mv / 4 * gauss();
+    sim->heat += ((heater_on ? 1.0 : 0.0) - sim->heat) * (1.0 - exp(-dt / 0.8));
+    double mv = 800.0 + sim->drift_mv_per_s * sim->t_s + sim->walk_mv + response_mv * sim->heat +
+                sim->noise_mv * gauss();
+    return (int)lround(mv);
+}
+
+static void sim_lockin_window(sim_lockin_t *sim, double response_mv, grove_aqs_lockin_result_t *result) {
+    grove_aqs_lockin_t lockin;
+    grove_aqs_lockin_init(&lockin, LOCKIN_SIM_SAMPLES);
+    for (int k = 0; k < LOCKIN_SIM_SAMPLES * LOCKIN_SIM_PERIODS; k++) {
+        grove_aqs_lockin_update(&lockin, sim_lockin_sample(sim, grove_aqs_lockin_heater_on(&lockin), response_mv));
+    }
+    grove_aqs_lockin_result(&lockin, result);
+}
+
+/* What grove_aqs_read_data() gives: the heater on, the samples of a window averaged */
+static double sim_dc_window(sim_lockin_t *sim, double response_mv) {
+    double sum = 0;
+    for (int k = 0; k < LOCKIN_SIM_SAMPLES * LOCKIN_SIM_PERIODS; k++) {
+        sum += sim_lockin_sample(sim, true, response_mv);
+    }
+    return sum / (LOCKIN_SIM_SAMPLES * LOCKIN_SIM_PERIODS);
+}
+
+static int bench_lockin(int argc, char **argv) {
+    uint32_t trials = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 200;
+    const double response_mv = 200.0;
+    const double step_mv = 10.0;     // Response change to detect between two windows
+    trials = trials < 10 ? 10 : trials;
+    printf("lockin: %u trials, %d samples x %d periods of %.0f s per window, response %.0f -> %.0f mV\n", trials,
+           LOCKIN_SIM_SAMPLES, LOCKIN_SIM_PERIODS, LOCKIN_SIM_PERIOD_S, response_mv, response_mv + step_mv);
+
+    int failures = 0;
+    grove_aqs_lockin_t lockin;
+    grove_aqs_lockin_result_t r;
+
+    // Exact inputs: a sine at the modulation frequency, a constant, an incomplete period
+    grove_aqs_lockin_init(&lockin, LOCKIN_SIM_SAMPLES);
+    for (int k = 0; k < 4 * LOCKIN_SIM_SAMPLES; k++) {
+        double angle = 2.0 * M_PI * (k + 0.5) / LOCKIN_SIM_SAMPLES + 0.5;
+        grove_aqs_lockin_update(&lockin, (int)lround(800.0 + 100.0 * sin(angle)));
+    }
+    grove_aqs_lockin_result(&lockin, &r);
+    bool sine_ok = abs((int)r.amplitude_uv - 100000) < 500 && abs(r.dc_uv - 800000) < 100;
+    grove_aqs_lockin_init(&lockin, LOCKIN_SIM_SAMPLES);
+    for (int k = 0; k < 3 * LOCKIN_SIM_SAMPLES / 2; k++) {
+        grove_aqs_lockin_update(&lockin, 1234);
+    }
+    grove_aqs_lockin_result(&lockin, &r);
+    bool constant_ok = r.amplitude_uv == 0 && r.dc_uv == 1234000 && r.periods == 1;
+
+    // Response gain and phase from a noise- and drift-free run
+    sim_lockin_t sim = { 0 };
+    sim_lockin_window(&sim, 1000.0, &r);
+    sim_lockin_window(&sim, 1000.0, &r);
+    double gain = r.amplitude_uv / 1000.0 / 1000.0;
+    double cos_phi = r.i_uv / (double)r.amplitude_uv;
+    double sin_phi = r.q_uv / (double)r.amplitude_uv;
+    printf("  response at the modulation frequency: %.3f of the step, %.0f deg behind the heater\n", gain,
+           -atan2(sin_phi, cos_phi) * 180.0 / M_PI);
+
+    printf("  %10s %12s %12s %12s %12s %8s\n", "noise", "DC rms err", "DC SNR", "lock-in err", "lock-in SNR", "gain");
+    static const double noise_levels[] = { 2.0, 8.0, 20.0 };
+    double worst_gain_db = 1e9;
+    bool unbiased = true;
+    srand(1);
+    for (size_t n = 0; n < sizeof(noise_levels) / sizeof(noise_levels[0]); n++) {
+        double dc_sq = 0, li_sq = 0, li_sum = 0;
+        for (uint32_t t = 0; t < trials; t++) {
+            sim_lockin_t dc = { .noise_mv = noise_levels[n], .drift_mv_per_s = 0.2, .heat = 1.0 };
+            double before = sim_dc_window(&dc, response_mv);
+            double err = sim_dc_window(&dc, response_mv + step_mv) - before - step_mv;
+            dc_sq += err * err;
+
+            sim_lockin_t li = { .noise_mv = noise_levels[n], .drift_mv_per_s = 0.2 };
+            grove_aqs_lockin_result_t r1, r2;
+            sim_lockin_window(&li, response_mv, &r1);
+            sim_lockin_window(&li, response_mv + step_mv, &r2);
+            // Projected on the response phase: noise in quadrature to it drops out
+            double projected = ((r2.i_uv - r1.i_uv) * cos_phi + (r2.q_uv - r1.q_uv) * sin_phi) / 1000.0;
+            err = projected / gain - step_mv;
+            li_sq += err * err;
+            li_sum += err;
+        }
+        double dc_rms = sqrt(dc_sq / trials);
+        double li_rms = sqrt(li_sq / trials);
+        double dc_snr = 20.0 * log10(step_mv / dc_rms);
+        double li_snr = 20.0 * log10(step_mv / li_rms);
+        printf("  %7.0f mV %9.2f mV %9.1f dB %9.2f mV %9.1f dB %5.1f dB\n", noise_levels[n], dc_rms, dc_snr, li_rms,
+               li_snr, li_snr - dc_snr);
+        worst_gain_db = li_snr - dc_snr < worst_gain_db ? li_snr - dc_snr : worst_gain_db;
+        unbiased &= fabs(li_sum / trials) < 3.0 * li_rms / sqrt(trials) + 0.2;
+    }
+
+    // Kernel cost
+    const uint32_t updates = 10000000;
+    grove_aqs_lockin_init(&lockin, LOCKIN_SIM_SAMPLES);
+    double t0 = now_us();
+    for (uint32_t k = 0; k < updates; k++) {
+        grove_aqs_lockin_update(&lockin, (int32_t)(k & 0xfff));
+    }
+    double t1 = now_us();
+    grove_aqs_lockin_result(&lockin, &r);
+    printf("  kernel: %.2f ns per sample (%u periods)\n", (t1 - t0) * 1000.0 / updates, r.periods);
+
+    failures += check(sine_ok, "sine amplitude and mean recovered");
+    failures += check(constant_ok, "constant rejected, partial period left out");
+    failures += check(unbiased, "lock-in step estimate unbiased");
+    failures += check(worst_gain_db >= 10.0, "lock-in SNR at least 10 dB above DC");
+    return failures == 0 ? 0 : 1;
+}
+
+#define CLASSIFY_SIM_WINDOW 30       // Readings per window
+#define CLASSIFY_SIM_INTERVAL_S 10
+#define CLASSIFY_SIM_CLASSES 3       // Clean air, smoke, solvent
+#define CLASSIFY_SIM_HIDDEN 16
+#define CLASSIFY_SIM_PHASES 8
+
+static const char *const classify_sim_names[CLASSIFY_SIM_CLASSES] = { "clean", "smoke", "solvent" };
+
+/* Heater-cycle response of each class, per phase group (Q12, 4096 = flat) */
+static const int classify_sim_shape[CLASSIFY_SIM_CLASSES][GROVE_AQS_FEATURE_CYCLE_GROUPS] = {
+    { 4096, 4096, 4096, 4096 },
+    { 4700, 4400, 3900, 3300 },
+    { 3700, 4000, 4300, 4400 },
+};
+
+typedef struct {
+    int32_t features[GROVE_AQS_FEATURE_COUNT];
+    int label;
+    grove_aqs_quality_t level;       // What the thresholds say about the mean
+} classify_sample_t;
+
+/* One window of a class: smoke and solvent overlap in level, smoke is noisy
+ * and bursty, solvent is smooth with a steady rise; half the windows come
+ * without a heater cycle */
+static void classify_sim_window(grove_aqs_window_t *w, int label, bool with_cycle, int64_t *t_us) {
+    double level, noise_mv, slope_mv_per_min, walk_mv;
+    switch (label) {
+        case 0:
+            level = 250 + rand() % 600;
+            noise_mv = 4;
+            slope_mv_per_min = 4 * gauss();
+            walk_mv = 1;
+            break;
+        case 1:
+            level = 1100 + rand() % 800;
+            noise_mv = 25;
+            slope_mv_per_min = 20 * gauss();
+            walk_mv = 15;
+            break;
+        default:
+            level = 1100 + rand() % 800;
+            noise_mv = 5;
+            slope_mv_per_min = 15 + rand() % 40;
+            walk_mv = 2;
+            break;
+    }
+    grove_aqs_window_init(w, CLASSIFY_SIM_WINDOW);
+    double walk = 0;
+    for (int k = 0; k < CLASSIFY_SIM_WINDOW; k++) {
+        walk += walk_mv * gauss();
+        double mv = level + slope_mv_per_min * k * CLASSIFY_SIM_INTERVAL_S / 60.0 + walk + noise_mv * gauss();
+        grove_aqs_window_push(w, (int)lround(mv), *t_us);
+        *t_us += CLASSIFY_SIM_INTERVAL_S * 1000000LL + rand() % 20000;
+    }
+
+    grove_aqs_profile_features_t cycle = { .phase_count = CLASSIFY_SIM_PHASES };
+    for (int p = 0; p < CLASSIFY_SIM_PHASES; p++) {
+        int group = p * GROVE_AQS_FEATURE_CYCLE_GROUPS / CLASSIFY_SIM_PHASES;
+        cycle.shape_q12[p] = (uint16_t)lround(classify_sim_shape[label][group] + 150 * gauss());
+    }
+    grove_aqs_window_set_cycle(w, with_cycle ? &cycle : NULL);
+}
+
+static void classify_sim_set(classify_sample_t *set, uint32_t count, const grove_aqs_core_params_t *params) {
+    int64_t t_us = 0;
+    grove_aqs_window_t w;
+    for (uint32_t i = 0; i < count; i++) {
+        set[i].label = (int)(i % CLASSIFY_SIM_CLASSES);
+        classify_sim_window(&w, set[i].label, (i / CLASSIFY_SIM_CLASSES) % 2 == 0, &t_us);
+        grove_aqs_window_features(&w, set[i].features);
+        set[i].level = grove_aqs_core_classify(params, set[i].features[GROVE_AQS_FEATURE_LEVEL]);
+    }
+}
+
+/* Float reference of the model: inputs scaled to [-1, 1], one ReLU hidden layer */
+typedef struct {
+    double offset[GROVE_AQS_FEATURE_COUNT];
+    double half[GROVE_AQS_FEATURE_COUNT];
+    double w1[CLASSIFY_SIM_HIDDEN][GROVE_AQS_FEATURE_COUNT];
+    double b1[CLASSIFY_SIM_HIDDEN];
+    double w2[CLASSIFY_SIM_CLASSES][CLASSIFY_SIM_HIDDEN];
+    double b2[CLASSIFY_SIM_CLASSES];
+} classify_float_t;
+
+static void classify_float_forward(const classify_float_t *m, const int32_t *features, double *hidden,
+                                   double *logits) {
+    double x[GROVE_AQS_FEATURE_COUNT];
+    for (int i = 0; i < GROVE_AQS_FEATURE_COUNT; i++) {
+        x[i] = (features[i] - m->offset[i]) / m->half[i];
+        x[i] = x[i] < -1 ? -1 : x[i] > 1 ? 1 : x[i];
+    }
+    for (int h = 0; h < CLASSIFY_SIM_HIDDEN; h++) {
+        double a = m->b1[h];
+        for (int i = 0; i < GROVE_AQS_FEATURE_COUNT; i++) {
+            a += m->w1[h][i] * x[i];
+        }
+        hidden[h] = a > 0 ? a : 0;
+    }
+    for (int o = 0; o < CLASSIFY_SIM_CLASSES; o++) {
+        double a = m->b2[o];
+        for (int h = 0; h < CLASSIFY_SIM_HIDDEN; h++) {
+            a += m->w2[o][h] * hidden[h];
+        }
+        logits[o] = a;
+    }
+}
+
+static int classify_argmax(const double *v, int n) {
+    int best = 0;
+    for (int i = 1; i < n; i++) {
+        best = v[i] > v[best] ? i : best;
+    }
+    return best;
+}
+
+/* Softmax cross-entropy, plain SGD */
+static void classify_float_train(classify_float_t *m, const classify_sample_t *set, uint32_t count) {
+    for (int i = 0; i < GROVE_AQS_FEATURE_COUNT; i++) {
+        int32_t lo = set[0].features[i], hi = lo;
+        for (uint32_t s = 1; s < count; s++) {
+            lo = set[s].features[i] < lo ? set[s].features[i] : lo;
+            hi = set[s].features[i] > hi ? set[s].features[i] : hi;
+        }
+        m->offset[i] = (lo + hi) / 2;
+        m->half[i] = hi - lo > 2 ? (hi - lo) / 2.0 : 1.0;
+    }
+    for (int h = 0; h < CLASSIFY_SIM_HIDDEN; h++) {
+        for (int i = 0; i < GROVE_AQS_FEATURE_COUNT; i++) {
+            m->w1[h][i] = 0.5 * gauss();
+        }
+        m->b1[h] = 0.1;
+    }
+    for (int o = 0; o < CLASSIFY_SIM_CLASSES; o++) {
+        for (int h = 0; h < CLASSIFY_SIM_HIDDEN; h++) {
+            m->w2[o][h] = 0.5 * gauss();
+        }
+        m->b2[o] = 0;
+    }
+
+    const double rate = 0.02;
+    for (int epoch = 0; epoch < 60; epoch++) {
+        for (uint32_t n = 0; n < count; n++) {
+            const classify_sample_t *s = &set[(n * 7919u + (uint32_t)epoch * 104729u) % count];
+            double x[GROVE_AQS_FEATURE_COUNT], hidden[CLASSIFY_SIM_HIDDEN], logits[CLASSIFY_SIM_CLASSES];
+            classify_float_forward(m, s->features, hidden, logits);
+            for (int i = 0; i < GROVE_AQS_FEATURE_COUNT; i++) {
+                x[i] = (s->features[i] - m->offset[i]) / m->half[i];
+                x[i] = x[i] < -1 ? -1 : x[i] > 1 ? 1 : x[i];
+            }
+            double top = logits[classify_argmax(logits, CLASSIFY_SIM_CLASSES)];
+            double sum = 0, grad[CLASSIFY_SIM_CLASSES];
+            for (int o = 0; o < CLASSIFY_SIM_CLASSES; o++) {
+                grad[o] = exp(logits[o] - top);
+                sum += grad[o];
+            }
+            for (int o = 0; o < CLASSIFY_SIM_CLASSES; o++) {
+                grad[o] = grad[o] / sum - (o == s->label);
+            }
+            for (int h = 0; h < CLASSIFY_SIM_HIDDEN; h++) {
+                double back = 0;
+                for (int o = 0; o < CLASSIFY_SIM_CLASSES; o++) {
+                    back += grad[o] * m->w2[o][h];
+                    m->w2[o][h] -= rate * grad[o] * hidden[h];
+                }
+                if (hidden[h] > 0) {
+                    for (int i = 0; i < GROVE_AQS_FEATURE_COUNT; i++) {
+                        m->w1[h][i] -= rate * back * x[i];
+                    }
+                    m->b1[h] -= rate * back;
+                }
+            }
+            for (int o = 0; o < CLASSIFY_SIM_CLASSES; o++) {
+                m->b2[o] -= rate * grad[o];
+            }
+        }
+    }
+}
+
+/* CRC-32 (IEEE 802.3) of the blob body, as a model exporter computes it */
+static uint32_t classify_crc32(const uint8_t *p, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+    while (len--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* Multiplier in [2^30, 2^31) and shift with multiplier / 2^shift = scale */
+static void classify_requant(double scale, grove_aqs_model_layer_t *layer) {
+    int shift = 31;
+    while (scale * ldexp(1.0, shift) < ldexp(1.0, 30) && shift < 62) {
+        shift++;
+    }
+    layer->shift = (uint8_t)shift;
+    layer->multiplier = (int32_t)lround(scale * ldexp(1.0, shift));
+}
+
+static int8_t classify_q8(double v) {
+    long q = lround(v);
+    return (int8_t)(q < -127 ? -127 : q > 127 ? 127 : q);
+}
+
+/* Quantize the float model into a blob: symmetric per-layer weight scales,
+ * activation scales from the largest value seen on the training set */
+static size_t classify_export(const classify_float_t *m, const classify_sample_t *set, uint32_t count,
+                              uint32_t *blob, size_t capacity) {
+    double hidden_max = 1e-9, logit_max = 1e-9;
+    for (uint32_t s = 0; s < count; s++) {
+        double hidden[CLASSIFY_SIM_HIDDEN], logits[CLASSIFY_SIM_CLASSES];
+        classify_float_forward(m, set[s].features, hidden, logits);
+        for (int h = 0; h < CLASSIFY_SIM_HIDDEN; h++) {
+            hidden_max = hidden[h] > hidden_max ? hidden[h] : hidden_max;
+        }
+        for (int o = 0; o < CLASSIFY_SIM_CLASSES; o++) {
+            logit_max = fabs(logits[o]) > logit_max ? fabs(logits[o]) : logit_max;
+        }
+    }
+    const double in_scale = 1.0 / 127, hidden_scale = hidden_max / 127, out_scale = logit_max / 127;
+
+    memset(blob, 0, capacity);
+    uint8_t *bytes = (uint8_t *)blob;
+    grove_aqs_model_header_t *header = (grove_aqs_model_header_t *)blob;
+    header->magic = GROVE_AQS_MODEL_MAGIC;
+    header->version = GROVE_AQS_MODEL_VERSION;
+    header->input_count = GROVE_AQS_FEATURE_COUNT;
+    header->layer_count = 2;
+    for (int i = 0; i < GROVE_AQS_FEATURE_COUNT; i++) {
+        header->inputs[i].offset = (int32_t)m->offset[i];
+        header->inputs[i].scale_q16 = (int32_t)lround(127.0 * 65536.0 / m->half[i]);
+    }
+    static const uint8_t class_map[CLASSIFY_SIM_CLASSES] = {
+        GROVE_AQS_MODEL_KEEP_LEVEL, GROVE_AQS_QUALITY_SMOKE, GROVE_AQS_QUALITY_SOLVENT,
+    };
+    memcpy(header->class_map, class_map, sizeof(class_map));
+
+    size_t offset = sizeof(*header);
+    for (int l = 0; l < 2; l++) {
+        int in = l == 0 ? GROVE_AQS_FEATURE_COUNT : CLASSIFY_SIM_HIDDEN;
+        int out = l == 0 ? CLASSIFY_SIM_HIDDEN : CLASSIFY_SIM_CLASSES;
+        const double *w = l == 0 ? &m->w1[0][0] : &m->w2[0][0];
+        const double *b = l == 0 ? m->b1 : m->b2;
+        double x_scale = l == 0 ? in_scale : hidden_scale;
+        double y_scale = l == 0 ? hidden_scale : out_scale;
+        double w_max = 1e-9;
+        for (int k = 0; k < in * out; k++) {
+            w_max = fabs(w[k]) > w_max ? fabs(w[k]) : w_max;
+        }
+        double w_scale = w_max / 127;
+
+        grove_aqs_model_layer_t *layer = (grove_aqs_model_layer_t *)(bytes + offset);
+        layer->in = (uint8_t)in;
+        layer->out = (uint8_t)out;
+        layer->relu = l == 0;
+        classify_requant(w_scale * x_scale / y_scale, layer);
+        offset += sizeof(*layer);
+        int32_t *bias = (int32_t *)(bytes + offset);
+        for (int o = 0; o < out; o++) {
+            bias[o] = (int32_t)lround(b[o] / (w_scale * x_scale));
+        }
+        offset += out * sizeof(int32_t);
+        int8_t *weights = (int8_t *)(bytes + offset);
+        for (int k = 0; k < in * out; k++) {
+            weights[k] = classify_q8(w[k] / w_scale);
+        }
+        offset += ((size_t)in * out + 3) & ~(size_t)3;
+    }
+    header->size = (uint32_t)offset;
+    header->crc32 = classify_crc32(bytes + sizeof(*header), offset - sizeof(*header));
+    return offset;
+}
+
+static int bench_classify(int argc, char **argv) {
+    uint32_t windows = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 3000;
+    const char *path = argc > 1 ? argv[1] : NULL;
+    windows = windows < 300 ? 300 : windows;
+    printf("classify: %u training + %u test windows of %d readings every %d s, %d -> %d ReLU -> %d MLP\n", windows,
+           windows, CLASSIFY_SIM_WINDOW, CLASSIFY_SIM_INTERVAL_S, GROVE_AQS_FEATURE_COUNT, CLASSIFY_SIM_HIDDEN,
+           CLASSIFY_SIM_CLASSES);
+
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, 3300, 700, 1000, 1500, 2000);
+    classify_sample_t *train = calloc(windows, sizeof(*train));
+    classify_sample_t *test = calloc(windows, sizeof(*test));
+    classify_float_t *fm = calloc(1, sizeof(*fm));
+    if (train == NULL || test == NULL || fm == NULL) {
+        return 1;
+    }
+    srand(1);
+    classify_sim_set(train, windows, &params);
+    classify_sim_set(test, windows, &params);
+
+    double t0 = now_us();
+    classify_float_train(fm, train, windows);
+    double t1 = now_us();
+    static uint32_t blob[1024];
+    size_t size = classify_export(fm, train, windows, blob, sizeof(blob));
+    grove_aqs_model_t model;
+    esp_err_t ret = grove_aqs_model_load(blob, size, &model);
+    printf("  trained in %.0f ms, blob %zu bytes: %s\n", (t1 - t0) / 1000.0, size, ret == ESP_OK ? "loaded" : "rejected");
+    if (ret != ESP_OK) {
+        return 1;
+    }
+
+    // Accuracy on the test set, by whether the window has heater-cycle features
+    uint32_t float_ok[2] = { 0 }, int8_ok[2] = { 0 }, total[2] = { 0 }, agree = 0;
+    uint32_t class_ok[CLASSIFY_SIM_CLASSES] = { 0 }, class_total[CLASSIFY_SIM_CLASSES] = { 0 };
+    uint32_t level_hist[GROVE_AQS_QUALITY_LEVEL_COUNT][CLASSIFY_SIM_CLASSES] = { { 0 } };
+    static const grove_aqs_quality_t expected[CLASSIFY_SIM_CLASSES] = {
+        GROVE_AQS_QUALITY_FRESH, GROVE_AQS_QUALITY_SMOKE, GROVE_AQS_QUALITY_SOLVENT,
+    };
+    bool keeps_level = true;
+    for (uint32_t s = 0; s < windows; s++) {
+        const classify_sample_t *t = &test[s];
+        bool cycle = t->features[GROVE_AQS_FEATURE_CYCLE] != 0;
+        double hidden[CLASSIFY_SIM_HIDDEN], logits[CLASSIFY_SIM_CLASSES];
+        classify_float_forward(fm, t->features, hidden, logits);
+        int float_class = classify_argmax(logits, CLASSIFY_SIM_CLASSES);
+        grove_aqs_model_output_t out;
+        grove_aqs_model_infer(&model, t->features, t->level, &out);
+        total[cycle]++;
+        float_ok[cycle] += float_class == t->label;
+        int8_ok[cycle] += out.output == t->label;
+        agree += out.output == float_class;
+        class_total[t->label]++;
+        class_ok[t->label] += out.output == t->label;
+        level_hist[t->level][t->label]++;
+        if (out.output == 0) {
+            keeps_level &= out.quality == t->level;
+        } else {
+            keeps_level &= out.quality == expected[out.output];
+        }
+    }
+
+    // Best any threshold rule can do: the majority class of each level
+    uint32_t level_ok = 0;
+    for (int q = 0; q < GROVE_AQS_QUALITY_LEVEL_COUNT; q++) {
+        uint32_t best = 0;
+        for (int c = 0; c < CLASSIFY_SIM_CLASSES; c++) {
+            best = level_hist[q][c] > best ? level_hist[q][c] : best;
+        }
+        level_ok += best;
+    }
+
+    printf("  %-22s %10s %10s\n", "accuracy", "float", "int8");
+    printf("  %-22s %9.1f%% %9.1f%%\n", "with heater cycle", 100.0 * float_ok[1] / total[1],
+           100.0 * int8_ok[1] / total[1]);
+    printf("  %-22s %9.1f%% %9.1f%%\n", "without heater cycle", 100.0 * float_ok[0] / total[0],
+           100.0 * int8_ok[0] / total[0]);
+    double float_acc = 100.0 * (float_ok[0] + float_ok[1]) / windows;
+    double int8_acc = 100.0 * (int8_ok[0] + int8_ok[1]) / windows;
+    printf("  %-22s %9.1f%% %9.1f%%   int8 agrees with float on %.1f%%\n", "all", float_acc, int8_acc,
+           100.0 * agree / windows);
+    printf("  int8 per class:");
+    for (int c = 0; c < CLASSIFY_SIM_CLASSES; c++) {
+        printf(" %s %.1f%%", classify_sim_names[c], class_total[c] ? 100.0 * class_ok[c] / class_total[c] : 0.0);
+    }
+    printf("\n");
+    printf("  thresholds alone (best class per level): %.1f%%; smoke vs solvent per level:", 100.0 * level_ok / windows);
+    for (int q = 0; q < GROVE_AQS_QUALITY_LEVEL_COUNT; q++) {
+        if (level_hist[q][1] + level_hist[q][2] > 0) {
+            printf(" %s %u/%u", grove_aqs_quality_to_string((grove_aqs_quality_t)q), level_hist[q][1], level_hist[q][2]);
+        }
+    }
+    printf("\n");
+
+    // Latency per window: features and inference
+    grove_aqs_window_t w;
+    int64_t t_us = 0;
+    classify_sim_window(&w, 1, true, &t_us);
+    const uint32_t runs = 200000;
+    int32_t features[GROVE_AQS_FEATURE_COUNT];
+    grove_aqs_model_output_t out;
+    volatile uint32_t sink = 0;   // Keeps the loops from being optimized away
+    t0 = now_us();
+    for (uint32_t r = 0; r < runs; r++) {
+        w.mv[r % CLASSIFY_SIM_WINDOW] ^= (int16_t)(r & 1);
+        grove_aqs_window_features(&w, features);
+        sink += features[GROVE_AQS_FEATURE_SLOPE];
+    }
+    t1 = now_us();
+    for (uint32_t r = 0; r < runs; r++) {
+        features[GROVE_AQS_FEATURE_LEVEL] = 1000 + (int32_t)(r & 0x1ff);
+        grove_aqs_model_infer(&model, features, GROVE_AQS_QUALITY_MODERATE, &out);
+        sink += out.output;
+    }
+    double t2 = now_us();
+    printf("  latency per window: features %.0f ns + inference %.0f ns (%d MACs)\n", (t1 - t0) * 1000.0 / runs,
+           (t2 - t1) * 1000.0 / runs, GROVE_AQS_FEATURE_COUNT * CLASSIFY_SIM_HIDDEN +
+           CLASSIFY_SIM_HIDDEN * CLASSIFY_SIM_CLASSES);
+
+    // Damaged blobs are refused
+    int failures = 0;
+    grove_aqs_model_t bad;
+    ((uint8_t *)blob)[size - 1] ^= 0x40;
+    failures += check(grove_aqs_model_load(blob, size, &bad) == ESP_ERR_INVALID_CRC, "corrupted blob rejected");
+    ((uint8_t *)blob)[size - 1] ^= 0x40;
+    failures += check(grove_aqs_model_load(blob, size - 4, &bad) == ESP_ERR_INVALID_SIZE, "truncated blob rejected");
+    blob[0] ^= 1;
+    failures += check(grove_aqs_model_load(blob, size, &bad) == ESP_ERR_INVALID_VERSION, "foreign blob rejected");
+    blob[0] ^= 1;
+
+    if (path != NULL) {
+        FILE *f = fopen(path, "wb");
+        if (f == NULL || fwrite(blob, 1, size, f) != size) {
+            perror(path);
+            failures++;
+        } else {
+            printf("  model written to %s\n", path);
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+    }
+
+    failures += check(int8_acc >= 90.0, "int8 accuracy at least 90%");
+    failures += check(int8_acc >= float_acc - 2.0, "int8 within 2 points of float");
+    failures += check(int8_acc >= 100.0 * level_ok / windows + 20.0, "classifier beats thresholds by 20 points");
+    failures += check(keeps_level, "categories mapped, clean air keeps its level");
+    free(train);
+    free(test);
+    free(fm);
+    return failures == 0 ? 0 : 1;
+}
+
+/* Float reference of grove_aqs_ppm_estimate() on the same curve constants */
+static double ppm_float(const grove_aqs_ppm_params_t *p, int voltage_mv) {
+    double ratio = (p->circuit_mv - voltage_mv) / (double)voltage_mv * exp2(p->log2_load_r0_q16 / 65536.0);
+    return exp2(p->curve.log2_ppm_q16 / 65536.0 + p->curve.slope_q16 / 65536.0 * log2(ratio));
+}
+
+static int bench_ppm(int argc, char **argv) {
+    uint32_t samples = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 2000000;
+    static const char *const gas_names[GROVE_AQS_GAS_COUNT] = { "alcohol", "hydrogen", "isobutane" };
+    // Concentration of the lower-Rs datasheet point of each built-in curve; the other is at 10 ppm
+    static const double datasheet_high_ppm[GROVE_AQS_GAS_COUNT] = { 300.0, 300.0, 300.0 };
+    const uint32_t load_ohm = 10000;
+    const int circuit_mv = 5000, clean_air_mv = 300;
+    samples = samples < 1000 ? 1000 : samples;
+    printf("ppm: RL %u ohm, Vc %d mV, clean air %d mV, %u estimates timed\n", load_ohm, circuit_mv, clean_air_mv,
+           samples);
+
+    // Table functions against libm
+    double log2_err = 0, exp2_err = 0;
+    for (uint64_t x = 1; x <= UINT32_MAX; x = x * 1.0007 + 1) {
+        double err = fabs(grove_aqs_log2_q16((uint32_t)x) - log2((double)x) * 65536.0);
+        log2_err = err > log2_err ? err : log2_err;
+    }
+    for (int32_t y = 20 << 16; y < 31 << 16; y += 37) {  // Large results: rounding stays below the error
+        double exact = exp2(y / 65536.0);
+        double err = fabs(grove_aqs_exp2_q16(y) - exact) / exact;
+        exp2_err = err > exp2_err ? err : exp2_err;
+    }
+    printf("  log2: max error %.1f LSB (Q16), exp2: max relative error %.1e\n", log2_err, exp2_err);
+
+    // Each gas: the curve through its datasheet points, fixed point against float over all voltages
+    bool monotonic = true;
+    double worst_rel = 0, worst_point = 0;
+    printf("  %-10s %8s %10s %14s %14s %12s\n", "gas", "slope", "ppm@R0", "ppm @ 1000 mV", "ppm @ 2500 mV",
+           "max vs float");
+    for (int g = 0; g < GROVE_AQS_GAS_COUNT; g++) {
+        grove_aqs_ppm_curve_t curve;
+        grove_aqs_ppm_params_t params;
+        grove_aqs_ppm_curve_get((grove_aqs_gas_t)g, &curve);
+        grove_aqs_ppm_params_init(&params, load_ohm, circuit_mv, clean_air_mv, &curve);
+
+        // Both datasheet points come back out of the fitted curve
+        for (int k = 0; k < 2; k++) {
+            double ratio = (k == 0 ? curve.min_ratio_q16 : curve.max_ratio_q16) / 65536.0;
+            double fitted = exp2(curve.log2_ppm_q16 / 65536.0 + curve.slope_q16 / 65536.0 * log2(ratio));
+            double expected = k == 0 ? datasheet_high_ppm[g] : 10.0;
+            double err = fabs(fitted - expected) / expected;
+            worst_point = err > worst_point ? err : worst_point;
+        }
+
+        double max_rel = 0;
+        uint32_t last = 0;
+        for (int mv = 1; mv < circuit_mv; mv++) {
+            grove_aqs_ppm_t est;
+            grove_aqs_ppm_estimate(&params, mv, &est);
+            double ref = ppm_float(&params, mv) * 10.0;
+            if (ref >= 100.0 && ref < 4e9) {
+                double err = (fabs(est.ppm_x10 - ref) - 0.5) / ref;  // Beyond the rounding to 0.1 ppm
+                max_rel = err > max_rel ? err : max_rel;
+            }
+            monotonic &= est.ppm_x10 >= last;
+            last = est.ppm_x10;
+        }
+        grove_aqs_ppm_t at1000, at2500;
+        grove_aqs_ppm_estimate(&params, 1000, &at1000);
+        grove_aqs_ppm_estimate(&params, 2500, &at2500);
+        printf("  %-10s %8.3f %10.2f %10.1f%s %10.1f%s %11.3f%%\n", gas_names[g], curve.slope_q16 / 65536.0,
+               exp2(curve.log2_ppm_q16 / 65536.0), at1000.ppm_x10 / 10.0, at1000.in_range ? "    " : " (x)",
+               at2500.ppm_x10 / 10.0, at2500.in_range ? "    " : " (x)", max_rel * 100.0);
+        worst_rel = max_rel > worst_rel ? max_rel : worst_rel;
+    }
+    printf("  (x): Rs/R0 outside the datasheet points, extrapolated\n");
+
+    // Rs and R0 themselves
+    grove_aqs_ppm_curve_t curve;
+    grove_aqs_ppm_params_t params;
+    grove_aqs_ppm_curve_get(GROVE_AQS_GAS_ALCOHOL, &curve);
+    grove_aqs_ppm_params_init(&params, load_ohm, circuit_mv, clean_air_mv, &curve);
+    grove_aqs_ppm_t clean;
+    grove_aqs_ppm_estimate(&params, clean_air_mv, &clean);
+    double r0 = load_ohm * (double)(circuit_mv - clean_air_mv) / clean_air_mv;
+    printf("  clean air: Rs %u ohm (exact %.0f), Rs/R0 %.4f\n", clean.rs_ohm, r0, clean.ratio_q16 / 65536.0);
+
+    // Cost per estimate against the float version
+    volatile uint32_t sink = 0;      // Keeps the loops from being optimized away
+    double t0 = now_us();
+    for (uint32_t i = 0; i < samples; i++) {
+        grove_aqs_ppm_t est;
+        grove_aqs_ppm_estimate(&params, 1 + (int)(i % 4998), &est);
+        sink += est.ppm_x10;
+    }
+    double t1 = now_us();
+    for (uint32_t i = 0; i < samples; i++) {
+        sink += (uint32_t)(ppm_float(&params, 1 + (int)(i % 4998)) * 10.0);
+    }
+    double t2 = now_us();
+    printf("  estimate: %.1f ns fixed point, %.1f ns with libm doubles\n", (t1 - t0) * 1000.0 / samples,
+           (t2 - t1) * 1000.0 / samples);
+
+    int failures = 0;
+    grove_aqs_ppm_curve_t bad;
+    failures += check(log2_err <= 4.0, "log2 within 4 LSB");
+    failures += check(exp2_err <= 2e-5, "exp2 within 2e-5");
+    failures += check(worst_point <= 0.01, "curves pass through the datasheet points");
+    failures += check(worst_rel <= 0.001, "fixed point within 0.1% of float");
+    failures += check(monotonic, "concentration rises with the output voltage");
+    failures += check(abs((int)clean.ratio_q16 - 65536) <= 16 && fabs(clean.rs_ohm - r0) <= r0 * 1e-4,
+                      "clean air reads Rs = R0");
+    failures += check(grove_aqs_ppm_curve_init(&bad, 10, 500, 100, 500) == ESP_ERR_INVALID_ARG &&
+                      grove_aqs_ppm_curve_init(&bad, 10, 1000000, 100, 1000001) == ESP_ERR_INVALID_ARG &&
+                      grove_aqs_ppm_params_init(&params, load_ohm, circuit_mv, circuit_mv, &curve) == ESP_ERR_INVALID_ARG,
+                      "degenerate curve and baseline rejected");
+    return failures == 0 ? 0 : 1;
+}
+
+/* A unit of the fleet: reads reference_mv * gain + offset at full heater power */
+typedef struct {
+    double gain;
+    double offset_mv;
+    int duty_pct;                    // 100, or the PWM heater duty it runs at
+} cal_unit_t;
+
+#define CAL_SENSITIVITY_PCT 50
+
+static int cal_unit_read(const cal_unit_t *u, double reference_mv) {
+    double full = reference_mv * u->gain + u->offset_mv + 5.0 * gauss();
+    double heater = 1.0 - CAL_SENSITIVITY_PCT / 100.0 * (1.0 - u->duty_pct / 100.0);
+    return (int)lround(full * heater);
+}
+
+/* What grove_aqs_calibrate_point() captures: the mean of some readings, heater-compensated */
+static int cal_capture(const cal_unit_t *u, int32_t heater_gain, double reference_mv, int samples) {
+    int64_t sum = 0;
+    for (int i = 0; i < samples; i++) {
+        sum += cal_unit_read(u, reference_mv);
+    }
+    return (int)(((sum / samples) * heater_gain) >> GROVE_AQS_CORE_GAIN_SHIFT);
+}
+
+static int bench_calibrate(int argc, char **argv) {
+    uint32_t units = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 200;
+    const int clean_mv = 400, reference_mv = 1500;   // Reference unit, as in Kconfig
+    const uint32_t readings = 2000;                  // Per unit, across the whole range
+    units = units < 10 ? 10 : units;
+    printf("calibrate: %u units, gain +-15%%, offset +-60 mV, half at 60%% heater duty; reference unit %d/%d mV\n",
+           units, clean_mv, reference_mv);
+
+    grove_aqs_core_params_t reference;
+    grove_aqs_core_params_init(&reference, 3300, 700, 1000, 1500, 2000);
+
+    srand(7);
+    uint32_t agree_before = 0, agree_after = 0, total = 0, rejected = 0;
+    double sq_before = 0, sq_after = 0, worst_after = 0;
+    for (uint32_t n = 0; n < units; n++) {
+        cal_unit_t u = {
+            .gain = 0.85 + 0.30 * rand() / RAND_MAX,
+            .offset_mv = -60.0 + 120.0 * rand() / RAND_MAX,
+            .duty_pct = n % 2 ? 60 : 100,
+        };
+        int32_t heater_gain = u.duty_pct < 100 ? grove_aqs_core_heater_gain(u.duty_pct, CAL_SENSITIVITY_PCT)
+                                               : GROVE_AQS_CORE_GAIN_ONE;
+        grove_aqs_core_params_t before = reference, after = reference;
+        before.gain = heater_gain;
+
+        grove_aqs_calibration_t cal;
+        if (!grove_aqs_core_calibrate(cal_capture(&u, heater_gain, clean_mv, 16),
+                                      cal_capture(&u, heater_gain, reference_mv, 16), clean_mv, reference_mv, &cal)) {
+            rejected++;
+            continue;
+        }
+        grove_aqs_core_set_calibration(&after, heater_gain, &cal);
+
+        for (uint32_t r = 0; r < readings; r++) {
+            double truth_mv = 200.0 + 2300.0 * r / readings;
+            int mv = cal_unit_read(&u, truth_mv);
+            int b = grove_aqs_core_compensate(&before, mv);
+            int a = grove_aqs_core_compensate(&after, mv);
+            grove_aqs_quality_t expected = grove_aqs_core_classify(&reference, (int)lround(truth_mv));
+            agree_before += grove_aqs_core_classify(&before, b) == expected;
+            agree_after += grove_aqs_core_classify(&after, a) == expected;
+            sq_before += (b - truth_mv) * (b - truth_mv);
+            sq_after += (a - truth_mv) * (a - truth_mv);
+            worst_after = fabs(a - truth_mv) > worst_after ? fabs(a - truth_mv) : worst_after;
+            total++;
+        }
+    }
+    printf("  %-14s %12s %12s\n", "", "error rms", "same level");
+    printf("  %-14s %9.1f mV %11.1f%%\n", "uncalibrated", sqrt(sq_before / total), 100.0 * agree_before / total);
+    printf("  %-14s %9.1f mV %11.1f%%   (worst %.0f mV)\n", "calibrated", sqrt(sq_after / total),
+           100.0 * agree_after / total, worst_after);
+
+    // Per-sample cost of the correction folded into the heater gain
+    grove_aqs_core_params_t params = reference;
+    grove_aqs_calibration_t cal = { .gain = 4400, .offset_mv = -25 };
+    grove_aqs_core_set_calibration(&params, grove_aqs_core_heater_gain(60, CAL_SENSITIVITY_PCT), &cal);
+    const uint32_t samples = 20000000;
+    volatile uint32_t sink = 0;      // Keeps the loop from being optimized away
+    uint32_t acc = 0;
+    double t0 = now_us();
+    for (uint32_t i = 0; i < samples; i++) {
+        acc += grove_aqs_core_classify(&params, grove_aqs_core_compensate(&params, (int)(i & 0xfff)));
+    }
+    double t1 = now_us();
+    sink += acc;
+    printf("  per sample: %.2f ns for correction and classification\n", (t1 - t0) * 1000.0 / samples);
+
+    int failures = 0;
+    grove_aqs_calibration_t bad;
+    failures += check(rejected == 0, "every unit calibrated");
+    failures += check(sqrt(sq_after / total) < 8.0, "calibrated error within noise");
+    failures += check(agree_after > agree_before && 100.0 * agree_after / total >= 98.0, "calibrated levels agree");
+    failures += check(!grove_aqs_core_calibrate(700, 700, clean_mv, reference_mv, &bad) &&
+                      !grove_aqs_core_calibrate(400, 800, clean_mv, reference_mv, &bad) &&
+                      !grove_aqs_core_calibrate(1500, 400, clean_mv, reference_mv, &bad),
+                      "degenerate captures rejected");
+    return failures == 0 ? 0 : 1;
+}
+
+/* Appends a section the parser does not know and reseals the blob */
+static size_t config_add_unknown(uint32_t *blob, size_t size) {
+    uint8_t *bytes = (uint8_t *)blob;
+    grove_aqs_config_section_t section = { .tag = 0x7fff, .size = 5 };
+    memcpy(bytes + size, &section, sizeof(section));
+    memcpy(bytes + size + sizeof(section), "later", 5);
+    memset(bytes + size + sizeof(section) + 5, 0, 3);
+    size += sizeof(section) + 8;
+
+    grove_aqs_config_blob_header_t *header = (grove_aqs_config_blob_header_t *)blob;
+    header->section_count++;
+    header->size = (uint32_t)size;
+    header->crc32 = classify_crc32(bytes + sizeof(*header), size - sizeof(*header));
+    return size;
+}
+
+static int bench_config(int argc, char **argv) {
+    uint32_t iterations = argc > 0 ? (uint32_t)strtoul(argv[0], NULL, 0) : 10000000;
+    grove_aqs_config_classify_t classify = {
+        .thresholds = {620, 1080, 1420, 2150},
+        .hysteresis_mv = 20,
+        .filter_shift = 2,
+    };
+    grove_aqs_calibration_t cal = { .gain = 4300, .offset_mv = -35 };
+    grove_aqs_config_blob_t sections = { .classify = &classify, .calibration = &cal };
+
+    uint32_t blob[32];
+    uint32_t copy[32];
+    size_t size;
+    esp_err_t ret = grove_aqs_config_blob_write(&sections, 42, blob, sizeof(blob), &size);
+    size_t needed;
+    esp_err_t short_ret = grove_aqs_config_blob_write(&sections, 42, copy, size - 1, &needed);
+    printf("config: %zu byte blob with classification and calibration sections\n", size);
+
+    int failures = 0;
+    failures += check(ret == ESP_OK, "blob written");
+    failures += check(short_ret == ESP_ERR_INVALID_SIZE && needed == size, "short buffer reports the size needed");
+
+    grove_aqs_config_blob_t parsed;
+    ret = grove_aqs_config_blob_parse(blob, size, &parsed);
+    failures += check(ret == ESP_OK && parsed.header->sequence == 42, "blob parsed");
+    failures += check(ret == ESP_OK && (const void *)parsed.classify > (const void *)blob &&
+                      (const uint8_t *)parsed.calibration < (const uint8_t *)blob + size,
+                      "sections point into the blob");
+    failures += check(ret == ESP_OK && memcmp(parsed.classify, &classify, sizeof(classify)) == 0 &&
+                      memcmp(parsed.calibration, &cal, sizeof(cal)) == 0, "values round trip");
+
+    // Every flipped bit after the header is caught by the CRC
+    uint32_t missed = 0;
+    for (size_t bit = sizeof(grove_aqs_config_blob_header_t) * 8; bit < size * 8; bit++) {
+        memcpy(copy, blob, size);
+        ((uint8_t *)copy)[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        missed += grove_aqs_config_blob_parse(copy, size, &parsed) != ESP_ERR_INVALID_CRC;
+    }
+    failures += check(missed == 0, "corrupted blobs rejected");
+    failures += check(grove_aqs_config_blob_parse(blob, size - 4, &parsed) == ESP_ERR_INVALID_SIZE,
+                      "truncated blob rejected");
+    memcpy(copy, blob, size);
+    ((grove_aqs_config_blob_header_t *)copy)->version++;
+    failures += check(grove_aqs_config_blob_parse(copy, size, &parsed) == ESP_ERR_INVALID_VERSION,
+                      "other version rejected");
+
+    grove_aqs_config_classify_t unordered = classify;
+    unordered.thresholds[2] = unordered.thresholds[1];
+    grove_aqs_config_blob_t invalid = { .classify = &unordered };
+    grove_aqs_config_blob_write(&invalid, 1, copy, sizeof(copy), &needed);
+    failures += check(grove_aqs_config_blob_parse(copy, needed, &parsed) == ESP_ERR_INVALID_ARG,
+                      "unordered thresholds rejected");
+    grove_aqs_calibration_t steep = { .gain = 3 * GROVE_AQS_CORE_GAIN_ONE, .offset_mv = 0 };
+    invalid = (grove_aqs_config_blob_t){ .calibration = &steep };
+    grove_aqs_config_blob_write(&invalid, 1, copy, sizeof(copy), &needed);
+    failures += check(grove_aqs_config_blob_parse(copy, needed, &parsed) == ESP_ERR_INVALID_ARG,
+                      "calibration gain out of range rejected");
+
+    memcpy(copy, blob, size);
+    size_t extended = config_add_unknown(copy, size);
+    failures += check(grove_aqs_config_blob_parse(copy, extended, &parsed) == ESP_OK &&
+                      parsed.classify != NULL && parsed.calibration != NULL, "unknown section skipped");
+
+    // Parsing is validation only: nothing is copied out of the blob
+    volatile uint32_t sink = 0;      // Keeps the loop from being optimized away
+    uint32_t acc = 0;
+    double t0 = now_us();
+    for (uint32_t i = 0; i < iterations; i++) {
+        grove_aqs_config_blob_parse(blob, size, &parsed);
+        acc += (uint32_t)parsed.classify->thresholds[0];
+    }
+    double t1 = now_us();
+    sink += acc;
+    printf("  parse and validate: %.1f ns per blob\n", (t1 - t0) * 1000.0 / iterations);
+    return failures == 0 ? 0 : 1;
+}
+
+/* Readings against presets that are selected, redefined and rebased under them */
+#define PRESET_VARIANTS 4
+
+typedef struct {
+    grove_aqs_live_params_t live;
+    grove_aqs_preset_t presets[2];
+    int thresholds[PRESET_VARIANTS][GROVE_AQS_QUALITY_LEVEL_COUNT - 1]; /* Every threshold set written */
+    grove_aqs_calibration_t corrections[2];  /* Every gain and offset written */
+    volatile int32_t inplace[GROVE_AQS_QUALITY_LEVEL_COUNT + 1]; /* Same values, rewritten in place */
+    atomic_bool stop;
+    uint32_t readings;
+    uint32_t torn_live;
+    uint32_t torn_inplace;
+} preset_race_t;
+
+/* Thresholds, then gain and offset, as read one by one; a concurrent rewrite shows up as a mix */
+static bool preset_consistent(const preset_race_t *race, const int32_t *read) {
+    bool thresholds = false;
+    for (int v = 0; v < PRESET_VARIANTS; v++) {
+        bool match = true;
+        for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+            match &= read[t] == race->thresholds[v][t];
+        }
+        thresholds |= match;
+    }
+    bool correction = false;
+    for (int c = 0; c < 2; c++) {
+        correction |= read[GROVE_AQS_QUALITY_LEVEL_COUNT - 1] == race->corrections[c].gain &&
+                      read[GROVE_AQS_QUALITY_LEVEL_COUNT] == race->corrections[c].offset_mv;
+    }
+    return thresholds && correction;
+}
+
+static void *preset_reader(void *arg) {
+    preset_race_t *race = arg;
+    int32_t read[GROVE_AQS_QUALITY_LEVEL_COUNT + 1];
+    while (!atomic_load(&race->stop)) {
+        // Preempted after every field, so a reading spans several writer steps as it may while converting
+        const volatile grove_aqs_core_params_t *params = grove_aqs_live_acquire(&race->live);
+        for (int i = 0; i < GROVE_AQS_QUALITY_LEVEL_COUNT + 1; i++) {
+            read[i] = i < GROVE_AQS_QUALITY_LEVEL_COUNT - 1 ? params->thresholds[i]
+                      : i == GROVE_AQS_QUALITY_LEVEL_COUNT - 1 ? params->gain : params->offset_mv;
+            sched_yield();
+        }
+        grove_aqs_live_release(&race->live);
+        race->torn_live += !preset_consistent(race, read);
+
+        for (int i = 0; i < GROVE_AQS_QUALITY_LEVEL_COUNT + 1; i++) {
+            read[i] = race->inplace[i];
+            sched_yield();
+        }
+        race->torn_inplace += !preset_consistent(race, read);
+        race->readings++;
+    }
+    return NULL;
+}
+
+/* One writer step, picked at random: select, define, rebase or publish, as the driver's API calls do */
+static void preset_race_step(preset_race_t *race) {
+    int index = rand() % 2;
+    grove_aqs_core_params_t params = *grove_aqs_live_current(&race->live);
+    switch (rand() % 4) {
+        case 0:
+            grove_aqs_live_switch(&race->live, &race->presets[index].params);
+            break;
+        case 1:
+            memcpy(params.thresholds, race->thresholds[rand() % PRESET_VARIANTS], sizeof(params.thresholds));
+            grove_aqs_live_rewrite(&race->live, &race->presets[index].params, &params);
+            break;
+        case 2:
+            params.gain = race->corrections[index].gain;
+            params.offset_mv = race->corrections[index].offset_mv;
+            if (!grove_aqs_preset_rebase(&race->live, race->presets, 2, &params)) {
+                grove_aqs_live_publish(&race->live, &params);
+            }
+            break;
+        default:
+            memcpy(params.thresholds, race->thresholds[rand() % PRESET_VARIANTS], sizeof(params.thresholds));
+            grove_aqs_live_publish(&race->live, &params);
+            break;
+    }
+    const grove_aqs_core_params_t *current = grove_aqs_live_current(&race->live);
+    for (int t = 0; t < GROVE_AQS_QUALITY_LEVEL_COUNT - 1; t++) {
+        race->inplace[t] = current->thresholds[t];
+    }
+    race->inplace[GROVE_AQS_QUALITY_LEVEL_COUNT - 1] = current->gain;
+    race->inplace[GROVE_AQS_QUALITY_LEVEL_COUNT] = current->offset_mv;
+}
+
+/* Random schedule of 1 to GROVE_AQS_SCHEDULE_MAX entries */
+static void preset_random_schedule(grove_aqs_schedule_t *schedule) {
+    memset(schedule, 0, sizeof(*schedule));
+    int count = 1 + rand() % GROVE_AQS_SCHEDULE_MAX;
+    for (int e = 0; e < count; e++) {
+        uint8_t days = (uint8_t)(1 + rand() % GROVE_AQS_SCHEDULE_EVERY_DAY);
+        grove_aqs_schedule_add(schedule, days, (uint8_t)(rand() % 24), (uint8_t)(rand() % 60),
+                               (uint8_t)(rand() % CONFIG_GROVE_AQS_PRESET_COUNT));
+    }
+}
+
+static int bench_preset(int argc, char **argv) {
+    uint32_t weeks = argc > 0 ? ((uint32_t)strtoul(argv[0], NULL, 0) + 6) / 7 : 200;
+    const int week_minutes = 7 * GROVE_AQS_SCHEDULE_MINUTES_PER_DAY;
+    srand(1);
+
+    // Replay two weeks minute by minute, switching at every entry, and compare the second
+    uint32_t mismatches = 0;
+    uint64_t lookups = 0;
+    for (uint32_t w = 0; w < weeks; w++) {
+        grove_aqs_schedule_t schedule;
+        preset_random_schedule(&schedule);
+        int current = -1;
+        for (int t = 0; t < 2 * week_minutes; t++) {
+            uint8_t day = (uint8_t)(t / GROVE_AQS_SCHEDULE_MINUTES_PER_DAY % 7);
+            uint16_t minute = (uint16_t)(t % GROVE_AQS_SCHEDULE_MINUTES_PER_DAY);
+            for (uint8_t e = 0; e < schedule.count; e++) {
+                if ((schedule.entries[e].days & (1u << day)) && schedule.entries[e].minute == minute) {
+                    current = schedule.entries[e].preset;
+                }
+            }
+            if (t >= week_minutes) {
+                mismatches += grove_aqs_schedule_lookup(&schedule, day, minute) != current;
+                lookups++;
+            }
+        }
+    }
+    printf("preset: %u random weekly schedules, %llu minutes compared\n", weeks, (unsigned long long)lookups);
+
+    int failures = 0;
+    failures += check(mismatches == 0, "lookup matches the replay");
+
+    grove_aqs_schedule_t schedule = { 0 };
+    grove_aqs_schedule_add(&schedule, GROVE_AQS_SCHEDULE_WEEKDAYS, 8, 0, 1);
+    grove_aqs_schedule_add(&schedule, GROVE_AQS_SCHEDULE_EVERY_DAY, 22, 30, 2);
+    failures += check(grove_aqs_schedule_lookup(&schedule, 1, 2 * 60) == 2, "evening entry holds past midnight");
+    failures += check(grove_aqs_schedule_lookup(&schedule, 6, 12 * 60) == 2, "weekday entry skipped on the weekend");
+    failures += check(grove_aqs_schedule_lookup(&schedule, 3, 8 * 60) == 1, "entry applies from its start minute");
+    grove_aqs_schedule_t empty = { 0 };
+    failures += check(grove_aqs_schedule_lookup(&empty, 0, 0) == -1, "empty schedule selects nothing");
+    failures += check(grove_aqs_schedule_add(&empty, 0, 8, 0, 0) == ESP_ERR_INVALID_ARG &&
+                      grove_aqs_schedule_add(&empty, 0x80, 8, 0, 0) == ESP_ERR_INVALID_ARG &&
+                      grove_aqs_schedule_add(&empty, 1, 24, 0, 0) == ESP_ERR_INVALID_ARG &&
+                      grove_aqs_schedule_add(&empty, 1, 8, 60, 0) == ESP_ERR_INVALID_ARG &&
+                      grove_aqs_schedule_add(&empty, 1, 8, 0, CONFIG_GROVE_AQS_PRESET_COUNT) == ESP_ERR_INVALID_ARG &&
+                      empty.count == 0, "invalid entries rejected");
+    for (int e = 0; e < GROVE_AQS_SCHEDULE_MAX; e++) {
+        grove_aqs_schedule_add(&empty, 1, 0, (uint8_t)e, 0);
+    }
+    failures += check(grove_aqs_schedule_add(&empty, 1, 1, 0, 0) == ESP_ERR_NO_MEM, "full schedule rejected");
+
+    grove_aqs_preset_t presets[CONFIG_GROVE_AQS_PRESET_COUNT] = {
+        { .name = "occupied" },
+        { .name = "unoccupied" },
+    };
+    failures += check(grove_aqs_preset_find(presets, CONFIG_GROVE_AQS_PRESET_COUNT, "unoccupied") == 1 &&
+                      grove_aqs_preset_find(presets, CONFIG_GROVE_AQS_PRESET_COUNT, "lab") == -1 &&
+                      grove_aqs_preset_find(presets, CONFIG_GROVE_AQS_PRESET_COUNT, "") == -1,
+                      "presets found by name");
+
+    volatile int sink = 0;           // Keeps the loops from being optimized away
+    grove_aqs_schedule_t full;
+    preset_random_schedule(&full);
+    while (full.count < GROVE_AQS_SCHEDULE_MAX) {
+        grove_aqs_schedule_add(&full, GROVE_AQS_SCHEDULE_WEEKDAYS, (uint8_t)(rand() % 24), 0, 0);
+    }
+    double t0 = now_us();
+    for (int t = 0; t < week_minutes; t++) {
+        sink += grove_aqs_schedule_lookup(&full, (uint8_t)(t / GROVE_AQS_SCHEDULE_MINUTES_PER_DAY),
+                                          (uint16_t)(t % GROVE_AQS_SCHEDULE_MINUTES_PER_DAY));
+    }
+    double t1 = now_us();
+    printf("  lookup with %d entries: %.1f ns\n", GROVE_AQS_SCHEDULE_MAX, (t1 - t0) * 1000.0 / week_minutes);
+
+    // Selecting a derived preset, against deriving the same constants and publishing them
+    static preset_race_t race = {
+        .presets = { { .name = "occupied" }, { .name = "unoccupied" } },
+        .thresholds = { {400, 1000, 1500, 2000}, {500, 1100, 1600, 2100}, {450, 900, 1400, 2200},
+                        {600, 1200, 1800, 2500} },
+        .corrections = { { .gain = 5310, .offset_mv = -35 }, { .gain = 4920, .offset_mv = 12 } },
+    };
+    const uint32_t switches = 10000000;
+    grove_aqs_calibration_t cal = { .gain = 4300, .offset_mv = -35 };
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, 3300, 400, 1000, 1500, 2000);
+    grove_aqs_live_init(&race.live, &params);
+    for (int i = 0; i < 2; i++) {
+        const int *t = race.thresholds[i];
+        grove_aqs_core_params_init(&race.presets[i].params, 3300, t[0], t[1], t[2], t[3]);
+        grove_aqs_core_set_calibration(&race.presets[i].params, grove_aqs_core_heater_gain(60, 35), &cal);
+    }
+    t0 = now_us();
+    for (uint32_t i = 0; i < switches; i++) {
+        grove_aqs_live_switch(&race.live, &race.presets[i & 1].params);
+        sink += grove_aqs_live_current(&race.live)->thresholds[0];
+    }
+    t1 = now_us();
+    for (uint32_t i = 0; i < switches; i++) {
+        const int *t = race.thresholds[i & 1];
+        grove_aqs_core_params_init(&params, 3300, t[0], t[1], t[2], t[3]);
+        grove_aqs_core_set_calibration(&params, grove_aqs_core_heater_gain(60, 35), &cal);
+        grove_aqs_live_publish(&race.live, &params);
+    }
+    double t2 = now_us();
+    for (uint32_t i = 0; i < switches; i++) {
+        sink += grove_aqs_live_acquire(&race.live)->thresholds[0];
+        grove_aqs_live_release(&race.live);
+    }
+    double t3 = now_us();
+    failures += check(memcmp(&params, &race.presets[1].params, sizeof(params)) == 0,
+                      "presets hold the derived constants");
+    printf("  switch: %.1f ns selecting a preset, %.1f ns deriving and publishing; %.1f ns per reading\n",
+           (t1 - t0) * 1000.0 / switches, (t2 - t1) * 1000.0 / switches, (t3 - t2) * 1000.0 / switches);
+
+    // Every way the driver changes the constants, under a concurrent reader
+    const uint32_t steps = 400000;
+    race.corrections[0] = (grove_aqs_calibration_t){ .gain = params.gain, .offset_mv = params.offset_mv };
+    grove_aqs_live_init(&race.live, &race.presets[0].params);
+    grove_aqs_live_switch(&race.live, &race.presets[0].params);
+    preset_race_step(&race);
+    pthread_t reader;
+    pthread_create(&reader, NULL, preset_reader, &race);
+    for (uint32_t i = 0; i < steps; i++) {
+        preset_race_step(&race);
+        sched_yield();               // Interleaves with the reader also on a single core
+    }
+    atomic_store(&race.stop, true);
+    pthread_join(reader, NULL);
+    failures += check(race.torn_live == 0, "no reading mixes two sets of constants");
+    printf("  %u readings during %u selects, defines, rebases and publishes: %u mixed, %u rewriting in place\n",
+           race.readings, steps, race.torn_live, race.torn_inplace);
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "core") == 0) {
+        return bench_core(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "journal") == 0) {
+        return bench_journal(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "boot") == 0) {
+        return bench_boot();
+    }
+    if (argc >= 2 && strcmp(argv[1], "query") == 0) {
+        return bench_query(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "mmap") == 0) {
+        return bench_mmap(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "dlog") == 0) {
+        return bench_dlog(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "trace") == 0) {
+        return bench_trace(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "retain") == 0) {
+        return bench_retain(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "wake") == 0) {
+        return bench_wake(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "energy") == 0) {
+        return bench_energy(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "heater") == 0) {
+        return bench_heater(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "profile") == 0) {
+        return bench_profile(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "lockin") == 0) {
+        return bench_lockin(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "classify") == 0) {
+        return bench_classify(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "ppm") == 0) {
+        return bench_ppm(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "calibrate") == 0) {
+        return bench_calibrate(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "config") == 0) {
+        return bench_config(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && strcmp(argv[1], "preset") == 0) {
+        return bench_preset(argc - 2, argv + 2);
+    }
+    fprintf(stderr, "usage: %s core [samples] | journal [samples] [sectors] | boot | query [sectors] | mmap [sectors]"
+            " | dlog [lines] [file] | trace [samples] [out.json] | retain [iterations] | wake [days]"
+            " | energy [days] | heater [samples] | profile [cycles] | lockin [trials]"
+             " | classify [windows] [model.bin] | ppm [samples] | calibrate [units] | config [iterations]"
+            " | preset [days]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file aqs_dlog_decode.c
+ * @brief Linux decoder for binary deferred log streams
+ *
+ * Usage: aqs_dlog_decode [file]
+ *
+ * Reads a stream (a grove_aqs_dlog_stream_header_t followed by
+ * grove_aqs_dlog_record_t records, as written by a sink calling
+ * grove_aqs_dlog_drain()) from the file or stdin and prints one line per
+ * record. The site table is the one generated from this source tree, so the
+ * stream must come from firmware built from the same sources.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+// Before any include of the table, which is include-guarded
+#define GROVE_AQS_DLOG_TABLE_STRINGS
+#include "grove_aqs_dlog.h"
+#include "grove_aqs_dlog_table.h"
+
+int main(int argc, char **argv) {
+    FILE *in = stdin;
+    if (argc >= 2) {
+        in = fopen(argv[1], "rb");
+        if (in == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    grove_aqs_dlog_stream_header_t header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || header.magic != GROVE_AQS_DLOG_STREAM_MAGIC) {
+        fprintf(stderr, "not a deferred log stream\n");
+        return 1;
+    }
+    if (header.version != GROVE_AQS_DLOG_STREAM_VERSION ||
+        header.record_size != sizeof(grove_aqs_dlog_record_t)) {
+        fprintf(stderr, "unsupported stream version %u (record size %u)\n",
+                header.version, header.record_size);
+        return 1;
+    }
+    if (header.table_hash != GROVE_AQS_DLOG_TABLE_HASH) {
+        fprintf(stderr, "stream was written with log table %08" PRIx32 ", this decoder has %08x\n",
+                header.table_hash, GROVE_AQS_DLOG_TABLE_HASH);
+        return 1;
+    }
+
+    grove_aqs_dlog_record_t record;
+    char line[256];
+    while (fread(&record, sizeof(record), 1, in) == 1) {
+        if (grove_aqs_dlog_format(&record, line, sizeof(line)) < 0) {
+            printf("%c (%" PRIu32 ") <unknown id %u>\n", record.level, record.timestamp_us, record.id);
+            continue;
+        }
+        printf("%c (%" PRIu32 ") %s: %s\n", record.level, record.timestamp_us,
+               grove_aqs_dlog_sites[record.id].name, line);
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
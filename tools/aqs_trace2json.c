@@ -0,0 +1,56 @@
+/**
+ * @file aqs_trace2json.c
+ * @brief Convert a raw trace dump (as sent by grove_aqs_trace_send_apptrace()) to Chrome trace JSON
+ *
+ * Usage: aqs_trace2json <dump> [out.json]
+ *
+ * The result opens in chrome://tracing or https://ui.perfetto.dev.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "grove_aqs_trace.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <dump> [out.json]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    grove_aqs_trace_dump_header_t header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || header.magic != GROVE_AQS_TRACE_DUMP_MAGIC) {
+        fprintf(stderr, "%s: not a trace dump\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    grove_aqs_trace_event_t *events = malloc((header.count ? header.count : 1) * sizeof(*events));
+    if (events == NULL) {
+        fclose(in);
+        return 1;
+    }
+    size_t count = fread(events, sizeof(*events), header.count, in);
+    fclose(in);
+    if (count < header.count) {
+        fprintf(stderr, "%s: truncated, %zu of %u events\n", argv[1], count, (unsigned)header.count);
+    }
+
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        perror(argv[2]);
+        free(events);
+        return 1;
+    }
+    grove_aqs_trace_write_json(out, events, count);
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(events);
+    return 0;
+}
@@ -0,0 +1,454 @@
+/**
+ * @file aqs_tune.c
+ * @brief Host (Linux) search for classification thresholds, hysteresis and smoothing from labelled traces
+ *
+ * Usage: aqs_tune [-j threads] [-o out.defaults] [-b out.bin] [-n sequence] [-s step_mv] [-H max_hysteresis_mv]
+ *                 trace.csv...
+ *        aqs_tune [options] synthetic [samples]
+ *
+ * A trace is a CSV file with one sample per line, "voltage_mv,level" or
+ * "timestamp_ms,voltage_mv,level", in sample order. The level is 0-4 or
+ * the name grove_aqs_quality_to_string() gives it; lines whose voltage
+ * does not parse (headers, comments) are skipped. Each file is replayed
+ * from a fresh filter state.
+ *
+ * Every combination of filter shift (0-GROVE_AQS_CORE_FILTER_SHIFT_MAX)
+ * and hysteresis (0 to max_hysteresis_mv in 20 mV steps) is a job; the
+ * jobs run on all cores. A job searches the four thresholds by coordinate
+ * descent, first in 100 mV and then in step_mv steps, scoring each
+ * candidate by replaying the traces through grove_aqs_core_track(), the
+ * decision the driver makes. The best result (most samples on their
+ * label, then fewest level changes) is written as an sdkconfig.defaults
+ * fragment and, with -b, as a config blob for grove_aqs_apply_config().
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "grove_aqs_config_blob.h"
+#include "grove_aqs_core.h"
+
+#define THRESHOLD_COUNT (GROVE_AQS_QUALITY_LEVEL_COUNT - 1)
+#define VOLTAGE_MAX_MV 3300
+#define COARSE_STEP_MV 100
+#define HYSTERESIS_STEP_MV 20
+
+/* Kconfig defaults, the starting point of every job and the baseline of the report */
+static const int default_thresholds[THRESHOLD_COUNT] = {700, 1000, 1500, 2000};
+
+typedef struct {
+    int16_t *mv;
+    uint8_t *label;
+    size_t count;
+} trace_t;
+
+typedef struct {
+    int thresholds[THRESHOLD_COUNT];
+    int hysteresis_mv;
+    uint8_t filter_shift;
+    size_t correct;
+    size_t changes;                  // Level changes, the flicker hysteresis and smoothing remove
+} result_t;
+
+typedef struct {
+    const trace_t *traces;
+    size_t trace_count;
+    int step_mv;
+    result_t *results;
+    size_t job_count;
+    atomic_size_t next_job;
+} search_t;
+
+/* ---- Traces ---- */
+
+static bool parse_level(const char *s, uint8_t *level) {
+    while (*s == ' ' || *s == '"') {
+        s++;
+    }
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end != s) {
+        if (v < 0 || v >= GROVE_AQS_QUALITY_LEVEL_COUNT) {
+            return false;
+        }
+        *level = (uint8_t)v;
+        return true;
+    }
+    size_t len = strcspn(s, "\"\r\n");
+    for (int q = 0; q < GROVE_AQS_QUALITY_LEVEL_COUNT; q++) {
+        const char *name = grove_aqs_quality_to_string((grove_aqs_quality_t)q);
+        if (strlen(name) == len && strncasecmp(s, name, len) == 0) {
+            *level = (uint8_t)q;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool trace_append(trace_t *trace, size_t *capacity, int mv, uint8_t label) {
+    if (trace->count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 4096;
+        int16_t *mvs = realloc(trace->mv, *capacity * sizeof(*mvs));
+        if (mvs == NULL) {
+            return false;
+        }
+        trace->mv = mvs;
+        uint8_t *labels = realloc(trace->label, *capacity * sizeof(*labels));
+        if (labels == NULL) {
+            return false;
+        }
+        trace->label = labels;
+    }
+    trace->mv[trace->count] = (int16_t)(mv < 0 ? 0 : mv > INT16_MAX ? INT16_MAX : mv);
+    trace->label[trace->count] = label;
+    trace->count++;
+    return true;
+}
+
+static int trace_load(const char *path, trace_t *trace) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+    memset(trace, 0, sizeof(*trace));
+    size_t capacity = 0;
+    size_t skipped = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char *fields[3];
+        int n = 0;
+        for (char *p = line; n < 3; p++) {
+            fields[n++] = p;
+            p = strchr(p, ',');
+            if (p == NULL) {
+                break;
+            }
+        }
+        if (n < 2) {
+            continue;
+        }
+        const char *mv_field = fields[n - 2];
+        char *end;
+        long mv = strtol(mv_field, &end, 10);
+        uint8_t label;
+        if (end == mv_field || !parse_level(fields[n - 1], &label)) {
+            skipped++;
+            continue;
+        }
+        if (!trace_append(trace, &capacity, (int)mv, label)) {
+            fclose(in);
+            return 1;
+        }
+    }
+    fclose(in);
+    if (trace->count == 0) {
+        fprintf(stderr, "%s: no labelled samples\n", path);
+        return 1;
+    }
+    fprintf(stderr, "%s: %zu samples, %zu lines skipped\n", path, trace->count, skipped);
+    return 0;
+}
+
+static double gauss(void) {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* Gas level that settles towards a new target every few minutes, labelled
+ * by thresholds unlike the defaults and measured with noise and spikes */
+static int trace_synthetic(size_t samples, trace_t *trace) {
+    static const int true_thresholds[THRESHOLD_COUNT] = {620, 1080, 1420, 2150};
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, VOLTAGE_MAX_MV, true_thresholds[0], true_thresholds[1],
+                               true_thresholds[2], true_thresholds[3]);
+    memset(trace, 0, sizeof(*trace));
+    size_t capacity = 0;
+    srand(1);
+    double level_mv = 400;
+    double target_mv = 400;
+    for (size_t i = 0; i < samples; i++) {
+        if (i % 300 == 0) {
+            target_mv = 250 + rand() % 2600;
+        }
+        level_mv += (target_mv - level_mv) / 40;
+        double measured = level_mv + 90 * gauss() + (rand() % 100 == 0 ? 600 : 0);
+        uint8_t label = (uint8_t)grove_aqs_core_classify(&params, (int)lround(level_mv));
+        if (!trace_append(trace, &capacity, (int)lround(measured), label)) {
+            return 1;
+        }
+    }
+    fprintf(stderr, "synthetic: %zu samples, labelled at %d/%d/%d/%d mV\n", samples, true_thresholds[0],
+            true_thresholds[1], true_thresholds[2], true_thresholds[3]);
+    return 0;
+}
+
+/* ---- Search ---- */
+
+static void evaluate(const search_t *search, result_t *r) {
+    grove_aqs_core_params_t params;
+    grove_aqs_core_params_init(&params, VOLTAGE_MAX_MV, r->thresholds[0], r->thresholds[1], r->thresholds[2],
+                               r->thresholds[3]);
+    params.hysteresis_mv = r->hysteresis_mv;
+    params.filter_shift = r->filter_shift;
+
+    r->correct = 0;
+    r->changes = 0;
+    for (size_t t = 0; t < search->trace_count; t++) {
+        const trace_t *trace = &search->traces[t];
+        grove_aqs_core_track_t track = {0};
+        grove_aqs_quality_t previous = GROVE_AQS_QUALITY_FRESH;
+        for (size_t i = 0; i < trace->count; i++) {
+            grove_aqs_quality_t level = grove_aqs_core_track(&params, &track, trace->mv[i]);
+            r->correct += level == trace->label[i];
+            r->changes += i > 0 && level != previous;
+            previous = level;
+        }
+    }
+}
+
+static bool better(const result_t *a, const result_t *b) {
+    return a->correct > b->correct || (a->correct == b->correct && a->changes < b->changes);
+}
+
+/* Best value of one threshold between its neighbours, on a grid of step_mv */
+static bool sweep(const search_t *search, result_t *best, int index, int lo, int hi, int step_mv) {
+    int floor_mv = index > 0 ? best->thresholds[index - 1] + 1 : 0;
+    int ceil_mv = index < THRESHOLD_COUNT - 1 ? best->thresholds[index + 1] - 1 : VOLTAGE_MAX_MV;
+    lo = lo < floor_mv ? floor_mv : lo;
+    hi = hi > ceil_mv ? ceil_mv : hi;
+
+    bool improved = false;
+    result_t candidate = *best;
+    for (int mv = lo; mv <= hi; mv += step_mv) {
+        candidate.thresholds[index] = mv;
+        evaluate(search, &candidate);
+        if (better(&candidate, best)) {
+            *best = candidate;
+            improved = true;
+        }
+    }
+    return improved;
+}
+
+static void search_job(const search_t *search, result_t *r) {
+    evaluate(search, r);
+    for (int pass = 0; pass < 2; pass++) {
+        bool improved = true;
+        for (int round = 0; round < 8 && improved; round++) {
+            improved = false;
+            for (int i = 0; i < THRESHOLD_COUNT; i++) {
+                int at = r->thresholds[i];
+                if (pass == 0) {
+                    improved |= sweep(search, r, i, at % COARSE_STEP_MV, VOLTAGE_MAX_MV, COARSE_STEP_MV);
+                } else {
+                    improved |= sweep(search, r, i, at - COARSE_STEP_MV, at + COARSE_STEP_MV, search->step_mv);
+                }
+            }
+        }
+    }
+}
+
+static void *search_worker(void *arg) {
+    search_t *search = arg;
+    size_t job;
+    while ((job = atomic_fetch_add(&search->next_job, 1)) < search->job_count) {
+        search_job(search, &search->results[job]);
+    }
+    return NULL;
+}
+
+/* ---- Main ---- */
+
+static int write_fragment(const char *path, const result_t *best, const result_t *baseline, size_t samples) {
+    FILE *out = path != NULL ? fopen(path, "w") : stdout;
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+    fprintf(out, "# aqs_tune: %.2f%% of %zu labelled samples on their level (defaults %.2f%%)\n",
+            100.0 * best->correct / samples, samples, 100.0 * baseline->correct / samples);
+    fprintf(out, "CONFIG_GROVE_AQS_FRESH_THRESHOLD=%d\n", best->thresholds[0]);
+    fprintf(out, "CONFIG_GROVE_AQS_GOOD_THRESHOLD=%d\n", best->thresholds[1]);
+    fprintf(out, "CONFIG_GROVE_AQS_MODERATE_THRESHOLD=%d\n", best->thresholds[2]);
+    fprintf(out, "CONFIG_GROVE_AQS_POOR_THRESHOLD=%d\n", best->thresholds[3]);
+    fprintf(out, "CONFIG_GROVE_AQS_HYSTERESIS_MV=%d\n", best->hysteresis_mv);
+    fprintf(out, "CONFIG_GROVE_AQS_FILTER_SHIFT=%u\n", best->filter_shift);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
+
+static int write_blob(const char *path, const result_t *best, uint32_t sequence) {
+    grove_aqs_config_classify_t classify = {
+        .hysteresis_mv = best->hysteresis_mv,
+        .filter_shift = best->filter_shift,
+    };
+    for (int t = 0; t < THRESHOLD_COUNT; t++) {
+        classify.thresholds[t] = best->thresholds[t];
+    }
+    grove_aqs_config_blob_t config = { .classify = &classify };
+    uint32_t blob[64];
+    size_t size;
+    if (grove_aqs_config_blob_write(&config, sequence, blob, sizeof(blob), &size) != ESP_OK) {
+        return 1;
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+    bool ok = fwrite(blob, 1, size, out) == size;
+    ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        perror(path);
+        return 1;
+    }
+    fprintf(stderr, "%s: config blob %u, %zu bytes\n", path, (unsigned)sequence, size);
+    return 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-j threads] [-o out.defaults] [-b out.bin] [-n sequence] [-s step_mv] "
+                    "[-H max_hysteresis_mv] trace.csv... | synthetic [samples]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *out_path = NULL;
+    const char *blob_path = NULL;
+    uint32_t sequence = 1;
+    int step_mv = 10;
+    int max_hysteresis_mv = 200;
+    bool synthetic = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:o:b:n:s:H:")) != -1) {
+        switch (opt) {
+            case 'j':
+                threads = strtol(optarg, NULL, 0);
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'b':
+                blob_path = optarg;
+                break;
+            case 'n':
+                sequence = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                step_mv = (int)strtol(optarg, NULL, 0);
+                break;
+            case 'H':
+                max_hysteresis_mv = (int)strtol(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind < argc && strcmp(argv[optind], "synthetic") == 0) {
+        synthetic = true;
+        optind++;
+    }
+    if ((!synthetic && optind >= argc) || threads < 1 || step_mv < 1 || step_mv > COARSE_STEP_MV ||
+        max_hysteresis_mv < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    size_t trace_count = synthetic ? 1 : (size_t)(argc - optind);
+    trace_t *traces = calloc(trace_count, sizeof(*traces));
+    if (traces == NULL) {
+        return 1;
+    }
+    size_t samples = 0;
+    for (size_t t = 0; t < trace_count; t++) {
+        int ret = synthetic ? trace_synthetic(optind < argc ? strtoul(argv[optind], NULL, 0) : 20000, &traces[t])
+                            : trace_load(argv[optind + t], &traces[t]);
+        if (ret != 0) {
+            return ret;
+        }
+        samples += traces[t].count;
+    }
+    if (samples == 0) {
+        fprintf(stderr, "no labelled samples\n");
+        return 1;
+    }
+
+    search_t search = {
+        .traces = traces,
+        .trace_count = trace_count,
+        .step_mv = step_mv,
+        .job_count = (size_t)(GROVE_AQS_CORE_FILTER_SHIFT_MAX + 1) * (max_hysteresis_mv / HYSTERESIS_STEP_MV + 1),
+    };
+    atomic_init(&search.next_job, 0);
+    search.results = calloc(search.job_count, sizeof(*search.results));
+    if (search.results == NULL) {
+        return 1;
+    }
+    for (size_t j = 0; j < search.job_count; j++) {
+        result_t *r = &search.results[j];
+        memcpy(r->thresholds, default_thresholds, sizeof(r->thresholds));
+        r->filter_shift = (uint8_t)(j % (GROVE_AQS_CORE_FILTER_SHIFT_MAX + 1));
+        r->hysteresis_mv = (int)(j / (GROVE_AQS_CORE_FILTER_SHIFT_MAX + 1)) * HYSTERESIS_STEP_MV;
+    }
+
+    result_t baseline = {0};
+    memcpy(baseline.thresholds, default_thresholds, sizeof(baseline.thresholds));
+    evaluate(&search, &baseline);
+
+    if ((size_t)threads > search.job_count) {
+        threads = (long)search.job_count;
+    }
+    pthread_t *workers = calloc((size_t)threads, sizeof(*workers));
+    if (workers == NULL) {
+        return 1;
+    }
+    for (long w = 0; w < threads; w++) {
+        if (pthread_create(&workers[w], NULL, search_worker, &search) != 0) {
+            fprintf(stderr, "failed to start worker %ld\n", w);
+            return 1;
+        }
+    }
+    for (long w = 0; w < threads; w++) {
+        pthread_join(workers[w], NULL);
+    }
+
+    // Jobs are ordered by hysteresis, then filter shift, so ties keep the least lag
+    const result_t *best = &search.results[0];
+    for (size_t j = 1; j < search.job_count; j++) {
+        if (better(&search.results[j], best)) {
+            best = &search.results[j];
+        }
+    }
+    fprintf(stderr, "%zu jobs on %ld threads\n", search.job_count, threads);
+    fprintf(stderr, "defaults %d/%d/%d/%d mV: %.2f%%, %zu level changes\n", baseline.thresholds[0],
+            baseline.thresholds[1], baseline.thresholds[2], baseline.thresholds[3],
+            100.0 * baseline.correct / samples, baseline.changes);
+    fprintf(stderr, "best %d/%d/%d/%d mV, hysteresis %d mV, filter 2^-%u: %.2f%%, %zu level changes\n",
+            best->thresholds[0], best->thresholds[1], best->thresholds[2], best->thresholds[3], best->hysteresis_mv,
+            best->filter_shift, 100.0 * best->correct / samples, best->changes);
+
+    int ret = write_fragment(out_path, best, &baseline, samples);
+    if (ret == 0 && blob_path != NULL) {
+        ret = write_blob(blob_path, best, sequence);
+    }
+    for (size_t t = 0; t < trace_count; t++) {
+        free(traces[t].mv);
+        free(traces[t].label);
+    }
+    free(traces);
+    free(search.results);
+    free(workers);
+    return ret;
+}
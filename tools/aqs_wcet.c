@@ -0,0 +1,120 @@
+/**
+ * @file aqs_wcet.c
+ * @brief Host (Linux) worst-case execution time run of the processing path
+ *
+ * Usage: aqs_wcet [budget_ns] [iterations] [model.bin]
+ *
+ * Times the stages a driver read runs after the conversion (raw-to-mV,
+ * compensation, smoothing and hysteresis, the classifier window and, with a
+ * model from `aqs_bench classify`, inference) under the adversarial
+ * scenarios of grove_aqs_wcet_run(), prints max, p99.9 and a histogram per
+ * scenario and exits with status 1 if any operation exceeded the budget.
+ * Pin it to a quiet CPU (taskset -c N) for stable numbers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "grove_aqs_classify.h"
+#include "grove_aqs_core.h"
+#include "grove_aqs_wcet.h"
+
+/* Processing state a driver read carries from one sample to the next */
+typedef struct {
+    grove_aqs_core_params_t params;
+    grove_aqs_core_track_t track;
+    grove_aqs_window_t window;
+    const grove_aqs_model_t *model;  // NULL: thresholds only
+    int64_t timestamp_us;
+} core_ctx_t;
+
+static volatile int sink;
+
+/* Stand-in for a read on the host: the ADC result is the adversarial raw value */
+static esp_err_t core_op(void *ctx, int raw, bool fail) {
+    core_ctx_t *core = ctx;
+    if (fail) {
+        // A failed conversion returns before any processing
+        return ESP_FAIL;
+    }
+
+    // Same stages as the driver's convert_sample()
+    int mv = grove_aqs_core_raw_to_mv(&core->params, raw);
+    int classified_mv = grove_aqs_core_compensate(&core->params, mv);
+    grove_aqs_quality_t quality = grove_aqs_core_track(&core->params, &core->track, classified_mv);
+    core->timestamp_us += 1000000;
+    grove_aqs_window_push(&core->window, classified_mv, core->timestamp_us);
+    if (core->model != NULL && grove_aqs_window_full(&core->window)) {
+        int32_t features[GROVE_AQS_FEATURE_COUNT];
+        grove_aqs_model_output_t out;
+        grove_aqs_window_features(&core->window, features);
+        grove_aqs_model_infer(core->model, features, quality, &out);
+        quality = out.quality;
+    }
+    sink = (int)quality;
+    return ESP_OK;
+}
+
+/* Reads a model blob into a 4-byte aligned buffer that stays allocated */
+static int load_model(const char *path, grove_aqs_model_t *model) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint32_t *blob = size > 0 ? malloc(((size_t)size + 3) & ~(size_t)3) : NULL;
+    if (blob == NULL || fread(blob, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        free(blob);
+        return -1;
+    }
+    fclose(f);
+
+    esp_err_t ret = grove_aqs_model_load(blob, (size_t)size, model);
+    if (ret != ESP_OK) {
+        fprintf(stderr, "%s: not a model blob (%d)\n", path, ret);
+        free(blob);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static core_ctx_t core;
+    static grove_aqs_model_t model;
+    grove_aqs_core_params_init(&core.params, 3300, 700, 1000, 1500, 2000);
+    grove_aqs_window_init(&core.window, CONFIG_GROVE_AQS_CLASSIFY_WINDOW);
+
+    grove_aqs_wcet_config_t config = GROVE_AQS_WCET_DEFAULT_CONFIG();
+    config.op = core_op;
+    config.ctx = &core;
+    config.params = &core.params;
+    config.iterations = 1000000;
+    if (argc > 1) {
+        config.budget_ns = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        config.iterations = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3) {
+        if (load_model(argv[3], &model) != 0) {
+            return 2;
+        }
+        core.model = &model;
+    }
+
+    grove_aqs_wcet_result_t result;
+    esp_err_t ret = grove_aqs_wcet_run(&config, &result);
+    if (ret != ESP_OK && ret != ESP_ERR_TIMEOUT) {
+        return 2;
+    }
+    for (int s = 0; s < GROVE_AQS_WCET_SCENARIO_COUNT; s++) {
+        grove_aqs_wcet_hist_print(&result.hist[s], grove_aqs_wcet_scenario_name(s), stdout);
+    }
+    printf("worst %u ns, budget %u ns: %s\n", (unsigned)result.worst_ns, (unsigned)config.budget_ns,
+           ret == ESP_OK ? "PASS" : "FAIL");
+    return ret == ESP_OK ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+#
+# Build an ESP-IDF project once per configuration fragment in
+# tools/size_configs/ and report the flash/RAM footprint of this component.
+#
+# Usage: tools/size_report.sh <idf-project-dir> [target]
+#
+# The project must use this component. Each configuration is built in its
+# own build directory (<project>/build_size_<name>) on top of the project's
+# sdkconfig.defaults, if it has one.
+
+set -euo pipefail
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <idf-project-dir> [target]" >&2
+    exit 2
+fi
+
+project=$(cd "$1" && pwd)
+target=${2:-esp32c2}
+configs=$(cd "$(dirname "$0")/size_configs" && pwd)
+
+for fragment in "$configs"/*.defaults; do
+    name=$(basename "$fragment" .defaults)
+    build="$project/build_size_$name"
+    defaults="$fragment"
+    if [ -f "$project/sdkconfig.defaults" ]; then
+        defaults="$project/sdkconfig.defaults;$fragment"
+    fi
+
+    idf.py -C "$project" -B "$build" -D SDKCONFIG="$build/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="$defaults" set-target "$target" build > "$build.log" 2>&1 || {
+        echo "$name: build failed, see $build.log" >&2
+        exit 1
+    }
+
+    echo "== $name ($target)"
+    idf.py -C "$project" -B "$build" -D SDKCONFIG="$build/sdkconfig" size-components 2>/dev/null |
+        grep -E "Archive File|grove_analog_aqs" || echo "   (component not linked)"
+done